@@ -19,9 +19,13 @@
  *
  */
 #include <string>
+#include <map>
+#include <pthread.h>
 
 #include "k2harchive.h"
 #include "k2hdaccess.h"
+#include "k2htrans.h"
+#include "k2hashfunc.h"
 #include "k2hutil.h"
 #include "k2hdbg.h"
 
@@ -276,6 +280,12 @@ inline void k2harchive_load_init_vals(PBCOM& pBinCom, unsigned char* &byKey, uns
 	K2H_Free(byExdata);
 }
 
+inline void k2harchive_scan_next(PBCOM& pBinCom, off_t& offset)
+{
+	offset += scom_total_length(pBinCom->scom);
+	K2H_Free(pBinCom);
+}
+
 bool K2HArchive::Load(K2HShm* pShm) const
 {
 	int		fd;
@@ -324,46 +334,149 @@ bool K2HArchive::Load(K2HShm* pShm) const
 		}
 
 		// set
-		bool	CommandResult;
-		if(SCOM_SET_ALL == pBinCom->scom.type){
+		bool	CommandResult = ExecuteCommand(pShm, pBinCom, byKey, byVal, bySKey, byAttrs, byExdata, false);
+
+		// check error
+		if(!CommandResult){
+			if(isErrSkip){
+				MSG_K2HPRN("Failed loading data-set\'s type(%ld: %s), so this data-set is skipped.", pBinCom->scom.type, pBinCom->scom.szCommand);
+				continue;
+			}else{
+				ERR_K2HPRN("Failed loading data-set\'s type(%ld: %s).", pBinCom->scom.type, pBinCom->scom.szCommand);
+				result = false;
+				break;
+			}
+		}
+	}
+	k2harchive_load_init_vals(pBinCom, byKey, byVal, bySKey, byAttrs, byExdata);
+
+	// cppcheck-suppress unreadVariable
+	K2H_CLOSE(fd);
+
+	return result;
+}
+
+bool K2HArchive::ExecuteCommand(K2HShm* pShm, const BCOM* pBinCom, const unsigned char* byKey, const unsigned char* byVal, const unsigned char* bySKey, const unsigned char* byAttrs, const unsigned char* byExdata, bool is_raw) const
+{
+	if(!pShm || !pBinCom){
+		ERR_K2HPRN("Parameters wrong.");
+		return false;
+	}
+
+	bool	CommandResult;
+	if(SCOM_SET_ALL == pBinCom->scom.type){
+		if(is_raw){
+			CommandResult = pShm->BulkSet(byKey, pBinCom->scom.key_length, byVal, pBinCom->scom.val_length, bySKey, pBinCom->scom.skey_length, byAttrs, pBinCom->scom.attr_length);
+		}else{
 			CommandResult = pShm->ReplaceAll(byKey, pBinCom->scom.key_length, byVal, pBinCom->scom.val_length, bySKey, pBinCom->scom.skey_length, byAttrs, pBinCom->scom.attr_length);
+		}
 
-		}else if(SCOM_REPLACE_VAL == pBinCom->scom.type){
-			CommandResult = pShm->ReplaceValue(byKey, pBinCom->scom.key_length, byVal, pBinCom->scom.val_length);
+	}else if(SCOM_REPLACE_VAL == pBinCom->scom.type){
+		CommandResult = pShm->ReplaceValue(byKey, pBinCom->scom.key_length, byVal, pBinCom->scom.val_length);
 
-		}else if(SCOM_REPLACE_SKEY == pBinCom->scom.type){
-			CommandResult = pShm->ReplaceSubkeys(byKey, pBinCom->scom.key_length, bySKey, pBinCom->scom.skey_length);
+	}else if(SCOM_REPLACE_SKEY == pBinCom->scom.type){
+		CommandResult = pShm->ReplaceSubkeys(byKey, pBinCom->scom.key_length, bySKey, pBinCom->scom.skey_length);
 
-		}else if(SCOM_REPLACE_ATTRS == pBinCom->scom.type){
-			CommandResult = pShm->ReplaceAttrs(byKey, pBinCom->scom.key_length, byAttrs, pBinCom->scom.attr_length);
+	}else if(SCOM_REPLACE_ATTRS == pBinCom->scom.type){
+		CommandResult = pShm->ReplaceAttrs(byKey, pBinCom->scom.key_length, byAttrs, pBinCom->scom.attr_length);
 
-		}else if(SCOM_DEL_KEY == pBinCom->scom.type){
-			CommandResult = pShm->Remove(byKey, pBinCom->scom.key_length, false);
+	}else if(SCOM_DEL_KEY == pBinCom->scom.type){
+		CommandResult = pShm->Remove(byKey, pBinCom->scom.key_length, false);
 
-		}else if(SCOM_OW_VAL == pBinCom->scom.type){
-			if(!byExdata || 0UL == pBinCom->scom.exdata_length){
+	}else if(SCOM_OW_VAL == pBinCom->scom.type){
+		if(!byExdata || 0UL == pBinCom->scom.exdata_length){
+			CommandResult = false;
+		}else{
+			K2HDAccess		daccess(pShm, K2HDAccess::WRITE_ACCESS);
+			OWVAL_EXDATA	exdata;
+
+			exdata.valoffset = 0;
+			memcpy(exdata.byData, byExdata, pBinCom->scom.exdata_length);
+			if(	!daccess.Open(byKey, pBinCom->scom.key_length) ||
+				!daccess.SetWriteOffset(exdata.valoffset) ||
+				!daccess.Write(byVal, pBinCom->scom.val_length) )
+			{
 				CommandResult = false;
 			}else{
-				K2HDAccess		daccess(pShm, K2HDAccess::WRITE_ACCESS);
-				OWVAL_EXDATA	exdata;
-
-				exdata.valoffset = 0;
-				memcpy(exdata.byData, byExdata, pBinCom->scom.exdata_length);
-				if(	!daccess.Open(byKey, pBinCom->scom.key_length) ||
-					!daccess.SetWriteOffset(exdata.valoffset) ||
-					!daccess.Write(byVal, pBinCom->scom.val_length) )
-				{
-					CommandResult = false;
-				}else{
-					CommandResult = true;
-				}
+				CommandResult = true;
 			}
-		}else{	// SCOM_RENAME == pBinCom->scom.type
-			CommandResult = pShm->Rename(byKey, pBinCom->scom.key_length, byExdata, pBinCom->scom.exdata_length, byAttrs, pBinCom->scom.attr_length);
 		}
+	}else{	// SCOM_RENAME == pBinCom->scom.type
+		CommandResult = pShm->Rename(byKey, pBinCom->scom.key_length, byExdata, pBinCom->scom.exdata_length, byAttrs, pBinCom->scom.attr_length);
+	}
+	return CommandResult;
+}
 
-		// check error
-		if(!CommandResult){
+//---------------------------------------------------------
+// Parallel loading
+//---------------------------------------------------------
+// [NOTE]
+// ParallelLoad reads the archive file twice.
+// At first, it reads only the command headers and keys, and calculates
+// the record and page count for expanding all areas before loading.
+// Next, records are distributed to partitions by key index range of the
+// hash value, and each partition is loaded by one thread. Because the
+// records for the same key are in the same partition, these records are
+// loaded in order of the archive file.
+// Only the rename command is related to two keys, so all partitions are
+// loaded before the rename command, and the rename command is loaded
+// alone(as a barrier).
+// If is_raw is true, the set(all) command is loaded by K2HShm::BulkSet(),
+// it means that the transaction and attributes are not processed.
+//
+typedef struct k2harchive_load_thread_param{
+	const K2HArchive*		parchive;
+	K2HShm*					pShm;
+	int						fd;
+	const k2harcofflist_t*	poffsets;
+	bool					is_raw;
+	bool					result;
+}K2HARCLOADTHPARAM, *PK2HARCLOADTHPARAM;
+
+void* K2HArchive::LoadWorkerProc(void* param)
+{
+	PK2HARCLOADTHPARAM	pThParam = reinterpret_cast<PK2HARCLOADTHPARAM>(param);
+	if(!pThParam || !pThParam->parchive || !pThParam->poffsets){
+		ERR_K2HPRN("Parameter is wrong.");
+		pthread_exit(NULL);
+	}
+	pThParam->result = pThParam->parchive->LoadCommands(pThParam->pShm, pThParam->fd, *(pThParam->poffsets), pThParam->is_raw);
+	pthread_exit(NULL);
+	return NULL;
+}
+
+bool K2HArchive::LoadCommands(K2HShm* pShm, int fd, const k2harcofflist_t& offsets, bool is_raw) const
+{
+	bool			result = true;
+	PBCOM			pBinCom= NULL;
+	unsigned char*	byKey	= NULL;
+	unsigned char*	byVal	= NULL;
+	unsigned char*	bySKey	= NULL;
+	unsigned char*	byAttrs	= NULL;
+	unsigned char*	byExdata= NULL;
+	for(k2harcofflist_t::const_iterator iter = offsets.begin(); offsets.end() != iter; ++iter, k2harchive_load_init_vals(pBinCom, byKey, byVal, bySKey, byAttrs, byExdata)){
+		off_t	offset = *iter;
+
+		// read data(command type is already checked)
+		if(	NULL == (pBinCom = static_cast<PBCOM>(ReadFile(fd, sizeof(BCOM), offset))) ||
+			(0L < pBinCom->scom.key_length && NULL == (byKey = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.key_length, offset + pBinCom->scom.key_pos)))) ||
+			(0L < pBinCom->scom.val_length && NULL == (byVal = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.val_length, offset + pBinCom->scom.val_pos)))) ||
+			(0L < pBinCom->scom.skey_length && NULL == (bySKey = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.skey_length, offset + pBinCom->scom.skey_pos)))) ||
+			(0L < pBinCom->scom.attr_length && NULL == (byAttrs = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.attr_length, offset + pBinCom->scom.attrs_pos)))) ||
+			(0L < pBinCom->scom.exdata_length && NULL == (byExdata = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.exdata_length, offset + pBinCom->scom.exdata_pos)))) )
+		{
+			if(isErrSkip){
+				MSG_K2HPRN("Could not read data from file, skipping, so this data-set is skipped.");
+				continue;
+			}else{
+				ERR_K2HPRN("Could not read data from file.");
+				result = false;
+				break;
+			}
+		}
+
+		// set
+		if(!ExecuteCommand(pShm, pBinCom, byKey, byVal, bySKey, byAttrs, byExdata, is_raw)){
 			if(isErrSkip){
 				MSG_K2HPRN("Failed loading data-set\'s type(%ld: %s), so this data-set is skipped.", pBinCom->scom.type, pBinCom->scom.szCommand);
 				continue;
@@ -376,12 +489,405 @@ bool K2HArchive::Load(K2HShm* pShm) const
 	}
 	k2harchive_load_init_vals(pBinCom, byKey, byVal, bySKey, byAttrs, byExdata);
 
+	return result;
+}
+
+bool K2HArchive::LoadPartitions(K2HShm* pShm, int fd, k2harcpartlist_t& partitions, bool is_raw) const
+{
+	bool	result = true;
+
+	if(1 == partitions.size()){
+		// no thread
+		result = LoadCommands(pShm, fd, partitions.front(), is_raw);
+		partitions.front().clear();
+		return result;
+	}
+
+	std::vector<K2HARCLOADTHPARAM>	params(partitions.size());
+	std::vector<pthread_t>			threads;
+	std::vector<size_t>				thindex;
+	for(size_t cnt = 0; cnt < partitions.size(); ++cnt){
+		if(partitions[cnt].empty()){
+			continue;
+		}
+		params[cnt].parchive	= this;
+		params[cnt].pShm		= pShm;
+		params[cnt].fd			= fd;
+		params[cnt].poffsets	= &partitions[cnt];
+		params[cnt].is_raw		= is_raw;
+		params[cnt].result		= false;
+
+		pthread_t	tid;
+		int			ret;
+		if(0 != (ret = pthread_create(&tid, NULL, K2HArchive::LoadWorkerProc, &params[cnt]))){
+			ERR_K2HPRN("Could not create thread for loading archive file by errno(%d), so load partition(%zu) on this thread.", ret, cnt);
+			if(!LoadCommands(pShm, fd, partitions[cnt], is_raw)){
+				result = false;
+			}
+			continue;
+		}
+		threads.push_back(tid);
+		thindex.push_back(cnt);
+	}
+
+	// wait for all threads
+	for(size_t cnt = 0; cnt < threads.size(); ++cnt){
+		int	ret;
+		if(0 != (ret = pthread_join(threads[cnt], NULL))){
+			ERR_K2HPRN("Failed to wait thread exiting by errno(%d).", ret);
+			result = false;
+		}else if(!params[thindex[cnt]].result){
+			ERR_K2HPRN("Failed to load partition(%zu) in archive file.", thindex[cnt]);
+			result = false;
+		}
+	}
+
+	for(k2harcpartlist_t::iterator iter = partitions.begin(); partitions.end() != iter; ++iter){
+		iter->clear();
+	}
+	return result;
+}
+
+bool K2HArchive::ParallelLoad(K2HShm* pShm, int thread_count, bool is_raw) const
+{
+	if(!pShm || !pShm->IsAttached() || thread_count < 1){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	int	fd;
+	if(-1 == (fd = open(filepath.c_str(), O_RDONLY))){
+		ERR_K2HPRN("Could not open file(%s): errno(%d)", filepath.c_str(), errno);
+		return false;
+	}
+
+	// Scan all command headers and keys
+	typedef struct archive_record{
+		off_t		offset;
+		long		type;
+		k2h_hash_t	hash;
+	}ARCREC;
+
+	std::vector<ARCREC>	records;
+	unsigned long		page_count = 0UL;
+	PBCOM				pBinCom;
+	off_t				offset;
+	for(offset = 0L; NULL != (pBinCom = static_cast<PBCOM>(ReadFile(fd, sizeof(BCOM), offset))); k2harchive_scan_next(pBinCom, offset)){
+		// check type
+		if(pBinCom->scom.type < SCOM_TYPE_MIN || SCOM_TYPE_MAX < pBinCom->scom.type){
+			if(isErrSkip){
+				MSG_K2HPRN("Load data-set\'s type(%ld: %s) is unknown, so this data-set is skipped.", pBinCom->scom.type, pBinCom->scom.szCommand);
+				continue;
+			}else{
+				ERR_K2HPRN("Load data-set\'s type(%ld: %s) is unknown.", pBinCom->scom.type, pBinCom->scom.szCommand);
+				K2H_Free(pBinCom);
+				K2H_CLOSE(fd);
+				return false;
+			}
+		}
+
+		// hash for key
+		ARCREC	record;
+		record.offset	= offset;
+		record.type		= pBinCom->scom.type;
+		record.hash		= 0UL;
+		if(0L < pBinCom->scom.key_length){
+			unsigned char*	byKey;
+			if(NULL == (byKey = static_cast<unsigned char*>(ReadFile(fd, pBinCom->scom.key_length, offset + pBinCom->scom.key_pos)))){
+				if(isErrSkip){
+					MSG_K2HPRN("Could not read data from file, skipping, so this data-set is skipped.");
+					continue;
+				}else{
+					ERR_K2HPRN("Could not read data from file.");
+					K2H_Free(pBinCom);
+					K2H_CLOSE(fd);
+					return false;
+				}
+			}
+			record.hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), pBinCom->scom.key_length);
+			K2H_Free(byKey);
+		}
+		records.push_back(record);
+
+		page_count += pShm->GetPageCount(pBinCom->scom.key_length) + pShm->GetPageCount(pBinCom->scom.val_length) + pShm->GetPageCount(pBinCom->scom.skey_length) + pShm->GetPageCount(pBinCom->scom.attr_length);
+	}
+
+	// Expand areas at once
+	if(!pShm->PrepareBulkLoad(static_cast<unsigned long>(records.size()), page_count)){
+		ERR_K2HPRN("Failed to prepare areas for loading archive file(%s).", filepath.c_str());
+		K2H_CLOSE(fd);
+		return false;
+	}
+
+	// Load by partitions
+	bool				result = true;
+	k2harcpartlist_t	partitions(static_cast<size_t>(thread_count));
+	for(std::vector<ARCREC>::const_iterator iter = records.begin(); records.end() != iter; ++iter){
+		if(SCOM_RENAME == iter->type){
+			// load all partitions before rename, and rename alone
+			k2harcpartlist_t	barrier(1);
+			barrier.front().push_back(iter->offset);
+			if(!LoadPartitions(pShm, fd, partitions, is_raw) || !LoadPartitions(pShm, fd, barrier, is_raw)){
+				result = false;
+				break;
+			}
+		}else{
+			partitions[pShm->GetBulkPartition(iter->hash, thread_count)].push_back(iter->offset);
+		}
+	}
+	if(result && !LoadPartitions(pShm, fd, partitions, is_raw)){
+		result = false;
+	}
+	if(!result){
+		ERR_K2HPRN("Failed to load archive file(%s).", filepath.c_str());
+	}
+
 	// cppcheck-suppress unreadVariable
 	K2H_CLOSE(fd);
 
 	return result;
 }
 
+//---------------------------------------------------------
+// Incremental archive
+//---------------------------------------------------------
+// [NOTE]
+// The incremental archive is made from the transaction file, it has
+// only commands which are put after the position(file offset) of the
+// transaction file. The position is got by K2HShm::SaveSnapshot(), and
+// the end position of the incremental archive is returned for the next.
+// Thus restoring is that the snapshot is loaded at first, and then all
+// incremental archives are loaded in order(by ParallelLoad()).
+//
+// If is_compact is true, the commands in the incremental archive are
+// compacted, it means that only the last command for each key is left.
+// The set(all) and delete commands overwrite all commands before them
+// for the same key, and the replace commands overwrite only the same
+// type command. Directly over write value commands are not compacted.
+// The rename command is related to two keys, so that the commands before
+// the rename command for these keys are not compacted by the commands
+// after it.
+//
+typedef struct archive_compact_record{
+	off_t		offset;
+	size_t		length;
+	long		type;
+	bool		is_keep;
+}ARCCMPREC;
+
+typedef std::vector<ARCCMPREC>					k2harccmpreclist_t;
+typedef std::vector<size_t>						k2harcidxlist_t;
+typedef std::map<std::string, k2harcidxlist_t>	k2harccmpkeymap_t;
+
+bool K2HArchive::PutIncrement(const K2HShm* pShm, off_t start_pos, off_t* pend_pos, bool is_compact) const
+{
+	if(!pShm || !pShm->IsAttached() || start_pos < 0L){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	int	trfd;
+	if(-1 == (trfd = K2HTransManager::Get()->GetArchiveFd(pShm))){
+		ERR_K2HPRN("Transaction is not enabled, or it does not have transaction file.");
+		return false;
+	}
+
+	// end position(the writer puts one command with locking)
+	off_t	end_pos;
+	{
+		K2HLock		AutoLock(trfd, 0L, K2HLock::RDLOCK);		// LOCK
+		struct stat	st;
+		if(-1 == fstat(trfd, &st)){
+			ERR_K2HPRN("Could not get transaction file stat: errno(%d)", errno);
+			return false;
+		}
+		end_pos = st.st_size;
+	}
+	if(end_pos < start_pos){
+		ERR_K2HPRN("The start position(%jd) is over the transaction file size(%jd), the transaction file might be rotated.", static_cast<intmax_t>(start_pos), static_cast<intmax_t>(end_pos));
+		return false;
+	}
+
+	int	fd;
+	if(-1 == (fd = open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH))){
+		ERR_K2HPRN("Could not open/create file(%s): errno(%d)", filepath.c_str(), errno);
+		return false;
+	}
+	bool	result = CopyCommands(trfd, start_pos, end_pos, fd, is_compact);
+	if(!result){
+		ERR_K2HPRN("Failed to put incremental archive file(%s) from transaction file.", filepath.c_str());
+	}else if(0 != fsync(fd)){
+		WAN_K2HPRN("Failed to sync incremental archive file(%s), errno = %d", filepath.c_str(), errno);
+	}
+	// cppcheck-suppress unreadVariable
+	K2H_CLOSE(fd);
+
+	if(result && pend_pos){
+		*pend_pos = end_pos;
+	}
+	return result;
+}
+
+bool K2HArchive::Compact(const char* pOutFile) const
+{
+	if(ISEMPTYSTR(pOutFile)){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(filepath == pOutFile){
+		ERR_K2HPRN("Output file(%s) must be different from archive file.", pOutFile);
+		return false;
+	}
+
+	int			srcfd;
+	struct stat	st;
+	if(-1 == (srcfd = open(filepath.c_str(), O_RDONLY))){
+		ERR_K2HPRN("Could not open file(%s): errno(%d)", filepath.c_str(), errno);
+		return false;
+	}
+	if(-1 == fstat(srcfd, &st)){
+		ERR_K2HPRN("Could not get file(%s) stat: errno(%d)", filepath.c_str(), errno);
+		K2H_CLOSE(srcfd);
+		return false;
+	}
+
+	int	destfd;
+	if(-1 == (destfd = open(pOutFile, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH))){
+		ERR_K2HPRN("Could not open/create file(%s): errno(%d)", pOutFile, errno);
+		K2H_CLOSE(srcfd);
+		return false;
+	}
+	bool	result = CopyCommands(srcfd, 0L, st.st_size, destfd, true);
+	if(!result){
+		ERR_K2HPRN("Failed to compact archive file(%s) to file(%s).", filepath.c_str(), pOutFile);
+	}
+
+	// cppcheck-suppress unreadVariable
+	K2H_CLOSE(destfd);
+	// cppcheck-suppress unreadVariable
+	K2H_CLOSE(srcfd);
+
+	return result;
+}
+
+bool K2HArchive::CopyCommands(int srcfd, off_t start_pos, off_t end_pos, int destfd, bool is_compact) const
+{
+	if(-1 == srcfd || -1 == destfd || start_pos < 0L || end_pos < start_pos){
+		ERR_K2HPRN("Parameters wrong.");
+		return false;
+	}
+
+	// Scan all command headers and keys
+	k2harccmpreclist_t	records;
+	k2harccmpkeymap_t	keymap;
+	PBCOM				pBinCom;
+	off_t				offset;
+	for(offset = start_pos; offset < end_pos; k2harchive_scan_next(pBinCom, offset)){
+		if(NULL == (pBinCom = static_cast<PBCOM>(ReadFile(srcfd, sizeof(BCOM), offset))) || end_pos < static_cast<off_t>(offset + scom_total_length(pBinCom->scom))){
+			// [NOTE]
+			// The position is not on the command boundary, or the file is broken.
+			// We can not find next command, so this is error even if isErrSkip.
+			//
+			ERR_K2HPRN("Could not read command at position(%jd).", static_cast<intmax_t>(offset));
+			K2H_Free(pBinCom);
+			return false;
+		}
+
+		ARCCMPREC	record;
+		record.offset	= offset;
+		record.length	= scom_total_length(pBinCom->scom);
+		record.type		= pBinCom->scom.type;
+		record.is_keep	= true;
+
+		// check type
+		if(pBinCom->scom.type < SCOM_TYPE_MIN || SCOM_TYPE_MAX < pBinCom->scom.type){
+			if(isErrSkip){
+				MSG_K2HPRN("Data-set\'s type(%ld: %s) is unknown, so this data-set is skipped.", pBinCom->scom.type, pBinCom->scom.szCommand);
+				continue;
+			}else{
+				ERR_K2HPRN("Data-set\'s type(%ld: %s) is unknown.", pBinCom->scom.type, pBinCom->scom.szCommand);
+				K2H_Free(pBinCom);
+				return false;
+			}
+		}
+		size_t	recindex = records.size();
+		records.push_back(record);
+
+		if(!is_compact || 0UL == pBinCom->scom.key_length){
+			continue;
+		}
+
+		// key(and new key for rename)
+		unsigned char*	byKey		= NULL;
+		unsigned char*	byNewKey	= NULL;
+		if(	NULL == (byKey = static_cast<unsigned char*>(ReadFile(srcfd, pBinCom->scom.key_length, offset + pBinCom->scom.key_pos))) ||
+			(SCOM_RENAME == pBinCom->scom.type && 0UL < pBinCom->scom.exdata_length && NULL == (byNewKey = static_cast<unsigned char*>(ReadFile(srcfd, pBinCom->scom.exdata_length, offset + pBinCom->scom.exdata_pos)))) )
+		{
+			ERR_K2HPRN("Could not read key data from file.");
+			K2H_Free(byKey);
+			K2H_Free(pBinCom);
+			return false;
+		}
+		string	strkey(reinterpret_cast<const char*>(byKey), pBinCom->scom.key_length);
+		K2H_Free(byKey);
+
+		if(SCOM_RENAME == pBinCom->scom.type){
+			// commands before rename are not compacted by commands after it
+			keymap.erase(strkey);
+			if(byNewKey){
+				keymap.erase(string(reinterpret_cast<const char*>(byNewKey), pBinCom->scom.exdata_length));
+				K2H_Free(byNewKey);
+			}
+			continue;
+		}
+
+		k2harcidxlist_t&	indexes = keymap[strkey];
+		if(SCOM_SET_ALL == pBinCom->scom.type || SCOM_DEL_KEY == pBinCom->scom.type){
+			for(k2harcidxlist_t::const_iterator iter = indexes.begin(); indexes.end() != iter; ++iter){
+				records[*iter].is_keep = false;
+			}
+			indexes.clear();
+
+		}else if(SCOM_REPLACE_VAL == pBinCom->scom.type || SCOM_REPLACE_SKEY == pBinCom->scom.type || SCOM_REPLACE_ATTRS == pBinCom->scom.type){
+			for(k2harcidxlist_t::iterator iter = indexes.begin(); indexes.end() != iter; ){
+				if(records[*iter].type == pBinCom->scom.type || (SCOM_REPLACE_VAL == pBinCom->scom.type && SCOM_OW_VAL == records[*iter].type)){
+					records[*iter].is_keep = false;
+					iter = indexes.erase(iter);
+				}else{
+					++iter;
+				}
+			}
+		}
+		indexes.push_back(recindex);
+	}
+	keymap.clear();
+
+	// Copy commands
+	off_t	destpos		= 0L;
+	size_t	keepcount	= 0UL;
+	for(k2harccmpreclist_t::const_iterator iter = records.begin(); records.end() != iter; ++iter){
+		if(!iter->is_keep){
+			continue;
+		}
+		unsigned char*	byData;
+		if(NULL == (byData = static_cast<unsigned char*>(ReadFile(srcfd, iter->length, iter->offset)))){
+			ERR_K2HPRN("Could not read command at position(%jd).", static_cast<intmax_t>(iter->offset));
+			return false;
+		}
+		if(-1 == k2h_pwrite(destfd, byData, iter->length, destpos)){
+			ERR_K2HPRN("Failed to write command.");
+			K2H_Free(byData);
+			return false;
+		}
+		K2H_Free(byData);
+		destpos += static_cast<off_t>(iter->length);
+		++keepcount;
+	}
+	MSG_K2HPRN("Copied %zu commands in %zu commands.", keepcount, records.size());
+
+	return true;
+}
+
 void* K2HArchive::ReadFile(int fd, size_t count, off_t offset) const
 {
 	if(-1 == fd || 0UL == count || 0L > offset){
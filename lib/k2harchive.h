@@ -21,10 +21,18 @@
 #ifndef	K2HARCHIVE_H
 #define	K2HARCHIVE_H
 
+#include <vector>
+
 #include "k2hcommon.h"
 #include "k2hcommand.h"
 #include "k2hshm.h"
 
+//---------------------------------------------------------
+// Typedefs
+//---------------------------------------------------------
+typedef std::vector<off_t>					k2harcofflist_t;
+typedef std::vector<k2harcofflist_t>		k2harcpartlist_t;
+
 //---------------------------------------------------------
 // K2HArchive Class
 //---------------------------------------------------------
@@ -40,10 +48,19 @@ class K2HArchive
 
 		bool Initialize(const char* pFile, bool iserrskip);
 		bool Serialize(K2HShm* pShm, bool isLoad) const;
+		bool ParallelLoad(K2HShm* pShm, int thread_count, bool is_raw = false) const;
+		bool PutIncrement(const K2HShm* pShm, off_t start_pos, off_t* pend_pos = NULL, bool is_compact = true) const;
+		bool Compact(const char* pOutFile) const;
 
 	protected:
+		static void* LoadWorkerProc(void* param);
+
 		bool Save(K2HShm* pShm) const;
 		bool Load(K2HShm* pShm) const;
+		bool LoadCommands(K2HShm* pShm, int fd, const k2harcofflist_t& offsets, bool is_raw) const;
+		bool LoadPartitions(K2HShm* pShm, int fd, k2harcpartlist_t& partitions, bool is_raw) const;
+		bool CopyCommands(int srcfd, off_t start_pos, off_t end_pos, int destfd, bool is_compact) const;
+		bool ExecuteCommand(K2HShm* pShm, const BCOM* pBinCom, const unsigned char* byKey, const unsigned char* byVal, const unsigned char* bySKey, const unsigned char* byAttrs, const unsigned char* byExdata, bool is_raw) const;
 		void* ReadFile(int fd, size_t count, off_t offset) const;
 };
 
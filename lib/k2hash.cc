@@ -342,6 +342,113 @@ bool k2h_put_archive(k2h_h handle, const char* filepath, bool errskip)
 	return k2h_archive_ext(handle, filepath, false, errskip);
 }
 
+bool k2h_put_archive_snapshot(k2h_h handle, const char* filepath, bool errskip)
+{
+	if(ISEMPTYSTR(filepath)){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->SaveSnapshot(filepath, errskip)){
+		ERR_K2HPRN("Failed to put snapshot file(%s).", filepath);
+		return false;
+	}
+	return true;
+}
+
+bool k2h_put_archive_snapshot_pos(k2h_h handle, const char* filepath, bool errskip, off_t* ptranspos)
+{
+	if(ISEMPTYSTR(filepath) || !ptranspos){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->SaveSnapshot(filepath, errskip, ptranspos)){
+		ERR_K2HPRN("Failed to put snapshot file(%s) with transaction position.", filepath);
+		return false;
+	}
+	return true;
+}
+
+bool k2h_put_archive_increment(k2h_h handle, const char* filepath, off_t startpos, off_t* pendpos, bool is_compact)
+{
+	if(ISEMPTYSTR(filepath) || startpos < 0){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+
+	K2HArchive	archiveobj;
+	if(!archiveobj.Initialize(filepath, false)){
+		ERR_K2HPRN("Could not open file(%s).", filepath);
+		return false;
+	}
+	if(!archiveobj.PutIncrement(pShm, startpos, pendpos, is_compact)){
+		ERR_K2HPRN("Failed to put incremental archive file(%s).", filepath);
+		return false;
+	}
+	return true;
+}
+
+bool k2h_compact_archive(const char* filepath, const char* outfilepath, bool errskip)
+{
+	if(ISEMPTYSTR(filepath) || ISEMPTYSTR(outfilepath)){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	K2HArchive	archiveobj;
+	if(!archiveobj.Initialize(filepath, errskip)){
+		ERR_K2HPRN("Could not open file(%s).", filepath);
+		return false;
+	}
+	if(!archiveobj.Compact(outfilepath)){
+		ERR_K2HPRN("Failed to compact archive file(%s) to file(%s).", filepath, outfilepath);
+		return false;
+	}
+	return true;
+}
+
+bool k2h_load_archive_parallel(k2h_h handle, const char* filepath, bool errskip, int threadcnt, bool is_raw)
+{
+	if(ISEMPTYSTR(filepath) || threadcnt < 1){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+
+	K2HArchive	archiveobj;
+	if(!archiveobj.Initialize(filepath, errskip)){
+		ERR_K2HPRN("Could not open file(%s).", filepath);
+		return false;
+	}
+	if(!archiveobj.ParallelLoad(pShm, threadcnt, is_raw)){
+		ERR_K2HPRN("Failed to load file(%s) by %d threads.", filepath, threadcnt);
+		return false;
+	}
+	return true;
+}
+
 int k2h_get_transaction_thread_pool()
 {
 	return K2HShm::GetTransThreadPool();
@@ -374,6 +481,20 @@ bool k2h_set_common_attr(k2h_h handle, const bool* is_mtime, const bool* is_defe
 	return true;
 }
 
+bool k2h_set_common_attr_compress(k2h_h handle, const char* comptype, const size_t* compmin, const int* complevel, const char* dictfile)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->SetCommonAttribute(NULL, NULL, NULL, NULL, NULL, NULL, comptype, compmin, complevel, dictfile)){
+		ERR_K2HPRN("Could not set compression parameters for common attributes.");
+		return false;
+	}
+	return true;
+}
+
 bool k2h_clean_common_attr(k2h_h handle)
 {
 	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
@@ -1536,6 +1657,82 @@ bool k2h_rename_str(k2h_h handle, const char* pkey, const char* pnewkey)
 	return k2h_rename(handle, reinterpret_cast<const unsigned char*>(pkey), strlen(pkey) + 1, reinterpret_cast<const unsigned char*>(pnewkey), strlen(pnewkey) + 1);
 }
 
+//---------------------------------------------------------
+// Functions : Atomic operation
+//---------------------------------------------------------
+bool k2h_increment(k2h_h handle, const unsigned char* pkey, size_t keylength, int64_t delta, int64_t* pvalue)
+{
+	if(!pkey || 0UL == keylength){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+
+	if(!pShm->Increment(pkey, keylength, delta, pvalue)){
+		ERR_K2HPRN("Failed to increment value.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_increment_str(k2h_h handle, const char* pkey, int64_t delta, int64_t* pvalue)
+{
+	if(ISEMPTYSTR(pkey)){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	return k2h_increment(handle, reinterpret_cast<const unsigned char*>(pkey), strlen(pkey) + 1, delta, pvalue);
+}
+
+bool k2h_compare_and_swap(k2h_h handle, const unsigned char* pkey, size_t keylength, const unsigned char* pexpected, size_t explength, const unsigned char* pnewval, size_t newlength, bool* pswapped)
+{
+	if(!pkey || 0UL == keylength || !pnewval || 0UL == newlength){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+
+	bool	is_swapped = false;
+	if(!pShm->CompareAndSwap(pkey, keylength, pexpected, explength, pnewval, newlength, is_swapped)){
+		ERR_K2HPRN("Failed to compare and swap value.");
+		return false;
+	}
+	if(pswapped){
+		*pswapped = is_swapped;
+	}
+	return true;
+}
+
+bool k2h_append(k2h_h handle, const unsigned char* pkey, size_t keylength, const unsigned char* pval, size_t vallength)
+{
+	if(!pkey || 0UL == keylength || !pval || 0UL == vallength){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+
+	if(!pShm->Append(pkey, keylength, pval, vallength)){
+		ERR_K2HPRN("Failed to append value.");
+		return false;
+	}
+	return true;
+}
+
 //---------------------------------------------------------
 // Functions : Direct set/get
 //---------------------------------------------------------
@@ -1743,19 +1940,27 @@ bool k2h_find_get_subkeys(k2h_find_h findhandle, PK2HKEYPCK* ppskeypck, int* psk
 		return false;
 	}
 
-	K2HSubKeys	Subkeys(bysubkeys, skeylength);
+	// [NOTE]
+	// subkeys binary is subkeys list or subkeys directory.
+	//
+	K2HSubKeys*	pSubkeys = reinterpret_cast<PK2HFINDHANDLE>(findhandle)->pShm->LoadSubKeys(bysubkeys, skeylength);
 	K2H_Free(bysubkeys);
+	if(!pSubkeys){
+		ERR_K2HPRN("Could not load subkeys.");
+		return false;
+	}
 
-	size_t		subkeycnt = Subkeys.size();
+	size_t		subkeycnt = pSubkeys->size();
 	PK2HKEYPCK	pskeypck;
 	if(NULL == (pskeypck = reinterpret_cast<PK2HKEYPCK>(calloc(subkeycnt, sizeof(K2HKEYPCK))))){
 		ERR_K2HPRN("Could not allocate memory.");
+		K2H_Delete(pSubkeys);
 		return false;
 	}
 
 	int	setpos = 0;
 	// cppcheck-suppress postfixOperator
-	for(K2HSubKeys::iterator iter = Subkeys.begin(); iter != Subkeys.end(); iter++){
+	for(K2HSubKeys::iterator iter = pSubkeys->begin(); iter != pSubkeys->end(); iter++){
 		if(0UL == iter->length){
 			WAN_K2HPRN("Subkey is empty.");
 			continue;
@@ -1763,12 +1968,14 @@ bool k2h_find_get_subkeys(k2h_find_h findhandle, PK2HKEYPCK* ppskeypck, int* psk
 		if(NULL == (pskeypck[setpos].pkey = reinterpret_cast<unsigned char*>(malloc(iter->length)))){
 			ERR_K2HPRN("Could not allocate memory.");
 			k2h_free_keypack(pskeypck, subkeycnt);
+			K2H_Delete(pSubkeys);
 			return false;
 		}
 		memcpy(pskeypck[setpos].pkey, iter->pSubKey, iter->length);
 		pskeypck[setpos].length = iter->length;
 		setpos++;
 	}
+	K2H_Delete(pSubkeys);
 
 	if(0 == setpos){
 		MSG_K2HPRN("Not have subkeys.");
@@ -1809,20 +2016,28 @@ int k2h_find_get_str_subkeys(k2h_find_h findhandle, char*** ppskeyarray)
 		return -1;
 	}
 
-	K2HSubKeys	Subkeys(bysubkeys, skeylength);
+	// [NOTE]
+	// subkeys binary is subkeys list or subkeys directory.
+	//
+	K2HSubKeys*	pSubkeys = reinterpret_cast<PK2HFINDHANDLE>(findhandle)->pShm->LoadSubKeys(bysubkeys, skeylength);
 	K2H_Free(bysubkeys);
+	if(!pSubkeys){
+		ERR_K2HPRN("Could not load subkeys.");
+		return -1;
+	}
 
-	size_t	subkeycnt = Subkeys.size();
+	size_t	subkeycnt = pSubkeys->size();
 	char**	pskeyarray;
 	if(NULL == (pskeyarray = reinterpret_cast<char**>(calloc(subkeycnt + 1UL, sizeof(char*))))){
 		ERR_K2HPRN("Could not allocate memory.");
+		K2H_Delete(pSubkeys);
 		return -1;
 	}
 
 	// copy
 	int	setpos = 0;
 	// cppcheck-suppress postfixOperator
-	for(K2HSubKeys::iterator iter = Subkeys.begin(); iter != Subkeys.end(); iter++){
+	for(K2HSubKeys::iterator iter = pSubkeys->begin(); iter != pSubkeys->end(); iter++){
 		if(0UL == iter->length){
 			WAN_K2HPRN("Subkey is empty.");
 			continue;
@@ -1830,12 +2045,14 @@ int k2h_find_get_str_subkeys(k2h_find_h findhandle, char*** ppskeyarray)
 		if(NULL == (pskeyarray[setpos] = reinterpret_cast<char*>(malloc(iter->length + 1UL)))){
 			ERR_K2HPRN("Could not allocate memory.");
 			k2h_free_keyarray(pskeyarray);
+			K2H_Delete(pSubkeys);
 			return -1;
 		}
 		memcpy(pskeyarray[setpos], iter->pSubKey, iter->length);
 		(pskeyarray[setpos])[iter->length] = '\0';						// for safe
 		setpos++;
 	}
+	K2H_Delete(pSubkeys);
 
 	if(0 == setpos){
 		MSG_K2HPRN("Not have subkeys.");
@@ -2171,6 +2388,72 @@ k2h_q_h k2h_q_handle_str_prefix(k2h_h handle, bool is_fifo, const char* pref)
 	return k2h_q_handle_prefix(handle, is_fifo, bypref, preflen);
 }
 
+k2h_q_h k2h_ringq_handle(k2h_h handle, bool is_fifo)
+{
+	return k2h_ringq_handle_prefix(handle, is_fifo, NULL, 0);
+}
+
+k2h_q_h k2h_ringq_handle_prefix(k2h_h handle, bool is_fifo, const unsigned char* pref, size_t preflen)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return K2H_INVALID_HANDLE;
+	}
+
+	K2HRingQueue*	pQueue = new K2HRingQueue;
+	if(!pQueue->Init(pShm, is_fifo, pref, preflen)){
+		ERR_K2HPRN("Could not initialize internal K2HRingQueue object.");
+		K2H_Delete(pQueue);
+		return K2H_INVALID_HANDLE;
+	}
+	return reinterpret_cast<k2h_q_h>(static_cast<K2HQueue*>(pQueue));
+}
+
+k2h_q_h k2h_ringq_handle_str_prefix(k2h_h handle, bool is_fifo, const char* pref)
+{
+	const unsigned char*	bypref = reinterpret_cast<const unsigned char*>(pref);
+	size_t					preflen= pref ? strlen(pref) : 0;						// do not count end of nil
+	if(ISEMPTYSTR(pref)){
+		bypref = NULL;
+		preflen= 0;
+	}
+	return k2h_ringq_handle_prefix(handle, is_fifo, bypref, preflen);
+}
+
+k2h_q_h k2h_shardq_handle(k2h_h handle, bool is_fifo, int shardcnt, int mode)
+{
+	return k2h_shardq_handle_prefix(handle, is_fifo, shardcnt, mode, NULL, 0);
+}
+
+k2h_q_h k2h_shardq_handle_prefix(k2h_h handle, bool is_fifo, int shardcnt, int mode, const unsigned char* pref, size_t preflen)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return K2H_INVALID_HANDLE;
+	}
+
+	K2HShardQueue*	pQueue = new K2HShardQueue;
+	if(!pQueue->Init(pShm, is_fifo, pref, preflen, shardcnt, mode)){
+		ERR_K2HPRN("Could not initialize internal K2HShardQueue object.");
+		K2H_Delete(pQueue);
+		return K2H_INVALID_HANDLE;
+	}
+	return reinterpret_cast<k2h_q_h>(static_cast<K2HQueue*>(pQueue));
+}
+
+k2h_q_h k2h_shardq_handle_str_prefix(k2h_h handle, bool is_fifo, int shardcnt, int mode, const char* pref)
+{
+	const unsigned char*	bypref = reinterpret_cast<const unsigned char*>(pref);
+	size_t					preflen= pref ? strlen(pref) : 0;						// do not count end of nil
+	if(ISEMPTYSTR(pref)){
+		bypref = NULL;
+		preflen= 0;
+	}
+	return k2h_shardq_handle_prefix(handle, is_fifo, shardcnt, mode, bypref, preflen);
+}
+
 bool k2h_q_free(k2h_q_h qhandle)
 {
 	K2HQueue*	pQueue = reinterpret_cast<K2HQueue*>(qhandle);
@@ -2373,6 +2656,64 @@ bool k2h_q_dump(k2h_q_h qhandle, FILE* stream)
 	return pQueue->Dump(stream ? stream : stdout);
 }
 
+bool k2h_q_push_batch(k2h_q_h qhandle, const PK2HBIN pdatas, size_t datacnt)
+{
+	K2HQueue*	pQueue = reinterpret_cast<K2HQueue*>(qhandle);
+	if(!pQueue){
+		ERR_K2HPRN("Invalid k2h_q_h handle.");
+		return false;
+	}
+	if(!pQueue->PushBatch(pdatas, datacnt)){
+		ERR_K2HPRN("Could not push to queue.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_q_pop_batch(k2h_q_h qhandle, size_t maxcount, PK2HBIN* ppdatas, size_t* pdatacnt)
+{
+	if(!ppdatas || !pdatacnt){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HQueue*	pQueue = reinterpret_cast<K2HQueue*>(qhandle);
+	if(!pQueue){
+		ERR_K2HPRN("Invalid k2h_q_h handle.");
+		return false;
+	}
+	if(!pQueue->PopBatch(maxcount, ppdatas, (*pdatacnt))){
+		ERR_K2HPRN("Could not pop to queue.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_q_pop_wait(k2h_q_h qhandle, unsigned char** ppdata, size_t* pdatalen, long timeout_ms)
+{
+	if(!ppdata || !pdatalen){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HQueue*	pQueue = reinterpret_cast<K2HQueue*>(qhandle);
+	if(!pQueue){
+		ERR_K2HPRN("Invalid k2h_q_h handle.");
+		return false;
+	}
+	if(!pQueue->PopWait(ppdata, (*pdatalen), timeout_ms)){
+		ERR_K2HPRN("Could not pop to queue.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_q_str_pop_wait(k2h_q_h qhandle, char** ppdata, long timeout_ms)
+{
+	size_t	tmplen = 0;
+	return k2h_q_pop_wait(qhandle, reinterpret_cast<unsigned char**>(ppdata), &tmplen, timeout_ms);
+}
+
 k2h_keyq_h k2h_keyq_handle(k2h_h handle, bool is_fifo)
 {
 	return k2h_keyq_handle_prefix(handle, is_fifo, NULL, 0);
@@ -2681,6 +3022,289 @@ bool k2h_keyq_dump(k2h_keyq_h keyqhandle, FILE* stream)
 	return pQueue->Dump(stream ? stream : stdout);
 }
 
+bool k2h_keyq_push_batch(k2h_keyq_h keyqhandle, const PK2HBIN pkeys, const PK2HBIN pvals, size_t datacnt)
+{
+	K2HKeyQueue*	pQueue = reinterpret_cast<K2HKeyQueue*>(keyqhandle);
+	if(!pQueue){
+		ERR_K2HPRN("Invalid k2h_keyq_h handle.");
+		return false;
+	}
+	if(!pQueue->PushBatch(pkeys, pvals, datacnt)){
+		ERR_K2HPRN("Could not push to queue.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_keyq_pop_batch(k2h_keyq_h keyqhandle, size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t* pdatacnt)
+{
+	if(!ppkeys || !ppvals || !pdatacnt){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	K2HKeyQueue*	pQueue = reinterpret_cast<K2HKeyQueue*>(keyqhandle);
+	if(!pQueue){
+		ERR_K2HPRN("Invalid k2h_keyq_h handle.");
+		return false;
+	}
+	if(!pQueue->PopBatch(maxcount, ppkeys, ppvals, (*pdatacnt))){
+		ERR_K2HPRN("Could not pop to queue.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Functions : Area compactor
+//---------------------------------------------------------
+bool k2h_start_area_compactor(k2h_h handle, long interval_ms, long step_count)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->StartAreaCompactor(interval_ms, step_count)){
+		ERR_K2HPRN("Could not start area compactor.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_stop_area_compactor(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->StopAreaCompactor()){
+		ERR_K2HPRN("Could not stop area compactor.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Functions : Expire reaper
+//---------------------------------------------------------
+int k2h_reap_expired(k2h_h handle, int max_items)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return -1;
+	}
+	if(max_items <= 0){
+		ERR_K2HPRN("max_items(%d) is wrong.", max_items);
+		return -1;
+	}
+	size_t	reaped = 0;
+	if(!pShm->ReapExpired(static_cast<size_t>(max_items), &reaped)){
+		ERR_K2HPRN("Could not reap expired keys.");
+		return -1;
+	}
+	return static_cast<int>(reaped);
+}
+
+bool k2h_start_expire_reaper(k2h_h handle, long interval_ms, long step_count)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->StartExpireReaper(interval_ms, step_count)){
+		ERR_K2HPRN("Could not start expire reaper.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_stop_expire_reaper(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->StopExpireReaper()){
+		ERR_K2HPRN("Could not stop expire reaper.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Functions : Cache mode
+//---------------------------------------------------------
+bool k2h_enable_cache(k2h_h handle, size_t limit, long watermark)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->EnableCache(limit, (0L < watermark ? watermark : K2HShm::DEFAULT_CACHE_WATERMARK))){
+		ERR_K2HPRN("Could not enable cache mode.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_disable_cache(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->DisableCache()){
+		ERR_K2HPRN("Could not disable cache mode.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Functions : Watch mode
+//---------------------------------------------------------
+bool k2h_enable_watch(k2h_h handle, size_t capacity)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->EnableWatch(0 < capacity ? capacity : static_cast<size_t>(K2HShm::DEFAULT_WATCH_CAPACITY))){
+		ERR_K2HPRN("Could not enable watch mode.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_disable_watch(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->DisableWatch()){
+		ERR_K2HPRN("Could not disable watch mode.");
+		return false;
+	}
+	return true;
+}
+
+uint64_t k2h_get_watch_sequence(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return 0;
+	}
+	return pShm->GetWatchSequence();
+}
+
+bool k2h_read_watch_events(k2h_h handle, uint64_t* psequence, const unsigned char* byprefix, size_t prefixlen, PK2HWATCHEVENT* ppevents, int* pevcnt, bool* poverflow)
+{
+	if(!psequence || !ppevents || !pevcnt){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	*ppevents	= NULL;
+	*pevcnt		= 0;
+
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	k2hwatchevlist_t	events;
+	bool				is_overflow = false;
+	if(!pShm->ReadWatchEvents(*psequence, events, is_overflow, byprefix, prefixlen)){
+		ERR_K2HPRN("Could not read watch events.");
+		return false;
+	}
+	if(poverflow){
+		*poverflow = is_overflow;
+	}
+	if(events.empty()){
+		return true;
+	}
+	if(NULL == (*ppevents = reinterpret_cast<PK2HWATCHEVENT>(malloc(sizeof(K2HWATCHEVENT) * events.size())))){
+		ERR_K2HPRN("Could not allocate memory.");
+		return false;
+	}
+	int	cnt = 0;
+	for(k2hwatchevlist_t::const_iterator iter = events.begin(); iter != events.end(); ++iter, ++cnt){
+		memcpy(&((*ppevents)[cnt]), &(*iter), sizeof(K2HWATCHEVENT));
+	}
+	*pevcnt = cnt;
+
+	return true;
+}
+
+bool k2h_wait_watch_event(k2h_h handle, uint64_t sequence, long timeout_ms)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	return pShm->WaitWatchEvent(sequence, timeout_ms);
+}
+
+//---------------------------------------------------------
+// Functions : Hot key cache
+//---------------------------------------------------------
+bool k2h_enable_hot_cache(k2h_h handle, size_t limit)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->EnableHotCache(0 < limit ? limit : static_cast<size_t>(K2HShm::DEFAULT_HOTCACHE_LIMIT))){
+		ERR_K2HPRN("Could not enable hot key cache.");
+		return false;
+	}
+	return true;
+}
+
+bool k2h_disable_hot_cache(k2h_h handle)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->DisableHotCache()){
+		ERR_K2HPRN("Could not disable hot key cache.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Functions : Parallel scan
+//---------------------------------------------------------
+bool k2h_scan_parallel(k2h_h handle, int nthreads, k2h_scan_callback fp, void* pExtData)
+{
+	K2HShm*	pShm = reinterpret_cast<K2HShm*>(handle);
+	if(!pShm){
+		ERR_K2HPRN("Invalid k2hash handle.");
+		return false;
+	}
+	if(!pShm->ScanParallel(nthreads, fp, pExtData)){
+		ERR_K2HPRN("Could not scan all keys.");
+		return false;
+	}
+	return true;
+}
+
 //---------------------------------------------------------
 // Functions : Print / Dump
 //---------------------------------------------------------
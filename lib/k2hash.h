@@ -68,6 +68,22 @@ typedef enum k2h_q_remove_trial_cb_result{
 #define	K2H_VERSION_LENGTH			8		// maximum version length
 #define	K2H_HASH_FUNC_VER_LENGTH	32		// hash function version length
 
+// for sharded queue mode
+#define	K2H_SHARDQ_PUSH_BY_THREAD	0x0		// push into the shard which is decided by thread id
+#define	K2H_SHARDQ_PUSH_BY_HASH		0x1		// push into the shard which is decided by hash value of data
+#define	K2H_SHARDQ_POP_ROUNDROBIN	0x0		// pop from the shards by round robin
+#define	K2H_SHARDQ_POP_AFFINITY		0x2		// pop from the shard which is decided by thread id at first
+#define	K2H_SHARDQ_DEFAULT_MODE		(K2H_SHARDQ_PUSH_BY_THREAD | K2H_SHARDQ_POP_ROUNDROBIN)
+
+// for watch event type
+#define	K2H_WATCH_KEY_LENGTH		64		// maximum key length in watch event(longer key is truncated)
+#define	K2H_WATCH_OP_SET			0L		// set key(value, subkeys and attributes)
+#define	K2H_WATCH_OP_VALUE			1L		// replace or over write value
+#define	K2H_WATCH_OP_SUBKEYS		2L		// replace subkeys
+#define	K2H_WATCH_OP_ATTRS			3L		// replace attributes
+#define	K2H_WATCH_OP_DELETE			4L		// delete key
+#define	K2H_WATCH_OP_RENAME			5L		// rename key(key is old key name, and new key is posted as K2H_WATCH_OP_SET)
+
 //---------------------------------------------------------
 // Structure
 //---------------------------------------------------------
@@ -131,8 +147,43 @@ typedef struct k2h_state{
 
 	struct timeval	last_update;							// Last update of data
 	struct timeval	last_area_update;						// Last update of expanding area
+
+	// [NOTE]
+	// Compression statistics are counted by builtin attribute in this process
+	// (not shared with other processes), and these are zero if compression is
+	// not used.
+	//
+	unsigned long	compress_count;							// Count of compressed values
+	unsigned long	compress_org_bytes;						// Total bytes of values before compressing
+	unsigned long	compress_bytes;							// Total bytes of values after compressing
+	unsigned long	compress_time_ns;						// Total CPU time for compressing(ns)
+	unsigned long	decompress_count;						// Count of decompressed values
+	unsigned long	decompress_time_ns;						// Total CPU time for decompressing(ns)
+
+	// [NOTE]
+	// Cache statistics are shared with all processes, and these are zero
+	// if k2hash is not cache mode.
+	//
+	size_t			cache_limit;							// Total size which starts evicting(0 means not cache mode)
+	unsigned long	cache_hits;								// Count of found keys by reading
+	unsigned long	cache_misses;							// Count of not found(expired) keys by reading
+	unsigned long	cache_evictions;						// Count of evicted keys
 }__attribute__ ((packed)) K2HSTATE, *PK2HSTATE;
 
+// for watch event
+//
+// [NOTE]
+// key has the top of key name up to K2H_WATCH_KEY_LENGTH bytes, and
+// keylength is the length of whole key name.
+//
+typedef struct k2h_watch_event{
+	uint64_t		sequence;								// Sequence number of event
+	k2h_hash_t		hash;									// Hash value of key
+	long			type;									// Event type(K2H_WATCH_OP_*)
+	size_t			keylength;								// Key length(not truncated)
+	unsigned char	key[K2H_WATCH_KEY_LENGTH];				// Key name(truncated)
+}__attribute__ ((packed)) K2HWATCHEVENT, *PK2HWATCHEVENT;
+
 //---------------------------------------------------------
 // Prototype Functions
 //---------------------------------------------------------
@@ -193,6 +244,30 @@ typedef K2HQRMCBRES (*k2h_q_remove_trial_callback)(const unsigned char* bydata,
 //	}
 //	
 
+typedef bool (*k2h_scan_callback)(const unsigned char* byKey, size_t keylen, const unsigned char* byValue, size_t vallen, void* pExtData);
+//
+// [SAMPLE] This is the sample k2h_scan_callback function.
+//
+//	This function is called from the worker threads in k2h_scan_parallel
+//	function for each key, then it is called by some threads at the same
+//	time. byKey and byValue point the data in k2hash or temporary buffer,
+//	these are valid only while this function is called. The value is raw
+//	data, so that it is not decrypted and decompressed. The collision key
+//	index of the key is locked for reading while this function is called,
+//	thus this function must not modify k2hash. If this function returns
+//	false, all workers stop scanning.
+//
+//	static bool ScanCallback(const unsigned char* byKey, size_t keylen, const unsigned char* byValue, size_t vallen, void* pExtData)
+//	{
+//		//
+//		// Do something for key and value(ex. counting, exporting).
+//		// pExtData is the parameter when you call k2h_scan_parallel function.
+//		//
+//	
+//		return true;
+//	}
+//	
+
 //---------------------------------------------------------
 // Functions
 //---------------------------------------------------------
@@ -272,7 +347,12 @@ extern bool k2h_close_wait(k2h_h handle, long waitms);
 // k2h_get_transaction_archive_fd		get transaction archive file descriptor, if it is set.
 // 
 // k2h_load_archive						load from (transaction formatted)archive file
+// k2h_load_archive_parallel			load from (transaction formatted)archive file by multi threads(partitioned by hash range)
 // k2h_put_archive						put to (transaction formatted)archive file
+// k2h_put_archive_snapshot				put consistent snapshot to (transaction formatted)archive file without stopping writers
+// k2h_put_archive_snapshot_pos			put consistent snapshot like k2h_put_archive_snapshot, and get transaction file position at the snapshot
+// k2h_put_archive_increment			put incremental archive file which has transaction after the position, and get the next position
+// k2h_compact_archive					compact archive file(keep only the last data-set for each key) to another file
 //
 // k2h_get_transaction_thread_pool		get thread pool count for transaction
 // k2h_set_transaction_thread_pool		set thread pool for transaction
@@ -291,7 +371,12 @@ extern bool k2h_disable_transaction(k2h_h handle);
 extern int k2h_get_transaction_archive_fd(k2h_h handle);
 
 extern bool k2h_load_archive(k2h_h handle, const char* filepath, bool errskip);
+extern bool k2h_load_archive_parallel(k2h_h handle, const char* filepath, bool errskip, int threadcnt, bool is_raw);
 extern bool k2h_put_archive(k2h_h handle, const char* filepath, bool errskip);
+extern bool k2h_put_archive_snapshot(k2h_h handle, const char* filepath, bool errskip);
+extern bool k2h_put_archive_snapshot_pos(k2h_h handle, const char* filepath, bool errskip, off_t* ptranspos);
+extern bool k2h_put_archive_increment(k2h_h handle, const char* filepath, off_t startpos, off_t* pendpos, bool is_compact);
+extern bool k2h_compact_archive(const char* filepath, const char* outfilepath, bool errskip);
 
 extern int k2h_get_transaction_thread_pool(void);
 extern bool k2h_set_transaction_thread_pool(int count);
@@ -300,6 +385,8 @@ extern bool k2h_unset_transaction_thread_pool(void);
 // [attribute]
 //
 // k2h_set_common_attr                  set common builtin attribute parameters
+// k2h_set_common_attr_compress         set compression parameters for common builtin attribute
+//                                      (comptype is "LZ4", "ZSTD" or "NO", NULL means not changing)
 // k2h_clean_common_attr                clear all common builtin attribute parameters and unload plugins
 // k2h_add_attr_plugin_library          load attribute plugin library as additional
 // k2h_add_attr_crypt_pass              add pass phrase for crypt in common builtin attribute
@@ -307,6 +394,7 @@ extern bool k2h_unset_transaction_thread_pool(void);
 // k2h_print_attr_information			print all attribute parameters
 // 
 extern bool k2h_set_common_attr(k2h_h handle, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire);
+extern bool k2h_set_common_attr_compress(k2h_h handle, const char* comptype, const size_t* compmin, const int* complevel, const char* dictfile);
 extern bool k2h_clean_common_attr(k2h_h handle);
 extern bool k2h_add_attr_plugin_library(k2h_h handle, const char* libpath);
 extern bool k2h_add_attr_crypt_pass(k2h_h handle, const char* pass, bool is_default_encrypt);
@@ -481,6 +569,22 @@ extern bool k2h_remove_str_subkey(k2h_h handle, const char* pkey, const char* ps
 extern bool k2h_rename(k2h_h handle, const unsigned char* pkey, size_t keylength, const unsigned char* pnewkey, size_t newkeylength);
 extern bool k2h_rename_str(k2h_h handle, const char* pkey, const char* pnewkey);
 
+// [atomic operation]
+//
+// k2h_increment			add delta to 64bit integer value(host byte order), the key is made if it does not exist.
+// k2h_increment_str		
+// k2h_compare_and_swap		set new value only when the value is same as expected value.
+//							if pexpected is NULL, the value is set only when the key does not exist.
+//							pswapped is set true when the value is swapped.
+// k2h_append				append data to value, the key is made if it does not exist.
+//
+// These functions can not operate the value which is encrypted or compressed.
+//
+extern bool k2h_increment(k2h_h handle, const unsigned char* pkey, size_t keylength, int64_t delta, int64_t* pvalue);
+extern bool k2h_increment_str(k2h_h handle, const char* pkey, int64_t delta, int64_t* pvalue);
+extern bool k2h_compare_and_swap(k2h_h handle, const unsigned char* pkey, size_t keylength, const unsigned char* pexpected, size_t explength, const unsigned char* pnewval, size_t newlength, bool* pswapped);
+extern bool k2h_append(k2h_h handle, const unsigned char* pkey, size_t keylength, const unsigned char* pval, size_t vallength);
+
 // [direct set/get]
 //
 // k2h_get_elements_by_hash			get binary elements from hash code
@@ -596,6 +700,12 @@ extern bool k2h_da_set_value_str(k2h_da_h dahandle, const char* pval);
 // k2h_q_handle					get k2h_q_h handle for filo or lifo queue
 // k2h_q_handle_prefix			get k2h_q_h handle for filo or lifo queue with queue prefix value
 // k2h_q_handle_str_prefix		get k2h_q_h handle for filo or lifo queue with string queue prefix value
+// k2h_ringq_handle				get k2h_q_h handle for filo or lifo ring buffer queue
+// k2h_ringq_handle_prefix		get k2h_q_h handle for filo or lifo ring buffer queue with queue prefix value
+// k2h_ringq_handle_str_prefix	get k2h_q_h handle for filo or lifo ring buffer queue with string queue prefix value
+// k2h_shardq_handle				get k2h_q_h handle for filo or lifo sharded queue
+// k2h_shardq_handle_prefix		get k2h_q_h handle for filo or lifo sharded queue with queue prefix value
+// k2h_shardq_handle_str_prefix	get k2h_q_h handle for filo or lifo sharded queue with string queue prefix value
 // k2h_q_free					free k2h_q_h handle
 // 
 // k2h_q_empty					check queue empty
@@ -619,6 +729,10 @@ extern bool k2h_da_set_value_str(k2h_da_h dahandle, const char* pval);
 // k2h_q_remove_wp				remove queue with pass phrase
 // k2h_q_remove_wp_ext			remove queue with calling callback function with pass phrase
 // k2h_q_dump					dump queue for debugging
+// k2h_q_push_batch				push the datas to queue at once
+// k2h_q_pop_batch				pop the datas(up to max count) from queue at once, the datas must be freed by free_k2hbins
+// k2h_q_pop_wait				pop the data from queue with waiting until pushed or timeout(ms, negative is no timeout)
+// k2h_q_str_pop_wait			pop the string data from queue with waiting until pushed or timeout(ms, negative is no timeout)
 // 
 // k2h_keyq_handle				get k2h_keyq_h handle for filo or lifo queue
 // k2h_keyq_handle_prefix		get k2h_keyq_h handle for filo or lifo queue with queue prefix value
@@ -656,16 +770,28 @@ extern bool k2h_da_set_value_str(k2h_da_h dahandle, const char* pval);
 // k2h_keyq_remove_wp			remove queue and remove queued key with pass from k2hash
 // k2h_keyq_remove_wp_ext		remove queue with calling callback function and remove queued key with pass from k2hash
 // k2h_keyq_dump				dump queue for debugging
+// k2h_keyq_push_batch			push the keys to queue and make key-values into k2hash at once(pvals allows NULL)
+// k2h_keyq_pop_batch			pop queued keys(up to max count) and those values at once, the keys and values must be freed by free_k2hbins
 // 
 // [NOTES]
 // k2h_q_h works only queue(fifo/lifo), but k2h_keyq_h works queue and it queued the value
 // which means key name in k2hash.
 // So k2h_q_h is K2HQueue class, k2h_keyq_h is K2HKeyQueue. These handle(class) is different
 // on pop() and remove() functions.
+// k2h_ringq_handle returns k2h_q_h handle which stores datas into ring buffer(K2HRingQueue),
+// k2h_q_XXX functions can be used for it but it does not support attributes and pass phrase.
+// k2h_shardq_handle returns k2h_q_h handle which spreads datas over shardcnt queues(K2HShardQueue),
+// mode is K2H_SHARDQ_PUSH_XXX | K2H_SHARDQ_POP_XXX. shardcnt 0 means using saved shard count.
 // 
 extern k2h_q_h k2h_q_handle(k2h_h handle, bool is_fifo);
 extern k2h_q_h k2h_q_handle_prefix(k2h_h handle, bool is_fifo, const unsigned char* pref, size_t preflen);
 extern k2h_q_h k2h_q_handle_str_prefix(k2h_h handle, bool is_fifo, const char* pref);
+extern k2h_q_h k2h_ringq_handle(k2h_h handle, bool is_fifo);
+extern k2h_q_h k2h_ringq_handle_prefix(k2h_h handle, bool is_fifo, const unsigned char* pref, size_t preflen);
+extern k2h_q_h k2h_ringq_handle_str_prefix(k2h_h handle, bool is_fifo, const char* pref);
+extern k2h_q_h k2h_shardq_handle(k2h_h handle, bool is_fifo, int shardcnt, int mode);
+extern k2h_q_h k2h_shardq_handle_prefix(k2h_h handle, bool is_fifo, int shardcnt, int mode, const unsigned char* pref, size_t preflen);
+extern k2h_q_h k2h_shardq_handle_str_prefix(k2h_h handle, bool is_fifo, int shardcnt, int mode, const char* pref);
 extern bool k2h_q_free(k2h_q_h qhandle);
 
 extern bool k2h_q_empty(k2h_q_h qhandle);
@@ -689,6 +815,10 @@ extern bool k2h_q_str_pop_wp(k2h_q_h qhandle, char** ppdata, const char* encpass
 extern bool k2h_q_remove_wp(k2h_q_h qhandle, int count, const char* encpass);
 extern int k2h_q_remove_wp_ext(k2h_q_h qhandle, int count, k2h_q_remove_trial_callback fp, void* pextdata, const char* encpass);
 extern bool k2h_q_dump(k2h_q_h qhandle, FILE* stream);
+extern bool k2h_q_push_batch(k2h_q_h qhandle, const PK2HBIN pdatas, size_t datacnt);
+extern bool k2h_q_pop_batch(k2h_q_h qhandle, size_t maxcount, PK2HBIN* ppdatas, size_t* pdatacnt);
+extern bool k2h_q_pop_wait(k2h_q_h qhandle, unsigned char** ppdata, size_t* pdatalen, long timeout_ms);
+extern bool k2h_q_str_pop_wait(k2h_q_h qhandle, char** ppdata, long timeout_ms);
 
 extern k2h_keyq_h k2h_keyq_handle(k2h_h handle, bool is_fifo);
 extern k2h_keyq_h k2h_keyq_handle_prefix(k2h_h handle, bool is_fifo, const unsigned char* pref, size_t preflen);
@@ -726,6 +856,80 @@ extern bool k2h_keyq_str_pop_keyval_wp(k2h_keyq_h keyqhandle, char** ppkey, char
 extern bool k2h_keyq_remove_wp(k2h_keyq_h keyqhandle, int count, const char* encpass);
 extern int k2h_keyq_remove_wp_ext(k2h_keyq_h keyqhandle, int count, k2h_q_remove_trial_callback fp, void* pextdata, const char* encpass);
 extern bool k2h_keyq_dump(k2h_keyq_h keyqhandle, FILE* stream);
+extern bool k2h_keyq_push_batch(k2h_keyq_h keyqhandle, const PK2HBIN pkeys, const PK2HBIN pvals, size_t datacnt);
+extern bool k2h_keyq_pop_batch(k2h_keyq_h keyqhandle, size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t* pdatacnt);
+
+// [area compactor]
+//
+// k2h_start_area_compactor	start background thread which compresses the lastest area by small steps
+//							while other processes(threads) read/write k2hash
+// k2h_stop_area_compactor	stop background area compactor thread
+//
+extern bool k2h_start_area_compactor(k2h_h handle, long interval_ms, long step_count);
+extern bool k2h_stop_area_compactor(k2h_h handle);
+
+// [expire reaper]
+//
+// k2h_reap_expired			remove expired keys(up to max_items) which are listed in expiry index
+//							without scanning all keys, returns removed key count(-1 means error)
+// k2h_start_expire_reaper	start background thread which removes expired keys by k2h_reap_expired
+//							every interval_ms
+// k2h_stop_expire_reaper	stop background expire reaper thread
+//
+extern int k2h_reap_expired(k2h_h handle, int max_items);
+extern bool k2h_start_expire_reaper(k2h_h handle, long interval_ms, long step_count);
+extern bool k2h_stop_expire_reaper(k2h_h handle);
+
+// [cache mode]
+//
+// k2h_enable_cache			enable cache mode which evicts keys by CLOCK algorithm when the total
+//							size of k2hash is over limit(byte) and free pages are under watermark.
+//							cache mode is shared with all processes which attach the k2hash.
+// k2h_disable_cache		disable cache mode
+//
+extern bool k2h_enable_cache(k2h_h handle, size_t limit, long watermark);
+extern bool k2h_disable_cache(k2h_h handle);
+
+// [watch mode]
+//
+// k2h_enable_watch			enable watch mode which posts the event for each mutation into the
+//							event ring(capacity events) in k2hash. if capacity is 0, the default
+//							capacity is used. the capacity can not be over the capacity at first
+//							enabling. watch mode is shared with all processes which attach the k2hash.
+// k2h_disable_watch		disable watch mode
+// k2h_get_watch_sequence	get the sequence number of next event, the reader starts reading from it.
+// k2h_read_watch_events	read events from *psequence, and *psequence is set next sequence number.
+//							the events are filtered by prefix if byprefix is not NULL. the events
+//							array must be freed by free(). if *poverflow is set true, some events
+//							are lost, then the reader must resync all keys.
+// k2h_wait_watch_event		wait until the event after sequence is posted or timeout(ms). if timeout_ms
+//							is negative, this waits without timeout.
+//
+extern bool k2h_enable_watch(k2h_h handle, size_t capacity);
+extern bool k2h_disable_watch(k2h_h handle);
+extern uint64_t k2h_get_watch_sequence(k2h_h handle);
+extern bool k2h_read_watch_events(k2h_h handle, uint64_t* psequence, const unsigned char* byprefix, size_t prefixlen, PK2HWATCHEVENT* ppevents, int* pevcnt, bool* poverflow);
+extern bool k2h_wait_watch_event(k2h_h handle, uint64_t sequence, long timeout_ms);
+
+// [hot key cache]
+//
+// k2h_enable_hot_cache		enable hot key cache in this process, which keeps decoded values up to limit(byte).
+//							the cached value is validated by key version which is shared with all processes,
+//							then it is never stale. if limit is 0, the default limit is used.
+// k2h_disable_hot_cache	disable hot key cache and free all cached values
+//
+extern bool k2h_enable_hot_cache(k2h_h handle, size_t limit);
+extern bool k2h_disable_hot_cache(k2h_h handle);
+
+// [parallel scan]
+//
+// k2h_scan_parallel		scan all keys by nthreads worker threads, and call fp for each key. the hash range
+//							of k2hash is split for workers, and each worker locks each collision key index
+//							only once. if nthreads is 0 or less, the count of online processors is used.
+//							expired keys, history keys and expire index keys are skipped. keys which are
+//							set or removed during scanning may or may not be called.
+//
+extern bool k2h_scan_parallel(k2h_h handle, int nthreads, k2h_scan_callback fp, void* pExtData);
 
 // [dump]
 //
@@ -20,6 +20,7 @@
  */
 
 #include <fullock/flckutil.h>
+#include <fullock/flckbaselist.tcc>
 
 #include <fstream>
 
@@ -43,6 +44,10 @@ using namespace std;
 #define	K2HATTR_ENV_ENCFILE							"K2HATTR_ENCFILE"
 #define	K2HATTR_ENV_ENC_TYPE						"K2HATTR_ENC_TYPE"
 #define	K2HATTR_ENV_ENC_ITER						"K2HATTR_ENC_ITER"
+#define	K2HATTR_ENV_COMPRESS						"K2HATTR_COMPRESS"
+#define	K2HATTR_ENV_COMPRESS_MIN					"K2HATTR_COMPRESS_MIN"
+#define	K2HATTR_ENV_COMPRESS_LEVEL					"K2HATTR_COMPRESS_LEVEL"
+#define	K2HATTR_ENV_COMPRESS_DICT					"K2HATTR_COMPRESS_DICT"
 
 #define	K2HATTR_ENV_VAL_NO							"NO"
 #define	K2HATTR_ENV_VAL_OFF							"OFF"
@@ -50,6 +55,9 @@ using namespace std;
 #define	K2HATTR_ENV_VAL_ON							"ON"
 #define	K2HATTR_ENV_VAL_ENCTYPE_AES256_PBKDF1		"AES256_PBKDF1"
 #define	K2HATTR_ENV_VAL_ENCTYPE_AES256_PBKDF2		"AES256_PBKDF2"
+#define	K2HATTR_ENV_VAL_ENCTYPE_AES256_GCM			"AES256_GCM"
+#define	K2HATTR_ENV_VAL_COMPTYPE_LZ4				"LZ4"
+#define	K2HATTR_ENV_VAL_COMPTYPE_ZSTD				"ZSTD"
 
 #define	K2HATTR_ENCFILE_COMMENT_CHAR				'#'
 
@@ -57,9 +65,11 @@ using namespace std;
 #define	K2HATTR_COMMON_EXPIRE						"expire"
 #define	K2HATTR_COMMON_AES256_MD5					"aes256md5"
 #define	K2HATTR_COMMON_AES256_PBKDF2				"aes256_cbc_pad.pbkdf2.sha256"		// <DATA ENC CIPHER>.<PCKS#5 v2>.<KEY HASH TYPE>
+#define	K2HATTR_COMMON_AES256_GCM					"aes256_gcm.pbkdf2.sha512"			// <DATA ENC CIPHER>.<PCKS#5 v2>.<KEY HASH TYPE>
 #define	K2HATTR_COMMON_UNIQ_ID						"uniqid"
 #define	K2HATTR_COMMON_PARENT_UNIQ_ID				"parentuniqid"
 #define	K2HATTR_COMMON_HISTORY_MARKER				"hismark"
+#define	K2HATTR_COMMON_COMPRESS						"compress"							// value is K2H_COMPRESS_LZ4_NAME or K2H_COMPRESS_ZSTD_NAME
 
 //---------------------------------------------------------
 // K2hCryptContext Class
@@ -125,6 +135,10 @@ const char*		K2hAttrBuiltin::ATTR_ENV_DEFAULT_ENC= K2HATTR_ENV_DEFAULT_ENC;
 const char*		K2hAttrBuiltin::ATTR_ENV_ENCFILE	= K2HATTR_ENV_ENCFILE;
 const char*		K2hAttrBuiltin::ATTR_ENV_ENC_TYPE	= K2HATTR_ENV_ENC_TYPE;
 const char*		K2hAttrBuiltin::ATTR_ENV_ENC_ITER	= K2HATTR_ENV_ENC_ITER;
+const char*		K2hAttrBuiltin::ATTR_ENV_COMPRESS	= K2HATTR_ENV_COMPRESS;
+const char*		K2hAttrBuiltin::ATTR_ENV_COMPRESS_MIN	= K2HATTR_ENV_COMPRESS_MIN;
+const char*		K2hAttrBuiltin::ATTR_ENV_COMPRESS_LEVEL	= K2HATTR_ENV_COMPRESS_LEVEL;
+const char*		K2hAttrBuiltin::ATTR_ENV_COMPRESS_DICT	= K2HATTR_ENV_COMPRESS_DICT;
 
 const int		K2hAttrBuiltin::TYPE_ATTRBUILTIN;
 const char*		K2hAttrBuiltin::ATTR_BUILTIN_VERSION= K2HATTR_BUILTIN_VERSION;
@@ -135,7 +149,9 @@ const char*		K2hAttrBuiltin::ATTR_UNIQID			= K2HATTR_COMMON_UNIQ_ID;
 const char*		K2hAttrBuiltin::ATTR_PUNIQID		= K2HATTR_COMMON_PARENT_UNIQ_ID;
 const char*		K2hAttrBuiltin::ATTR_AES256_MD5		= K2HATTR_COMMON_AES256_MD5;
 const char*		K2hAttrBuiltin::ATTR_AES256_PBKDF2	= K2HATTR_COMMON_AES256_PBKDF2;
+const char*		K2hAttrBuiltin::ATTR_AES256_GCM		= K2HATTR_COMMON_AES256_GCM;
 const char*		K2hAttrBuiltin::ATTR_HISMARK		= K2HATTR_COMMON_HISTORY_MARKER;
+const char*		K2hAttrBuiltin::ATTR_COMPRESS		= K2HATTR_COMMON_COMPRESS;
 
 const time_t	K2hAttrBuiltin::NOT_EXPIRE;
 const int		K2hAttrBuiltin::ATTR_MASK_NO;
@@ -144,6 +160,7 @@ const int		K2hAttrBuiltin::ATTR_MASK_ENCRYPT;
 const int		K2hAttrBuiltin::ATTR_MASK_HISTORY;
 const int		K2hAttrBuiltin::ATTR_MASK_EXPIRE;
 const int		K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP;
+const int		K2hAttrBuiltin::ATTR_MASK_COMPRESS;
 
 //---------------------------------------------------------
 // Utility macros
@@ -155,8 +172,25 @@ const int		K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP;
 #define	IS_ATTR_MASK_HISTORY(mask)					IS_ATTR_MASK(mask, K2hAttrBuiltin::ATTR_MASK_HISTORY)
 #define	IS_ATTR_MASK_EXPIRE(mask)					IS_ATTR_MASK(mask, K2hAttrBuiltin::ATTR_MASK_EXPIRE)
 #define	IS_ATTR_MASK_EXPIRE_KP(mask)				IS_ATTR_MASK(mask, K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP)
+#define	IS_ATTR_MASK_COMPRESS(mask)					IS_ATTR_MASK(mask, K2hAttrBuiltin::ATTR_MASK_COMPRESS)
 
-#define	ATTR_MASK_FILTER(mask)						(mask & (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE | K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP))
+#define	ATTR_MASK_FILTER(mask)						(mask & (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE | K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP | K2hAttrBuiltin::ATTR_MASK_COMPRESS))
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+// [NOTE]
+// The time for compressing is thread CPU time, because it should not
+// include waiting time by scheduling.
+//
+static inline uint64_t k2h_thread_cputime_ns(void)
+{
+	struct timespec	ts;
+	if(-1 == clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)){
+		return 0;
+	}
+	return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec));
+}
 
 //---------------------------------------------------------
 // K2hAttrBuiltin Class Methods
@@ -282,6 +316,119 @@ int K2hAttrBuiltin::LoadEncryptPassMap(PK2HBATTRPACK pPack, const char* pfile)
 	return pPack->EncPassMap.size();
 }
 
+//
+// Returns md5 string of pass, and AES256 GCM key made by the iteration
+// count if pkey is not NULL.
+//
+// [NOTE]
+// The md5 string and the key are cached for each pass, thus to_md5_string
+// and PBKDF2 are called only at first time for each pass. The key is made
+// again only when the iteration count is different from cached one(ex.
+// decrypting the value which is encrypted by other iteration count).
+// The cache is also used for the pass which is not loaded in EncPassMap,
+// then it is cleared when the count of cache reaches the limit.
+//
+bool K2hAttrBuiltin::GetPassCache(PK2HBATTRPACK pPack, const string& pass, string* pmd5, int iter, unsigned char* pkey)
+{
+	if(!pPack || pass.empty() || (pkey && iter < 1)){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	bool	is_md5	= false;
+	bool	is_key	= (NULL == pkey);
+	string	strMD5;
+
+	while(!fullock::flck_trylock_noshared_mutex(&(pPack->PassCacheLockVal)));		// LOCK
+	k2hepmap_t::const_iterator	pos = pPack->PassCache.find(pass);
+	if(pPack->PassCache.end() != pos){
+		strMD5	= pos->second.strMD5;
+		is_md5	= true;
+		if(pkey && iter == pos->second.KeyIterCount && K2H_ENCRYPT_GCM_KEY_LENGTH == pos->second.strKey.length()){
+			memcpy(pkey, pos->second.strKey.data(), K2H_ENCRYPT_GCM_KEY_LENGTH);
+			is_key	= true;
+		}
+	}
+	fullock::flck_unlock_noshared_mutex(&(pPack->PassCacheLockVal));				// UNLOCK
+
+	if(!is_md5 || !is_key){
+		// make md5 and key without locking, because these take long time.
+		if(!is_md5 && (strMD5 = to_md5_string(pass.c_str())).empty()){
+			ERR_K2HPRN("Could not make md5 string for pass.");
+			return false;
+		}
+		if(!is_key && !k2h_make_aes256_gcm_key(pass.c_str(), iter, pkey)){
+			ERR_K2HPRN("Could not make AES256 GCM key for pass.");
+			return false;
+		}
+
+		// set cache
+		while(!fullock::flck_trylock_noshared_mutex(&(pPack->PassCacheLockVal)));	// LOCK
+		if(K2H_ENCPASS_CACHE_MAX <= pPack->PassCache.size() && pPack->PassCache.end() == pPack->PassCache.find(pass)){
+			pPack->PassCache.clear();
+		}
+		K2HENCPASS&	encpass	= pPack->PassCache[pass];
+		encpass.strPass		= pass;
+		encpass.strMD5		= strMD5;
+		if(pkey){
+			encpass.KeyIterCount= iter;
+			encpass.strKey.assign(reinterpret_cast<const char*>(pkey), K2H_ENCRYPT_GCM_KEY_LENGTH);
+		}
+		fullock::flck_unlock_noshared_mutex(&(pPack->PassCacheLockVal));			// UNLOCK
+	}
+	if(pmd5){
+		*pmd5 = strMD5;
+	}
+	return true;
+}
+
+bool K2hAttrBuiltin::SetCompressType(PK2HBATTRPACK pPack, const char* pcomptype)
+{
+	if(!pPack || ISEMPTYSTR(pcomptype)){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(0 == strcasecmp(pcomptype, K2HATTR_ENV_VAL_NO) || 0 == strcasecmp(pcomptype, K2HATTR_ENV_VAL_OFF)){
+		pPack->CompType = K2H_COMP_NO;
+	}else if(0 == strcasecmp(pcomptype, K2HATTR_ENV_VAL_COMPTYPE_LZ4)){
+		if(!k2h_is_lz4_supported()){
+			ERR_K2HPRN("Compress type %s is specified, but k2hash is not built with LZ4.", pcomptype);
+			return false;
+		}
+		pPack->CompType = K2H_COMP_LZ4;
+	}else if(0 == strcasecmp(pcomptype, K2HATTR_ENV_VAL_COMPTYPE_ZSTD)){
+		if(!k2h_is_zstd_supported()){
+			ERR_K2HPRN("Compress type %s is specified, but k2hash is not built with zstd.", pcomptype);
+			return false;
+		}
+		pPack->CompType = K2H_COMP_ZSTD;
+	}else{
+		ERR_K2HPRN("Unknown compress type(%s).", pcomptype);
+		return false;
+	}
+	return true;
+}
+
+//
+// [NOTE]
+// The dictionary is prepared with CompLevel, thus the level must be set
+// before calling this.
+//
+bool K2hAttrBuiltin::LoadCompressDict(PK2HBATTRPACK pPack, const char* pfile)
+{
+	if(!pPack || ISEMPTYSTR(pfile)){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	PK2HCOMPDICT	pDict;
+	if(NULL == (pDict = k2h_load_zstd_dict(pfile, pPack->CompLevel))){
+		ERR_K2HPRN("Failed to load zstd dictionary from file %s", pfile);
+		return false;
+	}
+	k2h_free_zstd_dict(pPack->pCompDict);
+	pPack->pCompDict = pDict;
+	return true;
+}
+
 bool K2hAttrBuiltin::RawInitializeEnv(PK2HBATTRPACK pPack)
 {
 	if(!pPack){
@@ -344,6 +491,8 @@ bool K2hAttrBuiltin::RawInitializeEnv(PK2HBATTRPACK pPack)
 			pPack->IterCount	= 1;						// This case is always 1 for compatibility
 		}else if(0 == strcasecmp(value.c_str(), K2HATTR_ENV_VAL_ENCTYPE_AES256_PBKDF2)){
 			pPack->EncType = K2H_ENC_AES256_PBKDF2;
+		}else if(0 == strcasecmp(value.c_str(), K2HATTR_ENV_VAL_ENCTYPE_AES256_GCM)){
+			pPack->EncType = K2H_ENC_AES256_GCM;
 		}else{
 			WAN_K2HPRN("environment %s has unknown value(%s), but continue...", K2hAttrBuiltin::ATTR_ENV_ENC_TYPE, value.c_str());
 		}
@@ -360,10 +509,31 @@ bool K2hAttrBuiltin::RawInitializeEnv(PK2HBATTRPACK pPack)
 			}
 		}
 	}
+	if(k2h_getenv(K2hAttrBuiltin::ATTR_ENV_COMPRESS, value)){
+		if(!K2hAttrBuiltin::SetCompressType(pPack, value.c_str())){
+			WAN_K2HPRN("environment %s has wrong value(%s), but continue...", K2hAttrBuiltin::ATTR_ENV_COMPRESS, value.c_str());
+		}
+	}
+	if(k2h_getenv(K2hAttrBuiltin::ATTR_ENV_COMPRESS_MIN, value)){
+		long long	minlen = atoll(value.c_str());
+		if(minlen < 0){
+			WAN_K2HPRN("environment %s is wrong value(%lld), but continue...", K2hAttrBuiltin::ATTR_ENV_COMPRESS_MIN, minlen);
+		}else{
+			pPack->CompMinLength = static_cast<size_t>(minlen);
+		}
+	}
+	if(k2h_getenv(K2hAttrBuiltin::ATTR_ENV_COMPRESS_LEVEL, value)){
+		pPack->CompLevel = atoi(value.c_str());
+	}
+	if(k2h_getenv(K2hAttrBuiltin::ATTR_ENV_COMPRESS_DICT, value)){
+		if(!K2hAttrBuiltin::LoadCompressDict(pPack, value.c_str())){
+			WAN_K2HPRN("Failed to load zstd dictionary from file %s, but continue...", value.c_str());
+		}
+	}
 	return true;
 }
 
-bool K2hAttrBuiltin::RawInitialize(PK2HBATTRPACK pPack, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire)
+bool K2hAttrBuiltin::RawInitialize(PK2HBATTRPACK pPack, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const char* comptype, const size_t* compmin, const int* complevel, const char* compdict)
 {
 	if(is_mtime){
 		pPack->IsAttrMTime = *is_mtime;
@@ -396,10 +566,24 @@ bool K2hAttrBuiltin::RawInitialize(PK2HBATTRPACK pPack, const bool* is_mtime, co
 			return false;
 		}
 	}
+	if(!ISEMPTYSTR(comptype) && !K2hAttrBuiltin::SetCompressType(pPack, comptype)){
+		ERR_K2HPRN("Failed to set compress type(%s).", comptype);
+		return false;
+	}
+	if(compmin){
+		pPack->CompMinLength = *compmin;
+	}
+	if(complevel){
+		pPack->CompLevel = *complevel;
+	}
+	if(!ISEMPTYSTR(compdict) && !K2hAttrBuiltin::LoadCompressDict(pPack, compdict)){
+		ERR_K2HPRN("Failed to load zstd dictionary from file %s", compdict);
+		return false;
+	}
 	return true;
 }
 
-bool K2hAttrBuiltin::Initialize(const K2HShm* pshm, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire)
+bool K2hAttrBuiltin::Initialize(const K2HShm* pshm, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const char* comptype, const size_t* compmin, const int* complevel, const char* compdict)
 {
 	if(!pshm){
 		ERR_K2HPRN("Parameter is wrong");
@@ -415,7 +599,7 @@ bool K2hAttrBuiltin::Initialize(const K2HShm* pshm, const bool* is_mtime, const
 		K2hAttrBuiltin::CleanAttrBuiltin(pshm);
 		return false;
 	}
-	if(!K2hAttrBuiltin::RawInitialize(pPack, is_mtime, is_defenc, passfile, is_history, expire)){
+	if(!K2hAttrBuiltin::RawInitialize(pPack, is_mtime, is_defenc, passfile, is_history, expire, comptype, compmin, complevel, compdict)){
 		ERR_K2HPRN("Failed to set preset attributes.");
 		K2hAttrBuiltin::CleanAttrBuiltin(pshm);
 		return false;
@@ -441,6 +625,31 @@ bool K2hAttrBuiltin::IsMarkHistory(const K2HShm* pshm)
 	return pPack->IsAttrHistory;
 }
 
+//
+// [NOTE]
+// The statistics are counted in this process for each shm.
+//
+bool K2hAttrBuiltin::GetCompressStats(const K2HShm* pshm, uint64_t& compcnt, uint64_t& orgbytes, uint64_t& compbytes, uint64_t& comptime, uint64_t& decompcnt, uint64_t& decomptime)
+{
+	PK2HBATTRPACK	pPack = K2hAttrBuiltin::GetBuiltinAttrPack(pshm);
+	if(!pPack){
+		compcnt		= 0;
+		orgbytes	= 0;
+		compbytes	= 0;
+		comptime	= 0;
+		decompcnt	= 0;
+		decomptime	= 0;
+		return false;
+	}
+	compcnt		= __sync_add_and_fetch(&(pPack->CompCount),		0);
+	orgbytes	= __sync_add_and_fetch(&(pPack->CompOrgBytes),	0);
+	compbytes	= __sync_add_and_fetch(&(pPack->CompBytes),		0);
+	comptime	= __sync_add_and_fetch(&(pPack->CompTimeNs),	0);
+	decompcnt	= __sync_add_and_fetch(&(pPack->DecompCount),	0);
+	decomptime	= __sync_add_and_fetch(&(pPack->DecompTimeNs),	0);
+	return true;
+}
+
 bool K2hAttrBuiltin::AddCryptPass(const K2HShm* pshm, const char* pPass, bool is_default_encrypt)
 {
 	if(!pshm || ISEMPTYSTR(pPass)){
@@ -551,7 +760,9 @@ bool K2hAttrBuiltin::IsHandleAttr(const unsigned char* key, size_t keylen) const
 		((strlen(K2hAttrBuiltin::ATTR_UNIQID)		+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_UNIQID,			key, keylen))	||
 		((strlen(K2hAttrBuiltin::ATTR_PUNIQID)		+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_PUNIQID,			key, keylen))	||
 		((strlen(K2hAttrBuiltin::ATTR_AES256_PBKDF2)+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_AES256_PBKDF2,	key, keylen))	||
-		((strlen(K2hAttrBuiltin::ATTR_AES256_MD5)	+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_AES256_MD5,		key, keylen))	)
+		((strlen(K2hAttrBuiltin::ATTR_AES256_GCM)	+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_AES256_GCM,		key, keylen))	||
+		((strlen(K2hAttrBuiltin::ATTR_AES256_MD5)	+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_AES256_MD5,		key, keylen))	||
+		((strlen(K2hAttrBuiltin::ATTR_COMPRESS)		+ 1) == keylen && 0 == memcmp(K2hAttrBuiltin::ATTR_COMPRESS,		key, keylen))	)
 	{
 		return true;
 	}
@@ -623,6 +834,35 @@ bool K2hAttrBuiltin::UpdateAttr(K2HAttrs& attrs)
 		}
 	}
 
+	// compress
+	//
+	// [NOTE]
+	// The value is compressed before encrypting, because encrypted data
+	// can not be compressed. If the compressed value is not smaller than
+	// original, the value is not compressed and does not have attribute.
+	//
+	if(!IS_ATTR_MASK_COMPRESS(AttrMask) && K2H_COMP_NO != pBuiltinAttrPack->CompType && byValue && 0 < ValLen && pBuiltinAttrPack->CompMinLength <= ValLen){
+		unsigned char*	compValue;
+		size_t			compValLen	= 0;
+		const char*		pCompName	= NULL;
+		if(NULL != (compValue = CompressValue(compValLen, &pCompName))){
+			// replace value pointer in base class.
+			K2H_Free(byAllocValue);
+			byAllocValue= compValue;
+			byValue		= byAllocValue;
+			ValLen		= compValLen;
+
+			if(!SetAttr(attrs, K2hAttrBuiltin::ATTR_COMPRESS, pCompName)){
+				ERR_K2HPRN("Could not set %s attribute.", K2hAttrBuiltin::ATTR_COMPRESS);
+				return false;
+			}
+		}else{
+			RemoveAttr(attrs, K2hAttrBuiltin::ATTR_COMPRESS);
+		}
+	}else{
+		RemoveAttr(attrs, K2hAttrBuiltin::ATTR_COMPRESS);
+	}
+
 	// encrypt
 	if(!IS_ATTR_MASK_ENCRYPT(AttrMask) && (!EncPass.empty() || pBuiltinAttrPack->IsDefaultEncrypt) && byValue && 0 < ValLen){
 		// get pass
@@ -636,20 +876,34 @@ bool K2hAttrBuiltin::UpdateAttr(K2HAttrs& attrs)
 			}
 			pass	= pBuiltinAttrPack->EncPassMap[pBuiltinAttrPack->DefaultPassMD5].strPass;
 			strmd5	= pBuiltinAttrPack->DefaultPassMD5;
-		}else{
-			strmd5	= to_md5_string(pass.c_str());
+		}else if(K2H_ENC_AES256_GCM != pBuiltinAttrPack->EncType){
+			if(!K2hAttrBuiltin::GetPassCache(pBuiltinAttrPack, pass, &strmd5)){
+				ERR_K2HPRN("Could not get md5 for encrypt pass.");
+				return false;
+			}
 		}
 
 		// encrypt
 		unsigned char*	encValue;
 		size_t			encValLen = 0;
+		const char*		pEncAttrName;
 		if(K2H_ENC_AES256_PBKDF1 == pBuiltinAttrPack->EncType){
-			encValue = k2h_encrypt_aes256_cbc(pass.c_str(), byValue, ValLen, encValLen);
-		}else{		// K2H_ENC_AES256_PBKDF2 == pBuiltinAttrPack->EncType
-			encValue = k2h_encrypt_aes256_cbc_pbkdf2(pass.c_str(), pBuiltinAttrPack->IterCount, byValue, ValLen, encValLen);
+			encValue	= k2h_encrypt_aes256_cbc(pass.c_str(), byValue, ValLen, encValLen);
+			pEncAttrName= K2hAttrBuiltin::ATTR_AES256_MD5;
+		}else if(K2H_ENC_AES256_PBKDF2 == pBuiltinAttrPack->EncType){
+			encValue	= k2h_encrypt_aes256_cbc_pbkdf2(pass.c_str(), pBuiltinAttrPack->IterCount, byValue, ValLen, encValLen);
+			pEncAttrName= K2hAttrBuiltin::ATTR_AES256_PBKDF2;
+		}else{		// K2H_ENC_AES256_GCM == pBuiltinAttrPack->EncType
+			unsigned char	key[K2H_ENCRYPT_GCM_KEY_LENGTH];
+			if(!K2hAttrBuiltin::GetPassCache(pBuiltinAttrPack, pass, &strmd5, pBuiltinAttrPack->IterCount, key)){
+				ERR_K2HPRN("Could not get md5 and key for encrypt pass.");
+				return false;
+			}
+			encValue	= k2h_encrypt_aes256_gcm(key, pBuiltinAttrPack->IterCount, byValue, ValLen, encValLen);
+			pEncAttrName= K2hAttrBuiltin::ATTR_AES256_GCM;
 		}
 		if(!encValue){
-			ERR_K2HPRN("Could not encrypt value by AES256 CBC PAD(PBKDF1 or PBKDF2).");
+			ERR_K2HPRN("Could not encrypt value by AES256(CBC PAD with PBKDF1 or PBKDF2, or GCM).");
 			return false;
 		}
 
@@ -663,12 +917,25 @@ bool K2hAttrBuiltin::UpdateAttr(K2HAttrs& attrs)
 		IsCahnged = true;
 
 		// set md5
-		if(!SetAttr(attrs, (K2H_ENC_AES256_PBKDF1 == pBuiltinAttrPack->EncType ? K2hAttrBuiltin::ATTR_AES256_MD5 : K2hAttrBuiltin::ATTR_AES256_PBKDF2), strmd5.c_str())){
-			ERR_K2HPRN("Could not set %s attribute.", (K2H_ENC_AES256_PBKDF1 == pBuiltinAttrPack->EncType ? K2hAttrBuiltin::ATTR_AES256_MD5 : K2hAttrBuiltin::ATTR_AES256_PBKDF2));
+		if(!SetAttr(attrs, pEncAttrName, strmd5.c_str())){
+			ERR_K2HPRN("Could not set %s attribute.", pEncAttrName);
 			return false;
 		}
+
+		// remove other encrypt type attributes, because GetEncryptType() must decide only one type.
+		if(K2hAttrBuiltin::ATTR_AES256_MD5 != pEncAttrName){
+			RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_MD5);
+		}
+		if(K2hAttrBuiltin::ATTR_AES256_PBKDF2 != pEncAttrName){
+			RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2);
+		}
+		if(K2hAttrBuiltin::ATTR_AES256_GCM != pEncAttrName){
+			RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_GCM);
+		}
 	}else{
-		RemoveAttr(attrs, (K2H_ENC_AES256_PBKDF1 == pBuiltinAttrPack->EncType ? K2hAttrBuiltin::ATTR_AES256_MD5 : K2hAttrBuiltin::ATTR_AES256_PBKDF2));
+		RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_MD5);
+		RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2);
+		RemoveAttr(attrs, K2hAttrBuiltin::ATTR_AES256_GCM);
 	}
 
 	// history
@@ -745,12 +1012,25 @@ void K2hAttrBuiltin::GetInfo(stringstream& ss) const
 		for(k2hepmap_t::const_iterator iter = pBuiltinAttrPack->EncPassMap.begin(); iter != pBuiltinAttrPack->EncPassMap.end(); ++iter){
 			ss << "    encrypt pass(\"MD5\":\"pass\")          \"" << iter->second.strMD5 << "\":\"" << iter->second.strPass << "\"" << endl;
 		}
+		ss << "  Attribute compress:                   " << (K2H_COMP_LZ4 == pBuiltinAttrPack->CompType ? K2H_COMPRESS_LZ4_NAME : K2H_COMP_ZSTD == pBuiltinAttrPack->CompType ? K2H_COMPRESS_ZSTD_NAME : "no") << endl;
+		if(K2H_COMP_NO != pBuiltinAttrPack->CompType){
+			ss << "    compress minimum length             " << pBuiltinAttrPack->CompMinLength << endl;
+			if(K2H_COMP_ZSTD == pBuiltinAttrPack->CompType){
+				ss << "    compress level                      " << pBuiltinAttrPack->CompLevel << endl;
+				if(pBuiltinAttrPack->pCompDict){
+					ss << "    compress dictionary id              " << pBuiltinAttrPack->pCompDict->dictid << endl;
+				}else{
+					ss << "    compress dictionary id              no" << endl;
+				}
+			}
+		}
 	}else{
 		ss << "  Attribute mtime:                      n/a" << endl;
 		ss << "  Attribute history:                    n/a" << endl;
 		ss << "  Attribute expire:                     n/a" << endl;
 		ss << "  Attribute default encrypt:            n/a" << endl;
 		ss << "  Attribute default enc pass MD5        n/a" << endl;
+		ss << "  Attribute compress:                   n/a" << endl;
 	}
 }
 
@@ -839,10 +1119,13 @@ bool K2hAttrBuiltin::IsExpire(K2HAttrs& attrs) const
 		ERR_K2HPRN("%s attribute value must be %zu byte, but value is %zu byte.", K2hAttrBuiltin::ATTR_EXPIRE, sizeof(struct timespec), vallen);
 		return false;
 	}
+	return K2hAttrBuiltin::IsExpireTime(*reinterpret_cast<const struct timespec*>(pval));
+}
 
-	// expire and now time
-	const struct timespec*	expire	= reinterpret_cast<const struct timespec*>(pval);
-	struct timespec			nowtime	= {0, 0};
+bool K2hAttrBuiltin::IsExpireTime(const struct timespec& expire)
+{
+	// now time
+	struct timespec	nowtime	= {0, 0};
 	if(-1 == clock_gettime(CLOCK_REALTIME_COARSE, &nowtime)){
 		WAN_K2HPRN("Failed to get clock time by errno(%d), but continue with time() result value...", errno);
 		nowtime.tv_sec	= time(NULL);
@@ -851,16 +1134,92 @@ bool K2hAttrBuiltin::IsExpire(K2HAttrs& attrs) const
 
 	// check
 	bool	is_expire = false;
-	if(expire->tv_sec < nowtime.tv_sec){
+	if(expire.tv_sec < nowtime.tv_sec){
 		is_expire = true;
-	}else if(expire->tv_sec == nowtime.tv_sec){
-		if(expire->tv_nsec < nowtime.tv_nsec){
+	}else if(expire.tv_sec == nowtime.tv_sec){
+		if(expire.tv_nsec < nowtime.tv_nsec){
 			is_expire = true;
 		}
 	}
 	return is_expire;
 }
 
+//
+// Reads flags for expire, history marker, encryption and compression from serialized
+// attributes binary(see K2HAttrs) without making any object.
+//
+// [NOTE]
+// These flags are decided only by builtin attributes, and attribute
+// plugins do not affect them. Thus the caller can check expire and
+// history marker without K2hAttrOpsMan which loads plugins for each
+// calling. Only if the value is encrypted or compressed, the caller needs
+// K2hAttrOpsMan for decoding.
+// The result is as same as IsExpire(), IsHistory(), IsValueEncrypted() and
+// IsValueCompressed().
+//
+bool K2hAttrBuiltin::GetAttrFlags(const unsigned char* pattrs, size_t attrslength, K2HATTRFLAGS& attrflags)
+{
+	attrflags.flags			= K2HATTR_FLAG_NO;
+	attrflags.expire.tv_sec	= 0;
+	attrflags.expire.tv_nsec= 0;
+
+	if(!pattrs || attrslength < sizeof(size_t)){
+		return true;
+	}
+	size_t	expirelen	= strlen(K2hAttrBuiltin::ATTR_EXPIRE) + 1;
+	size_t	hismarklen	= strlen(K2hAttrBuiltin::ATTR_HISMARK) + 1;
+	size_t	md5len		= strlen(K2hAttrBuiltin::ATTR_AES256_MD5) + 1;
+	size_t	pbkdf2len	= strlen(K2hAttrBuiltin::ATTR_AES256_PBKDF2) + 1;
+	size_t	gcmlen		= strlen(K2hAttrBuiltin::ATTR_AES256_GCM) + 1;
+	size_t	complen		= strlen(K2hAttrBuiltin::ATTR_COMPRESS) + 1;
+
+	size_t					TotalCount	= *reinterpret_cast<const size_t*>(pattrs);
+	size_t					rest_length	= attrslength - sizeof(size_t);
+	const unsigned char*	byReadPos	= &pattrs[sizeof(size_t)];
+
+	for(size_t cnt = 0; cnt < TotalCount; ++cnt){
+		if(rest_length < (sizeof(size_t) * 2)){
+			ERR_K2HPRN("Not enough length for loading.");
+			return false;
+		}
+		size_t					keylen	= *reinterpret_cast<const size_t*>(byReadPos);
+		size_t					vallen	= *reinterpret_cast<const size_t*>(&byReadPos[sizeof(size_t)]);
+		const unsigned char*	pkey	= &byReadPos[sizeof(size_t) * 2];
+		const unsigned char*	pval	= &byReadPos[sizeof(size_t) * 2 + keylen];
+		if(rest_length < (sizeof(size_t) * 2 + keylen + vallen)){
+			ERR_K2HPRN("Not enough length for loading.");
+			return false;
+		}
+
+		if(expirelen == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_EXPIRE, keylen)){
+			if(sizeof(struct timespec) == vallen){
+				attrflags.flags		|= K2HATTR_FLAG_EXPIRE;
+				memcpy(&(attrflags.expire), pval, sizeof(struct timespec));
+			}else{
+				ERR_K2HPRN("%s attribute value must be %zu byte, but value is %zu byte.", K2hAttrBuiltin::ATTR_EXPIRE, sizeof(struct timespec), vallen);
+				attrflags.flags		&= ~K2HATTR_FLAG_EXPIRE;
+			}
+		}else if(hismarklen == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_HISMARK, keylen)){
+			if(sizeof(bool) == vallen && *reinterpret_cast<const bool*>(pval)){
+				attrflags.flags		|= K2HATTR_FLAG_HISTORY;
+			}else{
+				attrflags.flags		&= ~K2HATTR_FLAG_HISTORY;
+			}
+		}else if((md5len == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_AES256_MD5, keylen)) || (pbkdf2len == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_AES256_PBKDF2, keylen)) || (gcmlen == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_AES256_GCM, keylen))){
+			if(0 < vallen){
+				attrflags.flags		|= K2HATTR_FLAG_ENCRYPT;
+			}
+		}else if(complen == keylen && 0 == memcmp(pkey, K2hAttrBuiltin::ATTR_COMPRESS, keylen)){
+			if(0 < vallen){
+				attrflags.flags		|= K2HATTR_FLAG_COMPRESS;
+			}
+		}
+		byReadPos	+= (sizeof(size_t) * 2 + keylen + vallen);
+		rest_length -= (sizeof(size_t) * 2 + keylen + vallen);
+	}
+	return true;
+}
+
 bool K2hAttrBuiltin::GetTime(K2HAttrs& attrs, const char* key, struct timespec& time) const
 {
 	const unsigned char*	pval	= NULL;
@@ -897,10 +1256,12 @@ bool K2hAttrBuiltin::GetUniqId(K2HAttrs& attrs, bool is_parent, string& uniqid)
 bool K2hAttrBuiltin::GetEncryptKeyMd5(K2HAttrs& attrs, string* enckeymd5) const
 {
 	const char*	pval = NULL;
-	if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2, &pval) || !pval){		// check AES256 CBC PBKDF2 type
-		if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_MD5, &pval) || !pval){		// check AES256 CBC PBKDF1 type
-			// attr does not have key
-			return false;
+	if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_GCM, &pval) || !pval){			// check AES256 GCM type
+		if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2, &pval) || !pval){	// check AES256 CBC PBKDF2 type
+			if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_MD5, &pval) || !pval){	// check AES256 CBC PBKDF1 type
+				// attr does not have key
+				return false;
+			}
 		}
 	}
 	if(enckeymd5){
@@ -913,7 +1274,10 @@ bool K2hAttrBuiltin::GetEncryptType(K2HAttrs& attrs, K2HATTR_ENC_TYPE& enctype)
 {
 	const char*	pval	= NULL;
 	bool		result	= false;
-	if(GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2, &pval) && pval){			// AES256 CBC PBKDF2 type
+	if(GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_GCM, &pval) && pval){				// AES256 GCM type
+		enctype	= K2H_ENC_AES256_GCM;
+		result	= true;
+	}else if(GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_PBKDF2, &pval) && pval){	// AES256 CBC PBKDF2 type
 		enctype	= K2H_ENC_AES256_PBKDF2;
 		result	= true;
 	}else if(GetAttr(attrs, K2hAttrBuiltin::ATTR_AES256_MD5, &pval) && pval){		// AES256 CBC PBKDF1 type
@@ -923,6 +1287,69 @@ bool K2hAttrBuiltin::GetEncryptType(K2HAttrs& attrs, K2HATTR_ENC_TYPE& enctype)
 	return result;
 }
 
+bool K2hAttrBuiltin::GetCompressType(K2HAttrs& attrs, K2HATTR_COMP_TYPE& comptype) const
+{
+	const char*	pval = NULL;
+	if(!GetAttr(attrs, K2hAttrBuiltin::ATTR_COMPRESS, &pval) || !pval){
+		// attr does not have key
+		return false;
+	}
+	if(0 == strcmp(pval, K2H_COMPRESS_LZ4_NAME)){
+		comptype = K2H_COMP_LZ4;
+	}else if(0 == strcmp(pval, K2H_COMPRESS_ZSTD_NAME)){
+		comptype = K2H_COMP_ZSTD;
+	}else{
+		WAN_K2HPRN("%s attribute has unknown compress type(%s).", K2hAttrBuiltin::ATTR_COMPRESS, pval);
+		return false;
+	}
+	return true;
+}
+
+//
+// Returns compressed value and the name of compress type for attribute.
+// If the value is not smaller after compressing, returns NULL.
+//
+unsigned char* K2hAttrBuiltin::CompressValue(size_t& complen, const char** ppname) const
+{
+	if(!pBuiltinAttrPack || !byValue || 0 == ValLen){
+		return NULL;
+	}
+	uint64_t		start = k2h_thread_cputime_ns();
+	unsigned char*	pcomp;
+	if(K2H_COMP_LZ4 == pBuiltinAttrPack->CompType){
+		pcomp	= k2h_compress_lz4(byValue, ValLen, complen);
+		*ppname	= K2H_COMPRESS_LZ4_NAME;
+	}else{	// K2H_COMP_ZSTD == pBuiltinAttrPack->CompType
+		pcomp	= k2h_compress_zstd(pBuiltinAttrPack->pCompDict, pBuiltinAttrPack->CompLevel, byValue, ValLen, complen);
+		*ppname	= K2H_COMPRESS_ZSTD_NAME;
+	}
+	uint64_t		elapsed = k2h_thread_cputime_ns() - start;
+
+	// statistics(value which is not compressed is counted as same size)
+	__sync_add_and_fetch(&(pBuiltinAttrPack->CompCount),	1);
+	__sync_add_and_fetch(&(pBuiltinAttrPack->CompOrgBytes),	static_cast<uint64_t>(ValLen));
+	__sync_add_and_fetch(&(pBuiltinAttrPack->CompBytes),	static_cast<uint64_t>(pcomp ? complen : ValLen));
+	__sync_add_and_fetch(&(pBuiltinAttrPack->CompTimeNs),	elapsed);
+
+	return pcomp;
+}
+
+unsigned char* K2hAttrBuiltin::DecompressValue(K2HATTR_COMP_TYPE comptype, const unsigned char* pvalue, size_t length, size_t& declen) const
+{
+	uint64_t		start = k2h_thread_cputime_ns();
+	unsigned char*	pdec;
+	if(K2H_COMP_LZ4 == comptype){
+		pdec = k2h_decompress_lz4(pvalue, length, declen);
+	}else{	// K2H_COMP_ZSTD == comptype
+		pdec = k2h_decompress_zstd(pBuiltinAttrPack->pCompDict, pvalue, length, declen);
+	}
+	if(pdec){
+		__sync_add_and_fetch(&(pBuiltinAttrPack->DecompCount),	1);
+		__sync_add_and_fetch(&(pBuiltinAttrPack->DecompTimeNs),	k2h_thread_cputime_ns() - start);
+	}
+	return pdec;
+}
+
 // 
 // This method returns copied the Value if the value is not encrypted.
 // If the value is encrypted, there is following pattern.
@@ -932,6 +1359,8 @@ bool K2hAttrBuiltin::GetEncryptType(K2HAttrs& attrs, K2HATTR_ENC_TYPE& enctype)
 //    if found it, do decrypt value.
 // 3) if not found attrs's md5 in loaded pass list, check this object's
 //    EncPass. if it has correct md5, do decrypt value.
+// After decrypting, if the value is compressed, this method decompresses
+// it. Thus the result is always original value.
 //
 unsigned char* K2hAttrBuiltin::GetDecryptValue(K2HAttrs& attrs, const char* encpass, size_t& declen) const
 {
@@ -954,7 +1383,8 @@ unsigned char* K2hAttrBuiltin::GetDecryptValue(K2HAttrs& attrs, const char* encp
 			// not specify encrypt pass, so search pass from system loaded pass by md5
 			if(pBuiltinAttrPack->EncPassMap.end() == pBuiltinAttrPack->EncPassMap.find(enckeymd5)){
 				// not found in list, so compare object's EncPass
-				if(EncPass.empty() || enckeymd5 != to_md5_string(EncPass.c_str())){
+				string	strmd5;
+				if(EncPass.empty() || !K2hAttrBuiltin::GetPassCache(pBuiltinAttrPack, EncPass, &strmd5) || enckeymd5 != strmd5){
 					ERR_K2HPRN("There is no match encrypt pass in list.");
 					return presult;
 				}
@@ -964,7 +1394,8 @@ unsigned char* K2hAttrBuiltin::GetDecryptValue(K2HAttrs& attrs, const char* encp
 			}
 		}else{
 			// specified encrypt pass, so check it's md5
-			if(enckeymd5 != to_md5_string(encpass)){
+			string	strmd5;
+			if(!K2hAttrBuiltin::GetPassCache(pBuiltinAttrPack, string(encpass), &strmd5) || enckeymd5 != strmd5){
 				ERR_K2HPRN("Specified pass is not as same as encrypted value's pass.");
 				return presult;
 			}
@@ -974,15 +1405,39 @@ unsigned char* K2hAttrBuiltin::GetDecryptValue(K2HAttrs& attrs, const char* encp
 		// do decrypt
 		if(K2H_ENC_AES256_PBKDF1 == enctype){
 			presult = k2h_decrypt_aes256_cbc(strPass.c_str(), byValue, ValLen, declen);
-		}else{	// K2H_ENC_AES256_PBKDF2 == enctype
+		}else if(K2H_ENC_AES256_PBKDF2 == enctype){
 			presult = k2h_decrypt_aes256_cbc_pbkdf2(strPass.c_str(), byValue, ValLen, declen);
+		}else{	// K2H_ENC_AES256_GCM == enctype
+			unsigned char	key[K2H_ENCRYPT_GCM_KEY_LENGTH];
+			int				iter;
+			if(-1 == (iter = k2h_get_aes256_gcm_iteration_count(byValue, ValLen)) || !K2hAttrBuiltin::GetPassCache(pBuiltinAttrPack, strPass, NULL, iter, key)){
+				ERR_K2HPRN("Could not get key for decrypting value.");
+				return presult;
+			}
+			presult = k2h_decrypt_aes256_gcm(key, byValue, ValLen, declen);
 		}
 		if(!presult){
 			ERR_K2HPRN("Failed to decrypt value by pass.");
 			return presult;
 		}
-	}else{
-		// value is not encrypted, so copy value to result
+	}
+
+	K2HATTR_COMP_TYPE	comptype = K2H_COMP_NO;
+	if(GetCompressType(attrs, comptype)){
+		// value is compressed(decrypted value or raw value)
+		unsigned char*	pdec;
+		size_t			complen = (presult ? declen : ValLen);
+		if(NULL == (pdec = DecompressValue(comptype, (presult ? presult : byValue), complen, declen))){
+			ERR_K2HPRN("Failed to decompress value.");
+			K2H_Free(presult);
+			declen = 0;
+			return NULL;
+		}
+		K2H_Free(presult);
+		presult = pdec;
+
+	}else if(!presult){
+		// value is not encrypted and not compressed, so copy value to result
 		if(NULL == (presult = reinterpret_cast<unsigned char*>(malloc(ValLen)))){
 			ERR_K2HPRN("Could not allocation memory.");
 			return presult;
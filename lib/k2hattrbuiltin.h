@@ -22,9 +22,11 @@
 #ifndef	K2HATTRBUILTIN_H
 #define	K2HATTRBUILTIN_H
 
+#include <fullock/flckstructure.h>
 #include <map>
 #include <string>
 #include "k2hattrop.h"
+#include "k2hcompression.h"
 
 //---------------------------------------------------------
 // Structure
@@ -33,9 +35,19 @@
 
 typedef enum _k2hattr_enc_type{							// k2hattr encrypt type
 	K2H_ENC_AES256_PBKDF1	= 0,						// AES256 CBC PAD with PBKDF1
-	K2H_ENC_AES256_PBKDF2	= 1							// AES256 CBC PAD with PBKDF2
+	K2H_ENC_AES256_PBKDF2	= 1,						// AES256 CBC PAD with PBKDF2
+	K2H_ENC_AES256_GCM		= 2							// AES256 GCM with PBKDF2 key cached for each pass
 }K2HATTR_ENC_TYPE;
 
+typedef enum _k2hattr_comp_type{						// k2hattr compress type
+	K2H_COMP_NO				= 0,						// not compress
+	K2H_COMP_LZ4			= 1,						// LZ4 block
+	K2H_COMP_ZSTD			= 2							// zstd(with dictionary if it is loaded)
+}K2HATTR_COMP_TYPE;
+
+#define	K2H_COMPRESS_MIN_LENGTH					256		// default minimum value length for compressing
+#define	K2H_COMPRESS_ZSTD_LEVEL					3		// default zstd compression level
+
 // [NOTE]
 // In the future, k2hash could also support encryption of not AES256.
 // In that case, it would be better to add the type of encryption to
@@ -47,10 +59,16 @@ typedef enum _k2hattr_enc_type{							// k2hattr encrypt type
 typedef struct k2h_encrypt_pass{
 	std::string		strMD5;
 	std::string		strPass;
+	int				KeyIterCount;			// iteration count for strKey, 0 means strKey is not made
+	std::string		strKey;					// binary key for AES256 GCM made by PBKDF2
+
+	k2h_encrypt_pass(void) : strMD5(""), strPass(""), KeyIterCount(0), strKey("") { }
 }K2HENCPASS, *PK2HENCPASS;
 
 typedef std::map<std::string, K2HENCPASS>		k2hepmap_t;
 
+#define	K2H_ENCPASS_CACHE_MAX					64		// maximum count of pass cache
+
 typedef struct k2h_builtin_attr_pack{
 	bool				IsAttrMTime;			// whether stamp last modified time
 	bool				IsAttrHistory;			// whether build versioning
@@ -60,9 +78,21 @@ typedef struct k2h_builtin_attr_pack{
 	int					IterCount;				// iteration count for PBKDF2 key
 	K2HATTR_ENC_TYPE	EncType;				// encrypt type(default AES256 CBC with PBKDF2)
 	k2hepmap_t			EncPassMap;				// map for encrypt pass
-
-	k2h_builtin_attr_pack(void) : IsAttrMTime(false), IsAttrHistory(false), AttrExpireSec(-1), IsDefaultEncrypt(false), DefaultPassMD5(""), IterCount(K2H_PPBKDF2_KEY_ITERATION_COUNT), EncType(K2H_ENC_AES256_PBKDF2) { }	// -1 = K2hAttrBuiltin::NOT_EXPIRE
-	~k2h_builtin_attr_pack(void) { }
+	k2hepmap_t			PassCache;				// cache map for md5 and AES256 GCM key, key of map is pass(not md5)
+	volatile int		PassCacheLockVal;		// lock for PassCache
+	K2HATTR_COMP_TYPE	CompType;				// compress type(default not compress)
+	size_t				CompMinLength;			// minimum value length for compressing
+	int					CompLevel;				// compression level for zstd
+	PK2HCOMPDICT		pCompDict;				// dictionary for zstd
+	volatile uint64_t	CompCount;				// statistics for compression(these are updated by atomic)
+	volatile uint64_t	CompOrgBytes;
+	volatile uint64_t	CompBytes;
+	volatile uint64_t	CompTimeNs;
+	volatile uint64_t	DecompCount;
+	volatile uint64_t	DecompTimeNs;
+
+	k2h_builtin_attr_pack(void) : IsAttrMTime(false), IsAttrHistory(false), AttrExpireSec(-1), IsDefaultEncrypt(false), DefaultPassMD5(""), IterCount(K2H_PPBKDF2_KEY_ITERATION_COUNT), EncType(K2H_ENC_AES256_PBKDF2), PassCacheLockVal(FLCK_NOSHARED_MUTEX_VAL_UNLOCKED), CompType(K2H_COMP_NO), CompMinLength(K2H_COMPRESS_MIN_LENGTH), CompLevel(K2H_COMPRESS_ZSTD_LEVEL), pCompDict(NULL), CompCount(0), CompOrgBytes(0), CompBytes(0), CompTimeNs(0), DecompCount(0), DecompTimeNs(0) { }	// -1 = K2hAttrBuiltin::NOT_EXPIRE
+	~k2h_builtin_attr_pack(void) { k2h_free_zstd_dict(pCompDict); }
 }K2HBATTRPACK, *PK2HBATTRPACK;
 
 typedef std::map<const K2HShm*, PK2HBATTRPACK>	k2hbapackmap_t;
@@ -83,6 +113,10 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		static const char*		ATTR_ENV_ENCFILE;
 		static const char*		ATTR_ENV_ENC_TYPE;
 		static const char*		ATTR_ENV_ENC_ITER;
+		static const char*		ATTR_ENV_COMPRESS;
+		static const char*		ATTR_ENV_COMPRESS_MIN;
+		static const char*		ATTR_ENV_COMPRESS_LEVEL;
+		static const char*		ATTR_ENV_COMPRESS_DICT;
 
 		static const time_t		NOT_EXPIRE = -1;
 
@@ -98,7 +132,9 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		static const char*		ATTR_PUNIQID;
 		static const char*		ATTR_AES256_MD5;
 		static const char*		ATTR_AES256_PBKDF2;
+		static const char*		ATTR_AES256_GCM;
 		static const char*		ATTR_HISMARK;
+		static const char*		ATTR_COMPRESS;
 
 		// Mask values
 		//
@@ -115,6 +151,7 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		static const int		ATTR_MASK_HISTORY	= 1 << 2;
 		static const int		ATTR_MASK_EXPIRE	= 1 << 3;
 		static const int		ATTR_MASK_EXPIRE_KP	= 1 << 4;		// Special mask
+		static const int		ATTR_MASK_COMPRESS	= 1 << 5;
 
 	protected:
 		PK2HBATTRPACK			pBuiltinAttrPack;
@@ -130,9 +167,12 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		static PK2HBATTRPACK GetBuiltinAttrPack(const K2HShm* pshm);
 		static bool ClearEncryptPassMap(PK2HBATTRPACK pPack);
 		static int LoadEncryptPassMap(PK2HBATTRPACK pPack, const char* pfile);
+		static bool GetPassCache(PK2HBATTRPACK pPack, const std::string& pass, std::string* pmd5, int iter = 0, unsigned char* pkey = NULL);
 
+		static bool SetCompressType(PK2HBATTRPACK pPack, const char* pcomptype);
+		static bool LoadCompressDict(PK2HBATTRPACK pPack, const char* pfile);
 		static bool RawInitializeEnv(PK2HBATTRPACK pPack);
-		static bool RawInitialize(PK2HBATTRPACK pPack, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire);
+		static bool RawInitialize(PK2HBATTRPACK pPack, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const char* comptype, const size_t* compmin, const int* complevel, const char* compdict);
 
 		bool MarkHistoryEx(K2HAttrs& attrs, bool is_mark) const;
 
@@ -140,13 +180,20 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		bool GetUniqId(K2HAttrs& attrs, bool is_parent, std::string& uniqid) const;
 		bool GetEncryptKeyMd5(K2HAttrs& attrs, std::string* enckeymd5) const;
 		bool GetEncryptType(K2HAttrs& attrs, K2HATTR_ENC_TYPE& enctype) const;
+		bool GetCompressType(K2HAttrs& attrs, K2HATTR_COMP_TYPE& comptype) const;
+		unsigned char* CompressValue(size_t& complen, const char** ppname) const;
+		unsigned char* DecompressValue(K2HATTR_COMP_TYPE comptype, const unsigned char* pvalue, size_t length, size_t& declen) const;
 
 	public:
 		static bool CleanAttrBuiltin(const K2HShm* pshm);
-		static bool Initialize(const K2HShm* pshm, const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL);
+		static bool Initialize(const K2HShm* pshm, const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL, const char* comptype = NULL, const size_t* compmin = NULL, const int* complevel = NULL, const char* compdict = NULL);
 		static bool IsInitialized(const K2HShm* pshm) { return (NULL != K2hAttrBuiltin::GetBuiltinAttrPack(pshm)); }
 		static bool IsMarkHistory(const K2HShm* pshm);
 		static bool AddCryptPass(const K2HShm* pshm, const char* pPass, bool is_default_encrypt = false);
+		static bool GetAttrFlags(const unsigned char* pattrs, size_t attrslength, K2HATTRFLAGS& attrflags);
+		static bool IsExpireTime(const struct timespec& expire);
+		static bool GetCompressStats(const K2HShm* pshm, uint64_t& compcnt, uint64_t& orgbytes, uint64_t& compbytes, uint64_t& comptime, uint64_t& decompcnt, uint64_t& decomptime);
+		static bool IsExpire(const K2HATTRFLAGS& attrflags) { return (0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE) && K2hAttrBuiltin::IsExpireTime(attrflags.expire)); }
 
 		K2hAttrBuiltin(void);
 		virtual ~K2hAttrBuiltin(void);
@@ -172,6 +219,7 @@ class K2hAttrBuiltin : public K2hAttrOpsBase
 		bool GetUniqId(K2HAttrs& attrs, std::string& uniqid) const { return GetUniqId(attrs, false, uniqid); }
 		bool GetParentUniqId(K2HAttrs& attrs, std::string& uniqid) const { return GetUniqId(attrs, true, uniqid); }
 		bool IsValueEncrypted(K2HAttrs& attrs) const { return GetEncryptKeyMd5(attrs, NULL); }
+		bool IsValueCompressed(K2HAttrs& attrs) const { K2HATTR_COMP_TYPE comptype; return GetCompressType(attrs, comptype); }
 		bool GetEncryptKeyMd5(K2HAttrs& attrs, std::string& enckeymd5) const { return GetEncryptKeyMd5(attrs, &enckeymd5); }
 		unsigned char* GetDecryptValue(K2HAttrs& attrs, const char* encpass, size_t& declen) const;
 		bool IsHistory(K2HAttrs& attrs) const;
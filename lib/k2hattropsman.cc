@@ -19,6 +19,9 @@
  *
  */
 
+#include <fullock/flckstructure.h>
+#include <fullock/flckbaselist.tcc>
+
 #include "k2hcommon.h"
 #include "k2hattropsman.h"
 #include "k2hutil.h"
@@ -32,17 +35,26 @@ using namespace std;
 inline int GetBuiltinMaskValue(K2hAttrOpsMan::ATTRINITTYPE type)
 {
 	if(K2hAttrOpsMan::OPSMAN_MASK_ALL == type){
-		return (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE);
+		return (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE | K2hAttrBuiltin::ATTR_MASK_COMPRESS);
 	}else if(K2hAttrOpsMan::OPSMAN_MASK_HIS_EXPIREKP == type){
 		return (K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP);
 	}else if(K2hAttrOpsMan::OPSMAN_MASK_TRANSQUEUEKEY == type){
-		return (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP);
+		return (K2hAttrBuiltin::ATTR_MASK_MTIME | K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_EXPIRE_KP | K2hAttrBuiltin::ATTR_MASK_COMPRESS);
+	}else if(K2hAttrOpsMan::OPSMAN_MASK_RAW_VALUE == type){
+		return (K2hAttrBuiltin::ATTR_MASK_ENCRYPT | K2hAttrBuiltin::ATTR_MASK_HISTORY | K2hAttrBuiltin::ATTR_MASK_COMPRESS);
 	}else if(K2hAttrOpsMan::OPSMAN_MASK_NORMAL == type){
 		return K2hAttrBuiltin::ATTR_MASK_NO;
 	}
 	return K2hAttrBuiltin::ATTR_MASK_NO;
 }
 
+//---------------------------------------------------------
+// K2hAttrOpsMan Class Variables
+//---------------------------------------------------------
+const size_t			K2hAttrOpsMan::CHAIN_POOL_MAX;
+volatile int			K2hAttrOpsMan::ChainLockVal	= FLCK_NOSHARED_MUTEX_VAL_UNLOCKED;
+volatile unsigned long	K2hAttrOpsMan::ChainVersion	= 0;
+
 //---------------------------------------------------------
 // K2hAttrOpsMan Class Methods
 //---------------------------------------------------------
@@ -55,9 +67,145 @@ k2hattrlibmap_t& K2hAttrOpsMan::GetLibMap(void)
 	return PluginLibs;
 }
 
-bool K2hAttrOpsMan::InitializeCommonAttr(const K2HShm* pshm, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const strarr_t* pluginlibs)
+k2hattropschains_t& K2hAttrOpsMan::GetChainPool(void)
+{
+	static k2hattropschains_t	ChainPool;				// singleton
+	return ChainPool;
+}
+
+//
+// Takes a chain for shm and type from pool, returns NULL if there is
+// no chain in pool. Old version chains found in pool are discarded.
+//
+PK2HATTROPSCHAIN K2hAttrOpsMan::PopChain(const K2HShm* pshm, int type)
+{
+	PK2HATTROPSCHAIN	pchain	= NULL;
+	k2hattropschains_t	oldchains;
+	unsigned long		version	= __sync_add_and_fetch(&K2hAttrOpsMan::ChainVersion, 0);
+
+	while(!fullock::flck_trylock_noshared_mutex(&K2hAttrOpsMan::ChainLockVal));	// LOCK
+	k2hattropschains_t&	pool = K2hAttrOpsMan::GetChainPool();
+	for(k2hattropschains_t::iterator iter = pool.begin(); iter != pool.end(); ){
+		if(version != (*iter)->version){
+			oldchains.push_back(*iter);
+			iter = pool.erase(iter);
+		}else if(!pchain && pshm == (*iter)->pshm && type == (*iter)->type){
+			pchain	= *iter;
+			iter	= pool.erase(iter);
+		}else{
+			++iter;
+		}
+	}
+	fullock::flck_unlock_noshared_mutex(&K2hAttrOpsMan::ChainLockVal);			// UNLOCK
+
+	for(k2hattropschains_t::iterator iter = oldchains.begin(); iter != oldchains.end(); ++iter){
+		K2hAttrOpsMan::FreeChain(*iter);
+	}
+	return pchain;
+}
+
+//
+// Makes new chain which has attribute plugin objects and builtin object.
+// Each object in chain does not have key/value and parameters, those are
+// set in Initialize().
+//
+// [NOTE]
+// Builtin attribute plugin must be added lastest position in list.
+// Because the plugin changes value for encrypting when the flag is enabled.
+//
+PK2HATTROPSCHAIN K2hAttrOpsMan::BuildChain(const K2HShm* pshm, int type)
+{
+	PK2HATTROPSCHAIN	pchain	= new K2HATTROPSCHAIN;
+	pchain->pshm				= pshm;
+	pchain->type				= type;
+	pchain->version				= __sync_add_and_fetch(&K2hAttrOpsMan::ChainVersion, 0);
+
+	if(K2hAttrOpsMan::OPSMAN_MASK_ALL != type){
+		// if has lib list in map, make attr plugin objects from plugin library list, and push object list.
+		k2hattrlibmap_t::const_iterator	miter = K2hAttrOpsMan::GetLibMap().find(pshm);
+		if(K2hAttrOpsMan::GetLibMap().end() != miter){
+			const k2hattrliblist_t*	plist = miter->second;
+
+			if(plist){
+				for(k2hattrliblist_t::const_iterator liter = plist->begin(); liter != plist->end(); ++liter){
+					const K2hAttrPluginLib*	ploaded = *liter;
+					K2hAttrPlugin*			pPlugin = new K2hAttrPlugin(ploaded);
+
+					if(!K2hAttrOpsBase::AddAttrOpArray(pchain->attroplist, pPlugin)){
+						ERR_K2HPRN("Failed to adding attr plugin(%s).", ploaded->GetVersionInfo());
+						K2H_Delete(pPlugin);
+						K2hAttrOpsMan::FreeChain(pchain);
+						return NULL;
+					}
+				}
+			}
+		}
+	}
+
+	// check builtin initialized
+	if(!K2hAttrBuiltin::IsInitialized(pshm)){
+		MSG_K2HPRN("builtin attribute is not initialized yet, so initialize it here.");
+
+		if(!K2hAttrBuiltin::Initialize(pshm)){
+			ERR_K2HPRN("Could not initialize to builtin attribute.");
+			K2hAttrOpsMan::FreeChain(pchain);
+			return NULL;
+		}
+	}
+
+	// make builtin and push it
+	K2hAttrBuiltin*	pBuiltin = new K2hAttrBuiltin();
+	if(!K2hAttrOpsBase::AddAttrOpArray(pchain->attroplist, pBuiltin)){
+		ERR_K2HPRN("Failed to adding builtin attr plugin(%s).", pBuiltin->GetVersionInfo());
+		K2H_Delete(pBuiltin);
+		K2hAttrOpsMan::FreeChain(pchain);
+		return NULL;
+	}
+	return pchain;
+}
+
+//
+// Returns the chain to pool, the chain is discarded if it is old version
+// or pool is full.
+//
+void K2hAttrOpsMan::PushChain(PK2HATTROPSCHAIN pchain)
 {
-	if(!K2hAttrBuiltin::Initialize(pshm, is_mtime, is_defenc, passfile, is_history, expire)){
+	if(!pchain){
+		return;
+	}
+	bool	is_pooled = false;
+
+	while(!fullock::flck_trylock_noshared_mutex(&K2hAttrOpsMan::ChainLockVal));	// LOCK
+	k2hattropschains_t&	pool = K2hAttrOpsMan::GetChainPool();
+	if(pchain->version == K2hAttrOpsMan::ChainVersion && pool.size() < K2hAttrOpsMan::CHAIN_POOL_MAX){
+		pool.push_back(pchain);
+		is_pooled = true;
+	}
+	fullock::flck_unlock_noshared_mutex(&K2hAttrOpsMan::ChainLockVal);			// UNLOCK
+
+	if(!is_pooled){
+		K2hAttrOpsMan::FreeChain(pchain);
+	}
+}
+
+void K2hAttrOpsMan::FreeChain(PK2HATTROPSCHAIN pchain)
+{
+	if(!pchain){
+		return;
+	}
+	for(k2hattroplist_t::iterator iter = pchain->attroplist.begin(); iter != pchain->attroplist.end(); ++iter){
+		K2hAttrOpsBase*	pAttrOp = *iter;
+		K2H_Delete(pAttrOp);
+	}
+	pchain->attroplist.clear();
+	K2H_Delete(pchain);
+}
+
+bool K2hAttrOpsMan::InitializeCommonAttr(const K2HShm* pshm, const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const strarr_t* pluginlibs, const char* comptype, const size_t* compmin, const int* complevel, const char* compdict)
+{
+	K2hAttrOpsMan::UpdateChainVersion();
+
+	if(!K2hAttrBuiltin::Initialize(pshm, is_mtime, is_defenc, passfile, is_history, expire, comptype, compmin, complevel, compdict)){
 		ERR_K2HPRN("Failed to initialize builtin attribute by shm.");
 		return false;
 	}
@@ -117,6 +265,8 @@ bool K2hAttrOpsMan::AddPluginLib(const K2HShm* pshm, const char* path)
 		// append library
 		plist->push_back(pLib);
 	}
+	K2hAttrOpsMan::UpdateChainVersion();
+
 	return true;
 }
 
@@ -174,6 +324,12 @@ bool K2hAttrOpsMan::RemovePluginLib(const K2HShm* pshm)
 
 bool K2hAttrOpsMan::CleanCommonAttr(const K2HShm* pshm)
 {
+	// [NOTE]
+	// Pooled chains may have plugin objects which use the libraries, so
+	// those chains are discarded at next PopChain().
+	//
+	K2hAttrOpsMan::UpdateChainVersion();
+
 	bool	result = true;
 	if(!K2hAttrOpsMan::RemoveBuiltinAttr(pshm)){
 		ERR_K2HPRN("Failed to clean builtin attribute by shm.");
@@ -218,7 +374,7 @@ bool K2hAttrOpsMan::GetVersionInfos(const K2HShm* pshm, strarr_t& verinfos)
 //---------------------------------------------------------
 // K2hAttrOpsMan Methods
 //---------------------------------------------------------
-K2hAttrOpsMan::K2hAttrOpsMan(void) : byKey(NULL), KeyLen(0), byValue(NULL), ValLen(0), byUpdateValue(NULL), UpdateValLen(0)
+K2hAttrOpsMan::K2hAttrOpsMan(void) : pChain(NULL), byKey(NULL), KeyLen(0), byValue(NULL), ValLen(0), byUpdateValue(NULL), UpdateValLen(0)
 {
 }
 
@@ -229,6 +385,18 @@ K2hAttrOpsMan::~K2hAttrOpsMan(void)
 
 bool K2hAttrOpsMan::Clean(void)
 {
+	if(pChain){
+		// clear each object and return these to pool
+		for(k2hattroplist_t::iterator iter = attroplist.begin(); iter != attroplist.end(); ++iter){
+			K2hAttrOpsBase*	pAttrOp = *iter;
+			if(pAttrOp){
+				pAttrOp->Clear();
+			}
+		}
+		attroplist.swap(pChain->attroplist);
+		K2hAttrOpsMan::PushChain(pChain);
+		pChain = NULL;
+	}
 	for(k2hattroplist_t::iterator iter = attroplist.begin(); iter != attroplist.end(); ++iter){
 		K2hAttrOpsBase*	pAttrOp = *iter;
 		K2H_Delete(pAttrOp);
@@ -252,76 +420,46 @@ bool K2hAttrOpsMan::Initialize(const K2HShm* pshm, const unsigned char* pkey, si
 
 	Clean();
 
-	if(K2hAttrOpsMan::OPSMAN_MASK_ALL != type){
-		// if has lib list in map, make attr plugin objects from plugin library list, and push object list.
-		k2hattrlibmap_t::const_iterator	miter = K2hAttrOpsMan::GetLibMap().find(pshm);
-		if(K2hAttrOpsMan::GetLibMap().end() != miter){
-			const k2hattrliblist_t*	plist = miter->second;
+	// get prepared chain from pool or build it
+	if(NULL == (pChain = K2hAttrOpsMan::PopChain(pshm, type)) && NULL == (pChain = K2hAttrOpsMan::BuildChain(pshm, type))){
+		ERR_K2HPRN("Could not build attribute operation objects.");
+		return false;
+	}
+	attroplist.swap(pChain->attroplist);
 
-			if(plist){
-				for(k2hattrliblist_t::const_iterator liter = plist->begin(); liter != plist->end(); ++liter){
-					const K2hAttrPluginLib*	ploaded = *liter;
-					K2hAttrPlugin*			pPlugin = new K2hAttrPlugin(ploaded);
+	// set key & value and parameters to each object
+	int	BuiltinAttrMask = GetBuiltinMaskValue(type);
+	for(k2hattroplist_t::iterator iter = attroplist.begin(); iter != attroplist.end(); ++iter){
+		K2hAttrOpsBase*	pAttrOp = *iter;
 
-					if(!pPlugin->Set(pkey, key_len, pvalue, value_len)){
-						ERR_K2HPRN("Failed to set key and value pointer to attr plugin(%s).", ploaded->GetVersionInfo());
-						K2H_Delete(pPlugin);
-						Clean();
-						return false;
-					}
-					if(!K2hAttrOpsBase::AddAttrOpArray(attroplist, pPlugin)){
-						ERR_K2HPRN("Failed to adding attr plugin(%s).", ploaded->GetVersionInfo());
-						K2H_Delete(pPlugin);
-						Clean();
-						return false;
-					}
+		if(K2hAttrBuiltin::TYPE_ATTRBUILTIN == pAttrOp->GetType()){
+			K2hAttrBuiltin*	pBuiltin = dynamic_cast<K2hAttrBuiltin*>(pAttrOp);
+			if(!pBuiltin){
+				ERR_K2HPRN("Could not down cast base to builtin attribute object, why...");
+				Clean();
+				return false;
+			}
+			if(pkey && 0 != key_len){
+				if(!pAttrOp->Set(pkey, key_len, pvalue, value_len)){
+					ERR_K2HPRN("Failed to set key and value pointer to builtin attr plugin(%s).", pBuiltin->GetVersionInfo());
+					Clean();
+					return false;
 				}
 			}
+			if(!pBuiltin->Set(pshm, encpass, expire, BuiltinAttrMask)){
+				ERR_K2HPRN("Could not initialize to builtin attribute object.");
+				Clean();
+				return false;
+			}
+		}else{
+			if(!pAttrOp->Set(pkey, key_len, pvalue, value_len)){
+				ERR_K2HPRN("Failed to set key and value pointer to attr plugin(%s).", pAttrOp->GetVersionInfo());
+				Clean();
+				return false;
+			}
 		}
 	}
 
-	// check builtin initialized
-	if(!K2hAttrBuiltin::IsInitialized(pshm)){
-		MSG_K2HPRN("builtin attribute is not initialized yet, so initialize it here.");
-
-		if(!K2hAttrBuiltin::Initialize(pshm)){
-			ERR_K2HPRN("Could not initialize to builtin attribute.");
-			Clean();
-			return false;
-		}
-	}
-
-	// make builtin and push it
-	//
-	// [NOTE]
-	// Builtin attribute plugin must be added lastest position in list.
-	// Because the plugin changes value for encrypting when the flag is enabled.
-	//
-	K2hAttrBuiltin*	pBuiltin = new K2hAttrBuiltin();
-
-	if(pkey && 0 != key_len){
-		K2hAttrOpsBase*	pBaseOps = pBuiltin;
-		if(!pBaseOps->Set(pkey, key_len, pvalue, value_len)){
-			ERR_K2HPRN("Failed to set key and value pointer to builtin attr plugin(%s).", pBuiltin->GetVersionInfo());
-			K2H_Delete(pBuiltin);
-			Clean();
-			return false;
-		}
-	}
-	int	BuiltinAttrMask = GetBuiltinMaskValue(type);
-	if(!pBuiltin->Set(pshm, encpass, expire, BuiltinAttrMask)){
-		ERR_K2HPRN("Could not initialize to builtin attribute object.");
-		K2H_Delete(pBuiltin);
-		Clean();
-		return false;
-	}
-	if(!K2hAttrOpsBase::AddAttrOpArray(attroplist, pBuiltin)){
-		ERR_K2HPRN("Failed to adding builtin attr plugin(%s).", pBuiltin->GetVersionInfo());
-		K2H_Delete(pBuiltin);
-		Clean();
-		return false;
-	}
-
 	// set key & value
 	byKey	= pkey;
 	KeyLen	= key_len;
@@ -26,13 +26,37 @@
 #include "k2hattrbuiltin.h"
 #include "k2hattrplugin.h"
 
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+// [NOTE]
+// Attribute operation objects(chain) which are prepared for each shm
+// and type. The chain is built at first Initialize() and is reused by
+// another Initialize() after Clean(). The version is compared with the
+// version of attribute configuration, and the chain is discarded when
+// the configuration(plugin libraries, etc) is changed.
+//
+typedef struct k2h_attr_ops_chain{
+	const K2HShm*		pshm;
+	int					type;
+	unsigned long		version;
+	k2hattroplist_t		attroplist;
+}K2HATTROPSCHAIN, *PK2HATTROPSCHAIN;
+
+typedef std::vector<PK2HATTROPSCHAIN>	k2hattropschains_t;
+
 //---------------------------------------------------------
 // Class K2hAttrOpsMan
 //---------------------------------------------------------
 class K2hAttrOpsMan
 {
 	protected:
+		static const size_t		CHAIN_POOL_MAX = 64;					// maximum count of pooled chains
+		static volatile int		ChainLockVal;							// lock variable for chain pool
+		static volatile unsigned long	ChainVersion;					// version of attribute configuration
+
 		k2hattroplist_t			attroplist;								// libraries list
+		PK2HATTROPSCHAIN		pChain;									// chain which attroplist is borrowed from
 		const unsigned char*	byKey;
 		size_t					KeyLen;
 		const unsigned char*	byValue;
@@ -50,14 +74,23 @@ class K2hAttrOpsMan
 			OPSMAN_MASK_HIS_EXPIREKP,
 			OPSMAN_MASK_ALL_NOT_EXPIREKP,
 			OPSMAN_MASK_ALL,
+			OPSMAN_MASK_RAW_VALUE,
 			OPSMAN_MASK_QUEUEKEY		= OPSMAN_MASK_HIS_EXPIREKP,		// For normal K2HQueue's key
 			OPSMAN_MASK_TRANSQUEUEKEY	= OPSMAN_MASK_ALL_NOT_EXPIREKP,	// For Transaction K2HQueue's key
 			OPSMAN_MASK_KEYQUEUEKEY		= OPSMAN_MASK_ALL,				// For K2HKeyQueue's key
 			OPSMAN_MASK_QUEUEMARKER		= OPSMAN_MASK_ALL,				// For Queue's marker
+			OPSMAN_MASK_ATOMICKEY		= OPSMAN_MASK_RAW_VALUE,		// For the key which is made by atomic operation
 		}ATTRINITTYPE;
 
 	protected:
 		static k2hattrlibmap_t& GetLibMap(void);						// all libraries list map by each shm
+		static k2hattropschains_t& GetChainPool(void);					// pooled chains for all shm
+
+		static void UpdateChainVersion(void) { __sync_add_and_fetch(&K2hAttrOpsMan::ChainVersion, 1); }
+		static PK2HATTROPSCHAIN PopChain(const K2HShm* pshm, int type);
+		static PK2HATTROPSCHAIN BuildChain(const K2HShm* pshm, int type);
+		static void PushChain(PK2HATTROPSCHAIN pchain);
+		static void FreeChain(PK2HATTROPSCHAIN pchain);
 
 		static bool RemoveBuiltinAttr(const K2HShm* pshm);
 		static bool RemovePluginLib(k2hattrliblist_t* plist);
@@ -69,7 +102,7 @@ class K2hAttrOpsMan
 
 	public:
 		static bool AddPluginLib(const K2HShm* pshm, const char* path);
-		static bool InitializeCommonAttr(const K2HShm* pshm, const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL, const strarr_t* pluginlibs = NULL);
+		static bool InitializeCommonAttr(const K2HShm* pshm, const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL, const strarr_t* pluginlibs = NULL, const char* comptype = NULL, const size_t* compmin = NULL, const int* complevel = NULL, const char* compdict = NULL);
 		static bool CleanCommonAttr(const K2HShm* pshm);
 		static bool GetVersionInfos(const K2HShm* pshm, strarr_t& verinfos);
 		static bool IsMarkHistory(const K2HShm* pshm) { return K2hAttrBuiltin::IsMarkHistory(pshm); }
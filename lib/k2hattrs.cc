@@ -31,21 +31,21 @@ using namespace std;
 //---------------------------------------------------------
 // K2HAttrs Methods
 //---------------------------------------------------------
-K2HAttrs::K2HAttrs()
+K2HAttrs::K2HAttrs() : pArena(NULL), ArenaLength(0UL)
 {
 }
 
-K2HAttrs::K2HAttrs(const K2HAttrs& other)
+K2HAttrs::K2HAttrs(const K2HAttrs& other) : pArena(NULL), ArenaLength(0UL)
 {
 	(*this) = other;
 }
 
-K2HAttrs::K2HAttrs(const char* pattrs)
+K2HAttrs::K2HAttrs(const char* pattrs) : pArena(NULL), ArenaLength(0UL)
 {
 	Serialize(reinterpret_cast<const unsigned char*>(pattrs), pattrs ? strlen(pattrs) + 1 : 0UL);
 }
 
-K2HAttrs::K2HAttrs(const unsigned char* pattrs, size_t attrslength)
+K2HAttrs::K2HAttrs(const unsigned char* pattrs, size_t attrslength) : pArena(NULL), ArenaLength(0UL)
 {
 	Serialize(pattrs, attrslength);
 }
@@ -55,6 +55,17 @@ K2HAttrs::~K2HAttrs()
 	clear();
 }
 
+//
+// The key and value which point into arena are not freed, the arena is
+// freed at clear().
+//
+void K2HAttrs::FreeAttrData(unsigned char* pData) const
+{
+	if(pData && !IsArenaData(pData)){
+		free(pData);
+	}
+}
+
 bool K2HAttrs::Serialize(unsigned char** ppattrs, size_t& attrslen) const
 {
 	if(!ppattrs){
@@ -126,16 +137,49 @@ bool K2HAttrs::Serialize(const unsigned char* pattrs, size_t attrslength)
 		return true;
 	}
 
+	unsigned char*	byArena;
+	if(NULL == (byArena = static_cast<unsigned char*>(malloc(attrslength)))){
+		ERR_K2HPRN("Could not allocate memory.");
+		return false;
+	}
+	memcpy(byArena, pattrs, attrslength);
+
+	return Adopt(byArena, attrslength);
+}
+
+//
+// Loads attributes from binary and takes the ownership of it.
+// pattrs must be allocated by malloc, it is freed at clear() or
+// destructor(also freed when this method fails).
+//
+// [NOTE]
+// The binary is made by Serialize() and already sorted usually, then
+// each attribute points into the binary without allocation and copying.
+// Only if the attribute is not sorted(or duplicated), it is copied by
+// insert().
+//
+bool K2HAttrs::Adopt(unsigned char* pattrs, size_t attrslength)
+{
+	clear();
+
+	if(!pattrs || attrslength < sizeof(size_t)){
+		K2H_Free(pattrs);
+		return true;
+	}
+	pArena		= pattrs;
+	ArenaLength	= attrslength;
+
 	// get subkey count
 	size_t	TotalCount = 0UL;
 	{
 		const size_t*	pCountPos = reinterpret_cast<const size_t*>(pattrs);
 		TotalCount = *pCountPos;
 	}
+	Attrs.reserve(std::min(TotalCount, (attrslength - sizeof(size_t)) / (sizeof(size_t) * 2)));
 
 	// load
-	size_t					rest_length	= attrslength - sizeof(size_t);
-	const unsigned char*	byReadPos	= &pattrs[sizeof(size_t)];
+	size_t			rest_length	= attrslength - sizeof(size_t);
+	unsigned char*	byReadPos	= &pattrs[sizeof(size_t)];
 
 	for(size_t cnt = 0; cnt < TotalCount; cnt++){
 		// check length
@@ -144,10 +188,10 @@ bool K2HAttrs::Serialize(const unsigned char* pattrs, size_t attrslength)
 			break;
 		}
 		// key & value length and position
-		const size_t*			pKeyLengthPos	= reinterpret_cast<const size_t*>(byReadPos);
-		const size_t*			pValLengthPos	= reinterpret_cast<const size_t*>(&byReadPos[sizeof(size_t)]);
-		const unsigned char*	pKeyPos			= &byReadPos[sizeof(size_t) * 2];
-		const unsigned char*	pValPos			= &byReadPos[sizeof(size_t) * 2 + (*pKeyLengthPos)];
+		const size_t*	pKeyLengthPos	= reinterpret_cast<const size_t*>(byReadPos);
+		const size_t*	pValLengthPos	= reinterpret_cast<const size_t*>(&byReadPos[sizeof(size_t)]);
+		unsigned char*	pKeyPos			= &byReadPos[sizeof(size_t) * 2];
+		unsigned char*	pValPos			= &byReadPos[sizeof(size_t) * 2 + (*pKeyLengthPos)];
 
 		// re-check length
 		if(rest_length < (sizeof(size_t) * 2 + (*pKeyLengthPos) + (*pValLengthPos))){
@@ -155,8 +199,19 @@ bool K2HAttrs::Serialize(const unsigned char* pattrs, size_t attrslength)
 			break;
 		}
 
-		// set into array(with allocation)
-		insert(pKeyPos, *pKeyLengthPos, pValPos, *pValLengthPos);
+		// set into array
+		if(0UL < *pKeyLengthPos && (Attrs.empty() || 0 > Attrs.back().compare(pKeyPos, *pKeyLengthPos))){
+			// keep sorted, then only push back without allocation
+			K2HATTR	attr;
+			attr.keylength	= *pKeyLengthPos;
+			attr.vallength	= *pValLengthPos;
+			attr.pkey		= pKeyPos;
+			attr.pval		= (0UL < attr.vallength ? pValPos : NULL);
+			Attrs.push_back(attr);
+		}else{
+			// with allocation
+			insert(pKeyPos, *pKeyLengthPos, pValPos, *pValLengthPos);
+		}
 
 		// set rest length and next position
 		byReadPos	+= (sizeof(size_t) * 2 + (*pKeyLengthPos) + (*pValLengthPos));
@@ -181,10 +236,12 @@ void K2HAttrs::clear(void)
 {
 	// cppcheck-suppress postfixOperator
 	for(k2hattrarr_t::iterator iter = Attrs.begin(); iter != Attrs.end(); iter++){
-		K2H_Free(iter->pkey);
-		K2H_Free(iter->pval);
+		FreeAttrData(iter->pkey);
+		FreeAttrData(iter->pval);
 	}
 	Attrs.clear();
+	K2H_Free(pArena);
+	ArenaLength = 0UL;
 }
 
 bool K2HAttrs::empty(void) const
@@ -297,8 +354,8 @@ K2HAttrs::iterator K2HAttrs::erase(K2HAttrs::iterator iter)
 		return iter;
 	}
 
-	K2H_Free(iter.iter_pos->pkey);
-	K2H_Free(iter.iter_pos->pval);
+	FreeAttrData(iter.iter_pos->pkey);
+	FreeAttrData(iter.iter_pos->pval);
 	iter.iter_pos = Attrs.erase(iter.iter_pos);
 	return iter;
 }
@@ -358,8 +415,8 @@ K2HAttrs::iterator K2HAttrs::insert(const unsigned char* pkey, size_t keylength,
 			unsigned char*	poldkey = insert_iter->pkey;
 			unsigned char*	poldval = insert_iter->pval;
 			insert_iter = Attrs.erase(insert_iter);
-			K2H_Free(poldkey);
-			K2H_Free(poldval);
+			FreeAttrData(poldkey);
+			FreeAttrData(poldval);
 			break;
 
 		}else if(nResult < 0){
@@ -22,6 +22,7 @@
 #define	K2HATTRS_H
 
 #include <string.h>
+#include <time.h>
 #include <vector>
 #include "k2hutil.h"
 
@@ -77,6 +78,24 @@ typedef struct k2h_attr{
 
 typedef std::vector<K2HATTR>	k2hattrarr_t;
 
+// [NOTE]
+// Flags for builtin attributes which are read from attributes binary
+// directly(see K2hAttrBuiltin::GetAttrFlags), it is used for checking
+// expire/history/encrypt/compress without K2HAttrs and K2hAttrOpsMan objects.
+//
+#define	K2HATTR_FLAG_NO				0
+#define	K2HATTR_FLAG_EXPIRE			1
+#define	K2HATTR_FLAG_HISTORY		(1 << 1)
+#define	K2HATTR_FLAG_ENCRYPT		(1 << 2)
+#define	K2HATTR_FLAG_COMPRESS		(1 << 3)
+
+typedef struct k2h_attr_flags{
+	int				flags;
+	struct timespec	expire;						// valid only when K2HATTR_FLAG_EXPIRE is set
+
+	k2h_attr_flags() : flags(K2HATTR_FLAG_NO) { expire.tv_sec = 0; expire.tv_nsec = 0; }
+}K2HATTRFLAGS, *PK2HATTRFLAGS;
+
 //---------------------------------------------------------
 // Class K2HAttrs
 //---------------------------------------------------------
@@ -104,6 +123,11 @@ class K2HAttrs
 
 	protected:
 		k2hattrarr_t	Attrs;
+		unsigned char*	pArena;				// loaded binary, attrs which are loaded point into this area.
+		size_t			ArenaLength;
+
+		bool IsArenaData(const unsigned char* pData) const { return (pArena && pArena <= pData && pData < (pArena + ArenaLength)); }
+		void FreeAttrData(unsigned char* pData) const;
 
 	public:
 		typedef K2HAttrIterator	iterator;
@@ -116,6 +140,7 @@ class K2HAttrs
 
 		bool Serialize(unsigned char** ppattrs, size_t& attrslen) const;
 		bool Serialize(const unsigned char* pattrs, size_t attrslength);
+		bool Adopt(unsigned char* pattrs, size_t attrslength);
 		strarr_t::size_type KeyStringArray(strarr_t& strarr) const;
 
 		K2HAttrs& operator=(const K2HAttrs& other);
@@ -0,0 +1,615 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "k2hcommon.h"
+#include "k2hbuilder.h"
+#include "k2hashfunc.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility class for sequential writing
+//---------------------------------------------------------
+class K2HBuildWriter
+{
+	protected:
+		int						fd;
+		off_t					bufoffset;		// file offset of buffer top
+		vector<unsigned char>	buffer;
+		size_t					buflength;
+
+	public:
+		K2HBuildWriter(int file, size_t bufsize) : fd(file), bufoffset(0), buffer(bufsize, 0), buflength(0) {}
+
+		off_t GetOffset(void) const { return bufoffset + static_cast<off_t>(buflength); }
+		bool Flush(void);
+		bool Write(const void* pData, size_t length);
+		bool Fill(off_t offset);
+};
+
+bool K2HBuildWriter::Flush(void)
+{
+	for(size_t wrote = 0; wrote < buflength; ){
+		ssize_t	onewrote;
+		if(-1 == (onewrote = pwrite(fd, &buffer[wrote], buflength - wrote, bufoffset + static_cast<off_t>(wrote)))){
+			if(EINTR == errno){
+				continue;
+			}
+			ERR_K2HPRN("Failed to write file, errno = %d", errno);
+			return false;
+		}
+		wrote += static_cast<size_t>(onewrote);
+	}
+	bufoffset	+= static_cast<off_t>(buflength);
+	buflength	= 0;
+	return true;
+}
+
+bool K2HBuildWriter::Write(const void* pData, size_t length)
+{
+	const unsigned char*	bypos = static_cast<const unsigned char*>(pData);
+	while(0 < length){
+		if(buffer.size() <= buflength && !Flush()){
+			return false;
+		}
+		size_t	onelength = min(length, buffer.size() - buflength);
+		if(bypos){
+			memcpy(&buffer[buflength], bypos, onelength);
+			bypos += onelength;
+		}else{
+			memset(&buffer[buflength], 0, onelength);
+		}
+		buflength	+= onelength;
+		length		-= onelength;
+	}
+	return true;
+}
+
+//
+// Zero padding until offset
+//
+bool K2HBuildWriter::Fill(off_t offset)
+{
+	if(offset < GetOffset()){
+		ERR_K2HPRN("offset(%jd) is before current writing position(%jd).", static_cast<intmax_t>(offset), static_cast<intmax_t>(GetOffset()));
+		return false;
+	}
+	return Write(NULL, static_cast<size_t>(offset - GetOffset()));
+}
+
+//---------------------------------------------------------
+// Utility functions for sorting
+//---------------------------------------------------------
+// Compare by hash and subhash, and keep adding order.
+//
+struct k2hbld_hash_cmp
+{
+	bool operator()(const K2HBLDREC& rec1, const K2HBLDREC& rec2) const
+	{
+		if(rec1.hash != rec2.hash){
+			return rec1.hash < rec2.hash;
+		}
+		if(rec1.subhash != rec2.subhash){
+			return rec1.subhash < rec2.subhash;
+		}
+		return rec1.seq < rec2.seq;
+	}
+};
+
+//
+// Compare by collision key index position and subhash, and keep adding order.
+//
+struct k2hbld_ckindex_cmp
+{
+	k2h_hash_t	ckmask;
+
+	explicit k2hbld_ckindex_cmp(k2h_hash_t mask) : ckmask(mask) {}
+
+	bool operator()(const K2HBLDREC& rec1, const K2HBLDREC& rec2) const
+	{
+		if((rec1.hash & ckmask) != (rec2.hash & ckmask)){
+			return (rec1.hash & ckmask) < (rec2.hash & ckmask);
+		}
+		if(rec1.subhash != rec2.subhash){
+			return rec1.subhash < rec2.subhash;
+		}
+		return rec1.seq < rec2.seq;
+	}
+};
+
+//
+// Build balanced element tree for one collision key index.
+//
+// heads is the list of record positions which is the top of same subhash
+// records, and this function returns the relative address of top element
+// in the tree made from heads[start] to heads[end - 1].
+//
+static PELEMENT k2hbld_build_tree(vector<ELEMENT>& elements, const vector<size_t>& heads, size_t start, size_t end, off_t element_offset, PELEMENT parent)
+{
+	if(end <= start){
+		return NULL;
+	}
+	size_t		mid			= start + (end - start) / 2;
+	size_t		pos			= heads[mid];
+	PELEMENT	relElement	= reinterpret_cast<PELEMENT>(element_offset + static_cast<off_t>(pos * sizeof(ELEMENT)));
+
+	elements[pos].parent	= parent;
+	elements[pos].small		= k2hbld_build_tree(elements, heads, start, mid, element_offset, relElement);
+	elements[pos].big		= k2hbld_build_tree(elements, heads, mid + 1, end, element_offset, relElement);
+	return relElement;
+}
+
+//---------------------------------------------------------
+// K2HBuilder Methods
+//---------------------------------------------------------
+K2HBuilder::K2HBuilder(int mask_bitcnt, int cmask_bitcnt, int max_element_cnt, size_t pagesize) : min_mask_bitcnt(K2HShm::MIN_MASK_BITCOUNT), cmask_bitcnt(K2HShm::DEFAULT_COLLISION_MASK_BITCOUNT), max_element_cnt(K2HShm::DEFAULT_MAX_ELEMENT_CNT), pagesize(K2HShm::MIN_PAGE_SIZE)
+{
+	Initialize(mask_bitcnt, cmask_bitcnt, max_element_cnt, pagesize);
+}
+
+K2HBuilder::~K2HBuilder()
+{
+}
+
+bool K2HBuilder::Initialize(int mask_bitcnt, int cmask_bitcnt, int max_element_cnt, size_t pagesize)
+{
+	if(max_element_cnt <= 0){
+		ERR_K2HPRN("Maximum element count(%d) must be over 1.", max_element_cnt);
+		return false;
+	}
+	if(mask_bitcnt < K2HShm::MIN_MASK_BITCOUNT || K2HShm::MAX_MASK_BITCOUNT < mask_bitcnt){
+		ERR_K2HPRN("Mask bit count(%d) for hash should be from %d to %d.", mask_bitcnt, K2HShm::MIN_MASK_BITCOUNT, K2HShm::MAX_MASK_BITCOUNT);
+		return false;
+	}
+	if(cmask_bitcnt < 0 || K2HShm::DEFAULT_COLLISION_MASK_BITCOUNT < cmask_bitcnt){
+		// Warning
+		WAN_K2HPRN("Collision Mask bit count(%d) for hash should be under %d.", cmask_bitcnt, K2HShm::DEFAULT_COLLISION_MASK_BITCOUNT);
+	}
+	if(pagesize < static_cast<size_t>(K2HShm::MIN_PAGE_SIZE)){
+		// Warning
+		WAN_K2HPRN("Page size(%zu) is under minimum size(%d), so pagesize set minimum size.", pagesize, K2HShm::MIN_PAGE_SIZE);
+		pagesize = static_cast<size_t>(K2HShm::MIN_PAGE_SIZE);
+	}
+	min_mask_bitcnt			= mask_bitcnt;
+	this->cmask_bitcnt		= cmask_bitcnt;
+	this->max_element_cnt	= max_element_cnt;
+	this->pagesize			= pagesize;
+	return true;
+}
+
+bool K2HBuilder::Add(const char* pKey, const char* pValue)
+{
+	return Add(reinterpret_cast<const unsigned char*>(pKey), (pKey ? strlen(pKey) + 1 : 0), reinterpret_cast<const unsigned char*>(pValue), (pValue ? strlen(pValue) + 1 : 0));
+}
+
+//
+// Stack one record on memory.
+//
+// [NOTE]
+// The subkeys and attrs binary are set into the element as it is.
+// If the same key is added, the last one is used.
+//
+bool K2HBuilder::Add(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const unsigned char* bySubKeys, size_t sklength, const unsigned char* byAttrs, size_t attrlength)
+{
+	if(!byKey || 0 == keylength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!byValue){
+		vallength = 0;
+	}
+	if(!bySubKeys){
+		sklength = 0;
+	}
+	if(!byAttrs){
+		attrlength = 0;
+	}
+
+	K2HBLDREC	rec;
+	rec.hash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	rec.subhash		= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	rec.dataoffset	= datas.size();
+	rec.keylength	= keylength;
+	rec.vallength	= vallength;
+	rec.skeylength	= sklength;
+	rec.attrlength	= attrlength;
+	rec.seq			= records.size();
+	rec.is_deleted	= false;
+
+	datas.insert(datas.end(), byKey, byKey + keylength);
+	if(0 < vallength){
+		datas.insert(datas.end(), byValue, byValue + vallength);
+	}
+	if(0 < sklength){
+		datas.insert(datas.end(), bySubKeys, bySubKeys + sklength);
+	}
+	if(0 < attrlength){
+		datas.insert(datas.end(), byAttrs, byAttrs + attrlength);
+	}
+	records.push_back(rec);
+
+	return true;
+}
+
+bool K2HBuilder::IsSameKey(const K2HBLDREC& rec1, const K2HBLDREC& rec2) const
+{
+	if(rec1.hash != rec2.hash || rec1.subhash != rec2.subhash || rec1.keylength != rec2.keylength){
+		return false;
+	}
+	return (0 == memcmp(&datas[rec1.dataoffset], &datas[rec2.dataoffset], rec1.keylength));
+}
+
+//
+// Remove old records which have same key, and returns removed count.
+//
+// [NOTE]
+// After calling this, records are sorted by hash and subhash.
+//
+size_t K2HBuilder::RemoveDuplicateKeys(void)
+{
+	sort(records.begin(), records.end(), k2hbld_hash_cmp());
+
+	size_t	removed = 0;
+	for(size_t start = 0; start < records.size(); ){
+		size_t	end;
+		for(end = start + 1; end < records.size() && records[start].hash == records[end].hash && records[start].subhash == records[end].subhash; ++end);
+
+		// records in same hash/subhash are sorted by adding order, so the later one is alive.
+		for(size_t pos1 = start; pos1 < end; ++pos1){
+			for(size_t pos2 = pos1 + 1; pos2 < end; ++pos2){
+				if(!records[pos2].is_deleted && IsSameKey(records[pos1], records[pos2])){
+					records[pos1].is_deleted = true;
+					++removed;
+					break;
+				}
+			}
+		}
+		start = end;
+	}
+
+	if(0 < removed){
+		k2hbldreclist_t	tmplist;
+		tmplist.reserve(records.size() - removed);
+		for(k2hbldreclist_t::const_iterator iter = records.begin(); iter != records.end(); ++iter){
+			if(!iter->is_deleted){
+				tmplist.push_back(*iter);
+			}
+		}
+		records.swap(tmplist);
+	}
+	return removed;
+}
+
+//
+// Decide minimum mask bit count which makes all collision key index have
+// elements under max_element_count.
+//
+// [NOTE]
+// records must be sorted by hash(calling RemoveDuplicateKeys), then the
+// records in same collision key index(hash masked by cur_mask and collision
+// mask) are not always sequential. So this counts them by sorted positions.
+//
+int K2HBuilder::DecideMaskBitCount(void) const
+{
+	int	mask_bitcnt;
+	for(mask_bitcnt = min_mask_bitcnt; mask_bitcnt < K2HShm::MAX_MASK_BITCOUNT; ++mask_bitcnt){
+		// check simply by total count
+		if(static_cast<unsigned long>(INIT_CKINDEX_CNT(mask_bitcnt, cmask_bitcnt)) * static_cast<unsigned long>(max_element_cnt) < records.size()){
+			continue;
+		}
+		k2h_hash_t			ckmask = K2HShm::MakeMask(mask_bitcnt + cmask_bitcnt);
+		vector<k2h_hash_t>	ckindexes;
+		ckindexes.reserve(records.size());
+		for(k2hbldreclist_t::const_iterator iter = records.begin(); iter != records.end(); ++iter){
+			ckindexes.push_back(iter->hash & ckmask);
+		}
+		sort(ckindexes.begin(), ckindexes.end());
+
+		bool	is_over = false;
+		for(size_t start = 0; start < ckindexes.size(); ){
+			size_t	end;
+			for(end = start + 1; end < ckindexes.size() && ckindexes[start] == ckindexes[end]; ++end);
+			if(static_cast<size_t>(max_element_cnt) < (end - start)){
+				is_over = true;
+				break;
+			}
+			start = end;
+		}
+		if(!is_over){
+			break;
+		}
+	}
+	return mask_bitcnt;
+}
+
+unsigned long K2HBuilder::GetPageCount(size_t length) const
+{
+	if(0UL == length){
+		return 0UL;
+	}
+	size_t	datasize = pagesize - PAGEHEAD_SIZE;
+	return static_cast<unsigned long>((length / datasize) + (0 == (length % datasize) ? 0 : 1));
+}
+
+//
+// Build k2hash file from stacked records.
+//
+// [NOTE]
+// The file must not exist, because this method writes all areas without
+// locking. After building, the file can be attached normally, or the file
+// can be replaced with an attached file by k2hreplace tool.
+// If there are no element/page in areas, the file has one free element
+// and page for making areas array same as normal initializing.
+//
+bool K2HBuilder::Build(const char* file)
+{
+	if(ISEMPTYSTR(file)){
+		ERR_K2HPRN("file path is empty.");
+		return false;
+	}
+
+	// remove duplicate keys and decide mask
+	RemoveDuplicateKeys();
+	int			mask_bitcnt	= DecideMaskBitCount();
+	k2h_hash_t	ckmask		= K2HShm::MakeMask(mask_bitcnt + cmask_bitcnt);
+
+	// sort by collision key index position
+	sort(records.begin(), records.end(), k2hbld_ckindex_cmp(ckmask));
+
+	// count pages
+	unsigned long	page_count = 0;
+	for(k2hbldreclist_t::const_iterator iter = records.begin(); iter != records.end(); ++iter){
+		page_count += GetPageCount(iter->keylength) + GetPageCount(iter->vallength) + GetPageCount(iter->skeylength) + GetPageCount(iter->attrlength);
+	}
+	unsigned long	element_area_count	= max(static_cast<unsigned long>(records.size()), 1UL);
+	unsigned long	page_area_count		= max(page_count, 1UL);
+
+	// areas
+	//
+	// K2H					K2Hash Header structure area
+	// KINDEX * X			Key Index area
+	// CKINDEX * Y			Collision Key Index area
+	// ELEMENT * N			Element area(all records and one free element if no record)
+	// PAGE * P				Page area(all pages and one free page if no page)
+	//
+	size_t		syspagesize		= K2HShm::GetSystemPageSize();
+	off_t		kindex_offset	= static_cast<off_t>(ALIGNMENT(sizeof(K2H), syspagesize));
+	size_t		kindex_length	= sizeof(KINDEX) * INIT_KINDEX_CNT(mask_bitcnt);
+	off_t		ckindex_offset	= static_cast<off_t>(ALIGNMENT(static_cast<size_t>(kindex_offset) + kindex_length, syspagesize));
+	size_t		ckindex_length	= sizeof(CKINDEX) * INIT_CKINDEX_CNT(mask_bitcnt, cmask_bitcnt);
+	off_t		element_offset	= static_cast<off_t>(ALIGNMENT(static_cast<size_t>(ckindex_offset) + ckindex_length, syspagesize));
+	size_t		element_length	= sizeof(ELEMENT) * element_area_count;
+	off_t		page_offset		= static_cast<off_t>(ALIGNMENT(static_cast<size_t>(element_offset) + element_length, syspagesize));
+	size_t		page_length		= pagesize * page_area_count;
+	size_t		total_size		= static_cast<size_t>(page_offset) + page_length;
+
+	// make collision key index and element array
+	vector<CKINDEX>	ckindexes(INIT_CKINDEX_CNT(mask_bitcnt, cmask_bitcnt));
+	vector<ELEMENT>	elements(element_area_count);
+	memset(&ckindexes[0], 0, sizeof(CKINDEX) * ckindexes.size());
+	memset(&elements[0], 0, sizeof(ELEMENT) * elements.size());
+	{
+		off_t	page_pos = page_offset;
+		for(size_t pos = 0; pos < records.size(); ++pos){
+			const K2HBLDREC&	rec = records[pos];
+			elements[pos].hash			= rec.hash;
+			elements[pos].subhash		= rec.subhash;
+			elements[pos].keylength		= rec.keylength;
+			elements[pos].vallength		= rec.vallength;
+			elements[pos].skeylength	= rec.skeylength;
+			elements[pos].attrlength	= rec.attrlength;
+
+			// pages are laid out by element order
+			elements[pos].key			= (0 < rec.keylength	? reinterpret_cast<PPAGEHEAD>(page_pos) : NULL);
+			page_pos					+= static_cast<off_t>(GetPageCount(rec.keylength) * pagesize);
+			elements[pos].value			= (0 < rec.vallength	? reinterpret_cast<PPAGEHEAD>(page_pos) : NULL);
+			page_pos					+= static_cast<off_t>(GetPageCount(rec.vallength) * pagesize);
+			elements[pos].subkeys		= (0 < rec.skeylength	? reinterpret_cast<PPAGEHEAD>(page_pos) : NULL);
+			page_pos					+= static_cast<off_t>(GetPageCount(rec.skeylength) * pagesize);
+			elements[pos].attrs			= (0 < rec.attrlength	? reinterpret_cast<PPAGEHEAD>(page_pos) : NULL);
+			page_pos					+= static_cast<off_t>(GetPageCount(rec.attrlength) * pagesize);
+		}
+
+		// element tree in each collision key index
+		for(size_t start = 0; start < records.size(); ){
+			k2h_hash_t		ckpos = records[start].hash & ckmask;
+			size_t			end;
+			vector<size_t>	heads;
+			for(end = start; end < records.size() && ckpos == (records[end].hash & ckmask); ++end){
+				if(end == start || records[end - 1].subhash != records[end].subhash){
+					heads.push_back(end);
+				}else{
+					// same subhash element is linked from previous element
+					elements[end - 1].same	= reinterpret_cast<PELEMENT>(element_offset + static_cast<off_t>(end * sizeof(ELEMENT)));
+					elements[end].parent	= reinterpret_cast<PELEMENT>(element_offset + static_cast<off_t>((end - 1) * sizeof(ELEMENT)));
+				}
+			}
+			ckindexes[ckpos].element_count	= static_cast<unsigned long>(end - start);
+			ckindexes[ckpos].element_list	= k2hbld_build_tree(elements, heads, 0, heads.size(), element_offset, NULL);
+			start = end;
+		}
+	}
+
+	// make k2hash header
+	PK2H			pHead;
+	struct timeval	tv;
+	if(NULL == (pHead = reinterpret_cast<PK2H>(calloc(1, sizeof(K2H))))){
+		ERR_K2HPRN("Could not allocate memory.");
+		return false;
+	}
+	K2HShm::GetRealTimeval(tv);
+
+	sprintf(pHead->version,		K2H_VERSION_FORMAT, K2H_VERSION);
+	sprintf(pHead->hash_version,"%s", k2h_hash_version());
+	pHead->total_size					= total_size;
+	pHead->page_size					= pagesize;
+	pHead->max_mask						= K2HShm::MakeMask(K2HShm::MAX_MASK_BITCOUNT);
+	pHead->min_mask						= K2HShm::MakeMask(K2HShm::MIN_MASK_BITCOUNT);
+	pHead->cur_mask						= K2HShm::MakeMask(mask_bitcnt);
+	pHead->collision_mask				= K2HShm::MakeMask(cmask_bitcnt);
+	pHead->max_element_count			= static_cast<unsigned long>(max_element_cnt);
+	pHead->last_update.tv_sec			= tv.tv_sec;
+	pHead->last_update.tv_usec			= tv.tv_usec;
+	pHead->last_area_update.tv_sec		= tv.tv_sec;
+	pHead->last_area_update.tv_usec		= tv.tv_usec;
+	pHead->unassign_area				= total_size;
+	pHead->pextra						= NULL;
+
+	for(int bitcnt = 0, kindex_pos = 0; bitcnt <= mask_bitcnt; bitcnt++){
+		pHead->key_index_area[bitcnt]	= reinterpret_cast<PKINDEX>(kindex_offset + static_cast<off_t>(kindex_pos * sizeof(KINDEX)));
+		kindex_pos						+= 1 << (0 < bitcnt ? bitcnt - 1 : bitcnt);
+	}
+
+	if(records.empty()){
+		pHead->free_element_count		= 1;
+		pHead->pfree_elements			= reinterpret_cast<PELEMENT>(element_offset);
+	}else{
+		pHead->free_element_count		= 0;
+		pHead->pfree_elements			= NULL;
+	}
+	if(0 == page_count){
+		pHead->free_page_count			= 1;
+		pHead->pfree_pages				= reinterpret_cast<PPAGEHEAD>(page_offset);
+	}else{
+		pHead->free_page_count			= 0;
+		pHead->pfree_pages				= NULL;
+	}
+
+	if(	!K2HShm::SetAreasArray(pHead, K2H_AREA_KINDEX, kindex_offset, kindex_length)		||
+		!K2HShm::SetAreasArray(pHead, K2H_AREA_CKINDEX, ckindex_offset, ckindex_length)	||
+		!K2HShm::SetAreasArray(pHead, K2H_AREA_PAGELIST, element_offset, element_length)	||
+		!K2HShm::SetAreasArray(pHead, K2H_AREA_PAGE, page_offset, page_length)			)
+	{
+		ERR_K2HPRN("Failed to set Area information into Areas array.");
+		K2H_Free(pHead);
+		return false;
+	}
+
+	// open file
+	int	fd;
+	if(-1 == (fd = open(file, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH))){
+		ERR_K2HPRN("Could not create file(%s), errno = %d", file, errno);
+		K2H_Free(pHead);
+		return false;
+	}
+	if(0 != ftruncate(fd, static_cast<off_t>(total_size))){
+		ERR_K2HPRN("Could not truncate file(%s) to %zu, errno = %d", file, total_size, errno);
+		K2H_Free(pHead);
+		K2H_CLOSE(fd);
+		unlink(file);
+		return false;
+	}
+
+	// write all areas sequentially
+	K2HBuildWriter	writer(fd, K2HBuilder::WRITE_BUFFER_SIZE);
+	bool			result = writer.Write(pHead, sizeof(K2H));
+	K2H_Free(pHead);
+
+	// Key Index
+	if(result && (result = writer.Fill(kindex_offset))){
+		k2h_hash_t	cur_mask = K2HShm::MakeMask(mask_bitcnt);
+		for(long pos = 0; result && pos < INIT_KINDEX_CNT(mask_bitcnt); ++pos){
+			KINDEX	kindex;
+			kindex.assign		= KINDEX_ASSIGNED;
+			kindex.shifted_mask	= (cur_mask << cmask_bitcnt);
+			kindex.masked_hash	= ((static_cast<k2h_hash_t>(pos) << cmask_bitcnt) & (cur_mask << cmask_bitcnt));
+			kindex.ckey_list	= reinterpret_cast<PCKINDEX>(ckindex_offset + static_cast<off_t>(pos * CKINDEX_BYKINDEX_CNT(cmask_bitcnt) * sizeof(CKINDEX)));
+			result				= writer.Write(&kindex, sizeof(KINDEX));
+		}
+	}
+	// Collision Key Index
+	if(result && (result = writer.Fill(ckindex_offset))){
+		result = writer.Write(&ckindexes[0], sizeof(CKINDEX) * ckindexes.size());
+	}
+	// Element
+	if(result && (result = writer.Fill(element_offset))){
+		result = writer.Write(&elements[0], sizeof(ELEMENT) * elements.size());
+	}
+	// Page
+	if(result && (result = writer.Fill(page_offset))){
+		size_t			datasize = pagesize - PAGEHEAD_SIZE;
+		vector<size_t>	lengths(4);
+		for(k2hbldreclist_t::const_iterator iter = records.begin(); result && iter != records.end(); ++iter){
+			const unsigned char*	bydata = &datas[iter->dataoffset];
+			lengths[0] = iter->keylength;
+			lengths[1] = iter->vallength;
+			lengths[2] = iter->skeylength;
+			lengths[3] = iter->attrlength;
+
+			for(size_t cnt = 0; result && cnt < lengths.size(); ++cnt){
+				for(size_t rest = lengths[cnt]; result && 0 < rest; ){
+					PAGEHEAD	pagehead;
+					off_t		curpage		= writer.GetOffset();
+					size_t		onelength	= min(rest, datasize);
+					pagehead.prev			= (rest == lengths[cnt] ? NULL : reinterpret_cast<PPAGEHEAD>(curpage - static_cast<off_t>(pagesize)));
+					pagehead.next			= (onelength < rest ? reinterpret_cast<PPAGEHEAD>(curpage + static_cast<off_t>(pagesize)) : NULL);
+					pagehead.length			= onelength;
+
+					if(	!writer.Write(&pagehead, PAGEHEAD_SIZE)	||
+						!writer.Write(bydata, onelength)		||
+						!writer.Write(NULL, datasize - onelength)	)
+					{
+						result = false;
+					}
+					bydata	+= onelength;
+					rest	-= onelength;
+				}
+			}
+		}
+		// free page is written as zero(prev/next is NULL and length is 0)
+	}
+	if(result && (result = writer.Fill(static_cast<off_t>(total_size)))){
+		result = writer.Flush();
+	}
+	if(result && 0 != fsync(fd)){
+		ERR_K2HPRN("Failed to sync file(%s), errno = %d", file, errno);
+		result = false;
+	}
+	K2H_CLOSE(fd);
+
+	if(!result){
+		ERR_K2HPRN("Failed to write k2hash file(%s).", file);
+		unlink(file);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
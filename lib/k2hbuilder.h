@@ -0,0 +1,107 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+#ifndef	K2HBUILDER_H
+#define	K2HBUILDER_H
+
+#include <vector>
+
+#include "k2hcommon.h"
+#include "k2hstructure.h"
+#include "k2hshm.h"
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+typedef struct k2h_build_record{
+	k2h_hash_t		hash;
+	k2h_hash_t		subhash;
+	size_t			dataoffset;				// offset in data buffer(key, value, subkeys and attrs are sequential)
+	size_t			keylength;
+	size_t			vallength;
+	size_t			skeylength;
+	size_t			attrlength;
+	size_t			seq;					// added sequence number
+	bool			is_deleted;				// overwritten by same key record
+}K2HBLDREC, *PK2HBLDREC;
+
+typedef std::vector<K2HBLDREC>		k2hbldreclist_t;
+
+//---------------------------------------------------------
+// K2HBuilder Class
+//---------------------------------------------------------
+// This class builds a new k2hash file offline from key/value records.
+//
+// All records are stacked on memory by Add(), and Build() decides the
+// cur_mask which is enough for all records(each collision key index
+// does not have over max_element_count elements), and makes the file
+// with the key index, collision key index, element and page areas.
+// All areas are laid out sequentially in hash order, and the element
+// tree in each collision key index is balanced.
+// The file is written by large sequential writes, and it can be attached
+// normally(and replaced by k2hreplace tool).
+//
+// [NOTICE]
+// This class keeps all records on memory until Build(), so that it needs
+// the memory for all keys/values/subkeys/attrs and about 200 bytes for
+// each record(K2HBLDREC, ELEMENT and work area in Build()). The input
+// which is over the memory should be imported into the attached k2hash
+// by PrepareBulkLoad() and BulkSet()(k2himport without -build option)
+// instead of this class.
+//
+class K2HBuilder
+{
+	protected:
+		static const size_t	WRITE_BUFFER_SIZE	= (4 * 1024 * 1024);	// 4MB
+
+		int							min_mask_bitcnt;
+		int							cmask_bitcnt;
+		int							max_element_cnt;
+		size_t						pagesize;
+		std::vector<unsigned char>	datas;
+		k2hbldreclist_t				records;
+
+	public:
+		explicit K2HBuilder(int mask_bitcnt = K2HShm::MIN_MASK_BITCOUNT, int cmask_bitcnt = K2HShm::DEFAULT_COLLISION_MASK_BITCOUNT, int max_element_cnt = K2HShm::DEFAULT_MAX_ELEMENT_CNT, size_t pagesize = K2HShm::MIN_PAGE_SIZE);
+		virtual ~K2HBuilder();
+
+		bool Initialize(int mask_bitcnt, int cmask_bitcnt, int max_element_cnt, size_t pagesize);
+		bool Add(const char* pKey, const char* pValue);
+		bool Add(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const unsigned char* bySubKeys = NULL, size_t sklength = 0UL, const unsigned char* byAttrs = NULL, size_t attrlength = 0UL);
+		size_t Count(void) const { return records.size(); }
+		bool Build(const char* file);
+
+	protected:
+		bool IsSameKey(const K2HBLDREC& rec1, const K2HBLDREC& rec2) const;
+		size_t RemoveDuplicateKeys(void);
+		int DecideMaskBitCount(void) const;
+		unsigned long GetPageCount(size_t length) const;
+};
+
+#endif	// K2HBUILDER_H
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,174 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <time.h>
+
+#include <fullock/flckstructure.h>
+#include <fullock/flckbaselist.tcc>
+
+#include "k2hcommon.h"
+#include "k2hcompactor.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// K2HAreaCompactor : Class Methods
+//---------------------------------------------------------
+K2HAreaCompactor* K2HAreaCompactor::Get(void)
+{
+	static K2HAreaCompactor	compactor;							// singleton
+	return &compactor;
+}
+
+void* K2HAreaCompactor::WorkerProc(void* param)
+{
+	PCPTHPARAM	pcpparam = reinterpret_cast<PCPTHPARAM>(param);
+	if(!pcpparam || !pcpparam->pShm){
+		ERR_K2HPRN("The parameter pointer is NULL.");
+		pthread_exit(NULL);
+	}
+
+	K2HCOMPACTCURSOR	cursor;
+	struct timespec		sleeptime = {0, K2HAreaCompactor::MINIMUM_WAIT_SLEEP * 1000 * 1000};
+	while(!pcpparam->is_exit){
+		bool	isCompressed= false;
+		bool	isFinished	= false;
+		if(!pcpparam->pShm->AreaCompressStep(cursor, pcpparam->step_count, isCompressed, isFinished)){
+			WAN_K2HPRN("Something error occurred in compressing area by step, but continue...");
+			isFinished = true;
+		}
+		if(isCompressed){
+			MSG_K2HPRN("Compactor removed lastest area.");
+		}
+		if(!isFinished){
+			continue;
+		}
+
+		// sleep for interval
+		for(long waited = 0L; !pcpparam->is_exit && waited < pcpparam->interval_ms; waited += K2HAreaCompactor::MINIMUM_WAIT_SLEEP){
+			nanosleep(&sleeptime, NULL);
+		}
+	}
+
+	// put back fenced entries
+	if(!pcpparam->pShm->AreaCompressCancel(cursor)){
+		WAN_K2HPRN("Failed to put back fenced entries in target area.");
+	}
+	return NULL;
+}
+
+//---------------------------------------------------------
+// K2HAreaCompactor : Constructor / Destructor
+//---------------------------------------------------------
+K2HAreaCompactor::K2HAreaCompactor() : LockParam(FLCK_NOSHARED_MUTEX_VAL_UNLOCKED)
+{
+}
+
+K2HAreaCompactor::~K2HAreaCompactor()
+{
+	// [NOTE]
+	// All K2HShm objects should stop compactor before this destructor.
+	//
+	while(!cpparammap.empty()){
+		if(!Stop(cpparammap.begin()->first)){
+			break;
+		}
+	}
+}
+
+//---------------------------------------------------------
+// K2HAreaCompactor : Methods
+//---------------------------------------------------------
+bool K2HAreaCompactor::Start(K2HShm* pk2hshm, long interval_ms, long step_count)
+{
+	if(!pk2hshm || interval_ms <= 0L || step_count <= 0L){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	// stop running compactor for restarting
+	if(!Stop(pk2hshm)){
+		ERR_K2HPRN("Could not stop running compactor.");
+		return false;
+	}
+
+	PCPTHPARAM	pcpparam = new CPTHPARAM(pk2hshm, interval_ms, step_count);
+	int			result;
+	if(0 != (result = pthread_create(&(pcpparam->tid), NULL, K2HAreaCompactor::WorkerProc, pcpparam))){
+		ERR_K2HPRN("Failed to create thread(return code = %d).", result);
+		K2H_Delete(pcpparam);
+		return false;
+	}
+
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+	cpparammap[pk2hshm] = pcpparam;
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	return true;
+}
+
+bool K2HAreaCompactor::Stop(const K2HShm* pk2hshm)
+{
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+
+	cpparammap_t::iterator	iter = cpparammap.find(pk2hshm);
+	if(cpparammap.end() == iter){
+		fullock::flck_unlock_noshared_mutex(&LockParam);
+		return true;
+	}
+	PCPTHPARAM	pcpparam = iter->second;
+	cpparammap.erase(iter);
+
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	// wait for exiting thread
+	pcpparam->is_exit = true;
+
+	int		result;
+	bool	is_success = true;
+	if(0 != (result = pthread_join(pcpparam->tid, NULL))){
+		ERR_K2HPRN("Failed to wait exiting thread(return code = %d).", result);
+		is_success = false;
+	}
+	K2H_Delete(pcpparam);
+
+	return is_success;
+}
+
+bool K2HAreaCompactor::IsRun(const K2HShm* pk2hshm)
+{
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+	bool	result = (cpparammap.end() != cpparammap.find(pk2hshm));
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	return result;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
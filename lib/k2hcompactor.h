@@ -0,0 +1,88 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+#ifndef	K2HCOMPACTOR_H
+#define	K2HCOMPACTOR_H
+
+#include <pthread.h>
+#include <map>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+//
+// The structure is for each compactor thread.
+//
+typedef struct compactor_thread_param{
+	K2HShm*				pShm;
+	pthread_t			tid;
+	long				interval_ms;
+	long				step_count;
+	volatile bool		is_exit;
+
+	compactor_thread_param(K2HShm* pk2hshm, long interval, long count) : pShm(pk2hshm), tid(0), interval_ms(interval), step_count(count), is_exit(false) {}
+}CPTHPARAM, *PCPTHPARAM;
+
+typedef std::map<const K2HShm*, PCPTHPARAM>	cpparammap_t;
+
+//---------------------------------------------------------
+// K2HAreaCompactor Class
+//---------------------------------------------------------
+// This class runs one background thread for each K2HShm object, and
+// the thread compresses the lastest area by K2HShm::AreaCompressStep().
+// After the area can not be compressed any more, the thread sleeps
+// for interval_ms and tries it again.
+//
+class K2HAreaCompactor
+{
+	public:
+		static const long	MINIMUM_WAIT_SLEEP	= 100L;		// sleep unit for checking exit(100ms)
+
+	protected:
+		volatile int		LockParam;						// like mutex for thread parameters
+		cpparammap_t		cpparammap;						// K2HShm object <-> PCPTHPARAM
+
+	public:
+		static K2HAreaCompactor* Get(void);
+
+		bool Start(K2HShm* pk2hshm, long interval_ms, long step_count);
+		bool Stop(const K2HShm* pk2hshm);
+		bool IsRun(const K2HShm* pk2hshm);
+
+	protected:
+		static void* WorkerProc(void* param);
+
+		K2HAreaCompactor();
+		virtual ~K2HAreaCompactor();
+};
+
+#endif	// K2HCOMPACTOR_H
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
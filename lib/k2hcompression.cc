@@ -0,0 +1,377 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "k2hcommon.h"
+#include "k2hcompression.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utilities
+//---------------------------------------------------------
+bool k2h_is_lz4_supported(void)
+{
+#ifdef HAVE_LZ4
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool k2h_is_zstd_supported(void)
+{
+#ifdef HAVE_ZSTD
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t k2h_get_decompressed_length(const unsigned char* compdata, size_t complen)
+{
+	if(!compdata || complen < K2H_COMPRESS_HEAD_LENGTH){
+		return 0;
+	}
+	uint64_t	orglen;
+	memcpy(&orglen, compdata, sizeof(uint64_t));
+	return static_cast<size_t>(be64toh(orglen));
+}
+
+//
+// Allocates buffer for compressed data and sets original length to head.
+//
+static unsigned char* k2h_alloc_compress_buffer(size_t orglen, size_t bodylen)
+{
+	unsigned char*	pcomp;
+	if(NULL == (pcomp = reinterpret_cast<unsigned char*>(malloc(K2H_COMPRESS_HEAD_LENGTH + bodylen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+	uint64_t	belen = htobe64(static_cast<uint64_t>(orglen));
+	memcpy(pcomp, &belen, sizeof(uint64_t));
+	return pcomp;
+}
+
+//---------------------------------------------------------
+// LZ4
+//---------------------------------------------------------
+// [NOTE]
+// These functions return NULL when the compressed data is not smaller
+// than original, then the caller should keep original value.
+//
+unsigned char* k2h_compress_lz4(const unsigned char* orgdata, size_t orglen, size_t& complen)
+{
+#ifdef HAVE_LZ4
+	if(!orgdata || 0 == orglen || static_cast<size_t>(LZ4_MAX_INPUT_SIZE) < orglen){
+		return NULL;
+	}
+	int				bound = LZ4_compressBound(static_cast<int>(orglen));
+	unsigned char*	pcomp;
+	if(NULL == (pcomp = k2h_alloc_compress_buffer(orglen, static_cast<size_t>(bound)))){
+		return NULL;
+	}
+	int	result = LZ4_compress_default(reinterpret_cast<const char*>(orgdata), reinterpret_cast<char*>(&pcomp[K2H_COMPRESS_HEAD_LENGTH]), static_cast<int>(orglen), bound);
+	if(result <= 0 || orglen <= (K2H_COMPRESS_HEAD_LENGTH + static_cast<size_t>(result))){
+		K2H_Free(pcomp);
+		return NULL;
+	}
+	complen = K2H_COMPRESS_HEAD_LENGTH + static_cast<size_t>(result);
+	return pcomp;
+#else
+	ERR_K2HPRN("k2hash is not built with LZ4.");
+	return NULL;
+#endif
+}
+
+unsigned char* k2h_decompress_lz4(const unsigned char* compdata, size_t complen, size_t& declen)
+{
+#ifdef HAVE_LZ4
+	size_t	orglen = k2h_get_decompressed_length(compdata, complen);
+	if(0 == orglen || static_cast<size_t>(LZ4_MAX_INPUT_SIZE) < orglen){
+		ERR_K2HPRN("compressed data is something wrong.");
+		return NULL;
+	}
+	unsigned char*	pdec;
+	if(NULL == (pdec = reinterpret_cast<unsigned char*>(malloc(orglen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+	int	result = LZ4_decompress_safe(reinterpret_cast<const char*>(&compdata[K2H_COMPRESS_HEAD_LENGTH]), reinterpret_cast<char*>(pdec), static_cast<int>(complen - K2H_COMPRESS_HEAD_LENGTH), static_cast<int>(orglen));
+	if(result < 0 || orglen != static_cast<size_t>(result)){
+		ERR_K2HPRN("Failed to decompress LZ4 data(result=%d).", result);
+		K2H_Free(pdec);
+		return NULL;
+	}
+	declen = orglen;
+	return pdec;
+#else
+	ERR_K2HPRN("k2hash is not built with LZ4.");
+	return NULL;
+#endif
+}
+
+//---------------------------------------------------------
+// ZSTD
+//---------------------------------------------------------
+#ifdef HAVE_ZSTD
+
+// [NOTE]
+// The zstd contexts are kept for each thread, because making context
+// costs much more than compressing small value.
+//
+typedef struct k2h_zstd_thread_ctx{
+	ZSTD_CCtx*	cctx;
+	ZSTD_DCtx*	dctx;
+}K2HZSTDTHCTX, *PK2HZSTDTHCTX;
+
+static pthread_key_t	zstd_thread_ctx_key;
+static pthread_once_t	zstd_thread_ctx_once = PTHREAD_ONCE_INIT;
+
+static void k2h_free_zstd_thread_ctx(void* pctx)
+{
+	PK2HZSTDTHCTX	pZstdCtx = reinterpret_cast<PK2HZSTDTHCTX>(pctx);
+	if(pZstdCtx){
+		if(pZstdCtx->cctx){
+			ZSTD_freeCCtx(pZstdCtx->cctx);
+		}
+		if(pZstdCtx->dctx){
+			ZSTD_freeDCtx(pZstdCtx->dctx);
+		}
+		K2H_Free(pZstdCtx);
+	}
+}
+
+static void k2h_init_zstd_thread_ctx_key(void)
+{
+	int	result;
+	if(0 != (result = pthread_key_create(&zstd_thread_ctx_key, k2h_free_zstd_thread_ctx))){
+		ERR_K2HPRN("Could not create thread key for zstd context(errno=%d).", result);
+	}
+}
+
+static PK2HZSTDTHCTX k2h_get_zstd_thread_ctx(void)
+{
+	pthread_once(&zstd_thread_ctx_once, k2h_init_zstd_thread_ctx_key);
+
+	PK2HZSTDTHCTX	pZstdCtx = reinterpret_cast<PK2HZSTDTHCTX>(pthread_getspecific(zstd_thread_ctx_key));
+	if(!pZstdCtx){
+		if(NULL == (pZstdCtx = reinterpret_cast<PK2HZSTDTHCTX>(calloc(1, sizeof(K2HZSTDTHCTX))))){
+			ERR_K2HPRN("Could not allocation memory.");
+			return NULL;
+		}
+		if(NULL == (pZstdCtx->cctx = ZSTD_createCCtx()) || NULL == (pZstdCtx->dctx = ZSTD_createDCtx())){
+			ERR_K2HPRN("Failed to make zstd context.");
+			k2h_free_zstd_thread_ctx(pZstdCtx);
+			return NULL;
+		}
+		if(0 != pthread_setspecific(zstd_thread_ctx_key, pZstdCtx)){
+			ERR_K2HPRN("Could not set zstd context to thread.");
+			k2h_free_zstd_thread_ctx(pZstdCtx);
+			return NULL;
+		}
+	}
+	return pZstdCtx;
+}
+
+#endif	// HAVE_ZSTD
+
+PK2HCOMPDICT k2h_load_zstd_dict(const char* pfile, int level)
+{
+#ifdef HAVE_ZSTD
+	if(ISEMPTYSTR(pfile)){
+		ERR_K2HPRN("Parameter is wrong.");
+		return NULL;
+	}
+	int	fd;
+	if(-1 == (fd = open(pfile, O_RDONLY))){
+		ERR_K2HPRN("Could not open dictionary file(%s), errno=%d.", pfile, errno);
+		return NULL;
+	}
+	struct stat	st;
+	if(-1 == fstat(fd, &st) || 0 >= st.st_size){
+		ERR_K2HPRN("Dictionary file(%s) is empty or could not get stat.", pfile);
+		K2H_CLOSE(fd);
+		return NULL;
+	}
+	PK2HCOMPDICT	pDict;
+	if(NULL == (pDict = reinterpret_cast<PK2HCOMPDICT>(calloc(1, sizeof(K2HCOMPDICT))))){
+		ERR_K2HPRN("Could not allocation memory.");
+		K2H_CLOSE(fd);
+		return NULL;
+	}
+	pDict->length = static_cast<size_t>(st.st_size);
+	if(NULL == (pDict->pDict = reinterpret_cast<unsigned char*>(malloc(pDict->length)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		K2H_Free(pDict);
+		K2H_CLOSE(fd);
+		return NULL;
+	}
+	if(-1 == k2h_pread(fd, pDict->pDict, pDict->length, 0)){
+		ERR_K2HPRN("Could not read dictionary file(%s).", pfile);
+		k2h_free_zstd_dict(pDict);
+		K2H_CLOSE(fd);
+		return NULL;
+	}
+	K2H_CLOSE(fd);
+
+	pDict->dictid	= ZSTD_getDictID_fromDict(pDict->pDict, pDict->length);
+	pDict->level	= level;
+	if(NULL == (pDict->pCDict = ZSTD_createCDict(pDict->pDict, pDict->length, level)) || NULL == (pDict->pDDict = ZSTD_createDDict(pDict->pDict, pDict->length))){
+		ERR_K2HPRN("Could not make zstd dictionary from file(%s).", pfile);
+		k2h_free_zstd_dict(pDict);
+		return NULL;
+	}
+	return pDict;
+#else
+	ERR_K2HPRN("k2hash is not built with zstd.");
+	return NULL;
+#endif
+}
+
+void k2h_free_zstd_dict(PK2HCOMPDICT pDict)
+{
+	if(!pDict){
+		return;
+	}
+#ifdef HAVE_ZSTD
+	if(pDict->pCDict){
+		ZSTD_freeCDict(reinterpret_cast<ZSTD_CDict*>(pDict->pCDict));
+	}
+	if(pDict->pDDict){
+		ZSTD_freeDDict(reinterpret_cast<ZSTD_DDict*>(pDict->pDDict));
+	}
+#endif
+	K2H_Free(pDict->pDict);
+	K2H_Free(pDict);
+}
+
+//
+// If pDict is specified, the level is ignored and the dictionary level is used.
+//
+unsigned char* k2h_compress_zstd(const PK2HCOMPDICT pDict, int level, const unsigned char* orgdata, size_t orglen, size_t& complen)
+{
+#ifdef HAVE_ZSTD
+	if(!orgdata || 0 == orglen){
+		return NULL;
+	}
+	PK2HZSTDTHCTX	pZstdCtx;
+	if(NULL == (pZstdCtx = k2h_get_zstd_thread_ctx())){
+		return NULL;
+	}
+	size_t			bound = ZSTD_compressBound(orglen);
+	unsigned char*	pcomp;
+	if(NULL == (pcomp = k2h_alloc_compress_buffer(orglen, bound))){
+		return NULL;
+	}
+	size_t	result;
+	if(pDict && pDict->pCDict){
+		result = ZSTD_compress_usingCDict(pZstdCtx->cctx, &pcomp[K2H_COMPRESS_HEAD_LENGTH], bound, orgdata, orglen, reinterpret_cast<const ZSTD_CDict*>(pDict->pCDict));
+	}else{
+		result = ZSTD_compressCCtx(pZstdCtx->cctx, &pcomp[K2H_COMPRESS_HEAD_LENGTH], bound, orgdata, orglen, level);
+	}
+	if(ZSTD_isError(result)){
+		ERR_K2HPRN("Failed to compress by zstd(%s).", ZSTD_getErrorName(result));
+		K2H_Free(pcomp);
+		return NULL;
+	}
+	if(orglen <= (K2H_COMPRESS_HEAD_LENGTH + result)){
+		K2H_Free(pcomp);
+		return NULL;
+	}
+	complen = K2H_COMPRESS_HEAD_LENGTH + result;
+	return pcomp;
+#else
+	ERR_K2HPRN("k2hash is not built with zstd.");
+	return NULL;
+#endif
+}
+
+unsigned char* k2h_decompress_zstd(const PK2HCOMPDICT pDict, const unsigned char* compdata, size_t complen, size_t& declen)
+{
+#ifdef HAVE_ZSTD
+	size_t	orglen = k2h_get_decompressed_length(compdata, complen);
+	if(0 == orglen){
+		ERR_K2HPRN("compressed data is something wrong.");
+		return NULL;
+	}
+	const unsigned char*	pbody	= &compdata[K2H_COMPRESS_HEAD_LENGTH];
+	size_t					bodylen	= complen - K2H_COMPRESS_HEAD_LENGTH;
+
+	// check dictionary
+	unsigned int	dictid = ZSTD_getDictID_fromFrame(pbody, bodylen);
+	if(0 != dictid && (!pDict || !pDict->pDDict || dictid != pDict->dictid)){
+		ERR_K2HPRN("Compressed data needs zstd dictionary(id=%u), but it is not loaded.", dictid);
+		return NULL;
+	}
+
+	PK2HZSTDTHCTX	pZstdCtx;
+	if(NULL == (pZstdCtx = k2h_get_zstd_thread_ctx())){
+		return NULL;
+	}
+	unsigned char*	pdec;
+	if(NULL == (pdec = reinterpret_cast<unsigned char*>(malloc(orglen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+	size_t	result;
+	if(0 != dictid){
+		result = ZSTD_decompress_usingDDict(pZstdCtx->dctx, pdec, orglen, pbody, bodylen, reinterpret_cast<const ZSTD_DDict*>(pDict->pDDict));
+	}else{
+		result = ZSTD_decompressDCtx(pZstdCtx->dctx, pdec, orglen, pbody, bodylen);
+	}
+	if(ZSTD_isError(result) || orglen != result){
+		ERR_K2HPRN("Failed to decompress zstd data(%s).", ZSTD_isError(result) ? ZSTD_getErrorName(result) : "length is not match");
+		K2H_Free(pdec);
+		return NULL;
+	}
+	declen = orglen;
+	return pdec;
+#else
+	ERR_K2HPRN("k2hash is not built with zstd.");
+	return NULL;
+#endif
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
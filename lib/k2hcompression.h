@@ -0,0 +1,85 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#ifndef	K2HCOMPRESSION_H
+#define	K2HCOMPRESSION_H
+
+#include <string>
+
+//---------------------------------------------------------
+// Symbols
+//---------------------------------------------------------
+// [NOTE]
+// The compressed value has the original value length(8 byte, big
+// endian) before compressed data. LZ4 block format does not have
+// original length, so that k2hash has it for both types.
+//	<original length(8)><compressed data>
+//
+#define	K2H_COMPRESS_HEAD_LENGTH			8
+
+#define	K2H_COMPRESS_LZ4_NAME				"lz4"
+#define	K2H_COMPRESS_ZSTD_NAME				"zstd"
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+// Dictionary for zstd
+//
+// [NOTE]
+// The dictionary is loaded from the file which is made by "zstd --train",
+// and the prepared dictionaries for compressing/decompressing are made at
+// loading, because making them takes long time.
+// The zstd types are not exposed in this header, then these are void*.
+//
+typedef struct k2h_compress_dict{
+	unsigned char*	pDict;
+	size_t			length;
+	unsigned int	dictid;						// dictionary id in zstd dictionary(0 means raw content dictionary)
+	int				level;						// compression level for pCDict
+	void*			pCDict;						// ZSTD_CDict*
+	void*			pDDict;						// ZSTD_DDict*
+}K2HCOMPDICT, *PK2HCOMPDICT;
+
+//---------------------------------------------------------
+// Functions
+//---------------------------------------------------------
+bool k2h_is_lz4_supported(void);
+bool k2h_is_zstd_supported(void);
+size_t k2h_get_decompressed_length(const unsigned char* compdata, size_t complen);
+
+unsigned char* k2h_compress_lz4(const unsigned char* orgdata, size_t orglen, size_t& complen);
+unsigned char* k2h_decompress_lz4(const unsigned char* compdata, size_t complen, size_t& declen);
+
+PK2HCOMPDICT k2h_load_zstd_dict(const char* pfile, int level);
+void k2h_free_zstd_dict(PK2HCOMPDICT pDict);
+unsigned char* k2h_compress_zstd(const PK2HCOMPDICT pDict, int level, const unsigned char* orgdata, size_t orglen, size_t& complen);
+unsigned char* k2h_decompress_zstd(const PK2HCOMPDICT pDict, const unsigned char* compdata, size_t complen, size_t& declen);
+
+#endif	// K2HCOMPRESSION_H
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -20,8 +20,11 @@
  */
 
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <sys/syscall.h>
 
 #include "k2hcommon.h"
 #include "k2hcryptcommon.h"
@@ -224,6 +227,114 @@ int k2h_get_iteration_count(const unsigned char* getpos)
 	return static_cast<int>(tmpiter);
 }
 
+//
+// Utilities for AES256 GCM nonce
+//
+// [NOTE]
+// The key for AES256 GCM is cached for each pass, thus the nonce must
+// never be reused with same key. The nonce can not be made by rand_r
+// as same as IV, because the seed of it is only 32 bit and it is not
+// safe for forked processes. Then the nonce is read from the kernel
+// random source(getrandom, or /dev/urandom if it is not supported).
+//
+bool k2h_generate_nonce(unsigned char* nonce, size_t length)
+{
+	if(!nonce || 0 == length){
+		ERR_K2HPRN("parameters are wrong.");
+		return false;
+	}
+	size_t	readlen = 0;
+#ifdef	SYS_getrandom
+	while(readlen < length){
+		long	result = syscall(SYS_getrandom, &nonce[readlen], length - readlen, 0);
+		if(-1 == result){
+			if(EINTR == errno){
+				continue;
+			}
+			break;
+		}
+		readlen += static_cast<size_t>(result);
+	}
+#endif
+	if(readlen < length){
+		int	fd;
+		if(-1 == (fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC))){
+			ERR_K2HPRN("Could not open /dev/urandom by errno(%d).", errno);
+			return false;
+		}
+		while(readlen < length){
+			ssize_t	result = read(fd, &nonce[readlen], length - readlen);
+			if(-1 == result && EINTR == errno){
+				continue;
+			}else if(result <= 0){
+				ERR_K2HPRN("Could not read from /dev/urandom by errno(%d).", errno);
+				close(fd);
+				return false;
+			}
+			readlen += static_cast<size_t>(result);
+		}
+		close(fd);
+	}
+	return true;
+}
+
+//
+// Utilities for AES256 GCM data
+//
+// Allocates the area for encrypted data, and sets prefix, iteration
+// count and nonce to it. The encrypted data and tag are set by each
+// crypt library after the header.
+//
+unsigned char* k2h_make_aes256_gcm_header(size_t orglen, int iter)
+{
+	static const char	gcm_prefix[] = K2H_ENCRYPT_GCM_PREFIX;
+
+	if(iter < 1 || 0 == orglen){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+	unsigned char*	encryptdata;
+	if(NULL == (encryptdata = reinterpret_cast<unsigned char*>(malloc(orglen + K2H_ENCRYPTED_DATA_GCM_LENGTH)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+	memcpy(encryptdata, gcm_prefix, K2H_ENCRYPT_GCM_PREFIX_LENGTH);
+
+	if(!k2h_copy_iteration_count(&encryptdata[K2H_ENCRYPT_GCM_PREFIX_LENGTH], iter, K2H_ENCRYPT_ITER_LENGTH)){
+		ERR_K2HPRN("Could not save iteration count.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	if(!k2h_generate_nonce(&encryptdata[K2H_ENCRYPT_GCM_AAD_LENGTH], K2H_ENCRYPT_GCM_NONCE_LENGTH)){
+		ERR_K2HPRN("Could not make nonce.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	return encryptdata;
+}
+
+//
+// Returns iteration count in AES256 GCM encrypted data, or -1 if the data
+// is not AES256 GCM format.
+//
+int k2h_get_aes256_gcm_iteration_count(const unsigned char* encdata, size_t enclen)
+{
+	if(!encdata || enclen <= K2H_ENCRYPTED_DATA_GCM_LENGTH){
+		ERR_K2HPRN("parameters are wrong.");
+		return -1;
+	}
+	if(0 != memcmp(encdata, K2H_ENCRYPT_GCM_PREFIX, K2H_ENCRYPT_GCM_PREFIX_LENGTH)){
+		ERR_K2HPRN("encrypted data does not have AES256 GCM prefix.");
+		return -1;
+	}
+	int	iter = k2h_get_iteration_count(&encdata[K2H_ENCRYPT_GCM_PREFIX_LENGTH]);
+	if(iter < 1){
+		ERR_K2HPRN("iteration count(%d) in encrypted data is wrong.", iter);
+		return -1;
+	}
+	return iter;
+}
+
 //
 // Base64
 //
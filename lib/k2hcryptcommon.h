@@ -44,6 +44,26 @@
 // For PBKDF2
 #define	K2H_ENCRYPTED_DATA_EX2_LENGTH		(K2H_ENCRYPT_SALT_PREFIX_LENGTH + K2H_ENCRYPT_SALT_LENGTH + K2H_ENCRYPT_IV_LENGTH + K2H_ENCRYPT_ITER_LENGTH + K2H_ENCRYPT_MAX_PADDING_LENGTH)
 
+// For AES256 GCM
+//
+// [NOTE]
+// The key for AES256 GCM is made by PBKDF2(HMAC SHA512) from the pass
+// and the fixed salt, thus the key can be made only once for each pass
+// and be cached. Instead, the nonce is made at random for each value.
+// The encrypted data is following format, and prefix and iteration count
+// are authenticated as additional data.
+//	<prefix(8)><iteration(16)><nonce(12)><encrypted data(same length as original)><tag(16)>
+//
+#define	K2H_ENCRYPT_GCM_PREFIX				"K2HGCM__"				// prefix for AES256 GCM
+#define	K2H_ENCRYPT_GCM_PREFIX_LENGTH		8						// = strlen(K2H_ENCRYPT_GCM_PREFIX)
+#define	K2H_ENCRYPT_GCM_SALT				"K2HASH.AES256.GCM.PBKDF2"
+#define	K2H_ENCRYPT_GCM_SALT_LENGTH			24						// = strlen(K2H_ENCRYPT_GCM_SALT)
+#define	K2H_ENCRYPT_GCM_KEY_LENGTH			32
+#define	K2H_ENCRYPT_GCM_NONCE_LENGTH		12
+#define	K2H_ENCRYPT_GCM_TAG_LENGTH			16
+#define	K2H_ENCRYPT_GCM_AAD_LENGTH			(K2H_ENCRYPT_GCM_PREFIX_LENGTH + K2H_ENCRYPT_ITER_LENGTH)
+#define	K2H_ENCRYPTED_DATA_GCM_LENGTH		(K2H_ENCRYPT_GCM_AAD_LENGTH + K2H_ENCRYPT_GCM_NONCE_LENGTH + K2H_ENCRYPT_GCM_TAG_LENGTH)
+
 //---------------------------------------------------------
 // Functions
 //---------------------------------------------------------
@@ -52,6 +72,9 @@ bool k2h_pkcs5_salt(unsigned char* salt, size_t length);
 bool k2h_generate_iv(unsigned char* iv, size_t length);
 bool k2h_copy_iteration_count(unsigned char* setpos, int iter, size_t count);
 int k2h_get_iteration_count(const unsigned char* getpos);
+bool k2h_generate_nonce(unsigned char* nonce, size_t length);
+unsigned char* k2h_make_aes256_gcm_header(size_t orglen, int iter);
+int k2h_get_aes256_gcm_iteration_count(const unsigned char* encdata, size_t enclen);
 
 const char* k2h_crypt_lib_name(void);
 bool k2h_crypt_lib_initialize(void);
@@ -63,6 +86,9 @@ unsigned char* k2h_encrypt_aes256_cbc(const char* pass, const unsigned char* org
 unsigned char* k2h_decrypt_aes256_cbc(const char* pass, const unsigned char* encdata, size_t enclen, size_t& declen);
 unsigned char* k2h_encrypt_aes256_cbc_pbkdf2(const char* pass, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen);
 unsigned char* k2h_decrypt_aes256_cbc_pbkdf2(const char* pass, const unsigned char* encdata, size_t enclen, size_t& declen);
+bool k2h_make_aes256_gcm_key(const char* pass, int iter, unsigned char* key);
+unsigned char* k2h_encrypt_aes256_gcm(const unsigned char* key, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen);
+unsigned char* k2h_decrypt_aes256_gcm(const unsigned char* key, const unsigned char* encdata, size_t enclen, size_t& declen);
 
 #endif	// K2HCRYPTCOMMON_H
 
@@ -20,6 +20,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 #include <gcrypt.h>
 
 #include "k2hcommon.h"
@@ -677,6 +678,180 @@ unsigned char* k2h_decrypt_aes256_cbc_pbkdf2(const char* pass, const unsigned ch
 	return decryptdata;
 }
 
+//---------------------------------------------------------
+// AES256 GCM with cached PBKDF2 key
+//---------------------------------------------------------
+// [NOTE]
+// The key is made by PBKDF2 only once for each pass by caller, and
+// the cipher handle is kept for each thread. Thus encrypting and
+// decrypting do not need making key and opening cipher handle.
+//
+static pthread_key_t	gcm_thread_hd_key;
+static pthread_once_t	gcm_thread_hd_once = PTHREAD_ONCE_INIT;
+
+static void k2h_free_gcm_thread_hd(void* phd)
+{
+	gcry_cipher_hd_t*	pGcmHd = reinterpret_cast<gcry_cipher_hd_t*>(phd);
+	if(pGcmHd){
+		gcry_cipher_close(*pGcmHd);
+		K2H_Free(pGcmHd);
+	}
+}
+
+static void k2h_init_gcm_thread_hd_key(void)
+{
+	int	result;
+	if(0 != (result = pthread_key_create(&gcm_thread_hd_key, k2h_free_gcm_thread_hd))){
+		ERR_K2HPRN("Could not create thread key for AES256 GCM handle(errno=%d).", result);
+	}
+}
+
+static gcry_cipher_hd_t* k2h_get_gcm_thread_hd(const unsigned char* key, const unsigned char* nonce)
+{
+	pthread_once(&gcm_thread_hd_once, k2h_init_gcm_thread_hd_key);
+
+	gcry_error_t		gcryError;
+	gcry_cipher_hd_t*	pGcmHd = reinterpret_cast<gcry_cipher_hd_t*>(pthread_getspecific(gcm_thread_hd_key));
+	if(!pGcmHd){
+		if(NULL == (pGcmHd = reinterpret_cast<gcry_cipher_hd_t*>(malloc(sizeof(gcry_cipher_hd_t))))){
+			ERR_K2HPRN("Could not allocation memory.");
+			return NULL;
+		}
+		if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_open(pGcmHd, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, 0))){
+			ERR_K2HPRN("Failed to open cipher handle: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+			K2H_Free(pGcmHd);
+			return NULL;
+		}
+		if(0 != pthread_setspecific(gcm_thread_hd_key, pGcmHd)){
+			ERR_K2HPRN("Could not set AES256 GCM handle to thread.");
+			k2h_free_gcm_thread_hd(pGcmHd);
+			return NULL;
+		}
+	}
+
+	// set key and nonce(setting key resets handle)
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_setkey(*pGcmHd, key, K2H_ENCRYPT_GCM_KEY_LENGTH))){
+		ERR_K2HPRN("Failed to set key to cipher handle: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		return NULL;
+	}
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_setiv(*pGcmHd, nonce, K2H_ENCRYPT_GCM_NONCE_LENGTH))){
+		ERR_K2HPRN("Failed to set nonce to cipher handle: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		return NULL;
+	}
+	return pGcmHd;
+}
+
+bool k2h_make_aes256_gcm_key(const char* pass, int iter, unsigned char* key)
+{
+	if(ISEMPTYSTR(pass) || iter < 1 || !key){
+		ERR_K2HPRN("parameters are wrong.");
+		return false;
+	}
+	gcry_error_t	gcryError;
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_kdf_derive(pass, strlen(pass), GCRY_KDF_PBKDF2, GCRY_MD_SHA512, K2H_ENCRYPT_GCM_SALT, K2H_ENCRYPT_GCM_SALT_LENGTH, iter, K2H_ENCRYPT_GCM_KEY_LENGTH, key))){
+		ERR_K2HPRN("Failed to make PBKDF2 key from pass/salt/iteration: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		return false;
+	}
+	return true;
+}
+
+unsigned char* k2h_encrypt_aes256_gcm(const unsigned char* key, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen)
+{
+	if(!key || iter < 1 || !orgdata || 0 == orglen){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	gcry_error_t		gcryError;
+	gcry_cipher_hd_t*	pGcmHd;
+	unsigned char*		encryptdata;
+	unsigned char*		noncepos;
+	unsigned char*		setdatapos;
+
+	if(NULL == (encryptdata = k2h_make_aes256_gcm_header(orglen, iter))){
+		return NULL;
+	}
+	noncepos	= &encryptdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	setdatapos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+
+	if(NULL == (pGcmHd = k2h_get_gcm_thread_hd(key, noncepos))){
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+
+	// authenticate header
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_authenticate(*pGcmHd, encryptdata, K2H_ENCRYPT_GCM_AAD_LENGTH))){
+		ERR_K2HPRN("Failed to authenticate header: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+
+	// do encrypt
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_encrypt(*pGcmHd, setdatapos, orglen, orgdata, orglen))){
+		ERR_K2HPRN("Failed to AES256 GCM encrypt: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+
+	// set tag
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_gettag(*pGcmHd, &setdatapos[orglen], K2H_ENCRYPT_GCM_TAG_LENGTH))){
+		ERR_K2HPRN("Failed to get AES256 GCM tag: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	enclen = orglen + K2H_ENCRYPTED_DATA_GCM_LENGTH;
+
+	return encryptdata;
+}
+
+unsigned char* k2h_decrypt_aes256_gcm(const unsigned char* key, const unsigned char* encdata, size_t enclen, size_t& declen)
+{
+	if(!key || !encdata || enclen <= K2H_ENCRYPTED_DATA_GCM_LENGTH){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	gcry_error_t			gcryError;
+	gcry_cipher_hd_t*		pGcmHd;
+	unsigned char*			decryptdata;
+	const unsigned char*	noncepos	= &encdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	const unsigned char*	encbodypos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+	size_t					encbodylen	= enclen - K2H_ENCRYPTED_DATA_GCM_LENGTH;
+	const unsigned char*	tagpos		= &encbodypos[encbodylen];
+
+	if(NULL == (pGcmHd = k2h_get_gcm_thread_hd(key, noncepos))){
+		return NULL;
+	}
+	if(NULL == (decryptdata = reinterpret_cast<unsigned char*>(malloc(encbodylen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+
+	// authenticate header
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_authenticate(*pGcmHd, encdata, K2H_ENCRYPT_GCM_AAD_LENGTH))){
+		ERR_K2HPRN("Failed to authenticate header: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+
+	// do decrypt
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_decrypt(*pGcmHd, decryptdata, encbodylen, encbodypos, encbodylen))){
+		ERR_K2HPRN("Failed to AES256 GCM decrypt: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+
+	// check tag
+	if(GPG_ERR_NO_ERROR != (gcryError = gcry_cipher_checktag(*pGcmHd, tagpos, K2H_ENCRYPT_GCM_TAG_LENGTH))){
+		ERR_K2HPRN("Failed to authenticate AES256 GCM encrypted data, it may be broken or wrong key: %s/%s", gcry_strsource(gcryError), gcry_strerror(gcryError));
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+	declen = encbodylen;
+
+	return decryptdata;
+}
+
 /*
  * Local variables:
  * tab-width: 4
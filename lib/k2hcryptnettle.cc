@@ -26,6 +26,8 @@
 #include <nettle/pbkdf2.h>
 #include <nettle/aes.h>
 #include <nettle/cbc.h>
+#include <nettle/gcm.h>
+#include <nettle/memops.h>
 
 #include "k2hcommon.h"
 #include "k2hcryptcommon.h"
@@ -507,6 +509,96 @@ unsigned char* k2h_decrypt_aes256_cbc_pbkdf2(const char* pass, const unsigned ch
 	return decryptdata;
 }
 
+//---------------------------------------------------------
+// AES256 GCM with cached PBKDF2 key
+//---------------------------------------------------------
+// [NOTE]
+// The key is made by PBKDF2 only once for each pass by caller.
+// The context of nettle is plain structure without allocating, thus
+// it is made on stack for each calling.
+//
+bool k2h_make_aes256_gcm_key(const char* pass, int iter, unsigned char* key)
+{
+	if(ISEMPTYSTR(pass) || iter < 1 || !key){
+		ERR_K2HPRN("parameters are wrong.");
+		return false;
+	}
+	struct hmac_sha512_ctx	sha512_ctx;
+	hmac_sha512_set_key(&sha512_ctx, strlen(pass), reinterpret_cast<const unsigned char*>(pass));
+	PBKDF2(&sha512_ctx, hmac_sha512_update, hmac_sha512_digest, SHA512_DIGEST_SIZE, iter, K2H_ENCRYPT_GCM_SALT_LENGTH, reinterpret_cast<const unsigned char*>(K2H_ENCRYPT_GCM_SALT), K2H_ENCRYPT_GCM_KEY_LENGTH, key);
+	return true;
+}
+
+unsigned char* k2h_encrypt_aes256_gcm(const unsigned char* key, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen)
+{
+	if(!key || iter < 1 || !orgdata || 0 == orglen){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	struct gcm_aes256_ctx	gcmctx;
+	unsigned char*			encryptdata;
+	unsigned char*			noncepos;
+	unsigned char*			setdatapos;
+
+	if(NULL == (encryptdata = k2h_make_aes256_gcm_header(orglen, iter))){
+		return NULL;
+	}
+	noncepos	= &encryptdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	setdatapos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+
+	// set key and nonce, and authenticate header
+	gcm_aes256_set_key(&gcmctx, key);
+	gcm_aes256_set_iv(&gcmctx, K2H_ENCRYPT_GCM_NONCE_LENGTH, noncepos);
+	gcm_aes256_update(&gcmctx, K2H_ENCRYPT_GCM_AAD_LENGTH, encryptdata);
+
+	// do encrypt and set tag
+	gcm_aes256_encrypt(&gcmctx, orglen, setdatapos, orgdata);
+	gcm_aes256_digest(&gcmctx, K2H_ENCRYPT_GCM_TAG_LENGTH, &setdatapos[orglen]);
+
+	enclen = orglen + K2H_ENCRYPTED_DATA_GCM_LENGTH;
+
+	return encryptdata;
+}
+
+unsigned char* k2h_decrypt_aes256_gcm(const unsigned char* key, const unsigned char* encdata, size_t enclen, size_t& declen)
+{
+	if(!key || !encdata || enclen <= K2H_ENCRYPTED_DATA_GCM_LENGTH){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	struct gcm_aes256_ctx	gcmctx;
+	unsigned char*			decryptdata;
+	unsigned char			tag[K2H_ENCRYPT_GCM_TAG_LENGTH];
+	const unsigned char*	noncepos	= &encdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	const unsigned char*	encbodypos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+	size_t					encbodylen	= enclen - K2H_ENCRYPTED_DATA_GCM_LENGTH;
+	const unsigned char*	tagpos		= &encbodypos[encbodylen];
+
+	if(NULL == (decryptdata = reinterpret_cast<unsigned char*>(malloc(encbodylen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+
+	// set key and nonce, and authenticate header
+	gcm_aes256_set_key(&gcmctx, key);
+	gcm_aes256_set_iv(&gcmctx, K2H_ENCRYPT_GCM_NONCE_LENGTH, noncepos);
+	gcm_aes256_update(&gcmctx, K2H_ENCRYPT_GCM_AAD_LENGTH, encdata);
+
+	// do decrypt and check tag
+	gcm_aes256_decrypt(&gcmctx, encbodylen, decryptdata, encbodypos);
+	gcm_aes256_digest(&gcmctx, K2H_ENCRYPT_GCM_TAG_LENGTH, tag);
+	if(!memeql_sec(tag, tagpos, K2H_ENCRYPT_GCM_TAG_LENGTH)){
+		ERR_K2HPRN("Failed to authenticate AES256 GCM encrypted data, it may be broken or wrong key.");
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+	declen = encbodylen;
+
+	return decryptdata;
+}
+
 /*
  * Local variables:
  * tab-width: 4
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <nss.h>
 #include <pk11pub.h>
+#include <pkcs11n.h>
 #include <hasht.h>
 #include <blapit.h>
 #include <prinit.h>
@@ -996,6 +997,190 @@ unsigned char* k2h_decrypt_aes256_cbc_pbkdf2(const char* pass, const unsigned ch
 	return decryptdata;
 }
 
+//---------------------------------------------------------
+// AES256 GCM with cached PBKDF2 key
+//---------------------------------------------------------
+// [NOTE]
+// The key is made by PBKDF2 only once for each pass by caller, and
+// it is imported as symmetric key for each calling. NSS outputs the
+// encrypted data with tag, it is as same as k2hash format.
+//
+// The structure for GCM parameter was changed at NSS 3.52, and
+// CK_NSS_GCM_PARAMS is the old structure after it.
+//
+#if	(3 < NSS_VMAJOR) || (3 == NSS_VMAJOR && 52 <= NSS_VMINOR)
+typedef CK_NSS_GCM_PARAMS	K2HNSSGCMPARAMS;
+#else
+typedef CK_GCM_PARAMS		K2HNSSGCMPARAMS;
+#endif
+
+bool k2h_make_aes256_gcm_key(const char* pass, int iter, unsigned char* key)
+{
+	if(ISEMPTYSTR(pass) || iter < 1 || !key){
+		ERR_K2HPRN("parameters are wrong.");
+		return false;
+	}
+
+	// Passphrase(key) and Salt Items
+	SECItem			passItem;
+	passItem.type	= siBuffer;
+	passItem.data	= const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(pass));
+	passItem.len	= strlen(pass);
+
+	SECItem			saltItem;
+	saltItem.type	= siBuffer;
+	saltItem.data	= const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(K2H_ENCRYPT_GCM_SALT));
+	saltItem.len	= K2H_ENCRYPT_GCM_SALT_LENGTH;
+
+	// Algorithm ID
+	SECAlgorithmID*	algid;
+	if(NULL == (algid = PK11_CreatePBEV2AlgorithmID(SEC_OID_AES_256_CBC, SEC_OID_AES_256_CBC, SEC_OID_HMAC_SHA512, K2H_ENCRYPT_GCM_KEY_LENGTH, iter, &saltItem))){
+		ERR_K2HPRN("could not get Algorithm ID.");
+		return false;
+	}
+
+	// Slot
+	PK11SlotInfo*	Slot;
+	if(NULL == (Slot = PK11_GetBestSlot(CKM_AES_GCM, NULL))){
+		ERR_K2HPRN("could not get PKCS#11 slot.");
+		SECOID_DestroyAlgorithmID(algid, PR_TRUE);
+		return false;
+	}
+
+	// Symmetric key
+	PK11SymKey*		pKey;
+	if(NULL == (pKey = PK11_PBEKeyGen(Slot, algid, &passItem, PR_FALSE, NULL))){
+		ERR_K2HPRN("could not get Symmetric Key.");
+		PK11_FreeSlot(Slot);
+		SECOID_DestroyAlgorithmID(algid, PR_TRUE);
+		return false;
+	}
+
+	// copy raw key
+	SECItem*		rawKey;
+	if(SECSuccess != PK11_ExtractKeyValue(pKey) || NULL == (rawKey = PK11_GetKeyData(pKey)) || K2H_ENCRYPT_GCM_KEY_LENGTH != rawKey->len){
+		ERR_K2HPRN("could not get raw key data.");
+		PK11_FreeSymKey(pKey);
+		PK11_FreeSlot(Slot);
+		SECOID_DestroyAlgorithmID(algid, PR_TRUE);
+		return false;
+	}
+	memcpy(key, rawKey->data, K2H_ENCRYPT_GCM_KEY_LENGTH);
+
+	PK11_FreeSymKey(pKey);
+	PK11_FreeSlot(Slot);
+	SECOID_DestroyAlgorithmID(algid, PR_TRUE);
+
+	return true;
+}
+
+static bool k2h_nss_aes256_gcm(bool is_encrypt, const unsigned char* key, const unsigned char* aad, const unsigned char* nonce, const unsigned char* indata, size_t inlen, unsigned char* outdata, size_t maxoutlen, size_t& outlen)
+{
+	// Slot
+	PK11SlotInfo*	Slot;
+	if(NULL == (Slot = PK11_GetBestSlot(CKM_AES_GCM, NULL))){
+		ERR_K2HPRN("could not get PKCS#11 slot.");
+		return false;
+	}
+
+	// Symmetric key
+	SECItem			keyItem;
+	keyItem.type	= siBuffer;
+	keyItem.data	= const_cast<unsigned char*>(key);
+	keyItem.len		= K2H_ENCRYPT_GCM_KEY_LENGTH;
+
+	PK11SymKey*		pKey;
+	if(NULL == (pKey = PK11_ImportSymKey(Slot, CKM_AES_GCM, PK11_OriginUnwrap, (is_encrypt ? CKA_ENCRYPT : CKA_DECRYPT), &keyItem, NULL))){
+		ERR_K2HPRN("could not import Symmetric Key.");
+		PK11_FreeSlot(Slot);
+		return false;
+	}
+
+	// GCM parameter
+	K2HNSSGCMPARAMS	gcmParams;
+	gcmParams.pIv		= const_cast<unsigned char*>(nonce);
+	gcmParams.ulIvLen	= K2H_ENCRYPT_GCM_NONCE_LENGTH;
+	gcmParams.pAAD		= const_cast<unsigned char*>(aad);
+	gcmParams.ulAADLen	= K2H_ENCRYPT_GCM_AAD_LENGTH;
+	gcmParams.ulTagBits	= K2H_ENCRYPT_GCM_TAG_LENGTH * 8;
+
+	SECItem			paramItem;
+	paramItem.type	= siBuffer;
+	paramItem.data	= reinterpret_cast<unsigned char*>(&gcmParams);
+	paramItem.len	= sizeof(gcmParams);
+
+	// do encrypt/decrypt
+	unsigned int	resultlen = 0;
+	SECStatus		result;
+	if(is_encrypt){
+		result = PK11_Encrypt(pKey, CKM_AES_GCM, &paramItem, outdata, &resultlen, static_cast<unsigned int>(maxoutlen), indata, static_cast<unsigned int>(inlen));
+	}else{
+		result = PK11_Decrypt(pKey, CKM_AES_GCM, &paramItem, outdata, &resultlen, static_cast<unsigned int>(maxoutlen), indata, static_cast<unsigned int>(inlen));
+	}
+	PK11_FreeSymKey(pKey);
+	PK11_FreeSlot(Slot);
+
+	if(SECSuccess != result){
+		ERR_K2HPRN("Failed to AES256 GCM %s(error=%d).", (is_encrypt ? "encrypt" : "decrypt(it may be broken or wrong key)"), PR_GetError());
+		return false;
+	}
+	outlen = static_cast<size_t>(resultlen);
+	return true;
+}
+
+unsigned char* k2h_encrypt_aes256_gcm(const unsigned char* key, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen)
+{
+	if(!key || iter < 1 || !orgdata || 0 == orglen){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	unsigned char*	encryptdata;
+	unsigned char*	noncepos;
+	unsigned char*	setdatapos;
+	size_t			encbodylen = 0;
+
+	if(NULL == (encryptdata = k2h_make_aes256_gcm_header(orglen, iter))){
+		return NULL;
+	}
+	noncepos	= &encryptdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	setdatapos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+
+	// do encrypt(output is encrypted data and tag)
+	if(!k2h_nss_aes256_gcm(true, key, encryptdata, noncepos, orgdata, orglen, setdatapos, orglen + K2H_ENCRYPT_GCM_TAG_LENGTH, encbodylen)){
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	enclen = K2H_ENCRYPT_GCM_AAD_LENGTH + K2H_ENCRYPT_GCM_NONCE_LENGTH + encbodylen;
+
+	return encryptdata;
+}
+
+unsigned char* k2h_decrypt_aes256_gcm(const unsigned char* key, const unsigned char* encdata, size_t enclen, size_t& declen)
+{
+	if(!key || !encdata || enclen <= K2H_ENCRYPTED_DATA_GCM_LENGTH){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	unsigned char*			decryptdata;
+	const unsigned char*	noncepos	= &encdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	const unsigned char*	encbodypos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+	size_t					encbodylen	= enclen - (K2H_ENCRYPT_GCM_AAD_LENGTH + K2H_ENCRYPT_GCM_NONCE_LENGTH);		// with tag
+
+	if(NULL == (decryptdata = reinterpret_cast<unsigned char*>(malloc(encbodylen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+
+	// do decrypt(input is encrypted data and tag)
+	if(!k2h_nss_aes256_gcm(false, key, encdata, noncepos, encbodypos, encbodylen, decryptdata, encbodylen, declen)){
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+	return decryptdata;
+}
+
 /*
  * Local variables:
  * tab-width: 4
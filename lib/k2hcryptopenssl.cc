@@ -20,6 +20,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 #include <openssl/evp.h>
 #include <openssl/md5.h>
 #include <openssl/sha.h>
@@ -548,6 +549,200 @@ unsigned char* k2h_decrypt_aes256_cbc_pbkdf2(const char* pass, const unsigned ch
 	return decryptdata;
 }
 
+//---------------------------------------------------------
+// AES256 GCM with cached PBKDF2 key
+//---------------------------------------------------------
+// [NOTE]
+// The key is made by PBKDF2 only once for each pass by caller, and
+// the EVP cipher contexts are kept for each thread. Thus encrypting
+// and decrypting do not need making key and allocating context.
+//
+typedef struct k2h_gcm_thread_ctx{
+	EVP_CIPHER_CTX*		encctx;
+	EVP_CIPHER_CTX*		decctx;
+}K2HGCMTHCTX, *PK2HGCMTHCTX;
+
+static pthread_key_t	gcm_thread_ctx_key;
+static pthread_once_t	gcm_thread_ctx_once = PTHREAD_ONCE_INIT;
+
+static void k2h_free_gcm_thread_ctx(void* pctx)
+{
+	PK2HGCMTHCTX	pGcmCtx = reinterpret_cast<PK2HGCMTHCTX>(pctx);
+	if(pGcmCtx){
+		if(pGcmCtx->encctx){
+			EVP_CIPHER_CTX_free(pGcmCtx->encctx);
+		}
+		if(pGcmCtx->decctx){
+			EVP_CIPHER_CTX_free(pGcmCtx->decctx);
+		}
+		K2H_Free(pGcmCtx);
+	}
+}
+
+static void k2h_init_gcm_thread_ctx_key(void)
+{
+	int	result;
+	if(0 != (result = pthread_key_create(&gcm_thread_ctx_key, k2h_free_gcm_thread_ctx))){
+		ERR_K2HPRN("Could not create thread key for AES256 GCM context(errno=%d).", result);
+	}
+}
+
+static EVP_CIPHER_CTX* k2h_get_gcm_thread_ctx(bool is_encrypt)
+{
+	pthread_once(&gcm_thread_ctx_once, k2h_init_gcm_thread_ctx_key);
+
+	PK2HGCMTHCTX	pGcmCtx = reinterpret_cast<PK2HGCMTHCTX>(pthread_getspecific(gcm_thread_ctx_key));
+	if(!pGcmCtx){
+		if(NULL == (pGcmCtx = reinterpret_cast<PK2HGCMTHCTX>(calloc(1, sizeof(K2HGCMTHCTX))))){
+			ERR_K2HPRN("Could not allocation memory.");
+			return NULL;
+		}
+		if(NULL == (pGcmCtx->encctx = EVP_CIPHER_CTX_new()) || NULL == (pGcmCtx->decctx = EVP_CIPHER_CTX_new())){
+			ERR_K2HPRN("Failed to make EVP cipher context.");
+			k2h_free_gcm_thread_ctx(pGcmCtx);
+			return NULL;
+		}
+		// set cipher type only at first(iv length is 12 byte as default)
+		if(1 != EVP_EncryptInit_ex(pGcmCtx->encctx, EVP_aes_256_gcm(), NULL, NULL, NULL) || 1 != EVP_DecryptInit_ex(pGcmCtx->decctx, EVP_aes_256_gcm(), NULL, NULL, NULL)){
+			ERR_K2HPRN("Could not initialize EVP context.");
+			k2h_free_gcm_thread_ctx(pGcmCtx);
+			return NULL;
+		}
+		if(0 != pthread_setspecific(gcm_thread_ctx_key, pGcmCtx)){
+			ERR_K2HPRN("Could not set AES256 GCM context to thread.");
+			k2h_free_gcm_thread_ctx(pGcmCtx);
+			return NULL;
+		}
+	}
+	return (is_encrypt ? pGcmCtx->encctx : pGcmCtx->decctx);
+}
+
+bool k2h_make_aes256_gcm_key(const char* pass, int iter, unsigned char* key)
+{
+	if(ISEMPTYSTR(pass) || iter < 1 || !key){
+		ERR_K2HPRN("parameters are wrong.");
+		return false;
+	}
+	if(0 == PKCS5_PBKDF2_HMAC(pass, strlen(pass), reinterpret_cast<const unsigned char*>(K2H_ENCRYPT_GCM_SALT), K2H_ENCRYPT_GCM_SALT_LENGTH, iter, EVP_sha512(), K2H_ENCRYPT_GCM_KEY_LENGTH, key)){
+		ERR_K2HPRN("Failed to make PBKDF2 key from pass/salt/iteration.");
+		return false;
+	}
+	return true;
+}
+
+unsigned char* k2h_encrypt_aes256_gcm(const unsigned char* key, int iter, const unsigned char* orgdata, size_t orglen, size_t& enclen)
+{
+	if(!key || iter < 1 || !orgdata || 0 == orglen){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	EVP_CIPHER_CTX*	cictx;
+	unsigned char*	encryptdata;
+	unsigned char*	noncepos;
+	unsigned char*	setdatapos;
+	int				encbodylen = 0;
+	int				enclastlen = 0;
+	int				aadlen		= 0;
+
+	if(NULL == (cictx = k2h_get_gcm_thread_ctx(true))){
+		return NULL;
+	}
+	if(NULL == (encryptdata = k2h_make_aes256_gcm_header(orglen, iter))){
+		return NULL;
+	}
+	noncepos	= &encryptdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	setdatapos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+
+	// set key and nonce, and authenticate header
+	if(	1 != EVP_EncryptInit_ex(cictx, NULL, NULL, key, noncepos)										||
+		1 != EVP_EncryptUpdate(cictx, NULL, &aadlen, encryptdata, K2H_ENCRYPT_GCM_AAD_LENGTH)			)
+	{
+		ERR_K2HPRN("Could not initialize EVP context.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+
+	// do encrypt
+	if(1 != EVP_EncryptUpdate(cictx, setdatapos, &encbodylen, orgdata, static_cast<int>(orglen))){
+		ERR_K2HPRN("Failed to AES256 GCM encrypt.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	if(1 != EVP_EncryptFinal_ex(cictx, &setdatapos[encbodylen], &enclastlen)){
+		ERR_K2HPRN("Failed to AES256 GCM encrypt finally.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+
+	// set tag
+	if(1 != EVP_CIPHER_CTX_ctrl(cictx, EVP_CTRL_GCM_GET_TAG, K2H_ENCRYPT_GCM_TAG_LENGTH, &setdatapos[encbodylen + enclastlen])){
+		ERR_K2HPRN("Failed to get AES256 GCM tag.");
+		K2H_Free(encryptdata);
+		return NULL;
+	}
+	enclen = static_cast<size_t>(K2H_ENCRYPTED_DATA_GCM_LENGTH + encbodylen + enclastlen);
+
+	return encryptdata;
+}
+
+unsigned char* k2h_decrypt_aes256_gcm(const unsigned char* key, const unsigned char* encdata, size_t enclen, size_t& declen)
+{
+	if(!key || !encdata || enclen <= K2H_ENCRYPTED_DATA_GCM_LENGTH){
+		ERR_K2HPRN("parameters are wrong.");
+		return NULL;
+	}
+
+	EVP_CIPHER_CTX*			cictx;
+	unsigned char*			decryptdata;
+	const unsigned char*	noncepos	= &encdata[K2H_ENCRYPT_GCM_AAD_LENGTH];
+	const unsigned char*	encbodypos	= &noncepos[K2H_ENCRYPT_GCM_NONCE_LENGTH];
+	int						encbodylen	= static_cast<int>(enclen - K2H_ENCRYPTED_DATA_GCM_LENGTH);
+	const unsigned char*	tagpos		= &encbodypos[encbodylen];
+	int						decbodylen	= 0;
+	int						declastlen	= 0;
+	int						aadlen		= 0;
+
+	if(NULL == (cictx = k2h_get_gcm_thread_ctx(false))){
+		return NULL;
+	}
+	if(NULL == (decryptdata = reinterpret_cast<unsigned char*>(malloc(encbodylen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+
+	// set key and nonce, and authenticate header
+	if(	1 != EVP_DecryptInit_ex(cictx, NULL, NULL, key, noncepos)										||
+		1 != EVP_DecryptUpdate(cictx, NULL, &aadlen, encdata, K2H_ENCRYPT_GCM_AAD_LENGTH)				)
+	{
+		ERR_K2HPRN("Could not initialize EVP context.");
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+
+	// do decrypt
+	if(1 != EVP_DecryptUpdate(cictx, decryptdata, &decbodylen, encbodypos, encbodylen)){
+		ERR_K2HPRN("Failed to AES256 GCM decrypt.");
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+
+	// check tag
+	if(1 != EVP_CIPHER_CTX_ctrl(cictx, EVP_CTRL_GCM_SET_TAG, K2H_ENCRYPT_GCM_TAG_LENGTH, const_cast<unsigned char*>(tagpos))){
+		ERR_K2HPRN("Failed to set AES256 GCM tag.");
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+	if(1 != EVP_DecryptFinal_ex(cictx, &decryptdata[decbodylen], &declastlen)){
+		ERR_K2HPRN("Failed to authenticate AES256 GCM encrypted data, it may be broken or wrong key.");
+		K2H_Free(decryptdata);
+		return NULL;
+	}
+	declen = static_cast<size_t>(decbodylen + declastlen);
+
+	return decryptdata;
+}
+
 /*
  * Local variables:
  * tab-width: 4
@@ -23,6 +23,8 @@
 #include <string>
 
 #include "k2hshm.h"
+#include "k2hattrs.h"
+#include "k2hattropsman.h"
 #include "k2hdaccess.h"
 #include "k2htrans.h"
 #include "k2hutil.h"
@@ -100,14 +102,14 @@ const int	K2HDAccess::FILE_IO_BLOCK;
 K2HDAccess::K2HDAccess() : 
 	pK2HShm(NULL), pALObjCKI(NULL), AccessMode(K2HDAccess::READ_ACCESS), byOpKey(NULL), opkeylength(0UL), fileio_size(FILE_IO_BLOCK), 
 	pWriteValPage(NULL), abs_woffset(EOF), valpage_woffset(EOF), 
-	pReadValPage(NULL), abs_roffset(EOF), valpage_roffset(EOF)
+	pReadValPage(NULL), abs_roffset(EOF), valpage_roffset(EOF), byDecodedVal(NULL), decodedlength(0UL)
 {
 }
 
 K2HDAccess::K2HDAccess(K2HShm* pk2hshm, K2HDAccess::ACSMODE access_mode) : 
 	pK2HShm(NULL), pALObjCKI(NULL), AccessMode(access_mode), byOpKey(NULL), opkeylength(0UL), fileio_size(FILE_IO_BLOCK), 
 	pWriteValPage(NULL), abs_woffset(EOF), valpage_woffset(EOF), 
-	pReadValPage(NULL), abs_roffset(EOF), valpage_roffset(EOF)
+	pReadValPage(NULL), abs_roffset(EOF), valpage_roffset(EOF), byDecodedVal(NULL), decodedlength(0UL)
 {
 	if(!Reset(pk2hshm, access_mode)){
 		ERR_K2HPRN("Some parameters are wrong.");
@@ -132,6 +134,8 @@ bool K2HDAccess::Reset(K2HShm* pk2hshm, K2HDAccess::ACSMODE access_mode)
 	AccessMode		= access_mode;
 	opkeylength		= 0UL;
 	K2H_Free(byOpKey);
+	K2H_Free(byDecodedVal);
+	decodedlength	= 0UL;
 	ResetOffsets();
 
 	if(pk2hshm && pk2hshm->IsAttached()){
@@ -210,6 +214,65 @@ bool K2HDAccess::Open(const unsigned char* byKey, size_t keylength)
 	memcpy(byOpKey, byKey, keylength);
 	opkeylength = keylength;
 
+	// check compressed value
+	//
+	// [NOTE]
+	// The compressed value can not be accessed by offset directly, thus it
+	// is decompressed into private buffer only for reading. Writing to the
+	// compressed value is not allowed, because it breaks compressed data.
+	//
+	K2HATTRFLAGS	attrflags;
+	if(pK2HShm->GetAttrFlags(pALObjCKI->pElement, attrflags) && 0 != (attrflags.flags & K2HATTR_FLAG_COMPRESS)){
+		if(AccessMode != K2HDAccess::READ_ACCESS){
+			ERR_K2HPRN("The value for key is compressed, so could not open it with writing mode.");
+			Close();
+			return false;
+		}
+		if(!LoadDecodedValue()){
+			ERR_K2HPRN("Could not decompress the value for key.");
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// Loads the value which is decoded(decrypted and decompressed) by builtin
+// attribute into private buffer.
+//
+bool K2HDAccess::LoadDecodedValue(void)
+{
+	unsigned char*	byValue = NULL;
+	ssize_t			vallen;
+	if(0 >= (vallen = pK2HShm->Get(pALObjCKI->pElement, &byValue, K2HShm::PAGEOBJ_VALUE)) || !byValue){
+		ERR_K2HPRN("Could not get value from element.");
+		K2H_Free(byValue);
+		return false;
+	}
+	K2HAttrs*	pAttrs;
+	if(NULL == (pAttrs = pK2HShm->GetAttrs(pALObjCKI->pElement))){
+		ERR_K2HPRN("Could not get attributes from element.");
+		K2H_Free(byValue);
+		return false;
+	}
+	K2hAttrOpsMan	attrman;
+	if(!attrman.Initialize(pK2HShm, byOpKey, opkeylength, byValue, static_cast<size_t>(vallen), NULL)){
+		ERR_K2HPRN("Something error occurred during initializing attributes manager class.");
+		K2H_Delete(pAttrs);
+		K2H_Free(byValue);
+		return false;
+	}
+	K2H_Free(byDecodedVal);
+	decodedlength = 0UL;
+	if(NULL == (byDecodedVal = attrman.GetDecryptValue(*pAttrs, NULL, decodedlength))){
+		ERR_K2HPRN("Something error occurred during decoding value.");
+		K2H_Delete(pAttrs);
+		K2H_Free(byValue);
+		return false;
+	}
+	K2H_Delete(pAttrs);
+	K2H_Free(byValue);
 	return true;
 }
 
@@ -224,6 +287,8 @@ bool K2HDAccess::Close(void)
 		pALObjCKI->Unlock();
 		opkeylength	= 0UL;
 		K2H_Free(byOpKey);
+		K2H_Free(byDecodedVal);
+		decodedlength = 0UL;
 	}
 	return true;
 }
@@ -277,6 +342,13 @@ bool K2HDAccess::SetOffset(off_t offset, size_t length, bool isRead)
 	}
 	ResetOffsets(isRead);
 
+	if(byDecodedVal){
+		// decompressed value in private buffer(only reading)
+		abs_roffset		= offset;
+		valpage_roffset	= offset;
+		return true;
+	}
+
 	K2HPage*	pValPage = NULL;
 	off_t		valpage_offset = EOF;
 	if(!pALObjCKI->pElement->value){
@@ -369,7 +441,7 @@ bool K2HDAccess::GetSize(size_t& size) const
 	if(!IsOpen()){
 		return false;
 	}
-	size = pALObjCKI->pElement->vallength;
+	size = (byDecodedVal ? decodedlength : pALObjCKI->pElement->vallength);
 	return true;
 }
 
@@ -541,6 +613,9 @@ bool K2HDAccess::Read(unsigned char** byValue, size_t& vallength)
 		ERR_K2HPRN("This object is not initialized value page.");
 		return false;
 	}
+	if(byDecodedVal){
+		return ReadDecodedValue(byValue, vallength);
+	}
 	// Get values
 	K2HPage*	pLastValPage;
 	off_t		next_offset;
@@ -569,6 +644,31 @@ bool K2HDAccess::Read(unsigned char** byValue, size_t& vallength)
 	return true;
 }
 
+bool K2HDAccess::ReadDecodedValue(unsigned char** byValue, size_t& vallength)
+{
+	if(EOF == abs_roffset || decodedlength <= static_cast<size_t>(abs_roffset)){
+		ERR_K2HPRN("Read offset is over value length.");
+		return false;
+	}
+	size_t	read_length = min(vallength, decodedlength - static_cast<size_t>(abs_roffset));
+	if(NULL == (*byValue = reinterpret_cast<unsigned char*>(malloc(read_length)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return false;
+	}
+	memcpy(*byValue, &byDecodedVal[abs_roffset], read_length);
+
+	if(read_length < vallength){
+		valpage_roffset = EOF;
+		abs_roffset		= EOF;
+	}else{
+		abs_roffset		+= read_length;
+		valpage_roffset	= abs_roffset;
+	}
+	vallength = read_length;
+
+	return true;
+}
+
 bool K2HDAccess::Read(int fd, size_t& rlength)
 {
 	if(0 > fd || 0UL == rlength){
@@ -592,7 +692,9 @@ bool K2HDAccess::Read(int fd, size_t& rlength)
 	}
 
 	// total size
-	size_t	total_size	= min((pALObjCKI->pElement->vallength - static_cast<size_t>(abs_roffset)), rlength);
+	size_t	vallength	= 0UL;
+	GetSize(vallength);
+	size_t	total_size	= min((vallength - static_cast<size_t>(abs_roffset)), rlength);
 	size_t	total_write	= 0UL;
 	size_t	one_read;
 	for(total_write = 0UL; 0UL < total_size; total_size -= static_cast<size_t>(one_read), total_write += static_cast<size_t>(one_read), fpos += static_cast<off_t>(one_read)){
@@ -80,6 +80,9 @@ class K2HDAccess
 		off_t				abs_roffset;				// for reading
 		off_t				valpage_roffset;			// for reading
 
+		unsigned char*		byDecodedVal;				// for reading compressed value(decompressed value)
+		size_t				decodedlength;				// for reading compressed value
+
 	private:
 		K2HDAccess();
 
@@ -89,6 +92,8 @@ class K2HDAccess
 
 		bool IsOpen(void) const { return (NULL != pK2HShm && NULL != pALObjCKI && NULL != pALObjCKI->pElement); }
 		bool IsSetValPage(bool isRead) const;
+		bool LoadDecodedValue(void);
+		bool ReadDecodedValue(unsigned char** byValue, size_t& vallength);
 
 	public:
 		K2HDAccess(K2HShm* pk2hshm, K2HDAccess::ACSMODE access_mode);
@@ -0,0 +1,212 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+
+#include <string.h>
+
+#include <fullock/flckstructure.h>
+#include <fullock/flckbaselist.tcc>
+
+#include "k2hcommon.h"
+#include "k2hhotcache.h"
+#include "k2hattrbuiltin.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+k2h_hotcache_shard::k2h_hotcache_shard() : bytes(0), LockVal(FLCK_NOSHARED_MUTEX_VAL_UNLOCKED)
+{
+}
+
+//---------------------------------------------------------
+// Utility
+//---------------------------------------------------------
+static inline size_t k2h_hotcache_entry_size(const K2HHCENTRY& entry)
+{
+	return (entry.strKey.length() + entry.strPass.length() + entry.strValue.length() + K2HHotCache::ENTRY_OVERHEAD);
+}
+
+//---------------------------------------------------------
+// Class K2HHotCache
+//---------------------------------------------------------
+const int		K2HHotCache::SHARD_COUNT;
+const size_t	K2HHotCache::ENTRY_OVERHEAD;
+
+K2HHotCache::K2HHotCache(size_t limit) : ShardLimit(limit / SHARD_COUNT), Hits(0), Misses(0)
+{
+}
+
+K2HHotCache::~K2HHotCache()
+{
+	Clear();
+}
+
+//
+// Returns the copy of cached value if the entry for key and pass exists
+// and its version is as same as version. The entry which is old version
+// or expired is removed.
+//
+bool K2HHotCache::Get(k2h_hash_t hash, const unsigned char* byKey, size_t keylength, const char* encpass, uint64_t version, unsigned char** ppValue, ssize_t& vallength)
+{
+	if(!byKey || 0 == keylength || !ppValue){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	PK2HHCSHARD	pShard	= GetShard(hash);
+	string		strKey(reinterpret_cast<const char*>(byKey), keylength);
+	bool		result	= false;
+
+	while(!fullock::flck_trylock_noshared_mutex(&(pShard->LockVal)));		// LOCK
+
+	k2hhcmap_t::iterator	pos = pShard->index.find(strKey);
+	if(pShard->index.end() != pos){
+		K2HHCENTRY&	entry = *(pos->second);
+		if(entry.version != version || (entry.is_expire && K2hAttrBuiltin::IsExpireTime(entry.expire))){
+			// entry is old or expired
+			RemoveEntry(pShard, pos);
+
+		}else if(entry.strPass == (encpass ? encpass : "")){
+			*ppValue = NULL;
+			if(!entry.strValue.empty()){
+				if(NULL == (*ppValue = reinterpret_cast<unsigned char*>(malloc(entry.strValue.length())))){
+					ERR_K2HPRN("Could not allocate memory.");
+					fullock::flck_unlock_noshared_mutex(&(pShard->LockVal));	// UNLOCK
+					return false;
+				}
+				memcpy(*ppValue, entry.strValue.data(), entry.strValue.length());
+			}
+			vallength	= static_cast<ssize_t>(entry.strValue.length());
+			result		= true;
+
+			// move to top of LRU
+			pShard->lrulist.splice(pShard->lrulist.begin(), pShard->lrulist, pos->second);
+		}
+	}
+	fullock::flck_unlock_noshared_mutex(&(pShard->LockVal));				// UNLOCK
+
+	if(result){
+		__sync_add_and_fetch(&Hits, 1);
+	}else{
+		__sync_add_and_fetch(&Misses, 1);
+	}
+	return result;
+}
+
+//
+// Set the entry for key and pass, and evict the least recently used
+// entries if the total size of shard is over the limit.
+//
+void K2HHotCache::Set(k2h_hash_t hash, const unsigned char* byKey, size_t keylength, const char* encpass, uint64_t version, const struct timespec* pexpire, const unsigned char* byValue, size_t vallength)
+{
+	if(!byKey || 0 == keylength || (!byValue && 0 < vallength)){
+		ERR_K2HPRN("Parameters are wrong.");
+		return;
+	}
+	K2HHCENTRY	entry;
+	entry.strKey.assign(reinterpret_cast<const char*>(byKey), keylength);
+	entry.strPass	= encpass ? encpass : "";
+	if(byValue){
+		entry.strValue.assign(reinterpret_cast<const char*>(byValue), vallength);
+	}
+	entry.version	= version;
+	entry.is_expire	= (NULL != pexpire);
+	if(pexpire){
+		entry.expire = *pexpire;
+	}else{
+		entry.expire.tv_sec	= 0;
+		entry.expire.tv_nsec= 0;
+	}
+	size_t	entrysize = k2h_hotcache_entry_size(entry);
+	if(ShardLimit < entrysize){
+		// too large
+		return;
+	}
+
+	PK2HHCSHARD	pShard = GetShard(hash);
+
+	while(!fullock::flck_trylock_noshared_mutex(&(pShard->LockVal)));		// LOCK
+
+	k2hhcmap_t::iterator	pos = pShard->index.find(entry.strKey);
+	if(pShard->index.end() != pos){
+		RemoveEntry(pShard, pos);
+	}
+	while(!pShard->lrulist.empty() && ShardLimit < (pShard->bytes + entrysize)){
+		// evict least recently used entry
+		k2hhcmap_t::iterator	lastpos = pShard->index.find(pShard->lrulist.back().strKey);
+		if(pShard->index.end() == lastpos){
+			// why?
+			pShard->bytes -= min(pShard->bytes, k2h_hotcache_entry_size(pShard->lrulist.back()));
+			pShard->lrulist.pop_back();
+		}else{
+			RemoveEntry(pShard, lastpos);
+		}
+	}
+	pShard->lrulist.push_front(entry);
+	pShard->index[entry.strKey]	= pShard->lrulist.begin();
+	pShard->bytes				+= entrysize;
+
+	fullock::flck_unlock_noshared_mutex(&(pShard->LockVal));				// UNLOCK
+}
+
+void K2HHotCache::Clear(void)
+{
+	for(int cnt = 0; cnt < SHARD_COUNT; ++cnt){
+		while(!fullock::flck_trylock_noshared_mutex(&(Shards[cnt].LockVal)));	// LOCK
+		Shards[cnt].index.clear();
+		Shards[cnt].lrulist.clear();
+		Shards[cnt].bytes = 0;
+		fullock::flck_unlock_noshared_mutex(&(Shards[cnt].LockVal));			// UNLOCK
+	}
+}
+
+size_t K2HHotCache::GetCount(void)
+{
+	size_t	count = 0;
+	for(int cnt = 0; cnt < SHARD_COUNT; ++cnt){
+		while(!fullock::flck_trylock_noshared_mutex(&(Shards[cnt].LockVal)));	// LOCK
+		count += Shards[cnt].index.size();
+		fullock::flck_unlock_noshared_mutex(&(Shards[cnt].LockVal));			// UNLOCK
+	}
+	return count;
+}
+
+//
+// The caller must lock the shard.
+//
+void K2HHotCache::RemoveEntry(PK2HHCSHARD pShard, k2hhcmap_t::iterator& pos)
+{
+	pShard->bytes -= min(pShard->bytes, k2h_hotcache_entry_size(*(pos->second)));
+	pShard->lrulist.erase(pos->second);
+	pShard->index.erase(pos);
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,114 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#ifndef	K2HHOTCACHE_H
+#define	K2HHOTCACHE_H
+
+#include <time.h>
+#include <string>
+#include <list>
+#include <map>
+
+#include "k2hcommon.h"
+#include "k2hash.h"
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+// The entry has decoded(decrypted and decompressed) value for the key
+// and the pass which is used for reading. The version is the key version
+// in k2hash when the value was read, and the entry is valid only while
+// the key version is not changed.
+//
+typedef struct k2h_hotcache_entry{
+	std::string			strKey;
+	std::string			strPass;
+	std::string			strValue;
+	uint64_t			version;
+	bool				is_expire;
+	struct timespec		expire;
+}K2HHCENTRY, *PK2HHCENTRY;
+
+typedef std::list<K2HHCENTRY>							k2hhclist_t;
+typedef std::map<std::string, k2hhclist_t::iterator>	k2hhcmap_t;
+
+//
+// The shard has LRU list(top is the most recently used) and the index for
+// the list, these are protected by LockVal.
+//
+typedef struct k2h_hotcache_shard{
+	k2hhclist_t			lrulist;
+	k2hhcmap_t			index;
+	size_t				bytes;
+	volatile int		LockVal;
+
+	k2h_hotcache_shard();
+}K2HHCSHARD, *PK2HHCSHARD;
+
+//---------------------------------------------------------
+// K2HHotCache Class
+//---------------------------------------------------------
+// This class is the local cache of decoded values in the process, and
+// it is made for each K2HShm object. The cache is split into shards by
+// the hash value of key, and each shard evicts the least recently used
+// entry when the total size of entries is over the limit of shard.
+// This class does not validate entries, the caller checks the key version
+// and passes it to this class.
+//
+class K2HHotCache
+{
+	public:
+		static const int	SHARD_COUNT			= 16;
+		static const size_t	ENTRY_OVERHEAD		= 128;		// approximate size of one entry without key, pass and value
+
+	protected:
+		K2HHCSHARD			Shards[SHARD_COUNT];
+		size_t				ShardLimit;						// maximum total size of entries in one shard
+		volatile uint64_t	Hits;
+		volatile uint64_t	Misses;
+
+	public:
+		explicit K2HHotCache(size_t limit);
+		virtual ~K2HHotCache();
+
+		bool Get(k2h_hash_t hash, const unsigned char* byKey, size_t keylength, const char* encpass, uint64_t version, unsigned char** ppValue, ssize_t& vallength);
+		void Set(k2h_hash_t hash, const unsigned char* byKey, size_t keylength, const char* encpass, uint64_t version, const struct timespec* pexpire, const unsigned char* byValue, size_t vallength);
+		void Clear(void);
+
+		size_t GetCount(void);
+		uint64_t GetHits(void) const { return Hits; }
+		uint64_t GetMisses(void) const { return Misses; }
+
+	protected:
+		PK2HHCSHARD GetShard(k2h_hash_t hash) { return &Shards[hash % SHARD_COUNT]; }
+		void RemoveEntry(PK2HHCSHARD pShard, k2hhcmap_t::iterator& pos);
+};
+
+#endif	// K2HHOTCACHE_H
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -546,10 +546,16 @@ K2HPage* K2HPageFile::SetData(const unsigned char* byData, size_t length, off_t
 		}
 
 		// make new page object
+		//
+		// [NOTE]
+		// The page head is owned by current page object, then keep next
+		// page offset before deleting it.
+		//
+		PPAGEHEAD	pNextPageHead = pCurPageHead->next;
 		if(this != pCurrentPage){
 			K2H_Delete(pCurrentPage);
 		}
-		pCurrentPage = new K2HPageFile(pK2HShm, PageFd, reinterpret_cast<off_t>(pPageHead->next), true);
+		pCurrentPage = new K2HPageFile(pK2HShm, PageFd, reinterpret_cast<off_t>(pNextPageHead), true);
 
 		if(!pCurrentPage->LoadPageHead() || !pCurrentPage->pPageHead){
 			ERR_K2HPRN("Failed to read page head");
@@ -26,6 +26,7 @@
 #include <sys/syscall.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <fullock/flckstructure.h>
 #include <fullock/flckbaselist.tcc>
@@ -34,6 +35,7 @@
 #include "k2hshm.h"
 #include "k2hqueue.h"
 #include "k2hutil.h"
+#include "k2hashfunc.h"
 #include "k2hdbg.h"
 
 using namespace std;
@@ -42,6 +44,9 @@ using namespace std;
 // Symbols
 //---------------------------------------------------------
 #define	K2HQUEUE_MAKER		"MARKER"
+#define	K2HQUEUE_RINGMAKER	"RINGMARKER"
+#define	K2HQUEUE_SHARDCOUNT	"SHARDCOUNT"
+#define	K2HQUEUE_SHARD_FORM	"SHARD%d"
 #define	K2HQUEUE_KEY_FORM	"%016X_%016zX_%016lX"
 
 //---------------------------------------------------------
@@ -364,6 +369,147 @@ bool K2HQueue::Dump(FILE* stream)
 	return true;
 }
 
+//
+// Push datas into queue at once, the marker is updated only once.
+//
+bool K2HQueue::PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!pdatas || 0 == count){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+
+	// make keys automatically
+	PK2HBIN	pkeys;
+	if(NULL == (pkeys = reinterpret_cast<PK2HBIN>(calloc(count, sizeof(K2HBIN))))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return false;
+	}
+	for(size_t pos = 0; pos < count; ++pos){
+		if(NULL == (pkeys[pos].byptr = GetUniqKey(pkeys[pos].length))){
+			ERR_K2HPRN("Could not get uniq key.");
+			free_k2hbins(pkeys, pos);
+			return false;
+		}
+	}
+
+	// Push
+	bool	bResult = pK2HShm->PushQueue(marker, marker_len, pkeys, pdatas, count, isFIFO, attrtype, pAttrs, encpass, expire);
+	free_k2hbins(pkeys, count);
+
+	return bResult;
+}
+
+//
+// Pop datas from queue at once(up to maxcount), the marker is updated only once.
+//
+// [NOTICE]
+// If there is no popping data in k2hshm, this method returns true with *ppdatas=NULL and count=0.
+// The caller must free *ppdatas by free_k2hbins().
+//
+bool K2HQueue::PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass)
+{
+	if(!ppdatas || 0 == maxcount){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+
+	PK2HBIN	pkeys	= NULL;
+	*ppdatas		= NULL;
+	count			= 0;
+	if(!pK2HShm->PopQueue(marker, marker_len, maxcount, &pkeys, ppdatas, count, encpass)){
+		ERR_K2HPRN("Something error occurred during popping.");
+		return false;
+	}
+	free_k2hbins(pkeys, count);
+
+	return true;
+}
+
+//
+// Pop data with waiting until data is pushed or timeout.
+// timeout_ms is milliseconds, 0 means not waiting and negative value
+// means waiting without timeout.
+//
+// [NOTE]
+// This method calls virtual Pop method, so that this works for all type
+// of queue classes. The waiter sleeps by futex in k2hash(not polling),
+// and it is woken up by pushing to queue in any process.
+//
+// [NOTICE]
+// If there is no popping data until timeout, this method returns true
+// with *ppdata=NULL, as same as Pop method.
+//
+bool K2HQueue::PopWait(unsigned char** ppdata, size_t& datalen, long timeout_ms, K2HAttrs** ppAttrs, const char* encpass)
+{
+	if(!ppdata){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsInit()){
+		ERR_K2HPRN("This object is not initialized.");
+		return false;
+	}
+	*ppdata	= NULL;
+	datalen	= 0;
+
+	if(0 == timeout_ms){
+		return Pop(ppdata, datalen, ppAttrs, encpass);
+	}
+	if(!pK2HShm->StartQueueWait()){
+		ERR_K2HPRN("Could not start waiting queue.");
+		return false;
+	}
+
+	struct timespec	limit;
+	if(0 < timeout_ms){
+		clock_gettime(CLOCK_MONOTONIC, &limit);
+		limit.tv_sec	+= timeout_ms / 1000;
+		limit.tv_nsec	+= (timeout_ms % 1000) * 1000 * 1000;
+		if(1000 * 1000 * 1000 <= limit.tv_nsec){
+			limit.tv_sec++;
+			limit.tv_nsec -= 1000 * 1000 * 1000;
+		}
+	}
+
+	bool	result;
+	while(true){
+		// [NOTE]
+		// sequence must be read before checking queue.
+		uint32_t	sequence = pK2HShm->GetQueueWakeupSequence();
+
+		if(false == (result = Pop(ppdata, datalen, ppAttrs, encpass)) || *ppdata){
+			break;
+		}
+
+		long	wait_ms = -1;
+		if(0 < timeout_ms){
+			struct timespec	now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			wait_ms = (limit.tv_sec - now.tv_sec) * 1000 + (limit.tv_nsec - now.tv_nsec) / (1000 * 1000);
+			if(wait_ms <= 0){
+				break;
+			}
+		}
+		if(!pK2HShm->WaitQueueWakeup(sequence, wait_ms)){
+			ERR_K2HPRN("Something error occurred during waiting queue.");
+			result = false;
+			break;
+		}
+	}
+	pK2HShm->StopQueueWait();
+
+	return result;
+}
+
 //---------------------------------------------------------
 // K2HKeyQueue Class : Methods
 //---------------------------------------------------------
@@ -503,6 +649,729 @@ int K2HKeyQueue::Remove(int count, k2h_q_remove_trial_callback fp, void* pExtDat
 	return pK2HShm->RemoveQueue(marker, marker_len, count, true, fp, pExtData, encpass);
 }
 
+bool K2HKeyQueue::PushBatch(const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, const char* encpass, const time_t* expire)
+{
+	if(!pkeys || 0 == count){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+
+	// write keys and values
+	if(pvals){
+		for(size_t pos = 0; pos < count; ++pos){
+			if(!pkeys[pos].byptr || 0 == pkeys[pos].length){
+				ERR_K2HPRN("Key(position %zu) is empty.", pos);
+				return false;
+			}
+			if(!pK2HShm->Set(pkeys[pos].byptr, pkeys[pos].length, pvals[pos].byptr, pvals[pos].length, encpass, expire)){
+				ERR_K2HPRN("Something error occurred during writing key-value.");
+				return false;
+			}
+		}
+	}
+
+	// set queue
+	return K2HQueue::PushBatch(pkeys, count, NULL, encpass, expire);
+}
+
+bool K2HKeyQueue::PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	WAN_K2HPRN("K2HKeyQueue::PushBatch should not use directly.");
+
+	return PushBatch(pdatas, NULL, count, encpass, expire);
+}
+
+bool K2HKeyQueue::PopBatch(size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t& count, const char* encpass)
+{
+	if(!ppkeys || !ppvals){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	*ppvals	= NULL;
+
+	// Pop key names(= queued datas)
+	*ppkeys	= NULL;
+	count	= 0;
+	if(!K2HQueue::PopBatch(maxcount, ppkeys, count, encpass)){
+		ERR_K2HPRN("Something error occurred during popping.");
+		return false;
+	}
+	if(0 == count){
+		return true;
+	}
+
+	// Get values by keys.(with checking attribute)
+	if(NULL == (*ppvals = reinterpret_cast<PK2HBIN>(calloc(count, sizeof(K2HBIN))))){
+		ERR_K2HPRN("Could not allocation memory.");
+		free_k2hbins(*ppkeys, count);
+		*ppkeys	= NULL;
+		count	= 0;
+		return false;
+	}
+	for(size_t pos = 0; pos < count; ++pos){
+		ssize_t	valuelength;
+		if(-1 == (valuelength = pK2HShm->Get((*ppkeys)[pos].byptr, (*ppkeys)[pos].length, &((*ppvals)[pos].byptr), true, encpass))){
+			MSG_K2HPRN("There is no key or failed to getting value by key, but continue...");
+			(*ppvals)[pos].byptr	= NULL;
+			(*ppvals)[pos].length	= 0;
+		}else{
+			(*ppvals)[pos].length	= static_cast<size_t>(valuelength);
+		}
+
+		// Remove key and value from k2hash
+		if(!pK2HShm->Remove((*ppkeys)[pos].byptr, (*ppkeys)[pos].length, true)){
+			ERR_K2HPRN("Could not remove key from k2hash, but continue...");
+		}
+	}
+	return true;
+}
+
+// This method returns the values which are pointed by "Key"s.
+// The "Key"s are stored as value in Queue.
+//
+bool K2HKeyQueue::PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass)
+{
+	WAN_K2HPRN("K2HKeyQueue::PopBatch should not use directly.");
+
+	PK2HBIN	pkeys	= NULL;
+	bool	result	= PopBatch(maxcount, &pkeys, ppdatas, count, encpass);
+
+	free_k2hbins(pkeys, count);
+	return result;
+}
+
+//---------------------------------------------------------
+// K2HRingQueue Class : Class Method
+//---------------------------------------------------------
+unsigned char* K2HRingQueue::GetRingMarkerName(const unsigned char* pref, size_t preflen, size_t& markerlength)
+{
+	if(!pref || 0 == preflen){
+		ERR_K2HPRN("Parameters are wrong.");
+		return NULL;
+	}
+	// make ring marker key
+	unsigned char*	pmarker;
+	markerlength = 0;
+	if(NULL == (pmarker = k2hbinappendstr(pref, preflen, K2HQUEUE_RINGMAKER, markerlength))){
+		ERR_K2HPRN("Could not make ring marker.");
+	}
+	return pmarker;
+}
+
+//---------------------------------------------------------
+// K2HRingQueue Class : Methods
+//---------------------------------------------------------
+K2HRingQueue::K2HRingQueue(K2HShm* pk2h, bool is_fifo, const unsigned char* pref, size_t preflen) : K2HQueue(NULL, is_fifo, NULL, 0L, K2hAttrOpsMan::OPSMAN_MASK_QUEUEKEY)
+{
+	if(pk2h){
+		Init(pk2h, is_fifo, pref, preflen);
+	}
+}
+
+//
+// Replace the marker which is made by K2HQueue::Init to ring marker.
+//
+bool K2HRingQueue::SetRingMarker(void)
+{
+	K2H_Free(marker);
+	marker_len = 0UL;
+	if(NULL == (marker = K2HRingQueue::GetRingMarkerName(prefix, prefix_len, marker_len))){
+		ERR_K2HPRN("Could not make ring marker.");
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool K2HRingQueue::Init(K2HShm* pk2h, bool is_fifo, const unsigned char* pref, size_t preflen)
+{
+	if(!K2HQueue::Init(pk2h, is_fifo, pref, preflen)){
+		return false;
+	}
+	return SetRingMarker();
+}
+
+bool K2HRingQueue::Init(const unsigned char* pref, size_t preflen)
+{
+	if(!K2HQueue::Init(pref, preflen)){
+		return false;
+	}
+	return SetRingMarker();
+}
+
+bool K2HRingQueue::IsEmpty(void) const
+{
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	return pK2HShm->IsEmptyRingQueue(marker, marker_len);
+}
+
+int K2HRingQueue::GetCount(void) const
+{
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return 0;
+	}
+	return pK2HShm->GetCountRingQueue(marker, marker_len);
+}
+
+bool K2HRingQueue::Read(unsigned char** ppdata, size_t& datalen, int pos, const char* encpass) const
+{
+	if(!ppdata){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!ISEMPTYSTR(encpass)){
+		ERR_K2HPRN("Ring queue does not support pass phrase.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	return pK2HShm->ReadRingQueue(marker, marker_len, ppdata, datalen, isFIFO, pos);
+}
+
+bool K2HRingQueue::Push(const unsigned char* bydata, size_t datalen, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	K2HBIN	data;
+	data.byptr	= const_cast<unsigned char*>(bydata);
+	data.length	= datalen;
+	return PushBatch(&data, 1, pAttrs, encpass, expire);
+}
+
+//
+// [NOTICE]
+// If there is no popping data in k2hshm, this method returns true with *ppdata=NULL.
+// Return false means something error is occurred.
+//
+bool K2HRingQueue::Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs, const char* encpass)
+{
+	if(!ppdata){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	*ppdata	= NULL;
+	datalen	= 0;
+	if(ppAttrs){
+		*ppAttrs = NULL;
+	}
+
+	PK2HBIN	pdatas	= NULL;
+	size_t	count	= 0;
+	if(!PopBatch(1, &pdatas, count, encpass)){
+		return false;
+	}
+	if(pdatas && 0 < count){
+		*ppdata	= pdatas[0].byptr;
+		datalen	= pdatas[0].length;
+	}
+	K2H_Free(pdatas);
+
+	return true;
+}
+
+int K2HRingQueue::Remove(int count, k2h_q_remove_trial_callback fp, void* pExtData, const char* encpass)
+{
+	if(!ISEMPTYSTR(encpass)){
+		ERR_K2HPRN("Ring queue does not support pass phrase.");
+		return -1;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return -1;
+	}
+	if(count <= 0){
+		return 0;
+	}
+	return pK2HShm->RemoveRingQueue(marker, marker_len, isFIFO, static_cast<unsigned int>(count), fp, pExtData);
+}
+
+bool K2HRingQueue::Dump(FILE* stream)
+{
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	if(!pK2HShm->DumpRingQueue(stream, marker, marker_len)){
+		ERR_K2HPRN("Something error occurred during dumping.");
+		return false;
+	}
+	return true;
+}
+
+bool K2HRingQueue::PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!pdatas || 0 == count){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(pAttrs || !ISEMPTYSTR(encpass)){
+		ERR_K2HPRN("Ring queue does not support attributes and pass phrase.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	return pK2HShm->PushRingQueue(marker, marker_len, pdatas, count, expire);
+}
+
+//
+// [NOTICE]
+// If there is no popping data in k2hshm, this method returns true with *ppdatas=NULL and count=0.
+// The caller must free *ppdatas by free_k2hbins().
+//
+bool K2HRingQueue::PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass)
+{
+	if(!ppdatas || 0 == maxcount){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	*ppdatas	= NULL;
+	count		= 0;
+	if(!ISEMPTYSTR(encpass)){
+		ERR_K2HPRN("Ring queue does not support pass phrase.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	if(!pK2HShm->PopRingQueue(marker, marker_len, isFIFO, maxcount, ppdatas, count)){
+		ERR_K2HPRN("Something error occurred during popping.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// K2HShardQueue Class : Utility
+//---------------------------------------------------------
+// Parameter for callback function wrapper on removing
+//
+typedef struct k2h_shardq_remove_param{
+	k2h_q_remove_trial_callback	fp;
+	void*						pExtData;
+	bool						is_finish;
+}K2HSHARDQRMPARAM, *PK2HSHARDQRMPARAM;
+
+static K2HQRMCBRES k2h_shardq_remove_callback(const unsigned char* bydata, size_t datalen, const PK2HATTRPCK pattrs, int attrscnt, void* pExtData)
+{
+	PK2HSHARDQRMPARAM	pParam = reinterpret_cast<PK2HSHARDQRMPARAM>(pExtData);
+	if(!pParam || !pParam->fp){
+		return K2HQRMCB_RES_ERROR;
+	}
+	K2HQRMCBRES	res = pParam->fp(bydata, datalen, pattrs, attrscnt, pParam->pExtData);
+	if(K2HQRMCB_RES_ERROR == res || K2HQRMCB_RES_FIN_RM == res || K2HQRMCB_RES_FIN_NOTRM == res){
+		pParam->is_finish = true;
+	}
+	return res;
+}
+
+//---------------------------------------------------------
+// K2HShardQueue Class : Class Method
+//---------------------------------------------------------
+unsigned char* K2HShardQueue::GetShardCountKeyName(const unsigned char* pref, size_t preflen, size_t& keylength)
+{
+	if(!pref || 0 == preflen){
+		ERR_K2HPRN("Parameters are wrong.");
+		return NULL;
+	}
+	unsigned char*	pkey;
+	keylength = 0;
+	if(NULL == (pkey = k2hbinappendstr(pref, preflen, K2HQUEUE_SHARDCOUNT, keylength))){
+		ERR_K2HPRN("Could not make shard count key.");
+	}
+	return pkey;
+}
+
+//---------------------------------------------------------
+// K2HShardQueue Class : Methods
+//---------------------------------------------------------
+K2HShardQueue::K2HShardQueue(K2HShm* pk2h, bool is_fifo, const unsigned char* pref, size_t preflen, int shardcnt, int mode) : K2HQueue(NULL, is_fifo, NULL, 0L, K2hAttrOpsMan::OPSMAN_MASK_QUEUEKEY), shardmode(mode), rrpos(0)
+{
+	if(pk2h){
+		Init(pk2h, is_fifo, pref, preflen, shardcnt, mode);
+	}
+}
+
+K2HShardQueue::~K2HShardQueue()
+{
+	ClearShards();
+}
+
+bool K2HShardQueue::ClearShards(void)
+{
+	for(k2hqueues_t::iterator iter = shards.begin(); iter != shards.end(); ++iter){
+		K2H_Delete(*iter);
+	}
+	shards.clear();
+	rrpos = 0;
+
+	return true;
+}
+
+bool K2HShardQueue::Init(K2HShm* pk2h, bool is_fifo, const unsigned char* pref, size_t preflen, int shardcnt, int mode)
+{
+	ClearShards();
+	if(!K2HQueue::Init(pk2h, is_fifo, pref, preflen)){
+		return false;
+	}
+	shardmode = mode;
+	return InitShards(shardcnt);
+}
+
+bool K2HShardQueue::Init(const unsigned char* pref, size_t preflen, int shardcnt, int mode)
+{
+	ClearShards();
+	if(!K2HQueue::Init(pref, preflen)){
+		return false;
+	}
+	shardmode = mode;
+	return InitShards(shardcnt);
+}
+
+//
+// Decide shard count by the saved count in k2hash, and make sub queues.
+//
+bool K2HShardQueue::InitShards(int shardcnt)
+{
+	if(shardcnt < 0 || K2HShardQueue::MAX_SHARD_COUNT < shardcnt){
+		ERR_K2HPRN("Shard count(%d) is wrong, it must be 0 to %d.", shardcnt, K2HShardQueue::MAX_SHARD_COUNT);
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+
+	// load(or save) shard count
+	unsigned char*	pcntkey;
+	size_t			cntkeylen = 0;
+	if(NULL == (pcntkey = K2HShardQueue::GetShardCountKeyName(prefix, prefix_len, cntkeylen))){
+		return false;
+	}
+	unsigned char*	pcntval	= NULL;
+	ssize_t			cntvallen;
+	if(-1 != (cntvallen = pK2HShm->Get(pcntkey, cntkeylen, &pcntval, false)) && pcntval && static_cast<size_t>(cntvallen) == sizeof(int32_t)){
+		int32_t	savedcnt = 0;
+		memcpy(&savedcnt, pcntval, sizeof(int32_t));
+		if(0 != shardcnt && shardcnt != savedcnt){
+			ERR_K2HPRN("Shard count(%d) is different from saved shard count(%d).", shardcnt, savedcnt);
+			K2H_Free(pcntval);
+			K2H_Free(pcntkey);
+			return false;
+		}
+		shardcnt = savedcnt;
+	}else{
+		if(0 == shardcnt){
+			shardcnt = K2HShardQueue::DEFAULT_SHARD_COUNT;
+		}
+		// shard count key does not have any attribute
+		int32_t	savecnt = static_cast<int32_t>(shardcnt);
+		if(!pK2HShm->Set(pcntkey, cntkeylen, reinterpret_cast<const unsigned char*>(&savecnt), sizeof(int32_t), NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
+			ERR_K2HPRN("Could not save shard count.");
+			K2H_Free(pcntval);
+			K2H_Free(pcntkey);
+			return false;
+		}
+	}
+	K2H_Free(pcntval);
+	K2H_Free(pcntkey);
+
+	if(shardcnt <= 0 || K2HShardQueue::MAX_SHARD_COUNT < shardcnt){
+		ERR_K2HPRN("Shard count(%d) is wrong.", shardcnt);
+		return false;
+	}
+
+	// make sub queues
+	for(int cnt = 0; cnt < shardcnt; ++cnt){
+		char			szshard[32];
+		unsigned char*	pshardpref;
+		size_t			shardpreflen = 0;
+		sprintf(szshard, K2HQUEUE_SHARD_FORM, cnt);
+		if(NULL == (pshardpref = k2hbinappendstr(prefix, prefix_len, szshard, shardpreflen))){
+			ERR_K2HPRN("Could not make shard prefix.");
+			ClearShards();
+			return false;
+		}
+		K2HQueue*	pshard = new K2HQueue();
+		if(!pshard->Init(pK2HShm, isFIFO, pshardpref, shardpreflen, attrtype)){
+			ERR_K2HPRN("Could not initialize shard(%d) queue.", cnt);
+			K2H_Delete(pshard);
+			K2H_Free(pshardpref);
+			ClearShards();
+			return false;
+		}
+		K2H_Free(pshardpref);
+		shards.push_back(pshard);
+	}
+	return true;
+}
+
+size_t K2HShardQueue::GetPushShard(const unsigned char* bydata, size_t datalen) const
+{
+	if(0 != (shardmode & K2H_SHARDQ_PUSH_BY_HASH) && bydata && 0 < datalen){
+		return static_cast<size_t>(K2H_HASH_FUNC(reinterpret_cast<const void*>(bydata), datalen) % shards.size());
+	}
+	return static_cast<size_t>(gettid()) % shards.size();
+}
+
+size_t K2HShardQueue::GetPopShard(void)
+{
+	if(0 != (shardmode & K2H_SHARDQ_POP_AFFINITY)){
+		return static_cast<size_t>(gettid()) % shards.size();
+	}
+	size_t	pos	= rrpos % shards.size();
+	rrpos		= (pos + 1) % shards.size();
+	return pos;
+}
+
+bool K2HShardQueue::IsEmpty(void) const
+{
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	for(k2hqueues_t::const_iterator iter = shards.begin(); iter != shards.end(); ++iter){
+		if(!(*iter)->IsEmpty()){
+			return false;
+		}
+	}
+	return true;
+}
+
+int K2HShardQueue::GetCount(void) const
+{
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return 0;
+	}
+	int	total = 0;
+	for(k2hqueues_t::const_iterator iter = shards.begin(); iter != shards.end(); ++iter){
+		int	count = (*iter)->GetCount();
+		total	  = (INT_MAX - total) < count ? INT_MAX : (total + count);
+	}
+	return total;
+}
+
+bool K2HShardQueue::Read(unsigned char** ppdata, size_t& datalen, int pos, const char* encpass) const
+{
+	if(!ppdata || pos < 0){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	for(k2hqueues_t::const_iterator iter = shards.begin(); iter != shards.end(); ++iter){
+		int	count = (*iter)->GetCount();
+		if(pos < count){
+			return (*iter)->Read(ppdata, datalen, pos, encpass);
+		}
+		pos -= count;
+	}
+	MSG_K2HPRN("There is no data at the position in shard queue.");
+	return false;
+}
+
+bool K2HShardQueue::Push(const unsigned char* bydata, size_t datalen, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	return shards[GetPushShard(bydata, datalen)]->Push(bydata, datalen, pAttrs, encpass, expire);
+}
+
+//
+// [NOTICE]
+// If there is no popping data in all shards, this method returns true with *ppdata=NULL.
+// Return false means something error is occurred.
+//
+bool K2HShardQueue::Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs, const char* encpass)
+{
+	if(!ppdata){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	*ppdata	= NULL;
+	datalen	= 0;
+
+	size_t	start = GetPopShard();
+	for(size_t cnt = 0; cnt < shards.size(); ++cnt){
+		if(!shards[(start + cnt) % shards.size()]->Pop(ppdata, datalen, ppAttrs, encpass)){
+			ERR_K2HPRN("Something error occurred during popping from shard(%zu).", (start + cnt) % shards.size());
+			return false;
+		}
+		if(*ppdata){
+			break;
+		}
+	}
+	return true;
+}
+
+int K2HShardQueue::Remove(int count, k2h_q_remove_trial_callback fp, void* pExtData, const char* encpass)
+{
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return -1;
+	}
+
+	K2HSHARDQRMPARAM	param	= {fp, pExtData, false};
+	int					removed	= 0;
+	for(k2hqueues_t::iterator iter = shards.begin(); iter != shards.end() && 0 < count && !param.is_finish; ++iter){
+		int	checkcnt = min(count, (*iter)->GetCount());
+		if(0 >= checkcnt){
+			continue;
+		}
+		int	result;
+		if(fp){
+			result = (*iter)->Remove(checkcnt, k2h_shardq_remove_callback, &param, encpass);
+		}else{
+			result = (*iter)->Remove(checkcnt, NULL, NULL, encpass);
+		}
+		if(result < 0){
+			ERR_K2HPRN("Something error occurred during removing from shard.");
+			return -1;
+		}
+		removed	+= result;
+		count	-= checkcnt;
+	}
+	return removed;
+}
+
+bool K2HShardQueue::Dump(FILE* stream)
+{
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	for(k2hqueues_t::iterator iter = shards.begin(); iter != shards.end(); ++iter){
+		if(!(*iter)->Dump(stream)){
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// Push datas into shards at once.
+// When the shard is decided by the hash value, the datas are grouped by
+// each shard and pushed with keeping their order.
+//
+bool K2HShardQueue::PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!pdatas || 0 == count){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	if(0 == (shardmode & K2H_SHARDQ_PUSH_BY_HASH)){
+		return shards[GetPushShard(NULL, 0)]->PushBatch(pdatas, count, pAttrs, encpass, expire);
+	}
+
+	PK2HBIN	pgroup;
+	if(NULL == (pgroup = reinterpret_cast<PK2HBIN>(calloc(count, sizeof(K2HBIN))))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return false;
+	}
+	vector<size_t>	shardpos(count);
+	for(size_t pos = 0; pos < count; ++pos){
+		shardpos[pos] = GetPushShard(pdatas[pos].byptr, pdatas[pos].length);
+	}
+	bool	result = true;
+	for(size_t shard = 0; shard < shards.size() && result; ++shard){
+		size_t	groupcnt = 0;
+		for(size_t pos = 0; pos < count; ++pos){
+			if(shard == shardpos[pos]){
+				pgroup[groupcnt++] = pdatas[pos];
+			}
+		}
+		if(0 < groupcnt && !shards[shard]->PushBatch(pgroup, groupcnt, pAttrs, encpass, expire)){
+			ERR_K2HPRN("Could not push datas into shard(%zu).", shard);
+			result = false;
+		}
+	}
+	K2H_Free(pgroup);
+
+	return result;
+}
+
+//
+// [NOTICE]
+// If there is no popping data in all shards, this method returns true with *ppdatas=NULL and count=0.
+// The caller must free *ppdatas by free_k2hbins().
+//
+bool K2HShardQueue::PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass)
+{
+	if(!ppdatas || 0 == maxcount){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafeShards()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	*ppdatas	= NULL;
+	count		= 0;
+
+	size_t	start = GetPopShard();
+	for(size_t cnt = 0; cnt < shards.size() && count < maxcount; ++cnt){
+		PK2HBIN	pshardatas	= NULL;
+		size_t	shardcount	= 0;
+		if(!shards[(start + cnt) % shards.size()]->PopBatch(maxcount - count, &pshardatas, shardcount, encpass)){
+			ERR_K2HPRN("Something error occurred during popping from shard(%zu).", (start + cnt) % shards.size());
+			if(*ppdatas){
+				free_k2hbins(*ppdatas, count);
+				*ppdatas = NULL;
+			}
+			count = 0;
+			return false;
+		}
+		if(!pshardatas || 0 == shardcount){
+			K2H_Free(pshardatas);
+			continue;
+		}
+		if(!*ppdatas){
+			// first popping, use it as result
+			*ppdatas	= pshardatas;
+			count		= shardcount;
+			if(count < maxcount){
+				PK2HBIN	ptmp;
+				if(NULL == (ptmp = reinterpret_cast<PK2HBIN>(realloc(*ppdatas, sizeof(K2HBIN) * maxcount)))){
+					ERR_K2HPRN("Could not allocation memory.");
+					free_k2hbins(*ppdatas, count);
+					*ppdatas	= NULL;
+					count		= 0;
+					return false;
+				}
+				*ppdatas = ptmp;
+			}
+		}else{
+			memcpy(&((*ppdatas)[count]), pshardatas, sizeof(K2HBIN) * shardcount);
+			count += shardcount;
+			K2H_Free(pshardatas);
+		}
+	}
+	return true;
+}
+
 //---------------------------------------------------------
 // K2HLowOpsQueue Class : Methods
 //---------------------------------------------------------
@@ -542,16 +1411,34 @@ bool K2HLowOpsQueue::Push(const unsigned char* bydata, size_t datalen, K2HAttrs*
 	return pK2HShm->AddQueue(marker, marker_len, bydata, datalen, isFIFO);
 }
 
+//
+// Push queue key names to marker at once
+// pdatas	- pushing queue key binary arrays, those must be linked before calling this.
+// count	- pushing queue key count
+//
+bool K2HLowOpsQueue::PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!pdatas || 0 == count || pAttrs || encpass || expire){		// [NOTE] do not use pAttrs, encpass and expire.
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsSafe()){
+		ERR_K2HPRN("This object is not safe.");
+		return false;
+	}
+	return pK2HShm->AddQueue(marker, marker_len, pdatas, count, isFIFO);
+}
+
 //
 // Remove next queue key name from marker and set new next queue key
 //
-bool K2HLowOpsQueue::ReplaceTopQueueKey(const unsigned char* preplacekey, size_t replacekeylen)
+bool K2HLowOpsQueue::ReplaceTopQueueKey(const unsigned char* preplacekey, size_t replacekeylen, long popcount)
 {
 	if(!IsSafe()){
 		ERR_K2HPRN("This object is not safe.");
 		return false;
 	}
-	return pK2HShm->UpdateStartK2HMarker(marker, marker_len, preplacekey, replacekeylen);
+	return pK2HShm->UpdateStartK2HMarker(marker, marker_len, preplacekey, replacekeylen, popcount);
 }
 
 //
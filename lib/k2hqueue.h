@@ -21,6 +21,8 @@
 #ifndef	K2HQUEUE_H
 #define	K2HQUEUE_H
 
+#include <vector>
+
 #include "k2hattropsman.h"
 
 class K2HShm;
@@ -66,6 +68,11 @@ class K2HQueue
 		virtual bool Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
 		virtual int Remove(int count, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL, const char* encpass = NULL);
 		virtual bool Dump(FILE* stream);
+
+		virtual bool PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass = NULL);
+
+		bool PopWait(unsigned char** ppdata, size_t& datalen, long timeout_ms, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
 };
 
 //---------------------------------------------------------
@@ -98,6 +105,12 @@ class K2HQueue
 // Remove(int count)
 // 	Removes the key names from Queue, and removes those key from k2hash.
 // 
+// PushBatch(const PK2HBIN pkeys, const PK2HBIN pvals, size_t count)
+// 	This method writes keys and values into k2hash, and saves those keys into Queue at once.
+// 
+// PopBatch(size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t& count)
+// 	This method returns keys and values in Queue at once, and removes those keys from k2hash.
+// 
 // [NOTICE]
 // The base class's method K2HQueue::Push has "bydata" parameter, which means "key-name"
 // in this class. This value(byval) is stored into Queue.
@@ -117,6 +130,130 @@ class K2HKeyQueue : public K2HQueue
 		bool Pop(unsigned char** ppkey, size_t& keylen, unsigned char** ppval, size_t& vallen, const char* encpass = NULL);
 		virtual bool Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
 		virtual int Remove(int count, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL, const char* encpass = NULL);
+
+		bool PushBatch(const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		bool PopBatch(size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t& count, const char* encpass = NULL);
+		virtual bool PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass = NULL);
+};
+
+//---------------------------------------------------------
+// K2HRingQueue Class
+//---------------------------------------------------------
+// This class is queue which stores datas into contiguous ring buffer
+// instead of making key for each data. The ring buffer is the block in
+// the extra area of k2hash which is pointed by one key(ring marker),
+// and the block has head and tail offsets in ring buffer. Then pushing
+// (popping) is writing(reading) the record in ring buffer and updating
+// the offsets, it does not depend on the count of datas and mapping
+// mode. The ring buffer is moved to larger block automatically when it
+// does not have enough space.
+//
+// This class has same interface as K2HQueue, but the ring marker name is
+// different from K2HQueue marker. Thus the queue with same prefix for
+// K2HQueue and this class is different queue.
+//
+// [NOTICE]
+// This class does not support attributes and pass phrase for each data,
+// but supports expire time.
+//
+class K2HRingQueue : public K2HQueue
+{
+	protected:
+		static unsigned char* GetRingMarkerName(const unsigned char* pref, size_t preflen, size_t& markerlength);
+
+		bool SetRingMarker(void);
+
+	public:
+		explicit K2HRingQueue(K2HShm* pk2h = NULL, bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L);
+		virtual ~K2HRingQueue() {}
+
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress duplInheritedMember
+		bool Init(K2HShm* pk2h, bool is_fifo, const unsigned char* pref = NULL, size_t preflen = 0L);
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress duplInheritedMember
+		bool Init(const unsigned char* pref = NULL, size_t preflen = 0L);
+
+		virtual bool IsEmpty(void) const;
+		virtual int GetCount(void) const;
+		virtual bool Read(unsigned char** ppdata, size_t& datalen, int pos = 0, const char* encpass = NULL) const;
+		virtual bool Push(const unsigned char* bydata, size_t datalen, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
+		virtual int Remove(int count, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL, const char* encpass = NULL);
+		virtual bool Dump(FILE* stream);
+
+		virtual bool PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass = NULL);
+};
+
+//---------------------------------------------------------
+// K2HShardQueue Class
+//---------------------------------------------------------
+// This class spreads one logical queue over some sub queues(shards) for
+// removing the hot spot of one marker. Each shard is K2HQueue which has
+// prefix made from this queue prefix and shard number.
+//
+// The shard for pushing is decided by the thread id of pusher or the
+// hash value of pushing data(K2H_SHARDQ_PUSH_BY_XXX). The shard for
+// popping is decided by round robin or affinity which is the same shard
+// as pushing by thread id(K2H_SHARDQ_POP_XXX), and if the shard is empty,
+// the data is popped from other shards.
+// 
+// The shard count is saved into k2hash, and all objects for same queue
+// must use the same shard count. If the shard count is 0 for initializing,
+// this class uses saved shard count(or default count when it is not saved).
+//
+// [NOTICE]
+// The order of datas is guaranteed only in each shard(FIFO/LIFO), it is not
+// guaranteed in whole of this queue.
+// Read and Remove methods process the shards in order of shard number.
+//
+class K2HShardQueue : public K2HQueue
+{
+	public:
+		static const int			DEFAULT_SHARD_COUNT	= 8;
+		static const int			MAX_SHARD_COUNT		= 1024;
+
+	protected:
+		typedef std::vector<K2HQueue*>	k2hqueues_t;
+
+		k2hqueues_t					shards;
+		int							shardmode;		// K2H_SHARDQ_PUSH_XXX | K2H_SHARDQ_POP_XXX
+		size_t						rrpos;			// next shard for popping by round robin
+
+	protected:
+		static unsigned char* GetShardCountKeyName(const unsigned char* pref, size_t preflen, size_t& keylength);
+
+		bool IsSafeShards(void) const { return (IsSafe() && !shards.empty()); }
+		bool ClearShards(void);
+		bool InitShards(int shardcnt);
+		size_t GetPushShard(const unsigned char* bydata, size_t datalen) const;
+		size_t GetPopShard(void);
+
+	public:
+		explicit K2HShardQueue(K2HShm* pk2h = NULL, bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L, int shardcnt = 0, int mode = K2H_SHARDQ_DEFAULT_MODE);
+		virtual ~K2HShardQueue();
+
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress duplInheritedMember
+		bool Init(K2HShm* pk2h, bool is_fifo, const unsigned char* pref = NULL, size_t preflen = 0L, int shardcnt = 0, int mode = K2H_SHARDQ_DEFAULT_MODE);
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress duplInheritedMember
+		bool Init(const unsigned char* pref = NULL, size_t preflen = 0L, int shardcnt = 0, int mode = K2H_SHARDQ_DEFAULT_MODE);
+
+		int GetShardCount(void) const { return static_cast<int>(shards.size()); }
+
+		virtual bool IsEmpty(void) const;
+		virtual int GetCount(void) const;
+		virtual bool Read(unsigned char** ppdata, size_t& datalen, int pos = 0, const char* encpass = NULL) const;
+		virtual bool Push(const unsigned char* bydata, size_t datalen, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
+		virtual int Remove(int count, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL, const char* encpass = NULL);
+		virtual bool Dump(FILE* stream);
+
+		virtual bool PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL);
+		virtual bool PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass = NULL);
 };
 
 //---------------------------------------------------------
@@ -140,8 +277,10 @@ class K2HLowOpsQueue : public K2HQueue
 		virtual bool Read(unsigned char** ppdata, size_t& datalen, int pos = 0, const char* encpass = NULL) const;
 		virtual bool Push(const unsigned char* bydata, size_t datalen, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
 		virtual bool Pop(unsigned char** ppdata, size_t& datalen, K2HAttrs** ppAttrs, const char* encpass) { return K2HQueue::Pop(ppdata, datalen, ppAttrs, encpass); }
+		virtual bool PushBatch(const PK2HBIN pdatas, size_t count, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
+		virtual bool PopBatch(size_t maxcount, PK2HBIN* ppdatas, size_t& count, const char* encpass) { return K2HQueue::PopBatch(maxcount, ppdatas, count, encpass); }
 
-		bool ReplaceTopQueueKey(const unsigned char* preplacekey, size_t replacekeylen);
+		bool ReplaceTopQueueKey(const unsigned char* preplacekey, size_t replacekeylen, long popcount = -1L);
 		unsigned char* GetEdgeQueueKey(size_t& keylen, bool is_top) const;
 
 	public:
@@ -153,9 +292,13 @@ class K2HLowOpsQueue : public K2HQueue
 		//
 		// Push							: push new queue key name into queue, decide FIFO/LIFO by this method
 		// Pop							: pop one queue key name from queue, and replace new queue key in marker which is planned next popping, decide FIFO/LIFO by this method
+		// PushBatch					: push new queue key names into queue at once, those keys must be linked before calling this.
+		// PopBatch						: pop count queue key names from queue at once, and replace new queue key in marker which is planned next popping
 		//
 		bool Push(const unsigned char* bykey, size_t keylen) { return Push(bykey, keylen, NULL, NULL, NULL); }
-		bool Pop(const unsigned char* preplacekey, size_t replacekeylen) { return ReplaceTopQueueKey(preplacekey, replacekeylen); }
+		bool Pop(const unsigned char* preplacekey, size_t replacekeylen) { return ReplaceTopQueueKey(preplacekey, replacekeylen, 1L); }
+		bool PushBatch(const PK2HBIN pkeys, size_t count) { return PushBatch(pkeys, count, NULL, NULL, NULL); }
+		bool PopBatch(const unsigned char* preplacekey, size_t replacekeylen, size_t count) { return ReplaceTopQueueKey(preplacekey, replacekeylen, static_cast<long>(count)); }
 
 		//
 		// get queue key names methods
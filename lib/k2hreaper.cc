@@ -0,0 +1,167 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <time.h>
+
+#include <fullock/flckstructure.h>
+#include <fullock/flckbaselist.tcc>
+
+#include "k2hcommon.h"
+#include "k2hreaper.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// K2HExpireReaper : Class Methods
+//---------------------------------------------------------
+K2HExpireReaper* K2HExpireReaper::Get(void)
+{
+	static K2HExpireReaper	reaper;								// singleton
+	return &reaper;
+}
+
+void* K2HExpireReaper::WorkerProc(void* param)
+{
+	PRPTHPARAM	prpparam = reinterpret_cast<PRPTHPARAM>(param);
+	if(!prpparam || !prpparam->pShm){
+		ERR_K2HPRN("The parameter pointer is NULL.");
+		pthread_exit(NULL);
+	}
+
+	struct timespec		sleeptime = {0, K2HExpireReaper::MINIMUM_WAIT_SLEEP * 1000 * 1000};
+	while(!prpparam->is_exit){
+		size_t	reaped = 0;
+		if(!prpparam->pShm->ReapExpired(static_cast<size_t>(prpparam->step_count), &reaped)){
+			WAN_K2HPRN("Something error occurred in reaping expired keys, but continue...");
+			reaped = 0;
+		}
+		if(0 < reaped){
+			MSG_K2HPRN("Reaper removed %zu expired keys.", reaped);
+		}
+		if(static_cast<size_t>(prpparam->step_count) <= reaped){
+			continue;
+		}
+
+		// sleep for interval
+		for(long waited = 0L; !prpparam->is_exit && waited < prpparam->interval_ms; waited += K2HExpireReaper::MINIMUM_WAIT_SLEEP){
+			nanosleep(&sleeptime, NULL);
+		}
+	}
+	return NULL;
+}
+
+//---------------------------------------------------------
+// K2HExpireReaper : Constructor / Destructor
+//---------------------------------------------------------
+K2HExpireReaper::K2HExpireReaper() : LockParam(FLCK_NOSHARED_MUTEX_VAL_UNLOCKED)
+{
+}
+
+K2HExpireReaper::~K2HExpireReaper()
+{
+	// [NOTE]
+	// All K2HShm objects should stop reaper before this destructor.
+	//
+	while(!rpparammap.empty()){
+		if(!Stop(rpparammap.begin()->first)){
+			break;
+		}
+	}
+}
+
+//---------------------------------------------------------
+// K2HExpireReaper : Methods
+//---------------------------------------------------------
+bool K2HExpireReaper::Start(K2HShm* pk2hshm, long interval_ms, long step_count)
+{
+	if(!pk2hshm || interval_ms <= 0L || step_count <= 0L){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+
+	// stop running reaper for restarting
+	if(!Stop(pk2hshm)){
+		ERR_K2HPRN("Could not stop running reaper.");
+		return false;
+	}
+
+	PRPTHPARAM	prpparam = new RPTHPARAM(pk2hshm, interval_ms, step_count);
+	int			result;
+	if(0 != (result = pthread_create(&(prpparam->tid), NULL, K2HExpireReaper::WorkerProc, prpparam))){
+		ERR_K2HPRN("Failed to create thread(return code = %d).", result);
+		K2H_Delete(prpparam);
+		return false;
+	}
+
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+	rpparammap[pk2hshm] = prpparam;
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	return true;
+}
+
+bool K2HExpireReaper::Stop(const K2HShm* pk2hshm)
+{
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+
+	rpparammap_t::iterator	iter = rpparammap.find(pk2hshm);
+	if(rpparammap.end() == iter){
+		fullock::flck_unlock_noshared_mutex(&LockParam);
+		return true;
+	}
+	PRPTHPARAM	prpparam = iter->second;
+	rpparammap.erase(iter);
+
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	// wait for exiting thread
+	prpparam->is_exit = true;
+
+	int		result;
+	bool	is_success = true;
+	if(0 != (result = pthread_join(prpparam->tid, NULL))){
+		ERR_K2HPRN("Failed to wait exiting thread(return code = %d).", result);
+		is_success = false;
+	}
+	K2H_Delete(prpparam);
+
+	return is_success;
+}
+
+bool K2HExpireReaper::IsRun(const K2HShm* pk2hshm)
+{
+	while(!fullock::flck_trylock_noshared_mutex(&LockParam));	// no call sched_yield()
+	bool	result = (rpparammap.end() != rpparammap.find(pk2hshm));
+	fullock::flck_unlock_noshared_mutex(&LockParam);
+
+	return result;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -32,6 +32,7 @@
 #include "k2hshmupdater.h"
 #include "k2hattrs.h"
 #include "k2hattropsman.h"
+#include "k2hhotcache.h"
 #include "k2hutil.h"
 #include "k2hdbg.h"
 
@@ -194,7 +195,7 @@ void K2HShm::GetRealTimeval(struct timeval& tv)
 //---------------------------------------------------------
 // Constructor / Destructor
 //---------------------------------------------------------
-K2HShm::K2HShm() : ShmFd(-1), isAnonMem(false), isFullMapping(true), isTemporary(false), isReadMode(false), isSync(true), ShmPath(""), pHead(NULL), MmapInfos(this)
+K2HShm::K2HShm() : ShmFd(-1), isAnonMem(false), isFullMapping(true), isTemporary(false), isReadMode(false), isSync(true), ShmPath(""), pHead(NULL), MmapInfos(this), pHotCache(NULL)
 {
 }
 
@@ -229,12 +230,19 @@ K2HShm::~K2HShm()
 
 bool K2HShm::Clean(bool isRemoveFile)
 {
+	// stop area compactor and expire reaper
+	StopAreaCompactor();
+	StopExpireReaper();
+
 	// stop transaction
 	DisableTransaction();
 
 	// clean attribute plugins from common
 	CleanCommonAttribute();
 
+	// hot key cache
+	K2H_Delete(pHotCache);
+
 	MmapInfos.UnmapAll();
 	if(pHead){
 		pHead = NULL;
@@ -410,6 +418,11 @@ bool K2HShm::CheckExpandingKeyArea(PCKINDEX pCKIndex)
 		// Nothing to do
 		return true;
 	}
+	if(IsSnapshotActive()){
+		// cur_mask must not be changed while making snapshot, it will be expanded after snapshot.
+		MSG_K2HPRN("Now making snapshot, so does not expand key/ckey area.");
+		return true;
+	}
 	ALObjCKI.Unlock();
 
 	// Expand key/ckey area(automatically increasing cur_mask)
@@ -1092,6 +1105,14 @@ PCKINDEX K2HShm::GetCKIndex(PKINDEX pKindex, k2h_hash_t hash, K2HLock& ALObjCKI)
 	// Get target CKIndex pointer
 	ALObjCKI.Lock(ShmFd, Rel(&pCKindex[hash & pHead->collision_mask]));				// LOCK
 
+	if(pHead->pextra && !ALObjCKI.IsReadLock()){
+		// If making snapshot, captures the unit before writing.
+		if(!CaptureSnapshot(&pCKindex[hash & pHead->collision_mask], hash)){
+			WAN_K2HPRN("Failed to capture snapshot unit for hash(%" PRIu64 "), but continue...", hash);
+		}
+		// Invalidate the values in hot key caches of all processes.
+		IncrementKeyVersion(hash);
+	}
 	return &pCKindex[hash & pHead->collision_mask];
 }
 
@@ -1104,6 +1125,59 @@ PCKINDEX K2HShm::GetCKIndex(k2h_hash_t hash, K2HLock& ALObjCKI, bool isMergeCurm
 	return GetCKIndex(pKindex, hash, ALObjCKI);
 }
 
+//
+// This function locks and returns two Collision Key Indexes for two hashes.
+//
+// [NOTE]
+// Both ckey indexes are locked in ascending order of those offsets, so that
+// processes which lock two ckey indexes at the same time do not deadlock.
+// If both hashes are assigned the same ckey index, it is locked only once by
+// ALObjCKI1, and pCKIndex2 is as same as pCKIndex1.
+// The key indexes are gotten before locking, because merging cur_mask must
+// not run while ckey index is locked.
+//
+bool K2HShm::GetCKIndexPair(k2h_hash_t hash1, K2HLock& ALObjCKI1, PCKINDEX& pCKIndex1, k2h_hash_t hash2, K2HLock& ALObjCKI2, PCKINDEX& pCKIndex2) const
+{
+	pCKIndex1 = NULL;
+	pCKIndex2 = NULL;
+
+	PKINDEX	pKindex1;
+	PKINDEX	pKindex2;
+	if(NULL == (pKindex1 = GetKIndex(hash1, true)) || NULL == (pKindex2 = GetKIndex(hash2, true))){
+		return false;
+	}
+	if(!pKindex1->ckey_list || !pKindex2->ckey_list){
+		ERR_K2HPRN("PCKINDEX list is null.");
+		return false;
+	}
+	PCKINDEX	pTarget1 = &(static_cast<PCKINDEX>(Abs(pKindex1->ckey_list)))[hash1 & pHead->collision_mask];
+	PCKINDEX	pTarget2 = &(static_cast<PCKINDEX>(Abs(pKindex2->ckey_list)))[hash2 & pHead->collision_mask];
+
+	if(pTarget1 == pTarget2){
+		if(NULL == (pCKIndex1 = GetCKIndex(pKindex1, hash1, ALObjCKI1))){
+			return false;
+		}
+		pCKIndex2 = pCKIndex1;
+	}else if(Rel(pTarget1) < Rel(pTarget2)){
+		if(NULL == (pCKIndex1 = GetCKIndex(pKindex1, hash1, ALObjCKI1)) || NULL == (pCKIndex2 = GetCKIndex(pKindex2, hash2, ALObjCKI2))){
+			ALObjCKI2.Unlock();
+			ALObjCKI1.Unlock();
+			pCKIndex1 = NULL;
+			pCKIndex2 = NULL;
+			return false;
+		}
+	}else{
+		if(NULL == (pCKIndex2 = GetCKIndex(pKindex2, hash2, ALObjCKI2)) || NULL == (pCKIndex1 = GetCKIndex(pKindex1, hash1, ALObjCKI1))){
+			ALObjCKI1.Unlock();
+			ALObjCKI2.Unlock();
+			pCKIndex1 = NULL;
+			pCKIndex2 = NULL;
+			return false;
+		}
+	}
+	return true;
+}
+
 //
 // Get same has value Element list.
 //
@@ -1856,6 +1930,28 @@ ssize_t K2HShm::Get(const unsigned char* byKey, size_t keylen, unsigned char** b
 
 ssize_t K2HShm::Get(const unsigned char* byKey, size_t length, unsigned char** byValue, bool checkattr, const char* encpass) const
 {
+	// hot key cache
+	//
+	// [NOTE]
+	// The key version is read before locking, so that the value which is
+	// read after this is cached with old version if the key is updated
+	// during reading. Then it is never returned from cache.
+	//
+	k2h_hash_t	hash		= 0;
+	uint64_t	version		= 0;
+	bool		is_hotcache	= false;
+	if(pHotCache && checkattr && byKey && 0 < length && byValue){
+		hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), length);
+		if(GetKeyVersion(hash, version)){
+			ssize_t	vallen = -1;
+			if(pHotCache->Get(hash, byKey, length, encpass, version, byValue, vallen)){
+				SetCacheReference(hash, true);
+				return vallen;
+			}
+			is_hotcache = true;
+		}
+	}
+
 	K2HLock		ALObjCKI(K2HLock::RDLOCK);
 	PELEMENT	pElement;
 
@@ -1863,45 +1959,51 @@ ssize_t K2HShm::Get(const unsigned char* byKey, size_t length, unsigned char** b
 
 	if(NULL == (pElement = GetElement(byKey, length, ALObjCKI))){
 		MSG_K2HPRN("Key(%s) is not found", reinterpret_cast<const char*>(byKey));
+		CountCacheMiss();
 		return -1;
 	}
 
 	// at first, check attributes
+	//
+	// [NOTE]
+	// Expire, history marker, encrypted and compressed are checked by flags
+	// which are read from attributes binary directly. Only if the value is
+	// encrypted or compressed, we load attributes and make attributes manager
+	// for decoding.
+	//
 	K2HAttrs*	pAttrs		= NULL;
-	bool		IsEncrypted	= false;
+	bool		IsEncoded	= false;
+	bool		IsExpireAttr= false;
+	K2HATTRFLAGS	attrflags;
 	if(checkattr){
-		if(NULL != (pAttrs = GetAttrs(pElement))){
-			// check only expire and history marker.
-			K2hAttrOpsMan	attrman;
-			if(!attrman.Initialize(this, byKey, length, NULL, 0UL, NULL)){
-				ERR_K2HPRN("Something error occurred during initializing attributes manager class.");
-				K2H_Delete(pAttrs);
-				return -1;
-			}
+		if(GetAttrFlags(pElement, attrflags)){
+			IsExpireAttr = (0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE));
+
 			// check expire
-			if(attrman.IsExpire(*pAttrs)){
+			if(K2hAttrBuiltin::IsExpire(attrflags)){
 				MSG_K2HPRN("the key is expired.");
-				K2H_Delete(pAttrs);
+				CountCacheMiss();
 				return -1;
 			}
 			// check history marker
-			if(attrman.IsHistory(*pAttrs)){
+			if(0 != (attrflags.flags & K2HATTR_FLAG_HISTORY)){
 				MSG_K2HPRN("the key is marked history.");
-				K2H_Delete(pAttrs);
 				return -1;
 			}
-			// check encrypted value
-			if(attrman.IsValueEncrypted(*pAttrs)){
-				IsEncrypted = true;
+			// check encrypted or compressed value
+			if(0 != (attrflags.flags & (K2HATTR_FLAG_ENCRYPT | K2HATTR_FLAG_COMPRESS))){
+				IsEncoded	= true;
+				pAttrs		= GetAttrs(pElement);
 			}
 		}
 	}
 
 	// get value
 	ssize_t	vallen = Get(pElement, byValue, PAGEOBJ_VALUE);
+	SetCacheReference(pElement->hash, true);
 
-	// decrypt
-	if(0 < vallen && pAttrs && IsEncrypted){
+	// decrypt and decompress
+	if(0 < vallen && pAttrs && IsEncoded){
 		K2hAttrOpsMan	attrman;
 		if(!attrman.Initialize(this, byKey, length, *byValue, static_cast<size_t>(vallen), encpass)){
 			ERR_K2HPRN("Something error occurred during initializing attributes manager class.");
@@ -1912,28 +2014,28 @@ ssize_t K2HShm::Get(const unsigned char* byKey, size_t length, unsigned char** b
 			return -1;
 		}
 
-		// try to decrypt
+		// try to decrypt and decompress
 		unsigned char*	pDecryptValue;
 		size_t			DecryptLength = 0;
 		if(NULL == (pDecryptValue = attrman.GetDecryptValue(*pAttrs, encpass, DecryptLength))){
-			ERR_K2HPRN("Something error occurred during decrypting value.");
+			ERR_K2HPRN("Something error occurred during decrypting(decompressing) value.");
 			K2H_Delete(pAttrs);
 			K2H_Free(*byValue);
 			return -1;
 		}
 		K2H_Free(*byValue);
 
-		// copy decrypt data
-		if(NULL == (*byValue = reinterpret_cast<unsigned char*>(malloc(DecryptLength)))){
-			MSG_K2HPRN("Could not allocate memory.");
-			K2H_Delete(pAttrs);
-			return -1;
-		}
-		memcpy(*byValue, pDecryptValue, DecryptLength);
-		vallen = static_cast<ssize_t>(DecryptLength);
+		// decoded data is allocated, so set it directly
+		*byValue	= pDecryptValue;
+		vallen		= static_cast<ssize_t>(DecryptLength);
 	}
 	K2H_Delete(pAttrs);
+	ALObjCKI.Unlock();											// UNLOCK
 
+	// set hot key cache
+	if(is_hotcache && 0 <= vallen){
+		pHotCache->Set(hash, byKey, length, encpass, version, (IsExpireAttr ? &(attrflags.expire) : NULL), *byValue, static_cast<size_t>(vallen));
+	}
 	return vallen;
 }
 
@@ -1997,42 +2099,37 @@ K2HSubKeys* K2HShm::GetSubKeys(PELEMENT pElement, bool checkattr) const
 		return NULL;
 	}
 	if(checkattr){
-		// [Note]
-		K2HAttrs*	pAttrs;
-		if(NULL != (pAttrs = GetAttrs(pElement))){
-			// [NOTE]
-			// We need only to check expire flag, then we do not need to fill all parameters for initialize().
-			//
-			K2hAttrOpsMan	attrman;
-			if(!attrman.Initialize(this, NULL, 0UL, NULL, 0)){
-				ERR_K2HPRN("Something error occurred during initializing attributes manager class.");
-				K2H_Delete(pAttrs);
-				return NULL;
-			}
+		// [NOTE]
+		// We need only to check expire and history flags, then we do not need attributes manager.
+		//
+		K2HATTRFLAGS	attrflags;
+		if(GetAttrFlags(pElement, attrflags)){
 			// check expire
-			if(attrman.IsExpire(*pAttrs)){
+			if(K2hAttrBuiltin::IsExpire(attrflags)){
 				MSG_K2HPRN("the key is expired.");
-				K2H_Delete(pAttrs);
 				return NULL;
 			}
 			// check history marker
-			if(attrman.IsHistory(*pAttrs)){
+			if(0 != (attrflags.flags & K2HATTR_FLAG_HISTORY)){
 				MSG_K2HPRN("the key is marked history.");
-				K2H_Delete(pAttrs);
 				return NULL;
 			}
-			K2H_Delete(pAttrs);
-
 		}else{
 			// key does not have attribute
 		}
 	}
-	K2HPage*	pPage;
-	if(NULL == (pPage = GetPage(pElement, PAGEOBJ_SUBKEYS))){
+	K2HPage*				pPage;
+	const unsigned char*	bySubkeys	= NULL;
+	size_t					length		= 0UL;
+	if(NULL == (pPage = GetPage(pElement, PAGEOBJ_SUBKEYS)) || !pPage->GetData(&bySubkeys, &length)){
 		MSG_K2HPRN("Could not get subkeys from element.");
+		K2H_Delete(pPage);
 		return NULL;
 	}
-	K2HSubKeys*	pSubKeys = pPage->GetSubKeys();
+	// [NOTE]
+	// Subkeys area has subkeys list or subkeys directory.
+	//
+	K2HSubKeys*	pSubKeys = LoadSubKeys(bySubkeys, length);
 	K2H_Delete(pPage);
 	return pSubKeys;
 }
@@ -2072,6 +2169,47 @@ K2HAttrs* K2HShm::GetAttrs(PELEMENT pElement) const
 	return pAttrs;
 }
 
+bool K2HShm::GetAttrFlags(const unsigned char* byKey, size_t length, K2HATTRFLAGS& attrflags) const
+{
+	K2HLock		ALObjCKI(K2HLock::RDLOCK);
+	PELEMENT	pElement;
+
+	K2HFILE_UPDATE_CHECK(const_cast<K2HShm*>(this));
+
+	if(NULL == (pElement = GetElement(byKey, length, ALObjCKI))){
+		MSG_K2HPRN("Key(%s) is not found", reinterpret_cast<const char*>(byKey));
+		return false;
+	}
+	return GetAttrFlags(pElement, attrflags);
+}
+
+//
+// Returns false when the element does not have attributes.
+//
+bool K2HShm::GetAttrFlags(PELEMENT pElement, K2HATTRFLAGS& attrflags) const
+{
+	attrflags.flags = K2HATTR_FLAG_NO;
+
+	if(!pElement){
+		ERR_K2HPRN("PELEMENT is NULL.");
+		return false;
+	}
+	if(!pElement->attrs || 0UL == pElement->attrlength){
+		return false;
+	}
+	K2HPage*				pPage;
+	const unsigned char*	byAttrs	= NULL;
+	size_t					length	= 0UL;
+	if(NULL == (pPage = GetPage(pElement, PAGEOBJ_ATTRS)) || !pPage->GetData(&byAttrs, &length)){
+		MSG_K2HPRN("Could not get attributes from element.");
+		K2H_Delete(pPage);
+		return false;
+	}
+	bool	result = K2hAttrBuiltin::GetAttrFlags(byAttrs, length, attrflags);
+	K2H_Delete(pPage);
+	return result;
+}
+
 //---------------------------------------------------------
 // Set/Add Methods
 //---------------------------------------------------------
@@ -2101,10 +2239,43 @@ bool K2HShm::Set(const char* pKey, const char* pValue, K2HAttrs* pAttrs, const c
 	return result;
 }
 
+//
+// [NOTE]
+// If the key exists, it is updated in place and its subkeys record(subkeys
+// list or subkeys directory) is kept as it is, then the subkeys are not
+// loaded and serialized again. Only if it can not be updated in place(ex.
+// history mode), the subkeys are loaded and set to new key.
+//
 bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const char* encpass, const time_t* expire)
 {
-	K2HSubKeys*	pSubKeys= GetSubKeys(byKey, keylength);
+	if(!byKey || 0 == keylength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// evict keys before setting if cache mode
+	if(!CheckCacheEviction(keylength + vallength)){
+		WAN_K2HPRN("Failed to evict keys for cache mode, but continue...");
+	}
+
 	K2HAttrs*	pAttrs	= GetAttrs(byKey, keylength);
+	bool		is_set	= false;
+	if(!SetInPlace(byKey, keylength, byValue, vallength, NULL, false, pAttrs, encpass, expire, K2hAttrOpsMan::OPSMAN_MASK_NORMAL, is_set, true)){
+		ERR_K2HPRN("Failed to update existing key in place.");
+		K2H_Delete(pAttrs);
+		return false;
+	}
+	if(is_set){
+		K2H_Delete(pAttrs);
+		return true;
+	}
+
+	K2HSubKeys*	pSubKeys= GetSubKeys(byKey, keylength);
 	bool		result	= Set(byKey, keylength, byValue, vallength, pSubKeys, false, pAttrs, encpass, expire);
 
 	K2H_Delete(pSubKeys);
@@ -2129,6 +2300,21 @@ bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned ch
 	}
 	K2HFILE_UPDATE_CHECK(this);
 
+	// evict keys before setting if cache mode
+	if(!CheckCacheEviction(keylength + vallength)){
+		WAN_K2HPRN("Failed to evict keys for cache mode, but continue...");
+	}
+
+	// update existing key in place if it can
+	bool	is_set = false;
+	if(!SetInPlace(byKey, keylength, byValue, vallength, pSubKeys, isRemoveSubKeys, pAttrs, encpass, expire, attrtype, is_set)){
+		ERR_K2HPRN("Failed to update existing key in place.");
+		return false;
+	}
+	if(is_set){
+		return true;
+	}
+
 	// [NOTE]
 	// We remove key at first, and free lock to reget lock.
 	// Then there is a possibility that the same key may be created by another process
@@ -2281,6 +2467,20 @@ bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned ch
 			byValue = attrman.GetValue(vallength);		// get (new) value through attribute manager.
 		}
 
+		// expire time for expiry index
+		//
+		// [NOTE]
+		// Only normal keys are listed, queue's keys and markers must not be
+		// removed by reaper. The keys in expiry index are also not listed.
+		//
+		time_t			expire_sec = 0;
+		K2HATTRFLAGS	attrflags;
+		if(	K2hAttrOpsMan::OPSMAN_MASK_NORMAL == attrtype && byAttrs && K2hAttrBuiltin::GetAttrFlags(byAttrs, attrlength, attrflags) && 0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE) &&
+			(keylength < (sizeof(K2HEXPIRE_PREFIX) - 1) || 0 != memcmp(byKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)) )
+		{
+			expire_sec = attrflags.expire.tv_sec;
+		}
+
 		// make new element
 		PELEMENT	pNewElement;
 		if(NULL == (pNewElement = AllocateElement(hash, subhash, byKey, keylength, byValue, vallength, bySubKeys, sublength, byAttrs, attrlength))){
@@ -2308,6 +2508,9 @@ bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned ch
 
 		ALObjCKI.Unlock();								// Unlock
 
+		// new key is referenced for cache mode
+		SetCacheReference(hash, false);
+
 		// transaction for setting new key
 		K2HTransaction*	ptransobj = new K2HTransaction(this, true);		// stacking mode
 		if(ptransobj->IsEnable()){
@@ -2333,6 +2536,11 @@ bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned ch
 			WAN_K2HPRN("Failed to update timeval for data update.");
 		}
 
+		// list key in expiry index
+		if(0 < expire_sec && !AddExpireIndex(byKey, keylength, expire_sec)){
+			WAN_K2HPRN("Failed to add key to expiry index, but the key is expired when it is read.");
+		}
+
 		// check element count in ckey for increasing cur_mask(expanding key/ckey area)
 		if(!CheckExpandingKeyArea(pCKIndex)){					// Do not care for locking
 			ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
@@ -2343,6 +2551,167 @@ bool K2HShm::Set(const unsigned char* byKey, size_t keylength, const unsigned ch
 	return true;
 }
 
+//
+// Update existing key in place.
+//
+// [NOTE]
+// Set() removes existing key and makes new element which has new pages.
+// If the key exists and does not need to make history, this method updates
+// the element directly, and its pages are overwritten when these have
+// enough capacity.
+// This method does not update the key in following case, then is_set is
+// false and the caller must set the key as usual.
+//	- key is not found
+//	- history mode
+//	- the key has subkeys and they should be removed
+//	- attributes have uniqid(which was made in history mode)
+// The transactions are put as same as removing and setting the key.
+// If is_keep_subkeys is true, pSubKeys is ignored and the subkeys record
+// of the key is not changed.
+//
+bool K2HShm::SetInPlace(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2HSubKeys* pSubKeys, bool isRemoveSubKeys, K2HAttrs* pAttrs, const char* encpass, const time_t* expire, K2hAttrOpsMan::ATTRINITTYPE attrtype, bool& is_set, bool is_keep_subkeys)
+{
+	is_set = false;
+	if(K2hAttrOpsMan::IsMarkHistory(this)){
+		return true;
+	}
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	// get element
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElementList;
+	PELEMENT	pElement;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElementList = GetElementList(pCKIndex, hash, subhash)) || NULL == (pElement = GetElement(pElementList, byKey, keylength))){
+		return true;
+	}
+	if(!is_keep_subkeys && isRemoveSubKeys && pElement->subkeys){
+		return true;
+	}
+
+	// make subkeys to buffer
+	unsigned char*	bySubKeys	= NULL;
+	size_t			sublength	= 0UL;
+	if(!is_keep_subkeys && pSubKeys && !pSubKeys->Serialize(&bySubKeys, sublength)){
+		ERR_K2HPRN("Could not set subkeys binary data from subkeys object.");
+		return false;
+	}
+
+	// make attribute
+	//
+	// [NOTE]
+	// Attributes object is copied, because it must not be changed when the
+	// caller sets the key as usual.
+	//
+	K2hAttrOpsMan	attrman;
+	K2HAttrs		attrs;
+	unsigned char*	byAttrs		= NULL;
+	size_t			attrlength	= 0UL;
+	if(pAttrs){
+		attrs = *pAttrs;
+	}
+	if(!attrman.Initialize(this, byKey, keylength, byValue, vallength, encpass, expire, attrtype) || !attrman.UpdateAttr(attrs)){
+		ERR_K2HPRN("Could not make attributes for key.");
+		K2H_Free(bySubKeys);
+		return false;
+	}
+	if(!ISEMPTYSTR(attrman.IsUpdateUniqID())){
+		K2H_Free(bySubKeys);
+		return true;
+	}
+	if(!attrs.Serialize(&byAttrs, attrlength)){
+		ERR_K2HPRN("Could not set binary array from attribute list.");
+		K2H_Free(bySubKeys);
+		return false;
+	}
+	byValue = attrman.GetValue(vallength);				// get (new) value through attribute manager.
+
+	// keep old subkeys for removing chunk keys
+	//
+	// [NOTE]
+	// If the subkeys are kept, the subkeys record is read only for putting
+	// transaction, and it is not changed.
+	//
+	unsigned char*	byOldSubKeys	= NULL;
+	ssize_t			oldsublength	= 0;
+	if(is_keep_subkeys){
+		K2HTransaction	transobj(this);
+		if(pElement->subkeys && transobj.IsEnable()){
+			ssize_t		tmplength;
+			if(0 < (tmplength = Get(pElement, &bySubKeys, PAGEOBJ_SUBKEYS)) && bySubKeys){
+				sublength = static_cast<size_t>(tmplength);
+			}else{
+				K2H_Free(bySubKeys);
+			}
+		}
+	}else if(pElement->subkeys && (0 >= (oldsublength = Get(pElement, &byOldSubKeys, PAGEOBJ_SUBKEYS)) || !byOldSubKeys)){
+		K2H_Free(byOldSubKeys);
+		oldsublength = 0;
+	}
+
+	// update pages
+	if(	!SetPages(pElement, byValue, vallength, PAGEOBJ_VALUE)						||
+		(!is_keep_subkeys && !SetPages(pElement, bySubKeys, sublength, PAGEOBJ_SUBKEYS))	||
+		!SetPages(pElement, byAttrs, attrlength, PAGEOBJ_ATTRS)						)
+	{
+		ERR_K2HPRN("Failed to update value/subkeys/attrs in element.");
+		K2H_Free(byOldSubKeys);
+		K2H_Free(bySubKeys);
+		K2H_Free(byAttrs);
+		return false;
+	}
+	ALObjCKI.Unlock();									// Unlock
+	is_set = true;
+
+	// the key is referenced for cache mode
+	SetCacheReference(hash, false);
+
+	// transaction for removing and setting key
+	{
+		K2HTransaction	transobj(this);
+		if(transobj.IsEnable() && !transobj.DelKey(byKey, keylength)){
+			WAN_K2HPRN("Failed to put removing transaction.");
+		}
+	}
+	{
+		K2HTransaction	transobj(this);
+		if(transobj.IsEnable() && !transobj.SetAll(byKey, keylength, byValue, vallength, bySubKeys, sublength, byAttrs, attrlength)){
+			WAN_K2HPRN("Failed to put setting transaction.");
+		}
+	}
+
+	// remove chunk keys which are not used
+	if(byOldSubKeys){
+		RemoveSubKeysChunks(byOldSubKeys, static_cast<size_t>(oldsublength), bySubKeys, sublength);
+		K2H_Free(byOldSubKeys);
+	}
+
+	if(!UpdateTimeval()){
+		WAN_K2HPRN("Failed to update timeval for data update.");
+	}
+
+	// list key in expiry index
+	K2HATTRFLAGS	attrflags;
+	if(	K2hAttrOpsMan::OPSMAN_MASK_NORMAL == attrtype && byAttrs && K2hAttrBuiltin::GetAttrFlags(byAttrs, attrlength, attrflags) && 0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE) &&
+		(keylength < (sizeof(K2HEXPIRE_PREFIX) - 1) || 0 != memcmp(byKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)) )
+	{
+		if(!AddExpireIndex(byKey, keylength, attrflags.expire.tv_sec)){
+			WAN_K2HPRN("Failed to add key to expiry index, but the key is expired when it is read.");
+		}
+	}
+	K2H_Free(bySubKeys);
+	K2H_Free(byAttrs);
+
+	return true;
+}
+
 //
 // Make new element from free element list and set all data to it.
 //
@@ -2436,6 +2805,18 @@ bool K2HShm::AddSubkey(const unsigned char* byKey, size_t keylength, const unsig
 		return false;
 	}
 
+	// parent has subkeys directory, then add subkey into its chunk
+	unsigned char*	byDir		= NULL;
+	size_t			dirlength	= 0UL;
+	if(GetSubKeysDirectory(byKey, keylength, &byDir, dirlength)){
+		bool	result;
+		if(false == (result = AddSubKeyToDirectory(byKey, keylength, byDir, dirlength, bySubkey, skeylength))){
+			ERR_K2HPRN("Could not add subkey into subkeys directory in parent.");
+		}
+		K2H_Free(byDir);
+		return result;
+	}
+
 	// get parent subkeys
 	K2HSubKeys	k2hsubkeys;
 	K2HSubKeys*	pk2hsubkeys;
@@ -2445,11 +2826,11 @@ bool K2HShm::AddSubkey(const unsigned char* byKey, size_t keylength, const unsig
 		isDelete	= false;
 	}
 
-	// prepare parent's new subkeys
+	// prepare parent's new subkeys(subkeys list or subkeys directory)
 	unsigned char*	bySubkeys	= NULL;
 	size_t			skeyslength	= 0UL;
 	pk2hsubkeys->insert(bySubkey, skeylength);
-	if(!pk2hsubkeys->Serialize(&bySubkeys, skeyslength)){
+	if(!MakeSubKeysBinary(byKey, keylength, pk2hsubkeys, &bySubkeys, skeyslength)){
 		ERR_K2HPRN("Could not build subkeys for parent.");
 		if(isDelete){
 			K2H_Delete(pk2hsubkeys);
@@ -2461,6 +2842,7 @@ bool K2HShm::AddSubkey(const unsigned char* byKey, size_t keylength, const unsig
 	bool result;
 	if(false == (result = ReplaceSubkeys(byKey, keylength, bySubkeys, skeyslength))){
 		ERR_K2HPRN("Could not replace subkeys in parent.");
+		RemoveSubKeysChunks(bySubkeys, skeyslength, NULL, 0UL);
 	}
 	if(isDelete){
 		K2H_Delete(pk2hsubkeys);
@@ -2612,44 +2994,81 @@ bool K2HShm::RemoveEx(PELEMENT pElement, const unsigned char* bySubKey, size_t l
 		is_check_updated = true;
 	}
 
-	// get subkey page/array
-	K2HPage*	pSKeyPage = NULL;
-	K2HSubKeys*	pSubKeys;
-	if(!pElement->subkeys || NULL == (pSKeyPage = GetPageObject(pElement->subkeys)) || NULL == (pSubKeys = pSKeyPage->GetSubKeys())){
+	// get subkeys binary(subkeys list or subkeys directory)
+	unsigned char*	byCurSubkeys	= NULL;
+	ssize_t			CurSKLength		= -1;
+	if(!pElement->subkeys || 0 >= (CurSKLength = Get(pElement, &byCurSubkeys, PAGEOBJ_SUBKEYS)) || !byCurSubkeys){
 		WAN_K2HPRN("Element does not have subkeys.");
-		K2H_Delete(pSKeyPage);
+		K2H_Free(byCurSubkeys);
 		return true;
 	}
-	K2H_Delete(pSKeyPage);
 
-	// search subkey and remove it
-	if(!pSubKeys->erase(bySubKey, length)){
-		WAN_K2HPRN("Element does not have subkeys.");
-		K2H_Delete(pSubKeys);
-		return true;
-	}
+	K2HSubKeys*	pSubKeys = NULL;
+	if(K2HShm::IsSubKeysDirectory(byCurSubkeys, static_cast<size_t>(CurSKLength))){
+		// subkeys directory needs key name for updating chunk and directory.
+		unsigned char*	byKey		= NULL;
+		ssize_t			keylength	= -1;
+		if(0 >= (keylength = Get(pElement, &byKey, PAGEOBJ_KEY)) || !byKey){
+			ERR_K2HPRN("Could not get key name from element.");
+			K2H_Free(byCurSubkeys);
+			return false;
+		}
 
-	// Serialize
-	unsigned char*	bySubkeys = NULL;
-	size_t			SKLength = 0UL;
-	if(!pSubKeys->Serialize(&bySubkeys, SKLength)){
-		ERR_K2HPRN("Failed serializing subkeys.");
-		K2H_Delete(pSubKeys);
-		return false;
-	}
-	K2H_Delete(pSubKeys);		// NOTE : pSubKeys = NULL;
+		// Unlock(updating chunk and directory locks each key)
+		if(ALObjCKI.IsLocked()){
+			ALObjCKI.Unlock();
+		}
+
+		// search subkey in chunk and remove it
+		bool	is_found = false;
+		bool	result	 = RemoveSubKeyFromDirectory(byKey, static_cast<size_t>(keylength), byCurSubkeys, static_cast<size_t>(CurSKLength), bySubKey, length, is_found);
+		K2H_Free(byKey);
+		K2H_Free(byCurSubkeys);
+		if(!result){
+			ERR_K2HPRN("Could not remove subkey from subkeys directory.");
+			return false;
+		}
+		if(!is_found){
+			WAN_K2HPRN("Element does not have subkeys.");
+			return true;
+		}
+	}else{
+		if(NULL == (pSubKeys = LoadSubKeys(byCurSubkeys, static_cast<size_t>(CurSKLength)))){
+			WAN_K2HPRN("Element does not have subkeys.");
+			K2H_Free(byCurSubkeys);
+			return true;
+		}
+		K2H_Free(byCurSubkeys);
+
+		// search subkey and remove it
+		if(!pSubKeys->erase(bySubKey, length)){
+			WAN_K2HPRN("Element does not have subkeys.");
+			K2H_Delete(pSubKeys);
+			return true;
+		}
+
+		// Serialize
+		unsigned char*	bySubkeys = NULL;
+		size_t			SKLength = 0UL;
+		if(!pSubKeys->Serialize(&bySubkeys, SKLength)){
+			ERR_K2HPRN("Failed serializing subkeys.");
+			K2H_Delete(pSubKeys);
+			return false;
+		}
+		K2H_Delete(pSubKeys);		// NOTE : pSubKeys = NULL;
 
-	// Replace
-	if(!ReplacePage(pElement, bySubkeys, SKLength, PAGEOBJ_SUBKEYS)){
-		ERR_K2HPRN("Could not replace subkeys.");
+		// Replace
+		if(!ReplacePage(pElement, bySubkeys, SKLength, PAGEOBJ_SUBKEYS)){
+			ERR_K2HPRN("Could not replace subkeys.");
+			K2H_Free(bySubkeys);
+			return false;
+		}
 		K2H_Free(bySubkeys);
-		return false;
-	}
-	K2H_Free(bySubkeys);
 
-	// Unlock
-	if(ALObjCKI.IsLocked()){
-		ALObjCKI.Unlock();
+		// Unlock
+		if(ALObjCKI.IsLocked()){
+			ALObjCKI.Unlock();
+		}
 	}
 
 	// Remove subkey
@@ -2819,11 +3238,17 @@ bool K2HShm::RemoveEx(const unsigned char* byKey, size_t keylength, bool isSubKe
 		return true;
 	}
 
-	// get(keep) subkeys if needs
-	if(isSubKeys){
-		if(!GetSubKeys(pElement, pSubKeys)){
-			MSG_K2HPRN("Failed to get subkeys, but continue...");
-		}
+	// get(keep) subkeys binary
+	//
+	// [NOTE]
+	// Subkeys directory has chunk keys, then subkeys are loaded after
+	// unlocking and chunk keys are removed after removing key.
+	//
+	unsigned char*	bySubkeys	= NULL;
+	ssize_t			sklength	= 0;
+	if(pElement->subkeys && (0 >= (sklength = Get(pElement, &bySubkeys, PAGEOBJ_SUBKEYS)) || !bySubkeys)){
+		K2H_Free(bySubkeys);
+		sklength = 0;
 	}
 
 	// remove or make history
@@ -2832,7 +3257,14 @@ bool K2HShm::RemoveEx(const unsigned char* byKey, size_t keylength, bool isSubKe
 		// make history
 		ALObjCKI.Unlock();							// Unlock
 
-		// rename key
+		// get(keep) subkeys if needs
+		if(isSubKeys && bySubkeys){
+			if(!GetSubKeys(bySubkeys, static_cast<size_t>(sklength), pSubKeys)){
+				MSG_K2HPRN("Failed to get subkeys, but continue...");
+			}
+		}
+
+		// rename key(history key has subkeys directory and chunk keys)
 		string	uniqid;
 		result = RenameForHistory(byKey, keylength, &uniqid, ptranslist);
 		if(ppUniqid){
@@ -2854,14 +3286,28 @@ bool K2HShm::RemoveEx(const unsigned char* byKey, size_t keylength, bool isSubKe
 		}
 		ALObjCKI.Unlock();							// Unlock
 
+		// get(keep) subkeys if needs
+		if(isSubKeys && bySubkeys){
+			if(!GetSubKeys(bySubkeys, static_cast<size_t>(sklength), pSubKeys)){
+				MSG_K2HPRN("Failed to get subkeys, but continue...");
+			}
+		}
+
 		// remove key(pelement already take off from ckeyindex, so do not need to lock)
 		result = RemoveEx(pElement, ptranslist, is_check_updated);
 		if(ppUniqid){
 			*ppUniqid = NULL;
 		}
-	}
-	return result;
-}
+
+		// remove chunk keys
+		if(result && bySubkeys){
+			RemoveSubKeysChunks(bySubkeys, static_cast<size_t>(sklength), NULL, 0UL);
+		}
+	}
+	K2H_Free(bySubkeys);
+
+	return result;
+}
 
 bool K2HShm::RemoveSubkeys(K2HSubKeys* pSubKeys, k2htransobjlist_t* ptranslist, bool& is_check_updated)
 {
@@ -2897,26 +3343,19 @@ bool K2HShm::RemoveSubkeys(K2HSubKeys* pSubKeys, k2htransobjlist_t* ptranslist,
 	return true;
 }
 
-bool K2HShm::GetSubKeys(PELEMENT pElement, K2HSubKeys*& pSubKeys)
+bool K2HShm::GetSubKeys(const unsigned char* bySubkeys, size_t length, K2HSubKeys*& pSubKeys) const
 {
-	if(!pElement){
-		ERR_K2HPRN("PELEMENT is NULL.");
-		return false;
-	}
 	if(!IsAttached()){
 		ERR_K2HPRN("There is no attached K2HASH.");
 		return false;
 	}
 
-	// get subkey page/array
-	K2HPage*	pTgSKeyPage = NULL;
+	// load subkeys list or subkeys directory
 	K2HSubKeys*	pTgSubKeys	= NULL;
-	if(!pElement->subkeys || NULL == (pTgSKeyPage = GetPageObject(pElement->subkeys)) || NULL == (pTgSubKeys = pTgSKeyPage->GetSubKeys())){
+	if(!bySubkeys || 0UL == length || NULL == (pTgSubKeys = LoadSubKeys(bySubkeys, length))){
 		MSG_K2HPRN("Element does not have any subkeys.");
-		K2H_Delete(pTgSKeyPage);
 		return true;
 	}
-	K2H_Delete(pTgSKeyPage);
 
 	// add subkeys to buffer
 	if(pSubKeys){
@@ -2996,6 +3435,17 @@ bool K2HShm::Replace(const unsigned char* byKey, size_t keylength, const unsigne
 			}
 		}else if(PAGEOBJ_SUBKEYS == type){
 			// type subkeys
+			if(K2HShm::IsSubKeysDirectory(byData, dlength)){
+				// [NOTE]
+				// Subkeys directory refers chunk keys as it is, then make
+				// new key without subkeys and replace subkeys area.
+				//
+				if(!Set(byKey, keylength, NULL, 0UL, static_cast<K2HSubKeys*>(NULL), false)){
+					ERR_K2HPRN("Failed to make new key for subkeys directory.");
+					return false;
+				}
+				return Replace(byKey, keylength, byData, dlength, type);
+			}
 			K2HSubKeys	SubKeys;
 			K2HSubKeys*	pSubKeys = NULL;
 			if(byData && 0UL != dlength){
@@ -3026,11 +3476,29 @@ bool K2HShm::Replace(const unsigned char* byKey, size_t keylength, const unsigne
 			}
 		}
 	}else{
+		// keep old subkeys directory for removing chunk keys
+		unsigned char*	byOldDir	= NULL;
+		ssize_t			oldlength	= 0;
+		if(PAGEOBJ_SUBKEYS == type && pElement->subkeys){
+			if(0 >= (oldlength = Get(pElement, &byOldDir, PAGEOBJ_SUBKEYS)) || !K2HShm::IsSubKeysDirectory(byOldDir, static_cast<size_t>(oldlength))){
+				K2H_Free(byOldDir);
+				oldlength = 0;
+			}
+		}
+
 		// found -> replace
 		if(!ReplacePage(pElement, byData, dlength, type)){
 			ERR_K2HPRN("Failed to replace key data(or subkeys).");
+			K2H_Free(byOldDir);
 			return false;
 		}
+		ALObjCKI.Unlock();													// Unlock
+
+		// remove chunk keys which are not referred by new subkeys
+		if(byOldDir){
+			RemoveSubKeysChunks(byOldDir, static_cast<size_t>(oldlength), byData, dlength);
+			K2H_Free(byOldDir);
+		}
 	}
 	return true;
 }
@@ -3050,24 +3518,10 @@ bool K2HShm::ReplacePage(PELEMENT pElement, const unsigned char* byData, size_t
 		ERR_K2HPRN("There is no attached K2HASH.");
 		return false;
 	}
-	K2HPage*	pPage = NULL;
-
-	if(byData && 0UL < length){
-		if(!ReservePages(byData, length, &pPage) || !pPage){
-			ERR_K2HPRN("Failed to make page for key/value/strarr.");
-			return false;
-		}
-	}
-
-	if(!ReplacePage(pElement, pPage, length, type)){
+	if(!SetPages(pElement, byData, length, type)){
 		ERR_K2HPRN("Failed to replace data(type: %d).", type);
-		if(pPage && !pPage->Free()){
-			ERR_K2HPRN("FATAL: In error recovery logic, failed to free pages.");
-		}
-		K2H_Delete(pPage);
 		return false;
 	}
-	K2H_Delete(pPage);
 
 	// transaction
 	//
@@ -3140,6 +3594,144 @@ bool K2HShm::ReplacePage(PELEMENT pElement, const unsigned char* byData, size_t
 	return true;
 }
 
+// [NOTICE]
+// This function does not put transaction and update time.
+// If you call this directly, you must implement these function.
+//
+bool K2HShm::SetPages(PELEMENT pElement, const unsigned char* byData, size_t length, int type)
+{
+	// try to overwrite current pages
+	bool	is_written = false;
+	if(!OverWritePages(pElement, byData, length, type, is_written)){
+		ERR_K2HPRN("Failed to overwrite data(type: %d).", type);
+		return false;
+	}
+	if(is_written){
+		return true;
+	}
+
+	// replace new pages
+	K2HPage*	pPage = NULL;
+	if(byData && 0UL < length){
+		if(!ReservePages(byData, length, &pPage) || !pPage){
+			ERR_K2HPRN("Failed to make page for key/value/strarr.");
+			return false;
+		}
+	}
+	if(!ReplacePage(pElement, pPage, length, type)){
+		ERR_K2HPRN("Failed to replace data(type: %d).", type);
+		if(pPage && !pPage->Free()){
+			ERR_K2HPRN("FATAL: In error recovery logic, failed to free pages.");
+		}
+		K2H_Delete(pPage);
+		return false;
+	}
+	K2H_Delete(pPage);
+
+	return true;
+}
+
+//
+// Overwrite data into current pages in element.
+//
+// [NOTE]
+// If current pages have enough capacity for data, the data is written
+// into these pages from top, and the surplus pages after data are put
+// back to free page list. Then the same(or shorter) length data does not
+// need to lock free page list twice for reserving and freeing pages.
+// The page count is calculated from current data length, because the
+// pages are always reserved for the length.
+// If the data is not written, is_written is false and pages are not
+// changed. The key pages can not be overwritten, because the hash value
+// depends on key.
+//
+// [NOTICE]
+// This function does not put transaction and update time.
+// If you call this directly, you must implement these function.
+//
+bool K2HShm::OverWritePages(PELEMENT pElement, const unsigned char* byData, size_t length, int type, bool& is_written)
+{
+	is_written = false;
+	if(!pElement){
+		ERR_K2HPRN("PELEMENT is NULL.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(!byData || 0UL == length){
+		return true;
+	}
+
+	// get PPAGEHEAD
+	PPAGEHEAD	pRelPageHead;
+	size_t*		plength;
+	if(PAGEOBJ_VALUE == type){
+		pRelPageHead	= pElement->value;
+		plength			= &(pElement->vallength);
+	}else if(PAGEOBJ_SUBKEYS == type){
+		pRelPageHead	= pElement->subkeys;
+		plength			= &(pElement->skeylength);
+	}else if(PAGEOBJ_ATTRS == type){
+		pRelPageHead	= pElement->attrs;
+		plength			= &(pElement->attrlength);
+	}else{
+		return true;
+	}
+	if(!pRelPageHead || 0UL == *plength){
+		return true;
+	}
+
+	// check page count
+	size_t	pagedatasize = GetPageSize() - PAGEHEAD_SIZE;
+	if(((*plength + pagedatasize - 1) / pagedatasize) < ((length + pagedatasize - 1) / pagedatasize)){
+		MSG_K2HPRN("Current pages do not have enough capacity for data.");
+		return true;
+	}
+
+	// write data
+	K2HPage*	pPage;
+	K2HPage*	pLastPage;
+	bool		isChangeSize	= false;
+	off_t		next_pos		= 0L;
+	if(NULL == (pPage = GetPageObject(pRelPageHead, false))){
+		ERR_K2HPRN("Could not make page object.");
+		return false;
+	}
+	if(NULL == (pLastPage = pPage->SetData(byData, length, 0L, isChangeSize, next_pos))){
+		ERR_K2HPRN("Failed to overwrite data into pages.");
+		K2H_Delete(pPage);
+		return false;
+	}
+
+	// truncate last page and free surplus pages after it
+	PAGEHEAD	lasthead;
+	size_t		lastlength	= length - (((length - 1) / pagedatasize) * pagedatasize);
+	bool		result		= true;
+	if(!pLastPage->GetPageHead(&lasthead) || !pLastPage->SetPageHead(K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, NULL, lastlength)){
+		ERR_K2HPRN("Could not update last page head.");
+		result = false;
+	}else if(lasthead.next){
+		K2HPage*	pSurplusPage;
+		if(NULL == (pSurplusPage = GetPageObject(lasthead.next, false)) || !pSurplusPage->SetPageHead(K2HPage::SETHEAD_PREV, NULL) || !pSurplusPage->Free()){
+			ERR_K2HPRN("Could not free surplus pages.");
+			result = false;
+		}
+		K2H_Delete(pSurplusPage);
+	}
+	if(pLastPage != pPage){
+		K2H_Delete(pLastPage);
+	}
+	K2H_Delete(pPage);
+
+	if(result){
+		*plength	= length;
+		is_written	= true;
+	}
+	return result;
+}
+
 // [NOTICE]
 // This function does not put transaction and update time.
 // If you call this directly, you must implement these function.
@@ -3235,6 +3827,11 @@ bool K2HShm::Rename(const char* pOldKey, const char* pNewKey)
 }
 
 bool K2HShm::Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen)
+{
+	return Rename(byOldKey, oldkeylen, byNewKey, newkeylen, NULL, 0UL);
+}
+
+bool K2HShm::Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen, const unsigned char* byAttrs, size_t attrlen)
 {
 	if(!byOldKey || 0 == oldkeylen || !byNewKey || 0 == newkeylen){
 		ERR_K2HPRN("Some parameters are wrong.");
@@ -3246,124 +3843,48 @@ bool K2HShm::Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsig
 	}
 	K2HFILE_UPDATE_CHECK(this);
 
-	// make hash for old key
-	k2h_hash_t	oldhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
-	k2h_hash_t	oldsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
-
-	// get old key element
-	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
-	PCKINDEX	pOldCKIndex;
-	PELEMENT	pOldElementList	= NULL;
-	PELEMENT	pOldElement		= NULL;
-	if(NULL == (pOldCKIndex = GetCKIndex(oldhash, ALObjCKI))){
-		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
-		return false;
-	}
-	if(NULL == (pOldElementList = GetElementList(pOldCKIndex, oldhash, oldsubhash)) || NULL == (pOldElement = GetElement(pOldElementList, byOldKey, oldkeylen))){
-		ERR_K2HPRN("Could not find old key in k2hash.");
-		return false;
-	}
-
-	// make new page for new key
-	K2HPage*	pNewKeyPage = NULL;
-	if(!ReservePages(byNewKey, newkeylen, &pNewKeyPage) || !pNewKeyPage){
-		ERR_K2HPRN("Failed to set page for new key.");
-		return false;
-	}
-
-	// make new element for new key
-	PELEMENT	pNewElement;
-	if(NULL == (pNewElement = ReserveElement())){
-		ERR_K2HPRN("Failed to get free element.");
-		K2H_Delete(pNewKeyPage);
-		return false;
-	}
-
-	// make hash for new key
-	k2h_hash_t	newhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-	k2h_hash_t	newsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-
-	// copy old element's member to new element's
-	pNewElement->hash		= newhash;
-	pNewElement->subhash	= newsubhash;
-	pNewElement->key		= pNewKeyPage->GetPageHeadRelAddress();
-	pNewElement->value		= pOldElement->value;
-	pNewElement->subkeys	= pOldElement->subkeys;
-	pNewElement->attrs		= pOldElement->attrs;
-	pNewElement->keylength	= newkeylen;
-	pNewElement->vallength	= pOldElement->vallength;
-	pNewElement->skeylength	= pOldElement->skeylength;
-	pNewElement->attrlength	= pOldElement->attrlength;
-	K2H_Delete(pNewKeyPage);
-
-	// take off old element and remove it
-	if(!TakeOffElement(pOldCKIndex, pOldElement)){
-		ERR_K2HPRN("Failed to take off old element from ckey index.");
-		pNewElement->value		= NULL;
-		pNewElement->subkeys	= NULL;
-		pNewElement->attrs		= NULL;
-		pNewElement->vallength	= 0UL;
-		pNewElement->skeylength	= 0UL;
-		pNewElement->attrlength	= 0UL;
-		FreeElement(pNewElement);
-		return false;
-	}
-	pOldElement->value		= NULL;
-	pOldElement->subkeys	= NULL;
-	pOldElement->attrs		= NULL;
-	pOldElement->vallength	= 0UL;
-	pOldElement->skeylength	= 0UL;
-	pOldElement->attrlength	= 0UL;
-	if(!FreeElement(pOldElement)){
-		ERR_K2HPRN("Failed to remove old element.");
-		FreeElement(pNewElement);
-		return false;
-	}
-	ALObjCKI.Unlock();						// UNLOCK
-
-	// insert new element
-	PCKINDEX	pNewCKIndex;
-	if(NULL == (pNewCKIndex = GetCKIndex(newhash, ALObjCKI))){
-		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
-		FreeElement(pNewElement);
-		return false;
-	}
-	if(pNewCKIndex->element_list){
-		if(!InsertElement(static_cast<PELEMENT>(Abs(pNewCKIndex->element_list)), pNewElement)){
-			ERR_K2HPRN("Failed to insert new element");
-			FreeElement(pNewElement);
-			return false;
-		}
-	}else{
-		pNewCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pNewElement));
-	}
-	pNewCKIndex->element_count	+= 1UL;
-	ALObjCKI.Unlock();						// UNLOCK
-
-	// check element count in ckey for increasing cur_mask(expanding key/ckey area)
-	if(!CheckExpandingKeyArea(pNewCKIndex)){				// Do not care for locking
-		ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
+	// move element to new key
+	bool	is_changed = false;
+	if(!RelinkElement(byOldKey, oldkeylen, byNewKey, newkeylen, byAttrs, attrlen, NULL, 0UL, false, is_changed)){
+		ERR_K2HPRN("Failed to rename key.");
 		return false;
 	}
 
 	// transaction
 	K2HTransaction	transobj(this);
-	if(!transobj.Rename(byOldKey, oldkeylen, byNewKey, newkeylen, NULL, 0UL)){
+	if(!transobj.Rename(byOldKey, oldkeylen, byNewKey, newkeylen, byAttrs, attrlen)){
 		WAN_K2HPRN("Failed to put setting transaction.");
 	}
 
 	if(!UpdateTimeval()){
 		WAN_K2HPRN("Failed to update timeval for data update.");
 	}
+
+	// list new key in expiry index
+	K2HATTRFLAGS	attrflags;
+	if(	(newkeylen < (sizeof(K2HEXPIRE_PREFIX) - 1) || 0 != memcmp(byNewKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)) &&
+		GetAttrFlags(byNewKey, newkeylen, attrflags) && 0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE) && 0 == (attrflags.flags & K2HATTR_FLAG_HISTORY) )
+	{
+		if(!AddExpireIndex(byNewKey, newkeylen, attrflags.expire.tv_sec)){
+			WAN_K2HPRN("Failed to add key to expiry index, but the key is expired when it is read.");
+		}
+	}
 	return true;
 }
 
 //
-// For transaction(loading archive)
+// Rename for history(backup)
+//
+// Like rename() method, but this method generates new key name automatically and marks history into attributes.
 //
-bool K2HShm::Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen, const unsigned char* byAttrs, size_t attrlen)
+// [NOTE]
+// New key name and attributes are made from the attributes of old key, and
+// the element is moved after locking both old and new ckey indexes. If the
+// attributes are changed during unlocking, retry from reading attributes.
+//
+bool K2HShm::RenameForHistory(const unsigned char* byKey, size_t keylen, string* puniqid, k2htransobjlist_t* ptranslist)
 {
-	if(!byOldKey || 0 == oldkeylen || !byNewKey || 0 == newkeylen){
+	if(!byKey || 0 == keylen){
 		ERR_K2HPRN("Some parameters are wrong.");
 		return false;
 	}
@@ -3371,352 +3892,247 @@ bool K2HShm::Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsig
 		ERR_K2HPRN("There is no attached K2HASH.");
 		return false;
 	}
-	K2HFILE_UPDATE_CHECK(this);
-
-	// make hash for old key
-	k2h_hash_t	oldhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
-	k2h_hash_t	oldsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
-
-	// get old key element
-	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
-	PCKINDEX	pOldCKIndex;
-	PELEMENT	pOldElementList	= NULL;
-	PELEMENT	pOldElement		= NULL;
-	if(NULL == (pOldCKIndex = GetCKIndex(oldhash, ALObjCKI))){
-		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
-		return false;
-	}
-	if(NULL == (pOldElementList = GetElementList(pOldCKIndex, oldhash, oldsubhash)) || NULL == (pOldElement = GetElement(pOldElementList, byOldKey, oldkeylen))){
-		ERR_K2HPRN("Could not find old key in k2hash.");
+	if(!K2hAttrOpsMan::IsMarkHistory(this)){
+		ERR_K2HPRN("Not make history mode.");
 		return false;
 	}
+	K2HFILE_UPDATE_CHECK(this);
 
-	// make new page for new key
-	K2HPage*	pNewKeyPage = NULL;
-	if(!ReservePages(byNewKey, newkeylen, &pNewKeyPage) || !pNewKeyPage){
-		ERR_K2HPRN("Failed to set page for new key.");
-		return false;
-	}
+	string			uniqid;
+	unsigned char*	byNewAttrs	= NULL;
+	size_t			newattrlen	= 0UL;
+	unsigned char*	byNewKey	= NULL;
+	size_t			newkeylen	= 0UL;
+	while(true){
+		// get now attributes
+		unsigned char*	byOldAttrs	= NULL;
+		ssize_t			oldattrlen	= 0;
+		{
+			K2HLock		ALObjCKI(K2HLock::RDLOCK);	// LOCK
+			PELEMENT	pOldElement;
+			if(NULL == (pOldElement = GetElement(byKey, keylen, ALObjCKI))){
+				ERR_K2HPRN("Could not find old key in k2hash.");
+				return false;
+			}
+			if(pOldElement->attrs && (0 >= (oldattrlen = Get(pOldElement, &byOldAttrs, PAGEOBJ_ATTRS)) || !byOldAttrs)){
+				K2H_Free(byOldAttrs);
+				oldattrlen = 0;
+			}
+		}
 
-	// make new page for attrs
-	K2HPage*	pNewAttrPage= NULL;
-	bool		IsNewAttr	= false;
-	if(byAttrs && 0 < attrlen){
-		if(!ReservePages(byAttrs, attrlen, &pNewAttrPage) || !pNewAttrPage){
-			ERR_K2HPRN("Failed to set page for new attrs.");
-			K2H_Delete(pNewKeyPage);
+		// mark history flag into attributes. And get uniqid
+		//
+		// [NOTE] do not need to set value at initializing attrman.
+		//
+		K2HAttrs		attrs;
+		K2hAttrOpsMan	attrman;
+		if(byOldAttrs && !attrs.Serialize(byOldAttrs, static_cast<size_t>(oldattrlen))){
+			ERR_K2HPRN("Could not make attributes object from binary data.");
+			K2H_Free(byOldAttrs);
+			return false;
+		}
+		if(!attrman.Initialize(this, byKey, keylen, NULL, 0UL)){
+			ERR_K2HPRN("Failed to initialize attribute manager object.");
+			K2H_Free(byOldAttrs);
+			return false;
+		}
+		uniqid.clear();
+		if(!attrman.GetUniqId(attrs, uniqid)){
+			// there is not uniqid attribute in attrs, so make it.
+			if(!attrman.DirectSetUniqId(attrs, NULL) || !attrman.GetUniqId(attrs, uniqid)){
+				ERR_K2HPRN("Failed to add uniqid for marking history into attributes.");
+				K2H_Free(byOldAttrs);
+				return false;
+			}
+		}
+		if(!attrman.MarkHistory(attrs)){
+			ERR_K2HPRN("Failed to mark history into attributes.");
+			K2H_Free(byOldAttrs);
+			return false;
+		}
+		if(!attrs.Serialize(&byNewAttrs, newattrlen)){
+			ERR_K2HPRN("Could not make attribute binary data from object.");
+			K2H_Free(byOldAttrs);
 			return false;
 		}
-		IsNewAttr = true;
-	}
-
-	// make new element for new key
-	PELEMENT	pNewElement;
-	if(NULL == (pNewElement = ReserveElement())){
-		ERR_K2HPRN("Failed to get free element.");
-		K2H_Delete(pNewKeyPage);
-		K2H_Delete(pNewAttrPage);
-		return false;
-	}
-
-	// make hash for new key
-	k2h_hash_t	newhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-	k2h_hash_t	newsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-
-	// copy old element's member to new element's
-	pNewElement->hash		= newhash;
-	pNewElement->subhash	= newsubhash;
-	pNewElement->key		= pNewKeyPage->GetPageHeadRelAddress();
-	pNewElement->value		= pOldElement->value;
-	pNewElement->subkeys	= pOldElement->subkeys;
-	pNewElement->attrs		= IsNewAttr ? pNewAttrPage->GetPageHeadRelAddress() : pOldElement->attrs;
-	pNewElement->keylength	= newkeylen;
-	pNewElement->vallength	= pOldElement->vallength;
-	pNewElement->skeylength	= pOldElement->skeylength;
-	pNewElement->attrlength	= IsNewAttr ? attrlen : pOldElement->attrlength;
-	K2H_Delete(pNewKeyPage);
-	K2H_Delete(pNewAttrPage);
-
-	// take off old element and remove it
-	if(!TakeOffElement(pOldCKIndex, pOldElement)){
-		ERR_K2HPRN("Failed to take off old element from ckey index.");
-		pNewElement->value		= NULL;
-		pNewElement->subkeys	= NULL;
-		pNewElement->attrs		= NULL;
-		pNewElement->vallength	= 0UL;
-		pNewElement->skeylength	= 0UL;
-		pNewElement->attrlength	= 0UL;
-		FreeElement(pNewElement);
-		return false;
-	}
-	pOldElement->value		= NULL;
-	pOldElement->subkeys	= NULL;
-	pOldElement->vallength	= 0UL;
-	pOldElement->skeylength	= 0UL;
-	if(!IsNewAttr){
-		pOldElement->attrs		= NULL;
-		pOldElement->attrlength	= 0UL;
-	}
-	if(!FreeElement(pOldElement)){
-		ERR_K2HPRN("Failed to remove old element.");
-		FreeElement(pNewElement);
-		return false;
-	}
-	ALObjCKI.Unlock();						// UNLOCK
 
-	// insert new element
-	PCKINDEX	pNewCKIndex;
-	if(NULL == (pNewCKIndex = GetCKIndex(newhash, ALObjCKI))){
-		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
-		FreeElement(pNewElement);
-		return false;
-	}
-	if(pNewCKIndex->element_list){
-		if(!InsertElement(static_cast<PELEMENT>(Abs(pNewCKIndex->element_list)), pNewElement)){
-			ERR_K2HPRN("Failed to insert new element");
-			FreeElement(pNewElement);
+		// make new key
+		if(NULL == (byNewKey = K2HShm::MakeHistoryKey(byKey, keylen, uniqid.c_str(), newkeylen))){
+			ERR_K2HPRN("Could not make history key name.");
+			K2H_Free(byOldAttrs);
+			K2H_Free(byNewAttrs);
 			return false;
 		}
-	}else{
-		pNewCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pNewElement));
-	}
-	pNewCKIndex->element_count	+= 1UL;
-	ALObjCKI.Unlock();						// UNLOCK
 
-	// check element count in ckey for increasing cur_mask(expanding key/ckey area)
-	if(!CheckExpandingKeyArea(pNewCKIndex)){				// Do not care for locking
-		ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
-		return false;
+		// move element to new key
+		bool	is_changed = false;
+		bool	result = RelinkElement(byKey, keylen, byNewKey, newkeylen, byNewAttrs, newattrlen, byOldAttrs, static_cast<size_t>(oldattrlen), true, is_changed);
+		K2H_Free(byOldAttrs);
+		if(!result){
+			ERR_K2HPRN("Failed to rename key for history.");
+			K2H_Free(byNewAttrs);
+			K2H_Free(byNewKey);
+			return false;
+		}
+		if(!is_changed){
+			break;
+		}
+		MSG_K2HPRN("Attributes of key are changed during unlocking, thus retry.");
+		K2H_Free(byNewAttrs);
+		K2H_Free(byNewKey);
 	}
 
 	// transaction
-	K2HTransaction	transobj(this);
-	if(!transobj.Rename(byOldKey, oldkeylen, byNewKey, newkeylen, byAttrs, attrlen)){
+	K2HTransaction*	ptransobj = new K2HTransaction(this, (NULL != ptranslist));		// ptranslist for stacking transaction data
+	if(!ptransobj->Rename(byKey, keylen, byNewKey, newkeylen, byNewAttrs, newattrlen)){
 		WAN_K2HPRN("Failed to put setting transaction.");
+	}else{
+		if(ptranslist){
+			ptranslist->push_back(ptransobj);										// stacking
+			ptransobj = NULL;
+		}
 	}
+	K2H_Delete(ptransobj);
+	K2H_Free(byNewAttrs);
+	K2H_Free(byNewKey);
 
 	if(!UpdateTimeval()){
 		WAN_K2HPRN("Failed to update timeval for data update.");
 	}
+
+	if(puniqid){
+		*puniqid = uniqid;
+	}
 	return true;
 }
 
 //
-// Rename for history(backup)
+// Move element from old key to new key.
 //
-// Like rename() method, but this method generates new key name automatically and marks history into attributes.
+// [NOTE]
+// The element and its value and subkeys pages are not copied. This method
+// makes only new key pages(and attributes pages if byAttrs is specified),
+// and moves the element from old ckey index to new ckey index while both
+// ckey indexes are locked. Thus the cost of renaming depends on only key
+// length, and other processes never see both keys or neither key.
+// If new key already exists, this method fails.
+// If is_check_attrs is true, the attributes of old key are compared with
+// byOldAttrs, and if these are different, is_changed is set true and the
+// element is not moved.
 //
-bool K2HShm::RenameForHistory(const unsigned char* byKey, size_t keylen, string* puniqid, k2htransobjlist_t* ptranslist)
+bool K2HShm::RelinkElement(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen, const unsigned char* byAttrs, size_t attrlen, const unsigned char* byOldAttrs, size_t oldattrlen, bool is_check_attrs, bool& is_changed)
 {
-	if(!byKey || 0 == keylen){
-		ERR_K2HPRN("Some parameters are wrong.");
-		return false;
-	}
-	if(!IsAttached()){
-		ERR_K2HPRN("There is no attached K2HASH.");
-		return false;
-	}
-	if(!K2hAttrOpsMan::IsMarkHistory(this)){
-		ERR_K2HPRN("Not make history mode.");
-		return false;
-	}
-	K2HFILE_UPDATE_CHECK(this);
+	is_changed = false;
 
-	// make hash for old key
-	k2h_hash_t	oldhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylen);
-	k2h_hash_t	oldsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylen);
+	// make hash for old and new key
+	k2h_hash_t	oldhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
+	k2h_hash_t	oldsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byOldKey), oldkeylen);
+	k2h_hash_t	newhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
+	k2h_hash_t	newsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
 
-	// get old key element
-	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
-	PCKINDEX	pOldCKIndex;
-	PELEMENT	pOldElementList	= NULL;
-	PELEMENT	pOldElement		= NULL;
-	if(NULL == (pOldCKIndex = GetCKIndex(oldhash, ALObjCKI))){
+	// lock both ckey indexes
+	K2HLock		ALObjOldCKI(K2HLock::RWLOCK);		// LOCK
+	K2HLock		ALObjNewCKI(K2HLock::RWLOCK);		// LOCK
+	PCKINDEX	pOldCKIndex = NULL;
+	PCKINDEX	pNewCKIndex = NULL;
+	if(!GetCKIndexPair(oldhash, ALObjOldCKI, pOldCKIndex, newhash, ALObjNewCKI, pNewCKIndex)){
 		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
 		return false;
 	}
-	if(NULL == (pOldElementList = GetElementList(pOldCKIndex, oldhash, oldsubhash)) || NULL == (pOldElement = GetElement(pOldElementList, byKey, keylen))){
-		ERR_K2HPRN("Could not find old key in k2hash.");
-		return false;
-	}
 
-	// get now attributes and mark history flag into it. And get uniqid
-	//
-	// [NOTE] do not need to set value at initializing attrman.
-	//
-	K2HAttrs*		pAttrs;
-	K2hAttrOpsMan	attrman;
-	string			uniqid;
-	if(NULL == (pAttrs = GetAttrs(pOldElement))){
-		pAttrs = new K2HAttrs;
-	}
-	if(!attrman.Initialize(this, byKey, keylen, NULL, 0UL)){
-		ERR_K2HPRN("Failed to initialize attribute manager object.");
-		K2H_Delete(pAttrs);
-		return false;
-	}
-	if(!attrman.GetUniqId(*pAttrs, uniqid)){
-		// there is not uniqid attribute in attrs, so make it.
-		if(!attrman.DirectSetUniqId(*pAttrs, NULL) || !attrman.GetUniqId(*pAttrs, uniqid)){
-			ERR_K2HPRN("Failed to add uniqid for marking history into attributes.");
-			K2H_Delete(pAttrs);
-			return false;
-		}
-	}
-	if(!attrman.MarkHistory(*pAttrs)){
-		ERR_K2HPRN("Failed to mark history into attributes.");
-		K2H_Delete(pAttrs);
-		return false;
-	}
-
-	// make new attribute page for new key
-	unsigned char*	byNewAttrs		= NULL;
-	size_t			newattrlen		= 0UL;
-	K2HPage*		pNewAttrPage	= NULL;
-	if(!pAttrs->Serialize(&byNewAttrs, newattrlen)){
-		ERR_K2HPRN("Could not make attribute binary data from object.");
-		K2H_Delete(pAttrs);
+	// get old key element
+	PELEMENT	pElementList;
+	PELEMENT	pElement;
+	if(NULL == (pElementList = GetElementList(pOldCKIndex, oldhash, oldsubhash)) || NULL == (pElement = GetElement(pElementList, byOldKey, oldkeylen))){
+		ERR_K2HPRN("Could not find old key in k2hash.");
 		return false;
 	}
-	if(!ReservePages(byNewAttrs, newattrlen, &pNewAttrPage) || !pNewAttrPage){
-		ERR_K2HPRN("Failed to set page for new attributes.");
-		K2H_Delete(pAttrs);
-		K2H_Free(byNewAttrs);
+	if(NULL != (pElementList = GetElementList(pNewCKIndex, newhash, newsubhash)) && NULL != GetElement(pElementList, byNewKey, newkeylen)){
+		ERR_K2HPRN("New key already exists in k2hash.");
 		return false;
 	}
-	K2H_Delete(pAttrs);
 
-	// make new key
-	unsigned char*	byNewKey;
-	size_t			newkeylen = 0;
-	if(NULL == (byNewKey = K2HShm::MakeHistoryKey(byKey, keylen, uniqid.c_str(), newkeylen))){
-		ERR_K2HPRN("Could not make history key name.");
-		K2H_Free(byNewAttrs);
-		K2H_Delete(pNewAttrPage);
-		return false;
+	// check attributes
+	if(is_check_attrs){
+		unsigned char*	byNowAttrs	= NULL;
+		ssize_t			nowattrlen	= 0;
+		if(pElement->attrs && (0 >= (nowattrlen = Get(pElement, &byNowAttrs, PAGEOBJ_ATTRS)) || !byNowAttrs)){
+			K2H_Free(byNowAttrs);
+			nowattrlen = 0;
+		}
+		if(static_cast<size_t>(nowattrlen) != oldattrlen || (byNowAttrs && 0 != memcmp(byNowAttrs, byOldAttrs, oldattrlen))){
+			K2H_Free(byNowAttrs);
+			is_changed = true;
+			return true;
+		}
+		K2H_Free(byNowAttrs);
 	}
 
-	// make new page for new key
-	K2HPage*	pNewKeyPage = NULL;
+	// make new pages for key and attrs
+	K2HPage*	pNewKeyPage	= NULL;
+	K2HPage*	pNewAttrPage= NULL;
 	if(!ReservePages(byNewKey, newkeylen, &pNewKeyPage) || !pNewKeyPage){
 		ERR_K2HPRN("Failed to set page for new key.");
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
-		K2H_Delete(pNewAttrPage);
 		return false;
 	}
-
-	// make new element for new key
-	PELEMENT	pNewElement;
-	if(NULL == (pNewElement = ReserveElement())){
-		ERR_K2HPRN("Failed to get free element.");
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
-		K2H_Delete(pNewAttrPage);
+	if(byAttrs && 0 < attrlen && (!ReservePages(byAttrs, attrlen, &pNewAttrPage) || !pNewAttrPage)){
+		ERR_K2HPRN("Failed to set page for new attrs.");
+		if(!pNewKeyPage->Free()){
+			ERR_K2HPRN("FATAL: In error recovery logic, failed to free pages.");
+		}
 		K2H_Delete(pNewKeyPage);
 		return false;
 	}
 
-	// make hash for new key
-	k2h_hash_t	newhash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-	k2h_hash_t	newsubhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byNewKey), newkeylen);
-
-	// copy old element's member to new element's
-	pNewElement->hash		= newhash;
-	pNewElement->subhash	= newsubhash;
-	pNewElement->key		= pNewKeyPage->GetPageHeadRelAddress();
-	pNewElement->value		= pOldElement->value;
-	pNewElement->subkeys	= pOldElement->subkeys;
-	pNewElement->attrs		= pNewAttrPage->GetPageHeadRelAddress();
-	pNewElement->keylength	= newkeylen;
-	pNewElement->vallength	= pOldElement->vallength;
-	pNewElement->skeylength	= pOldElement->skeylength;
-	pNewElement->attrlength	= newattrlen;
-	K2H_Delete(pNewAttrPage);
-	K2H_Delete(pNewKeyPage);
-
-	// take off old element and remove it
-	if(!TakeOffElement(pOldCKIndex, pOldElement)){
+	// take off element from old ckey index
+	if(!TakeOffElement(pOldCKIndex, pElement)){
 		ERR_K2HPRN("Failed to take off old element from ckey index.");
-		pNewElement->value		= NULL;
-		pNewElement->subkeys	= NULL;
-		pNewElement->attrs		= NULL;
-		pNewElement->vallength	= 0UL;
-		pNewElement->skeylength	= 0UL;
-		pNewElement->attrlength	= 0UL;
-		FreeElement(pNewElement);
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
-		return false;
-	}
-	pOldElement->value		= NULL;
-	pOldElement->subkeys	= NULL;
-	pOldElement->vallength	= 0UL;
-	pOldElement->skeylength	= 0UL;
-	if(!FreeElement(pOldElement)){
-		ERR_K2HPRN("Failed to remove old element.");
-		FreeElement(pNewElement);
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
+		if(!pNewKeyPage->Free() || (pNewAttrPage && !pNewAttrPage->Free())){
+			ERR_K2HPRN("FATAL: In error recovery logic, failed to free pages.");
+		}
+		K2H_Delete(pNewKeyPage);
+		K2H_Delete(pNewAttrPage);
 		return false;
 	}
-	ALObjCKI.Unlock();						// UNLOCK
 
-	// insert new element
-	PCKINDEX	pNewCKIndex;
-	if(NULL == (pNewCKIndex = GetCKIndex(newhash, ALObjCKI))){
-		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
-		FreeElement(pNewElement);
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
-		return false;
+	// replace key(and attrs) pages, old pages are freed.
+	bool	result = (ReplacePage(pElement, pNewKeyPage, newkeylen, PAGEOBJ_KEY) && (!pNewAttrPage || ReplacePage(pElement, pNewAttrPage, attrlen, PAGEOBJ_ATTRS)));
+	K2H_Delete(pNewKeyPage);
+	K2H_Delete(pNewAttrPage);
+	if(!result){
+		// [NOTE]
+		// The element is not in ckey index, but it has new key page.
+		// Then insert it into new ckey index and continue.
+		//
+		ERR_K2HPRN("Failed to replace key or attributes pages, but continue...");
 	}
+	pElement->hash		= newhash;
+	pElement->subhash	= newsubhash;
+
+	// insert element into new ckey index
 	if(pNewCKIndex->element_list){
-		if(!InsertElement(static_cast<PELEMENT>(Abs(pNewCKIndex->element_list)), pNewElement)){
-			ERR_K2HPRN("Failed to insert new element");
-			FreeElement(pNewElement);
-			K2H_Free(byNewAttrs);
-			K2H_Free(byNewKey);
+		if(!InsertElement(static_cast<PELEMENT>(Abs(pNewCKIndex->element_list)), pElement)){
+			ERR_K2HPRN("Failed to insert element");
+			FreeElement(pElement);
 			return false;
 		}
 	}else{
-		pNewCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pNewElement));
+		pNewCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pElement));
 	}
 	pNewCKIndex->element_count	+= 1UL;
-	ALObjCKI.Unlock();						// UNLOCK
+	ALObjNewCKI.Unlock();								// UNLOCK
+	ALObjOldCKI.Unlock();								// UNLOCK
+
+	// new key is referenced for cache mode
+	SetCacheReference(newhash, false);
 
 	// check element count in ckey for increasing cur_mask(expanding key/ckey area)
 	if(!CheckExpandingKeyArea(pNewCKIndex)){				// Do not care for locking
 		ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
-		K2H_Free(byNewAttrs);
-		K2H_Free(byNewKey);
 		return false;
 	}
-
-	// transaction
-	K2HTransaction*	ptransobj = new K2HTransaction(this, (NULL != ptranslist));		// ptranslist for stacking transaction data
-	if(!ptransobj->Rename(byKey, keylen, byNewKey, newkeylen, byNewAttrs, newattrlen)){
-		WAN_K2HPRN("Failed to put setting transaction.");
-	}else{
-		if(ptranslist){
-			ptranslist->push_back(ptransobj);										// stacking
-			ptransobj = NULL;
-		}
-	}
-	K2H_Delete(ptransobj);
-	K2H_Free(byNewAttrs);
-	K2H_Free(byNewKey);
-
-	if(!UpdateTimeval()){
-		WAN_K2HPRN("Failed to update timeval for data update.");
-	}
-
-	if(puniqid){
-		*puniqid = uniqid;
-	}
 	return true;
 }
-
 //---------------------------------------------------------
 // Direct Access
 //---------------------------------------------------------
@@ -3815,7 +4231,7 @@ K2HShm::iterator K2HShm::begin(void)
 	K2HFILE_UPDATE_CHECK(this);
 
 	for(PELEMENT pFirstElement = static_cast<PELEMENT>(MmapInfos.begin(K2H_AREA_PAGELIST)); pFirstElement; pFirstElement = static_cast<PELEMENT>(MmapInfos.next(pFirstElement, sizeof(ELEMENT)))){
-		if(pFirstElement->key){
+		if(pFirstElement->key && !IsExpireIndexElement(pFirstElement)){
 			// For lock object
 			K2HLock		ALObjCKI(K2HLock::RDLOCK);					// LOCK
 			if(NULL != GetCKIndex(pFirstElement->hash, ALObjCKI)){
@@ -3849,7 +4265,7 @@ PELEMENT K2HShm::FindNextElement(PELEMENT pLastElement, K2HLock& ALObjCKI) const
 	K2HFILE_UPDATE_CHECK(const_cast<K2HShm*>(this));
 
 	for(PELEMENT pNextElement = static_cast<PELEMENT>(MmapInfos.next(pLastElement, sizeof(ELEMENT))); pNextElement; pNextElement = static_cast<PELEMENT>(MmapInfos.next(pNextElement, sizeof(ELEMENT)))){
-		if(pNextElement->key){
+		if(pNextElement->key && !IsExpireIndexElement(pNextElement)){
 			if(NULL != GetCKIndex(pNextElement->hash, ALObjCKI)){
 				return pNextElement;
 			}
@@ -3942,9 +4358,9 @@ bool K2HShm::UnsetTransThreadPool(void)
 //---------------------------------------------------------
 // Attributes control
 //---------------------------------------------------------
-bool K2HShm::SetCommonAttribute(const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const strarr_t* pluginlibs)
+bool K2HShm::SetCommonAttribute(const bool* is_mtime, const bool* is_defenc, const char* passfile, const bool* is_history, const time_t* expire, const strarr_t* pluginlibs, const char* comptype, const size_t* compmin, const int* complevel, const char* compdict)
 {
-	return K2hAttrOpsMan::InitializeCommonAttr(this, is_mtime, is_defenc, passfile, is_history, expire, pluginlibs);
+	return K2hAttrOpsMan::InitializeCommonAttr(this, is_mtime, is_defenc, passfile, is_history, expire, pluginlibs, comptype, compmin, complevel, compdict);
 }
 
 bool K2HShm::AddAttrCryptPass(const char* pass, bool is_default_encrypt)
@@ -88,11 +88,44 @@ class K2HIterator;
 class K2HDAccess;
 class K2HDALock;
 class K2HTransaction;
+class K2HHotCache;
 
 //---------------------------------------------------------
 // Typedefs
 //---------------------------------------------------------
 typedef std::vector<K2HTransaction*>		k2htransobjlist_t;
+typedef std::vector<K2HWATCHEVENT>		k2hwatchevlist_t;
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+// Cursor for compressing area by steps(online)
+//
+// This structure keeps the progress of AreaCompressStep() in
+// the caller process. Initialize it by constructor(or Reset()),
+// and pass it to AreaCompressStep() repeatedly.
+//
+typedef struct k2h_compact_cursor{
+	long			area_type;			// target area type(K2H_AREA_PAGELIST or K2H_AREA_PAGE)
+	off_t			area_offset;		// target area file offset
+	size_t			area_length;		// target area length
+	void*			anchor;				// relative address of anchor for fenced entries in target area
+	PELEMENT		next;				// relative address of element for next scanning(NULL is start of scanning)
+	unsigned long	moved;				// relocated count in this scanning
+
+	k2h_compact_cursor() : area_type(K2H_AREA_UNKNOWN), area_offset(0L), area_length(0UL), anchor(NULL), next(NULL), moved(0UL) {}
+
+	void Reset(void)
+	{
+		area_type	= K2H_AREA_UNKNOWN;
+		area_offset	= 0L;
+		area_length	= 0UL;
+		anchor		= NULL;
+		next		= NULL;
+		moved		= 0UL;
+	}
+	bool IsTarget(void) const { return (K2H_AREA_UNKNOWN != area_type); }
+}K2HCOMPACTCURSOR, *PK2HCOMPACTCURSOR;
 
 //---------------------------------------------------------
 // Class K2HShm
@@ -102,6 +135,8 @@ class K2HShm
 		friend class K2HIterator;
 		friend class K2HDAccess;
 		friend class K2HDALock;
+		friend class K2HBuilder;
+		friend class K2HTransaction;
 
 	public:
 		typedef K2HIterator	iterator;
@@ -138,6 +173,13 @@ class K2HShm
 		static const int	MAX_EXPAND_PAGE_CNT				= (1024 * 1024);	// maximum page count for expanding
 		static const long	DETACH_NO_WAIT					= 0;	// no wait finishing transaction at detaching
 		static const long	DETACH_BLOCK_WAIT				= -1;	// wait blocking by finishing transaction at detaching
+		static const long	DEFAULT_COMPACTOR_INTERVAL		= 1000;	// default interval(ms) for area compactor after finishing compress
+		static const long	DEFAULT_COMPACTOR_STEP_COUNT	= 64;	// default entry count by one step for area compactor
+		static const long	DEFAULT_REAPER_INTERVAL			= 1000;	// default interval(ms) for expire reaper after reaping all expired keys
+		static const long	DEFAULT_REAPER_STEP_COUNT		= 64;	// default key count by one step for expire reaper
+		static const long	DEFAULT_CACHE_WATERMARK			= 64;	// default free page count which starts evicting in cache mode
+		static const long	DEFAULT_WATCH_CAPACITY			= 4096;	// default event count in event ring for watch mode
+		static const long	DEFAULT_HOTCACHE_LIMIT			= 16 * 1024 * 1024;	// default total size of hot key cache
 
 	private:
 		static size_t	SystemPageSize;			// System page size, used this for initializing, extending area
@@ -152,6 +194,7 @@ class K2HShm
 		PK2H			pHead;
 		K2HMmapInfo		MmapInfos;
 		K2HFileMonitor	FileMon;
+		K2HHotCache*	pHotCache;				// hot key cache in this process(NULL means disable)
 
 	public:
 		static size_t GetSystemPageSize(void);
@@ -159,6 +202,7 @@ class K2HShm
 		static int GetTransThreadPool(void);
 		static bool SetTransThreadPool(int count);
 		static bool UnsetTransThreadPool(void);
+		static bool IsSubKeysDirectory(const unsigned char* bySubkeys, size_t length);
 
 		K2HShm();
 		virtual ~K2HShm();
@@ -206,9 +250,12 @@ class K2HShm
 																									// Subkeys      by Key
 		K2HSubKeys* GetSubKeys(const unsigned char* byKey, size_t length, bool checkattr = true) const;
 		K2HSubKeys* GetSubKeys(PELEMENT pElement, bool checkattr = true) const;						// Subkeys      by Element
+		K2HSubKeys* LoadSubKeys(const unsigned char* bySubkeys, size_t length) const;				// Subkeys      by binary(list or directory)
 		K2HAttrs* GetAttrs(const char* pKey) const;													// Attributes	by Key
 		K2HAttrs* GetAttrs(const unsigned char* byKey, size_t length) const;						// Attributes	by Key
 		K2HAttrs* GetAttrs(PELEMENT pElement) const;												// Attributes	by Element
+		bool GetAttrFlags(const unsigned char* byKey, size_t length, K2HATTRFLAGS& attrflags) const;	// Attribute flags by Key
+		bool GetAttrFlags(PELEMENT pElement, K2HATTRFLAGS& attrflags) const;						// Attribute flags by Element
 
 		// Set/Add
 		bool Set(const char* pKey, const char* pValue, const char* encpass = NULL, const time_t* expire = NULL);															// Keep subkey
@@ -240,6 +287,12 @@ class K2HShm
 		// Rename(for transaction)
 		bool Rename(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen, const unsigned char* byAttrs, size_t attrlen);
 
+		// Atomic operation
+		bool Increment(const char* pKey, int64_t delta, int64_t* pvalue = NULL);
+		bool Increment(const unsigned char* byKey, size_t keylength, int64_t delta, int64_t* pvalue = NULL);
+		bool CompareAndSwap(const unsigned char* byKey, size_t keylength, const unsigned char* byExpected, size_t explength, const unsigned char* byNew, size_t newlength, bool& is_swapped);
+		bool Append(const unsigned char* byKey, size_t keylength, const unsigned char* byData, size_t datalength);
+
 		// Direct access
 		K2HDAccess* GetDAccessObj(const char* pKey, K2HDAccess::ACSMODE acsmode = K2HDAccess::READ_ACCESS, off_t offset = 0L);
 		K2HDAccess* GetDAccessObj(const unsigned char* byKey, size_t keylength, K2HDAccess::ACSMODE acsmode = K2HDAccess::READ_ACCESS, off_t offset = 0L);
@@ -257,19 +310,39 @@ class K2HShm
 		// Queue
 		K2HQueue* GetQueueObj(bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L);
 		K2HKeyQueue* GetKeyQueueObj(bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L);
+		K2HShardQueue* GetShardQueueObj(bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L, int shardcnt = 0, int mode = K2H_SHARDQ_DEFAULT_MODE);
 		bool IsEmptyQueue(const unsigned char* byMark, size_t marklength) const;
 		int GetCountQueue(const unsigned char* byMark, size_t marklength) const;
 		bool ReadQueue(const unsigned char* byMark, size_t marklength, unsigned char** ppKey, size_t& keylength, unsigned char** ppValue, size_t& vallength, int pos = 0, const char* encpass = NULL) const;
 		bool PushFifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL) { return AddQueue(byMark, marklength, byKey, keylength, byValue, vallength, true, attrtype, pAttrs, encpass, expire); }
 		bool PushLifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL) { return AddQueue(byMark, marklength, byKey, keylength, byValue, vallength, false, attrtype, pAttrs, encpass, expire); }
 		bool PopQueue(const unsigned char* byMark, size_t marklength, unsigned char** ppKey, size_t& keylength, unsigned char** ppValue, size_t& vallength, K2HAttrs** ppAttrs = NULL, const char* encpass = NULL);
+		bool PushQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, bool is_fifo, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs = NULL, const char* encpass = NULL, const time_t* expire = NULL) { return AddQueue(byMark, marklength, pkeys, pvals, count, is_fifo, attrtype, pAttrs, encpass, expire); }
+		bool PopQueue(const unsigned char* byMark, size_t marklength, size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t& popcount, const char* encpass = NULL);
 		int RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned int count, bool rmkeyval, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL, const char* encpass = NULL);
 
+		// Ring Queue
+		K2HRingQueue* GetRingQueueObj(bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L);
+		bool IsEmptyRingQueue(const unsigned char* byMark, size_t marklength) const;
+		int GetCountRingQueue(const unsigned char* byMark, size_t marklength) const;
+		bool ReadRingQueue(const unsigned char* byMark, size_t marklength, unsigned char** ppValue, size_t& vallength, bool is_fifo, int pos = 0) const;
+		bool PushRingQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pvals, size_t count, const time_t* expire = NULL);
+		bool PopRingQueue(const unsigned char* byMark, size_t marklength, bool is_fifo, size_t maxcount, PK2HBIN* ppvals, size_t& popcount);
+		int RemoveRingQueue(const unsigned char* byMark, size_t marklength, bool is_fifo, unsigned int count, k2h_q_remove_trial_callback fp = NULL, void* pExtData = NULL);
+		bool GetRingQueueHead(const unsigned char* byMark, size_t marklength, K2HRINGHEAD& rhead) const;
+
+		// Queue wakeup
+		bool StartQueueWait(void);
+		void StopQueueWait(void);
+		uint32_t GetQueueWakeupSequence(void) const;
+		bool WaitQueueWakeup(uint32_t sequence, long timeout_ms) const;
+
 		// Queue( used by only k2hash library family )
 		K2HLowOpsQueue* GetLowOpsQueueObj(bool is_fifo = true, const unsigned char* pref = NULL, size_t preflen = 0L);
-		bool UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength);
+		bool UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, long popcount = -1L);
 		bool ReadQueue(const unsigned char* byMark, size_t marklength, unsigned char** ppKey, size_t& keylength, int pos = 0) const;
 		bool AddQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, bool is_fifo);
+		bool AddQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, size_t count, bool is_fifo);
 		bool PopQueueEx(const unsigned char* byMark, size_t marklength, bool& is_found, bool& is_expired, unsigned char** ppKey, size_t& keylength, unsigned char** ppValue, size_t& vallength, K2HAttrs** ppAttrs, const char* encpass);
 
 		// Dump
@@ -277,6 +350,7 @@ class K2HShm
 		bool PrintState(FILE* stream = stdout) const;
 		bool PrintAreaInfo(void) const;
 		bool DumpQueue(FILE* stream, const unsigned char* byMark, size_t marklength);
+		bool DumpRingQueue(FILE* stream, const unsigned char* byMark, size_t marklength);
 		PK2HSTATE GetState(void) const;
 
 		// Transaction
@@ -284,7 +358,7 @@ class K2HShm
 		bool DisableTransaction(void) const { return Transaction(false, NULL, NULL, 0, NULL, 0, NULL); }
 
 		// Attributes
-		bool SetCommonAttribute(const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL, const strarr_t* pluginlibs = NULL);
+		bool SetCommonAttribute(const bool* is_mtime = NULL, const bool* is_defenc = NULL, const char* passfile = NULL, const bool* is_history = NULL, const time_t* expire = NULL, const strarr_t* pluginlibs = NULL, const char* comptype = NULL, const size_t* compmin = NULL, const int* complevel = NULL, const char* compdict = NULL);
 		bool AddAttrCryptPass(const char* pass, bool is_default_encrypt = false);
 		bool AddAttrPluginLib(const char* path);
 		bool CleanCommonAttribute(void);
@@ -293,6 +367,46 @@ class K2HShm
 
 		// Area Compress
 		bool AreaCompress(bool& isCompressed);
+		bool AreaCompressStep(K2HCOMPACTCURSOR& cursor, long max_count, bool& isCompressed, bool& isFinished);
+		bool AreaCompressCancel(K2HCOMPACTCURSOR& cursor);
+		bool StartAreaCompactor(long interval_ms = DEFAULT_COMPACTOR_INTERVAL, long step_count = DEFAULT_COMPACTOR_STEP_COUNT);
+		bool StopAreaCompactor(void);
+
+		// Expiry index
+		bool ReapExpired(size_t maxcount, size_t* preaped = NULL);
+		bool StartExpireReaper(long interval_ms = DEFAULT_REAPER_INTERVAL, long step_count = DEFAULT_REAPER_STEP_COUNT);
+		bool StopExpireReaper(void);
+
+		// Cache mode
+		bool EnableCache(size_t limit, long watermark = DEFAULT_CACHE_WATERMARK);
+		bool DisableCache(void);
+		bool IsCacheMode(void) const;
+
+		// Watch mode
+		bool EnableWatch(size_t capacity = DEFAULT_WATCH_CAPACITY);
+		bool DisableWatch(void);
+		bool IsWatchMode(void) const;
+		uint64_t GetWatchSequence(void) const;
+		bool ReadWatchEvents(uint64_t& sequence, k2hwatchevlist_t& events, bool& is_overflow, const unsigned char* byPrefix = NULL, size_t prefixlen = 0UL, size_t maxcount = 0UL) const;
+		bool WaitWatchEvent(uint64_t sequence, long timeout_ms) const;
+
+		// Hot key cache
+		bool EnableHotCache(size_t limit = DEFAULT_HOTCACHE_LIMIT);
+		bool DisableHotCache(void);
+		bool IsHotCache(void) const { return (NULL != pHotCache); }
+
+		// Parallel scan
+		bool ScanParallel(int nthreads, k2h_scan_callback fp, void* pExtData, bool is_check_attrs = true) const;
+
+		// Bulk load
+		unsigned long GetPageCount(size_t length) const;
+		bool PrepareBulkLoad(unsigned long record_count, unsigned long page_count);
+		int GetBulkPartition(k2h_hash_t hash, int partcnt) const;
+		bool BulkSet(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const unsigned char* bySubKeys, size_t sklength, const unsigned char* byAttrs, size_t attrlength);
+
+		// Snapshot
+		bool SaveSnapshot(const char* pFile, bool isErrSkip = false, off_t* ptranspos = NULL);
+		bool IsSnapshotActive(void) const;
 
 		// Other
 		bool GetUpdateTimeval(struct timeval& tv) const;
@@ -318,9 +432,19 @@ class K2HShm
 		static bool CheckSystemLimit(void);
 
 		// Queue
-		static PBK2HMARKER InitK2HMarker(size_t& marklen, const unsigned char* bystart = NULL, size_t startlen = 0, const unsigned char* byend = NULL, size_t endlen = 0);
-		static PBK2HMARKER UpdateK2HMarker(PBK2HMARKER pmarker, size_t& marklen, const unsigned char* byKey, size_t keylength, bool is_end);
+		PBK2HMARKER InitK2HMarker(size_t& marklen, const unsigned char* bystart = NULL, size_t startlen = 0, const unsigned char* byend = NULL, size_t endlen = 0) const;
+		PBK2HMARKER UpdateK2HMarker(PBK2HMARKER pmarker, size_t& marklen, const unsigned char* byKey, size_t keylength, bool is_end, int64_t delta = 0) const;
+		bool IsExtK2HMarkerFormat(void) const;
 		static bool IsEmptyK2HMarker(PBK2HMARKER pmarker);
+		static bool IsSafeK2HMarker(PBK2HMARKER pmarker, size_t marklen);
+		static PK2HMARKEREXT GetK2HMarkerExt(PBK2HMARKER pmarker);
+		static bool CopyK2HMarkerCount(PBK2HMARKER pdstmarker, PBK2HMARKER psrcmarker, int64_t delta);
+		static bool ShiftK2HMarkerHead(PBK2HMARKER pmarker, int64_t shift);
+		static bool ChangeK2HMarkerGeneration(PBK2HMARKER pmarker);
+		static unsigned char* GetQueueIndexKey(const unsigned char* byMark, size_t marklength, size_t& keylength);
+
+		// Subkeys directory
+		static unsigned char* MakeSubKeysChunkKey(const unsigned char* byKey, size_t keylength, size_t& chunklength);
 
 		// For history
 		static unsigned char* MakeHistoryKey(const unsigned char* byBaseKey, size_t basekeylen, const char* pUniqid, size_t& hiskeylen);
@@ -340,6 +464,7 @@ class K2HShm
 
 		PCKINDEX GetCKIndex(PKINDEX pKindex, k2h_hash_t hash, K2HLock& ALObjCKI) const;
 		PCKINDEX GetCKIndex(k2h_hash_t hash, K2HLock& ALObjCKI, bool isMergeCurmask = true) const;
+		bool GetCKIndexPair(k2h_hash_t hash1, K2HLock& ALObjCKI1, PCKINDEX& pCKIndex1, k2h_hash_t hash2, K2HLock& ALObjCKI2, PCKINDEX& pCKIndex2) const;
 
 		PELEMENT GetElementList(PELEMENT pRelElement, k2h_hash_t hash, k2h_hash_t subhash) const;
 		PELEMENT GetElementList(PCKINDEX pCKindex, k2h_hash_t hash, k2h_hash_t subhash) const;
@@ -378,10 +503,57 @@ class K2HShm
 		bool ReplacePageHead(PPAGEHEAD pLastRelPage, PPAGEHEAD pRelPtr, bool isSetPrevPtr) const;
 		bool ExpandPages(K2HPage* pLastPage, size_t length);
 
+		// Extra area
+		PK2HEXTRA GetExtraArea(void) const;
+		PK2HEXTRA MakeExtraArea(void);
+
+		// Queue wakeup
+		void WakeupQueueWaiters(void) const;
+
+		// Expiry index
+		bool AddExpireIndex(const unsigned char* byKey, size_t keylength, time_t expire);
+		bool RemoveExpiredKey(const unsigned char* byKey, size_t keylength, bool& is_removed);
+		bool RemoveEmptyRingQueue(const unsigned char* byMark, size_t marklength, bool& is_removed);
+		bool IsExpireIndexElement(PELEMENT pElement) const;
+
+		// Ring queue block
+		PK2HRINGHEAD GetRingHead(PELEMENT pMarkerElement, k2h_hash_t hash) const;
+		PK2HRINGHEAD AllocateRingBlock(size_t needsize, k2h_hash_t hash);
+		bool FreeRingBlock(PK2HRINGHEAD pRingHead);
+		bool SetRingMarker(const unsigned char* byMark, size_t marklength, PK2HRINGHEAD pRingHead);
+
+		// Cache mode
+		void SetCacheReference(k2h_hash_t hash, bool is_read) const;
+		void CountCacheMiss(void) const;
+		bool CheckCacheEviction(size_t length);
+		bool EvictCacheUnit(k2h_hash_t unit, k2h_hash_t cache_mask, long& evicted);
+
+		// Watch mode
+		void PostWatchEvent(long scomtype, const unsigned char* byKey, size_t keylength, const unsigned char* byNewKey, size_t newkeylength) const;
+
+		// Hot key cache
+		bool MakeKeyVersionTable(void);
+		bool GetKeyVersion(k2h_hash_t hash, uint64_t& version) const;
+		void IncrementKeyVersion(k2h_hash_t hash) const;
+
+		// Parallel scan
+		static void* ScanWorkerProc(void* param);
+		bool ScanRange(k2h_hash_t start_hash, k2h_hash_t end_hash, k2h_hash_t scan_mask, k2h_scan_callback fp, void* pExtData, bool is_check_attrs, volatile bool& is_stop) const;
+		bool ScanElementList(PELEMENT pRelElement, k2h_hash_t unit_hash, k2h_hash_t scan_mask, k2h_scan_callback fp, void* pExtData, bool is_check_attrs, volatile bool& is_stop) const;
+
+		// Atomic operation
+		bool GetAtomicElement(PCKINDEX pCKIndex, k2h_hash_t hash, k2h_hash_t subhash, const unsigned char* byKey, size_t keylength, PELEMENT& pElement, bool& is_expired) const;
+		bool SetAtomicValue(K2HLock& ALObjCKI, PCKINDEX pCKIndex, PELEMENT pElement, k2h_hash_t hash, k2h_hash_t subhash, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength);
+		bool WriteAtomicValue(K2HLock& ALObjCKI, PELEMENT pElement, const unsigned char* byKey, size_t keylength, const unsigned char* byData, size_t length, off_t offset);
+
+		// Snapshot
+		bool CaptureSnapshot(PCKINDEX pCKIndex, k2h_hash_t hash, int fd = -1) const;
+
 		// Search
 		PELEMENT FindNextElement(PELEMENT pLastElement, K2HLock& ALObjCKI) const;
 
 		// Set
+		bool SetInPlace(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2HSubKeys* pSubKeys, bool isRemoveSubKeys, K2HAttrs* pAttrs, const char* encpass, const time_t* expire, K2hAttrOpsMan::ATTRINITTYPE attrtype, bool& is_set, bool is_keep_subkeys = false);
 		PELEMENT AllocateElement(k2h_hash_t hash, k2h_hash_t subhash, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const unsigned char* bySubKeys, size_t sublength, const unsigned char* byAttrs, size_t attrlength);
 
 		// Remove
@@ -391,7 +563,15 @@ class K2HShm
 		bool RemoveEx(PELEMENT pElement, k2htransobjlist_t* ptranslist, bool& is_check_updated);
 		bool RemoveEx(const unsigned char* byKey, size_t keylength, k2htransobjlist_t* ptranslist, bool& is_check_updated);
 		bool RemoveSubkeys(K2HSubKeys* pSubKeys, k2htransobjlist_t* ptranslist, bool& is_check_updated);
-		bool GetSubKeys(PELEMENT pElement, K2HSubKeys*& pSubKeys);																// Using only for removing subkeys
+		bool GetSubKeys(const unsigned char* bySubkeys, size_t length, K2HSubKeys*& pSubKeys) const;							// Using only for removing subkeys
+
+		// Subkeys directory
+		bool GetSubKeysDirectory(const unsigned char* byKey, size_t keylength, unsigned char** ppDir, size_t& dirlength) const;
+		bool MakeSubKeysBinary(const unsigned char* byKey, size_t keylength, K2HSubKeys* pSubKeys, unsigned char** ppSubkeys, size_t& length);
+		bool SetSubKeysChunk(const unsigned char* byChunk, size_t chunklength, const K2HSubKeys& subkeys, bool is_new);
+		bool AddSubKeyToDirectory(const unsigned char* byKey, size_t keylength, const unsigned char* byDir, size_t dirlength, const unsigned char* bySubkey, size_t skeylength);
+		bool RemoveSubKeyFromDirectory(const unsigned char* byKey, size_t keylength, const unsigned char* byDir, size_t dirlength, const unsigned char* bySubkey, size_t skeylength, bool& is_found);
+		void RemoveSubKeysChunks(const unsigned char* byOldDir, size_t oldlength, const unsigned char* byNewDir, size_t newlength);
 
 		// Replace
 		bool Replace(const unsigned char* byKey, size_t keylength, const unsigned char* byData, size_t dlength, int type);
@@ -399,9 +579,12 @@ class K2HShm
 		bool ReplacePage(PELEMENT pElement, const unsigned char* byData, size_t length, int type);
 		bool ReplacePage(PELEMENT pElement, K2HPage* pPage, size_t totallength, int type);
 		bool ReplacePage(PELEMENT pElement, PPAGEHEAD pRelPageHead, size_t totallength, int type);
+		bool SetPages(PELEMENT pElement, const unsigned char* byData, size_t length, int type);
+		bool OverWritePages(PELEMENT pElement, const unsigned char* byData, size_t length, int type, bool& is_written);
 
 		// Rename(for history)
 		bool RenameForHistory(const unsigned char* byKey, size_t keylen, std::string* puniqid, k2htransobjlist_t* ptranslist);
+		bool RelinkElement(const unsigned char* byOldKey, size_t oldkeylen, const unsigned char* byNewKey, size_t newkeylen, const unsigned char* byAttrs, size_t attrlen, const unsigned char* byOldAttrs, size_t oldattrlen, bool is_check_attrs, bool& is_changed);
 
 		// Direct get/set
 		PBALLEDATA GetElementToBinary(PELEMENT pAbsElement) const;
@@ -409,9 +592,14 @@ class K2HShm
 
 		// Queue
 		PBK2HMARKER GetMarker(const unsigned char* byMark, size_t marklength, K2HLock* pALObjCKI = NULL) const;
+		bool AddK2HMarkerCount(const unsigned char* byMark, size_t marklength, int64_t delta, bool is_change_gen = false);
+		bool InheritK2HMarkerCount(const unsigned char* byMark, size_t marklength, PBK2HMARKER pnewmarker, int64_t delta) const;
 		bool AddQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, bool is_fifo, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
-		bool AddFifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
-		bool AddLifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
+		bool AddQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, bool is_fifo, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
+		bool AddFifoQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
+		bool AddLifoQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire);
+		bool ReadQueueByIndex(const unsigned char* byMark, size_t marklength, PBK2HMARKER pmarker, unsigned char** ppKey, size_t& keylength, int pos) const;
+		bool GetNextQueueKey(const unsigned char* byKey, size_t keylength, unsigned char** ppNextKey, size_t& nextlength) const;
 
 		// Dumping
 		bool DumpFreeElements(FILE* stream, int nest, PELEMENT pRelElements, long count) const;
@@ -433,6 +621,21 @@ class K2HShm
 		bool CopyPageData(K2HPage* pSrcTop, K2HPage* pDestTop);
 		bool ReplacePageInElement(PELEMENT pElement, int type, void* pRelExpArea, size_t ExpLength);
 		bool ReplacePagesInElement(PELEMENT pElement, void* pRelExpArea, size_t ExpLength);
+		bool FreeLastestArea(PK2HAREA pLastestArea, bool& is_need_check);
+
+		// Area Compress by steps( especial methods )
+		bool FindCompactAnchor(K2HCOMPACTCURSOR& cursor);
+		bool IsCompactAnchor(const K2HCOMPACTCURSOR& cursor) const;
+		unsigned long GetCompactFenceCount(const K2HCOMPACTCURSOR& cursor) const;
+		bool FenceCompactElement(K2HCOMPACTCURSOR& cursor, PELEMENT pElement);
+		bool FenceCompactPage(K2HCOMPACTCURSOR& cursor, PPAGEHEAD pRelPageHead);
+		bool FenceCompactFreeEntries(K2HCOMPACTCURSOR& cursor, unsigned long* pcount, bool is_count_only);
+		bool UnfenceCompactArea(K2HCOMPACTCURSOR& cursor);
+		bool IsCompactLinkedElement(PCKINDEX pCKIndex, PELEMENT pElement) const;
+		bool StartCompactArea(K2HCOMPACTCURSOR& cursor, bool& isStarted);
+		bool RelocateElement(K2HCOMPACTCURSOR& cursor, PELEMENT pElement);
+		bool RelocatePages(K2HCOMPACTCURSOR& cursor, PELEMENT pElement);
+		bool ReleaseCompactArea(K2HCOMPACTCURSOR& cursor, bool& isCompressed);
 
 		// Others
 		bool UpdateTimeval(bool isAreaUpdate = false) const;
@@ -0,0 +1,481 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+
+#include <string.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hpage.h"
+#include "k2hashfunc.h"
+#include "k2htrans.h"
+#include "k2hattrs.h"
+#include "k2hattropsman.h"
+#include "k2hattrbuiltin.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Methods for atomic operation
+//---------------------------------------------------------
+// [NOTE]
+// Atomic operations(increment, compare-and-swap and append) read and
+// update the value while only one collision key index is locked for
+// writing, so that these are safe between threads and processes without
+// K2HDALock.
+// These operate on the raw value, then the value which is encrypted or
+// compressed can not be operated. The key which is made by these methods
+// does not encrypt/compress the value and does not make history.
+// If the key is expired, it is operated as a new key.
+// When the value is updated in place, the attributes(mtime, expire) are
+// not updated, and the transaction is put as over-writing value(OW_VAL)
+// which has only the updated part of the value.
+//
+
+//
+// Get element for atomic operation.
+//
+// If the key is not found, pElement is set NULL. If the key is expired,
+// is_expired is set true.
+// This returns false when the value can not be operated atomically.
+//
+bool K2HShm::GetAtomicElement(PCKINDEX pCKIndex, k2h_hash_t hash, k2h_hash_t subhash, const unsigned char* byKey, size_t keylength, PELEMENT& pElement, bool& is_expired) const
+{
+	pElement	= NULL;
+	is_expired	= false;
+
+	PELEMENT	pElementList;
+	if(NULL == (pElementList = GetElementList(pCKIndex, hash, subhash)) || NULL == (pElement = GetElement(pElementList, byKey, keylength))){
+		MSG_K2HPRN("Not found Key in k2hash.");
+		return true;
+	}
+
+	K2HATTRFLAGS	attrflags;
+	if(GetAttrFlags(pElement, attrflags)){
+		if(0 != (attrflags.flags & K2HATTR_FLAG_HISTORY)){
+			ERR_K2HPRN("The key is marked history, it could not be operated.");
+			return false;
+		}
+		if(K2hAttrBuiltin::IsExpire(attrflags)){
+			MSG_K2HPRN("The key is expired, it is operated as new key.");
+			is_expired = true;
+			return true;
+		}
+		if(0 != (attrflags.flags & (K2HATTR_FLAG_ENCRYPT | K2HATTR_FLAG_COMPRESS))){
+			ERR_K2HPRN("The value is encrypted or compressed, it could not be operated.");
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// Set whole value to new key or expired key.
+//
+// If pElement is NULL, this makes new element and inserts it into ckey
+// index. If not, the element is expired and its value and attributes are
+// replaced. Subkeys in the element are kept.
+// This method must be called with locking ckey index, and it is unlocked
+// in this method.
+//
+bool K2HShm::SetAtomicValue(K2HLock& ALObjCKI, PCKINDEX pCKIndex, PELEMENT pElement, k2h_hash_t hash, k2h_hash_t subhash, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength)
+{
+	// make attribute
+	K2hAttrOpsMan	attrman;
+	K2HAttrs		attrs;
+	unsigned char*	byAttrs		= NULL;
+	size_t			attrlength	= 0UL;
+	if(!attrman.Initialize(this, byKey, keylength, byValue, vallength, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ATOMICKEY) || !attrman.UpdateAttr(attrs) || !attrs.Serialize(&byAttrs, attrlength)){
+		ERR_K2HPRN("Could not make attributes for key.");
+		return false;
+	}
+
+	bool			is_created	= (NULL == pElement);
+	unsigned char*	bySubkeys	= NULL;
+	ssize_t			sklength	= 0;
+	if(is_created){
+		// make new element
+		if(NULL == (pElement = AllocateElement(hash, subhash, byKey, keylength, byValue, vallength, NULL, 0UL, byAttrs, attrlength))){
+			ERR_K2HPRN("Failed to allocate new element and to set datas to it.");
+			K2H_Free(byAttrs);
+			return false;
+		}
+		if(pCKIndex->element_list){
+			if(!InsertElement(static_cast<PELEMENT>(Abs(pCKIndex->element_list)), pElement)){
+				ERR_K2HPRN("Failed to insert element");
+				FreeElement(pElement);
+				K2H_Free(byAttrs);
+				return false;
+			}
+		}else{
+			pCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pElement));
+		}
+		pCKIndex->element_count += 1UL;
+
+	}else{
+		// replace value and attributes in expired element
+		if(!SetPages(pElement, byValue, vallength, PAGEOBJ_VALUE) || !SetPages(pElement, byAttrs, attrlength, PAGEOBJ_ATTRS)){
+			ERR_K2HPRN("Failed to replace value and attributes in element.");
+			K2H_Free(byAttrs);
+			return false;
+		}
+
+		// get subkeys for transaction
+		if(pElement->subkeys && (0 >= (sklength = Get(pElement, &bySubkeys, PAGEOBJ_SUBKEYS)) || !bySubkeys)){
+			K2H_Free(bySubkeys);
+			sklength = 0;
+		}
+	}
+	ALObjCKI.Unlock();								// Unlock
+
+	SetCacheReference(hash, false);
+
+	// transaction
+	K2HTransaction	transobj(this);
+	if(!transobj.SetAll(byKey, keylength, byValue, vallength, bySubkeys, static_cast<size_t>(sklength), byAttrs, attrlength)){
+		WAN_K2HPRN("Failed to put setting transaction.");
+	}
+	K2H_Free(bySubkeys);
+
+	if(!UpdateTimeval()){
+		WAN_K2HPRN("Failed to update timeval for data update.");
+	}
+
+	// list key in expiry index
+	K2HATTRFLAGS	attrflags;
+	if(byAttrs && K2hAttrBuiltin::GetAttrFlags(byAttrs, attrlength, attrflags) && 0 != (attrflags.flags & K2HATTR_FLAG_EXPIRE)){
+		if(!AddExpireIndex(byKey, keylength, attrflags.expire.tv_sec)){
+			WAN_K2HPRN("Failed to add key to expiry index, but the key is expired when it is read.");
+		}
+	}
+	K2H_Free(byAttrs);
+
+	// check element count in ckey for increasing cur_mask(expanding key/ckey area)
+	if(is_created && !CheckExpandingKeyArea(pCKIndex)){		// Do not care for locking
+		ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
+		return false;
+	}
+	return true;
+}
+
+//
+// Write data into value pages from offset.
+//
+// The pages are added when the data is over the end of value, and the
+// value length is updated.
+// This method must be called with locking ckey index, and it is unlocked
+// in this method.
+//
+bool K2HShm::WriteAtomicValue(K2HLock& ALObjCKI, PELEMENT pElement, const unsigned char* byKey, size_t keylength, const unsigned char* byData, size_t length, off_t offset)
+{
+	if(!pElement->value || static_cast<size_t>(offset) > pElement->vallength){
+		ERR_K2HPRN("The element does not have value pages or offset is over value length.");
+		return false;
+	}
+
+	K2HPage*	pPage;
+	K2HPage*	pLastPage;
+	bool		isChangeSize	= false;
+	off_t		next_pos		= 0L;
+	if(NULL == (pPage = GetPageObject(pElement->value, false))){
+		ERR_K2HPRN("Could not make page object for value.");
+		return false;
+	}
+	if(NULL == (pLastPage = pPage->SetData(byData, length, offset, isChangeSize, next_pos))){
+		ERR_K2HPRN("Failed to write data into value pages.");
+		K2H_Delete(pPage);
+		return false;
+	}
+	if(pLastPage != pPage){
+		K2H_Delete(pLastPage);
+	}
+	K2H_Delete(pPage);
+
+	if(pElement->vallength < (static_cast<size_t>(offset) + length)){
+		pElement->vallength = static_cast<size_t>(offset) + length;
+	}
+	k2h_hash_t	hash = pElement->hash;
+	ALObjCKI.Unlock();								// Unlock
+
+	SetCacheReference(hash, false);
+
+	// transaction
+	K2HTransaction	transobj(this);
+	if(!transobj.OverWriteValue(byKey, keylength, byData, length, offset)){
+		WAN_K2HPRN("Failed to put over-writing value transaction.");
+	}
+
+	if(!UpdateTimeval()){
+		WAN_K2HPRN("Failed to update timeval for data update.");
+	}
+	return true;
+}
+
+bool K2HShm::Increment(const char* pKey, int64_t delta, int64_t* pvalue)
+{
+	return Increment(reinterpret_cast<const unsigned char*>(pKey), (pKey ? strlen(pKey) + 1 : 0UL), delta, pvalue);
+}
+
+//
+// Add delta to the value which is 64bit signed integer(host byte order).
+// If the key is not found(or expired), new key which has delta is made.
+// The value after adding is set to pvalue.
+//
+bool K2HShm::Increment(const unsigned char* byKey, size_t keylength, int64_t delta, int64_t* pvalue)
+{
+	if(!byKey || 0 == keylength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// evict keys before setting if cache mode
+	if(!CheckCacheEviction(keylength + sizeof(int64_t))){
+		WAN_K2HPRN("Failed to evict keys for cache mode, but continue...");
+	}
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElement;
+	bool		is_expired;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(!GetAtomicElement(pCKIndex, hash, subhash, byKey, keylength, pElement, is_expired)){
+		return false;
+	}
+
+	int64_t	value = delta;
+	bool	result;
+	if(!pElement || is_expired){
+		result = SetAtomicValue(ALObjCKI, pCKIndex, pElement, hash, subhash, byKey, keylength, reinterpret_cast<const unsigned char*>(&value), sizeof(int64_t));
+	}else{
+		if(sizeof(int64_t) != pElement->vallength){
+			ERR_K2HPRN("The value length(%zu) is not 64bit integer.", pElement->vallength);
+			return false;
+		}
+		unsigned char*	byValue = NULL;
+		if(static_cast<ssize_t>(sizeof(int64_t)) != Get(pElement, &byValue, PAGEOBJ_VALUE) || !byValue){
+			ERR_K2HPRN("Could not get value from element.");
+			K2H_Free(byValue);
+			return false;
+		}
+		int64_t	oldvalue;
+		memcpy(&oldvalue, byValue, sizeof(int64_t));
+		K2H_Free(byValue);
+
+		value	= oldvalue + delta;
+		result	= WriteAtomicValue(ALObjCKI, pElement, byKey, keylength, reinterpret_cast<const unsigned char*>(&value), sizeof(int64_t), 0L);
+	}
+	if(!result){
+		ERR_K2HPRN("Failed to increment value.");
+		return false;
+	}
+	if(pvalue){
+		*pvalue = value;
+	}
+	return true;
+}
+
+//
+// Swap the value to byNew only if the current value is same as byExpected.
+// If byExpected is NULL, the value is set only when the key is not found(or
+// expired).
+// The result of comparing is set to is_swapped, and this returns false
+// only when something error occurred.
+//
+bool K2HShm::CompareAndSwap(const unsigned char* byKey, size_t keylength, const unsigned char* byExpected, size_t explength, const unsigned char* byNew, size_t newlength, bool& is_swapped)
+{
+	is_swapped = false;
+	if(!byKey || 0 == keylength || !byNew || 0 == newlength || (byExpected && 0 == explength)){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// evict keys before setting if cache mode
+	if(!CheckCacheEviction(keylength + newlength)){
+		WAN_K2HPRN("Failed to evict keys for cache mode, but continue...");
+	}
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElement;
+	bool		is_expired;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(!GetAtomicElement(pCKIndex, hash, subhash, byKey, keylength, pElement, is_expired)){
+		return false;
+	}
+
+	if(!pElement || is_expired){
+		if(byExpected){
+			MSG_K2HPRN("The key is not found, thus not swapped.");
+			return true;
+		}
+		if(!SetAtomicValue(ALObjCKI, pCKIndex, pElement, hash, subhash, byKey, keylength, byNew, newlength)){
+			ERR_K2HPRN("Failed to set new value.");
+			return false;
+		}
+		is_swapped = true;
+		return true;
+	}
+	if(!byExpected || explength != pElement->vallength){
+		MSG_K2HPRN("The value is not same as expected, thus not swapped.");
+		return true;
+	}
+
+	// compare
+	unsigned char*	byValue = NULL;
+	if(static_cast<ssize_t>(explength) != Get(pElement, &byValue, PAGEOBJ_VALUE) || !byValue){
+		ERR_K2HPRN("Could not get value from element.");
+		K2H_Free(byValue);
+		return false;
+	}
+	bool	is_same = (0 == memcmp(byValue, byExpected, explength));
+	K2H_Free(byValue);
+	if(!is_same){
+		MSG_K2HPRN("The value is not same as expected, thus not swapped.");
+		return true;
+	}
+
+	// swap
+	if(newlength == pElement->vallength){
+		if(!WriteAtomicValue(ALObjCKI, pElement, byKey, keylength, byNew, newlength, 0L)){
+			ERR_K2HPRN("Failed to over-write value.");
+			return false;
+		}
+	}else{
+		// [NOTE]
+		// ReplacePage puts replacing value transaction and updates time.
+		//
+		if(!ReplacePage(pElement, byNew, newlength, PAGEOBJ_VALUE)){
+			ERR_K2HPRN("Failed to replace value.");
+			return false;
+		}
+		ALObjCKI.Unlock();							// Unlock
+		SetCacheReference(hash, false);
+	}
+	is_swapped = true;
+
+	return true;
+}
+
+//
+// Append data to the end of value.
+// If the key is not found(or expired), new key which has data is made.
+//
+bool K2HShm::Append(const unsigned char* byKey, size_t keylength, const unsigned char* byData, size_t datalength)
+{
+	if(!byKey || 0 == keylength || !byData || 0 == datalength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// evict keys before setting if cache mode
+	if(!CheckCacheEviction(keylength + datalength)){
+		WAN_K2HPRN("Failed to evict keys for cache mode, but continue...");
+	}
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElement;
+	bool		is_expired;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(!GetAtomicElement(pCKIndex, hash, subhash, byKey, keylength, pElement, is_expired)){
+		return false;
+	}
+
+	bool	result;
+	if(!pElement || is_expired){
+		result = SetAtomicValue(ALObjCKI, pCKIndex, pElement, hash, subhash, byKey, keylength, byData, datalength);
+	}else if(!pElement->value || 0UL == pElement->vallength){
+		// [NOTE]
+		// ReplacePage puts replacing value transaction and updates time.
+		//
+		if(true == (result = ReplacePage(pElement, byData, datalength, PAGEOBJ_VALUE))){
+			ALObjCKI.Unlock();						// Unlock
+			SetCacheReference(hash, false);
+		}
+	}else{
+		result = WriteAtomicValue(ALObjCKI, pElement, byKey, keylength, byData, datalength, static_cast<off_t>(pElement->vallength));
+	}
+	if(!result){
+		ERR_K2HPRN("Failed to append value.");
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
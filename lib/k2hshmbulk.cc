@@ -0,0 +1,234 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hpage.h"
+#include "k2hashfunc.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Methods for bulk loading
+//---------------------------------------------------------
+//
+// Returns page count which is needed for the data length.
+//
+unsigned long K2HShm::GetPageCount(size_t length) const
+{
+	if(!IsAttached() || pHead->page_size <= PAGEHEAD_SIZE || 0UL == length){
+		return 0UL;
+	}
+	size_t	datasize = pHead->page_size - PAGEHEAD_SIZE;
+	return static_cast<unsigned long>((length / datasize) + (0 == (length % datasize) ? 0 : 1));
+}
+
+//
+// Expands all areas before loading many records at once.
+//
+// [NOTE]
+// The cur_mask is increased until the average element count in each
+// collision key index is under half of max_element_count, because the
+// key index area is expanded when only one collision key index is over
+// max_element_count.
+// Element and page areas are reserved here by each area expanding unit,
+// then setting each record does not need to expand(and lock) areas.
+//
+bool K2HShm::PrepareBulkLoad(unsigned long record_count, unsigned long page_count)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// Key Index / Collision Key Index
+	{
+		K2HLock	ALObjCMask(ShmFd, Rel(&(pHead->cur_mask)), K2HLock::RWLOCK);		// LOCK
+
+		while(pHead->cur_mask < pHead->max_mask){
+			unsigned long	capacity = static_cast<unsigned long>(INIT_CKINDEX_CNT(K2HShm::GetMaskBitCount(pHead->cur_mask), K2HShm::GetMaskBitCount(pHead->collision_mask))) * (pHead->max_element_count / 2 + 1);
+			if(record_count <= capacity){
+				break;
+			}
+			if(IsSnapshotActive()){
+				WAN_K2HPRN("Now making snapshot, so could not increase Current mask(%p) for bulk loading.", reinterpret_cast<void*>(pHead->cur_mask));
+				break;
+			}
+			if(!ExpandKIndexArea(ALObjCMask)){
+				ERR_K2HPRN("Failed increasing Current mask(%p) for bulk loading.", reinterpret_cast<void*>(pHead->cur_mask));
+				return false;
+			}
+		}
+	}
+
+	// Elements
+	{
+		K2HLock	ALObjFEC(ShmFd, Rel(&(pHead->free_element_count)), K2HLock::RWLOCK);	// LOCK
+
+		while(pHead->free_element_count < 0 || static_cast<unsigned long>(pHead->free_element_count) < record_count){
+			if(!ExpandElementArea()){
+				ERR_K2HPRN("Failed to expand ELEMENT area for bulk loading.");
+				return false;
+			}
+		}
+	}
+
+	// Pages
+	{
+		K2HLock	ALObjFPC(ShmFd, Rel(&(pHead->free_page_count)), K2HLock::RWLOCK);		// LOCK
+
+		while(pHead->free_page_count < 0 || static_cast<unsigned long>(pHead->free_page_count) < page_count){
+			if(!ExpandPageArea()){
+				ERR_K2HPRN("Failed to expand PAGE area for bulk loading.");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//
+// Returns partition number for the hash value.
+//
+// The partition is decided by the range of key index position(masked hash
+// by cur_mask), thus each partition does not share any collision key index.
+// Then the threads which set keys in each partition are not blocked by
+// locking collision key index each other.
+//
+int K2HShm::GetBulkPartition(k2h_hash_t hash, int partcnt) const
+{
+	if(!IsAttached() || partcnt <= 1){
+		return 0;
+	}
+	k2h_hash_t	masked_hash = (hash >> K2HShm::GetMaskBitCount(pHead->collision_mask)) & pHead->cur_mask;
+	return static_cast<int>((masked_hash * static_cast<k2h_hash_t>(partcnt)) / (pHead->cur_mask + 1UL));
+}
+
+//
+// Set raw key/value/subkeys/attrs into k2hash for bulk loading.
+//
+// This method does not put transaction, does not make attributes(the attrs
+// binary is set as it is), does not make history and does not remove old
+// subkeys. If the key exists, the element is replaced by new one.
+// The new element is made before locking collision key index, so that the
+// period of locking is only for inserting element.
+//
+bool K2HShm::BulkSet(const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, const unsigned char* bySubKeys, size_t sklength, const unsigned char* byAttrs, size_t attrlength)
+{
+	if(!byKey || 0 == keylength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	// make new element
+	PELEMENT	pNewElement;
+	if(NULL == (pNewElement = AllocateElement(hash, subhash, byKey, keylength, byValue, vallength, bySubKeys, sklength, byAttrs, attrlength))){
+		ERR_K2HPRN("Failed to allocate new element and to set datas to it.");
+		return false;
+	}
+
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);		// LOCK
+	PCKINDEX	pCKIndex;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		FreeElement(pNewElement);
+		return false;
+	}
+
+	// take off old element
+	PELEMENT	pElementList;
+	PELEMENT	pOldElement = NULL;
+	if(NULL != (pElementList = GetElementList(pCKIndex, hash, subhash)) && NULL != (pOldElement = GetElement(pElementList, byKey, keylength))){
+		if(!TakeOffElement(pCKIndex, pOldElement)){
+			ERR_K2HPRN("Failed to take off element from ckey index.");
+			FreeElement(pNewElement);
+			return false;
+		}
+	}
+
+	// Insert new element
+	if(pCKIndex->element_list){
+		if(!InsertElement(static_cast<PELEMENT>(Abs(pCKIndex->element_list)), pNewElement)){
+			ERR_K2HPRN("Failed to insert element");
+			FreeElement(pNewElement);
+
+			// [NOTE]
+			// The old element is already taken off from ckey index, then it
+			// must be put back for keeping existed data.
+			//
+			if(pOldElement){
+				if(!InsertElement(static_cast<PELEMENT>(Abs(pCKIndex->element_list)), pOldElement)){
+					ERR_K2HPRN("Failed to put back old element into ckey index, so it is leaked.");
+					return false;
+				}
+				pCKIndex->element_count += 1UL;
+			}
+			return false;
+		}
+	}else{
+		pCKIndex->element_list = reinterpret_cast<PELEMENT>(Rel(pNewElement));
+	}
+	pCKIndex->element_count	+= 1UL;
+
+	ALObjCKI.Unlock();								// Unlock
+
+	// free old element(already taken off from ckey index, so do not need to lock)
+	if(pOldElement && !FreeElement(pOldElement)){
+		WAN_K2HPRN("Failed to free old element, but continue...");
+	}
+
+	if(!UpdateTimeval()){
+		WAN_K2HPRN("Failed to update timeval for data update.");
+	}
+
+	// check element count in ckey for increasing cur_mask(expanding key/ckey area)
+	if(!CheckExpandingKeyArea(pCKIndex)){			// Do not care for locking
+		ERR_K2HPRN("Something error occurred by checking/expanding key/ckey area.");
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,380 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+static inline bool k2h_has_cache_area(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, cache_evictions) + sizeof(uint64_t)) <= pExtra->length);
+}
+
+static inline bool k2h_is_cache_active(const PK2HEXTRA pExtra)
+{
+	return (k2h_has_cache_area(pExtra) && K2H_CACHE_ACTIVE == pExtra->cache_state);
+}
+
+//
+// The keys for subkeys directory chunk and expiry index are used by
+// k2hash library, they are not evicted.
+//
+static inline bool k2h_is_internal_key(const unsigned char* byKey, size_t keylength)
+{
+	if(!byKey){
+		return false;
+	}
+	if((sizeof(K2HSKDIR_CHUNK_PREFIX) - 1) <= keylength && 0 == memcmp(byKey, K2HSKDIR_CHUNK_PREFIX, sizeof(K2HSKDIR_CHUNK_PREFIX) - 1)){
+		return true;
+	}
+	if((sizeof(K2HEXPIRE_PREFIX) - 1) <= keylength && 0 == memcmp(byKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)){
+		return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------
+// Methods
+//---------------------------------------------------------
+// [NOTE]
+// Cache mode keeps the total size of k2hash around the limit by evicting
+// keys, it is useful when k2hash is used as cache shared by processes.
+// The limit is soft, because the areas are expanded when the free pages
+// are not enough after evicting or by other processes at same time.
+// All keys except the keys used by k2hash library can be evicted, then
+// queues should not be used in k2hash which is cache mode.
+//
+// The reference bitmap is made for collision key indexes at enabling, if
+// the key index is expanded after that, one reference unit includes some
+// collision key indexes.
+//
+bool K2HShm::EnableCache(size_t limit, long watermark)
+{
+	if(0 == limit || watermark <= 0L){
+		ERR_K2HPRN("Parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for cache mode.");
+		return false;
+	}
+	if(!k2h_has_cache_area(pExtra)){
+		ERR_K2HPRN("Extra area does not have cache mode area.");
+		return false;
+	}
+
+	K2HLock	ALObjCache(ShmFd, Rel(const_cast<long*>(&(pExtra->cache_state))), K2HLock::RWLOCK);	// LOCK
+	K2HLock	ALObjCMask(ShmFd, Rel(&(pHead->cur_mask)), K2HLock::RDLOCK);							// LOCK
+
+	k2h_hash_t	cache_mask		= K2HShm::MakeMask(K2HShm::GetMaskBitCount(pHead->cur_mask) + K2HShm::GetMaskBitCount(pHead->collision_mask));
+	size_t		bitmap_length	= static_cast<size_t>(cache_mask / 8) + 1;
+
+	// bitmap area(if the area is small, makes new area)
+	if(!pExtra->cache_bitmap || pExtra->cache_bitmap_length < bitmap_length){
+		size_t	area_length		= ALIGNMENT(bitmap_length, K2HShm::SystemPageSize);
+		off_t	new_area_start	= 0L;
+		if(NULL == ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)){
+			ERR_K2HPRN("Could not expand bitmap area for cache mode.");
+			return false;
+		}
+		pExtra->cache_bitmap		= reinterpret_cast<unsigned char*>(new_area_start);
+		pExtra->cache_bitmap_length	= area_length;
+	}
+	unsigned char*	pBitmap;
+	if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->cache_bitmap)))){
+		ERR_K2HPRN("Could not get cache bitmap area.");
+		return false;
+	}
+
+	// [NOTE]
+	// All units are referenced at starting, so that the keys which are
+	// already set are not evicted before other keys.
+	//
+	memset(pBitmap, 0xFF, pExtra->cache_bitmap_length);
+
+	pExtra->cache_limit			= limit;
+	pExtra->cache_watermark		= watermark;
+	pExtra->cache_mask			= cache_mask;
+	pExtra->cache_hand			= 0;
+	pExtra->cache_hits			= 0;
+	pExtra->cache_misses		= 0;
+	pExtra->cache_evictions		= 0;
+	__sync_synchronize();
+	pExtra->cache_state			= K2H_CACHE_ACTIVE;
+
+	return true;
+}
+
+bool K2HShm::DisableCache(void)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_cache_area(pExtra)){
+		return true;
+	}
+	K2HLock	ALObjCache(ShmFd, Rel(const_cast<long*>(&(pExtra->cache_state))), K2HLock::RWLOCK);	// LOCK
+	pExtra->cache_state	= K2H_CACHE_NONE;
+
+	return true;
+}
+
+bool K2HShm::IsCacheMode(void) const
+{
+	return k2h_is_cache_active(GetExtraArea());
+}
+
+//
+// Set reference bit for the unit of hash, and count hit if reading.
+//
+// [NOTE]
+// The bit is read before setting, because writing shared cache line for
+// each reading costs.
+//
+void K2HShm::SetCacheReference(k2h_hash_t hash, bool is_read) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_cache_active(pExtra)){
+		return;
+	}
+	if(is_read){
+		__sync_add_and_fetch(&(pExtra->cache_hits), 1);
+	}
+
+	unsigned char*	pBitmap;
+	if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->cache_bitmap)))){
+		// bitmap area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->cache_bitmap)))){
+			return;
+		}
+	}
+	k2h_hash_t		unit	= hash & pExtra->cache_mask;
+	size_t			bytepos	= static_cast<size_t>(unit / 8);
+	unsigned char	bitval	= static_cast<unsigned char>(1 << (unit % 8));
+	if(bytepos < pExtra->cache_bitmap_length && 0 == (pBitmap[bytepos] & bitval)){
+		__sync_fetch_and_or(&pBitmap[bytepos], bitval);
+	}
+}
+
+void K2HShm::CountCacheMiss(void) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_cache_active(pExtra)){
+		return;
+	}
+	__sync_add_and_fetch(&(pExtra->cache_misses), 1);
+}
+
+//
+// Evict keys before setting the key which needs length bytes, if the
+// total size(all areas) is over the limit and free pages are under the
+// watermark.
+//
+// [NOTE]
+// This method is called before locking any collision key index, and
+// the hand walks units up to twice, because the first walking may only
+// clear reference bits.
+//
+bool K2HShm::CheckCacheEviction(size_t length)
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_cache_active(pExtra) || static_cast<size_t>(pHead->unassign_area) < pExtra->cache_limit){
+		return true;
+	}
+	long	needpages = pExtra->cache_watermark + static_cast<long>(GetPageCount(length));
+	if(needpages <= pHead->free_page_count && 0L < pHead->free_element_count){
+		return true;
+	}
+
+	unsigned char*	pBitmap;
+	if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->cache_bitmap)))){
+		// bitmap area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(this);
+		if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->cache_bitmap)))){
+			ERR_K2HPRN("Could not get cache bitmap area.");
+			return false;
+		}
+	}
+	k2h_hash_t	cache_mask	= pExtra->cache_mask;
+	long		evicted		= 0L;
+	for(k2h_hash_t walked = 0UL; walked <= (cache_mask * 2 + 1) && (pHead->free_page_count < needpages || pHead->free_element_count <= 0L); ++walked){
+		k2h_hash_t		unit	= static_cast<k2h_hash_t>(__sync_fetch_and_add(&(pExtra->cache_hand), 1)) & cache_mask;
+		size_t			bytepos	= static_cast<size_t>(unit / 8);
+		unsigned char	bitval	= static_cast<unsigned char>(1 << (unit % 8));
+		if(pExtra->cache_bitmap_length <= bytepos){
+			ERR_K2HPRN("Cache unit(%" PRIu64 ") is over bitmap area length(%zu).", unit, pExtra->cache_bitmap_length);
+			return false;
+		}
+		if(0 != (pBitmap[bytepos] & bitval)){
+			// second chance
+			__sync_fetch_and_and(&pBitmap[bytepos], static_cast<unsigned char>(~bitval));
+			continue;
+		}
+		if(!EvictCacheUnit(unit, cache_mask, evicted)){
+			WAN_K2HPRN("Failed to evict keys in cache unit(%" PRIu64 "), but continue...", unit);
+		}
+	}
+	if(0L < evicted){
+		__sync_add_and_fetch(&(pExtra->cache_evictions), static_cast<uint64_t>(evicted));
+		MSG_K2HPRN("Evicted %ld keys for cache mode.", evicted);
+	}
+	return true;
+}
+
+//
+// Evict all keys in the unit.
+//
+// [NOTE]
+// If the key index is expanded after enabling cache mode, the unit has
+// some collision key indexes and these are evicted one by one. Keys are
+// taken off while the collision key index is locked, and removed after
+// unlocking as same as removing key. Subkeys are not removed, and the
+// history is not made.
+//
+bool K2HShm::EvictCacheUnit(k2h_hash_t unit, k2h_hash_t cache_mask, long& evicted)
+{
+	k2h_hash_t	all_mask = K2HShm::MakeMask(K2HShm::GetMaskBitCount(pHead->cur_mask) + K2HShm::GetMaskBitCount(pHead->collision_mask));
+	bool		result	 = true;
+
+	for(k2h_hash_t hash = unit; hash <= all_mask; hash += (cache_mask + 1)){
+		K2HLock		ALObjCKI(K2HLock::RWLOCK);		// LOCK
+		PCKINDEX	pCKIndex;
+		if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+			ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+			result = false;
+			continue;
+		}
+
+		// pick up elements
+		vector<PELEMENT>			elements;
+		vector<PELEMENT>			stack;
+		vector<unsigned char*>		subkeys;
+		vector<size_t>				sklengths;
+		if(pCKIndex->element_list){
+			stack.push_back(static_cast<PELEMENT>(Abs(pCKIndex->element_list)));
+		}
+		while(!stack.empty()){
+			PELEMENT	pElement = stack.back();
+			stack.pop_back();
+			if(!pElement){
+				ERR_K2HPRN("Element in collision key index is NULL.");
+				result = false;
+				break;
+			}
+			if(pElement->small){
+				stack.push_back(static_cast<PELEMENT>(Abs(pElement->small)));
+			}
+			if(pElement->big){
+				stack.push_back(static_cast<PELEMENT>(Abs(pElement->big)));
+			}
+			if(pElement->same){
+				stack.push_back(static_cast<PELEMENT>(Abs(pElement->same)));
+			}
+			if(unit != (pElement->hash & cache_mask)){
+				continue;
+			}
+			unsigned char*	byKey	= NULL;
+			ssize_t			keylen;
+			if(-1 == (keylen = Get(pElement, &byKey, PAGEOBJ_KEY)) || !byKey || k2h_is_internal_key(byKey, static_cast<size_t>(keylen))){
+				K2H_Free(byKey);
+				continue;
+			}
+			K2H_Free(byKey);
+
+			// get(keep) subkeys binary for chunk keys
+			unsigned char*	bySubkeys	= NULL;
+			ssize_t			sklength	= 0;
+			if(pElement->subkeys && (0 >= (sklength = Get(pElement, &bySubkeys, PAGEOBJ_SUBKEYS)) || !bySubkeys)){
+				K2H_Free(bySubkeys);
+				sklength = 0;
+			}
+			elements.push_back(pElement);
+			subkeys.push_back(bySubkeys);
+			sklengths.push_back(static_cast<size_t>(sklength));
+		}
+
+		// take off elements
+		for(size_t pos = 0; pos < elements.size(); ++pos){
+			if(!TakeOffElement(pCKIndex, elements[pos])){
+				ERR_K2HPRN("Failed to take off element from ckey index.");
+				elements[pos] = NULL;
+				result = false;
+			}
+		}
+		ALObjCKI.Unlock();							// Unlock
+
+		// remove keys
+		bool	is_check_updated = true;
+		for(size_t pos = 0; pos < elements.size(); ++pos){
+			if(elements[pos]){
+				if(!RemoveEx(elements[pos], NULL, is_check_updated)){
+					ERR_K2HPRN("Failed to remove evicted key.");
+					result = false;
+				}else{
+					if(subkeys[pos]){
+						RemoveSubKeysChunks(subkeys[pos], sklengths[pos], NULL, 0UL);
+					}
+					++evicted;
+				}
+			}
+			K2H_Free(subkeys[pos]);
+		}
+	}
+	return result;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -30,6 +30,7 @@
 #include "k2hpagefile.h"
 #include "k2hpagemem.h"
 #include "k2hshmupdater.h"
+#include "k2hcompactor.h"
 #include "k2hutil.h"
 #include "k2hdbg.h"
 
@@ -41,6 +42,7 @@ using namespace std;
 //
 // Returns lastest area.
 // But if it is K2H_AREA_PAGELIST and K2H_AREA_PAGE, returns not lastest area.
+// If it is K2H_AREA_EXTRA, returns NULL because it can not be removed.
 // K2H_AREA_PAGELIST and K2H_AREA_PAGE must be over one area.
 //
 PK2HAREA K2HShm::GetLastestArea(void) const
@@ -53,6 +55,11 @@ PK2HAREA K2HShm::GetLastestArea(void) const
 	// mmap loop for all index area
 	for(int nCnt = MAX_K2HAREA_COUNT; 0 < nCnt; nCnt--){
 		if(K2H_AREA_UNKNOWN != (pHead->areas[nCnt - 1]).type){
+			// extra area is pointed from head, so it can not be removed.
+			if(K2H_AREA_EXTRA == (pHead->areas[nCnt - 1]).type){
+				MSG_K2HPRN("### type = %ld is extra area in k2hash, so it can not be removed.", (pHead->areas[nCnt - 1]).type);
+				return NULL;
+			}
 			// check same area for PAGELIST and PAGE
 			if(K2H_AREA_PAGELIST == (pHead->areas[nCnt - 1]).type || K2H_AREA_PAGE == (pHead->areas[nCnt - 1]).type){
 				bool	isfound = false;
@@ -115,6 +122,12 @@ bool K2HShm::PrintAreaInfo(void) const
 				}
 				strType += "PAGE";
 			}
+			if(K2H_AREA_EXTRA == ((pHead->areas[nCnt]).type & K2H_AREA_EXTRA)){
+				if(strType.length()){
+					strType += ",";
+				}
+				strType += "EXTRA";
+			}
 		}
 		fprintf(stdout, "    No.%d\ttype = %s AREA(%ld),\tfile offset=%jd,\tarea length=%zu\n", nCnt + 1, strType.c_str(), (pHead->areas[nCnt]).type, static_cast<intmax_t>((pHead->areas[nCnt]).file_offset), (pHead->areas[nCnt]).length);
 	}
@@ -901,6 +914,41 @@ bool K2HShm::AreaCompress(bool& isCompressed)
 		return true;
 	}
 
+	// free lastest area
+	bool	is_need_check = false;
+	if(!FreeLastestArea(pLastestArea, is_need_check)){
+		ERR_K2HPRN("Could not free lastest area.");
+		return false;
+	}
+	isCompressed = true;
+
+	ALObjUnArea.Unlock();					// UNLOCK
+
+	// need to check area update
+	if(is_need_check){
+		if(!DoAreaUpdate()){
+			ERR_K2HPRN("Something error occurred during updating area information, but continue...");
+		}
+	}
+	return true;
+}
+
+//
+// Unmap and truncate lastest area which does not have any used entry.
+//
+// [NOTICE]
+// must lock unassign_area before calling this method.
+//
+bool K2HShm::FreeLastestArea(PK2HAREA pLastestArea, bool& is_need_check)
+{
+	if(!pLastestArea){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	long	type		= pLastestArea->type;
+	off_t	ExpOffset	= pLastestArea->file_offset;
+	size_t	ExpLength	= pLastestArea->length;
+
 	// munmap lastest area
 	if(isFullMapping || K2H_AREA_PAGE != type){
 		if(!MmapInfos.Unmap(type, ExpOffset, ExpLength)){
@@ -915,7 +963,7 @@ bool K2HShm::AreaCompress(bool& isCompressed)
 	pLastestArea->length		= 0UL;
 
 	// set notice area update by monitor file
-	bool	is_need_check = false;
+	is_need_check = false;
 	if(!FileMon.UpdateArea(is_need_check)){
 		WAN_K2HPRN("Failed to update area notice throw monitor file, but continue...");
 	}
@@ -925,9 +973,774 @@ bool K2HShm::AreaCompress(bool& isCompressed)
 		ERR_K2HPRN("Could not truncate file, errno = %d", errno);
 		return false;
 	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Area Compress by steps(online)
+//---------------------------------------------------------
+// [NOTE]
+// AreaCompressStep() compresses the lastest area by small steps, it can
+// be called while other processes(threads) read and write k2hash.
+// Each step relocates at most max_count entries, and locks only one
+// collision key index at a time for relocating one element(or pages in
+// one element). Thus writers are not stopped for long time.
+//
+// The entries in the target area which are not used(free entries and
+// relocated entries) are taken off from free list and chained into the
+// "fence" list, then writers never reuse them. The fence list is anchored
+// in the target area itself:
+//	ELEMENT area :	The anchor element has parent pointer to itself, same
+//					pointer is the top of fence list, and vallength is the
+//					count of fenced elements(including the anchor).
+//	PAGE area    :	The anchor page has prev pointer to itself, next pointer
+//					is the top of fence list, and length is the count of
+//					fenced pages(including the anchor).
+// Because the fence list is in k2hash, fenced entries are not lost if
+// the compactor process dies. The next compactor finds the anchor and
+// continues, or puts fenced entries back when the target area is changed.
+// When all entries in the target area are fenced, the area is removed
+// as same as AreaCompress().
+//
+// [NOTICE]
+// Same as AreaCompress(), the areas before EXTRA area can not be removed.
+// Only one compactor works at the same time, the pHead->last_area_update
+// offset is used for this exclusive lock.
+//
+static inline bool is_in_compact_area(const void* pRelAddress, const K2HCOMPACTCURSOR& cursor)
+{
+	off_t	offset = reinterpret_cast<off_t>(pRelAddress);
+	return (cursor.area_offset <= offset && offset < (cursor.area_offset + static_cast<off_t>(cursor.area_length)));
+}
+
+static inline unsigned long get_compact_area_count(const K2HCOMPACTCURSOR& cursor, size_t pagesize)
+{
+	return static_cast<unsigned long>(cursor.area_length / (K2H_AREA_PAGELIST == cursor.area_type ? sizeof(ELEMENT) : pagesize));
+}
+
+bool K2HShm::IsCompactAnchor(const K2HCOMPACTCURSOR& cursor) const
+{
+	if(!cursor.anchor || !is_in_compact_area(cursor.anchor, cursor)){
+		return false;
+	}
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		const PELEMENT	pAnchor = static_cast<PELEMENT>(Abs(cursor.anchor));
+		return (pAnchor && pAnchor->parent == reinterpret_cast<PELEMENT>(cursor.anchor));
+	}
+
+	K2HPage*	pAnchor;
+	PAGEHEAD	AnchorHead;
+	if(NULL == (pAnchor = GetPageObject(reinterpret_cast<PPAGEHEAD>(cursor.anchor), false))){
+		return false;
+	}
+	bool	result = (pAnchor->GetPageHead(&AnchorHead) && AnchorHead.prev == reinterpret_cast<PPAGEHEAD>(cursor.anchor));
+	K2H_Delete(pAnchor);
+
+	return result;
+}
+
+unsigned long K2HShm::GetCompactFenceCount(const K2HCOMPACTCURSOR& cursor) const
+{
+	if(!cursor.anchor){
+		return 0UL;
+	}
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		const PELEMENT	pAnchor = static_cast<PELEMENT>(Abs(cursor.anchor));
+		return (pAnchor ? static_cast<unsigned long>(pAnchor->vallength) : 0UL);
+	}
+
+	K2HPage*	pAnchor;
+	PAGEHEAD	AnchorHead;
+	if(NULL == (pAnchor = GetPageObject(reinterpret_cast<PPAGEHEAD>(cursor.anchor), false))){
+		return 0UL;
+	}
+	unsigned long	count = (pAnchor->GetPageHead(&AnchorHead) ? static_cast<unsigned long>(AnchorHead.length) : 0UL);
+	K2H_Delete(pAnchor);
+
+	return count;
+}
+
+//
+// Search the anchor of fence list in target area, and recount fenced entries.
+// The anchor is left by the compactor which was stopped(or died) before.
+//
+bool K2HShm::FindCompactAnchor(K2HCOMPACTCURSOR& cursor)
+{
+	cursor.anchor = NULL;
+
+	unsigned long	area_count = get_compact_area_count(cursor, GetPageSize());
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		PELEMENT	pTopElement;
+		if(NULL == (pTopElement = static_cast<PELEMENT>(Abs(reinterpret_cast<void*>(cursor.area_offset))))){
+			ERR_K2HPRN("Could not get target element area address.");
+			return false;
+		}
+		for(unsigned long cnt = 0; cnt < area_count; ++cnt){
+			PELEMENT	pRelElement = ADDPTR(reinterpret_cast<PELEMENT>(cursor.area_offset), static_cast<off_t>(cnt * sizeof(ELEMENT)));
+			if(pTopElement[cnt].parent != pRelElement){
+				continue;
+			}
+			// found anchor, recount
+			size_t	count = 1UL;
+			for(PELEMENT pElement = static_cast<PELEMENT>(Abs(pTopElement[cnt].same)); pElement; pElement = static_cast<PELEMENT>(Abs(pElement->same))){
+				++count;
+			}
+			pTopElement[cnt].vallength	= count;
+			cursor.anchor				= pRelElement;
+			break;
+		}
+	}else{
+		PAGEHEAD	CurPageHead;
+		for(unsigned long cnt = 0; cnt < area_count; ++cnt){
+			PPAGEHEAD	pRelPageHead = reinterpret_cast<PPAGEHEAD>(cursor.area_offset + static_cast<off_t>(cnt * GetPageSize()));
+			K2HPage*	pPage;
+			if(NULL == (pPage = GetPageObject(pRelPageHead, false)) || !pPage->GetPageHead(&CurPageHead)){
+				ERR_K2HPRN("Could not get page head in target page area.");
+				K2H_Delete(pPage);
+				return false;
+			}
+			if(CurPageHead.prev != pRelPageHead){
+				K2H_Delete(pPage);
+				continue;
+			}
+			// found anchor, recount
+			size_t		count = 1UL;
+			PAGEHEAD	FencePageHead;
+			for(PPAGEHEAD pRelFence = CurPageHead.next; pRelFence; pRelFence = FencePageHead.next){
+				K2HPage*	pFence;
+				if(NULL == (pFence = GetPageObject(pRelFence, false)) || !pFence->GetPageHead(&FencePageHead)){
+					ERR_K2HPRN("Could not get fenced page head in target page area.");
+					K2H_Delete(pFence);
+					K2H_Delete(pPage);
+					return false;
+				}
+				K2H_Delete(pFence);
+				++count;
+			}
+			if(!pPage->SetPageHead(K2HPage::SETHEAD_LENGTH, NULL, NULL, count)){
+				ERR_K2HPRN("Could not set fenced page count to anchor.");
+				K2H_Delete(pPage);
+				return false;
+			}
+			K2H_Delete(pPage);
+			cursor.anchor = pRelPageHead;
+			break;
+		}
+	}
+	return true;
+}
+
+//
+// Chain one element in target area into fence list.
+//
+bool K2HShm::FenceCompactElement(K2HCOMPACTCURSOR& cursor, PELEMENT pElement)
+{
+	if(!pElement){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	PELEMENT	pRelElement = reinterpret_cast<PELEMENT>(Rel(pElement));
+	if(!is_in_compact_area(pRelElement, cursor)){
+		ERR_K2HPRN("Element(%p) is not in target area.", pRelElement);
+		return false;
+	}
+	pElement->small		= NULL;
+	pElement->big		= NULL;
+	pElement->hash		= 0UL;
+	pElement->subhash	= 0UL;
+	pElement->key		= NULL;
+	pElement->value		= NULL;
+	pElement->subkeys	= NULL;
+	pElement->attrs		= NULL;
+	pElement->keylength	= 0UL;
+	pElement->skeylength= 0UL;
+	pElement->attrlength= 0UL;
+
+	if(!cursor.anchor){
+		// this element is anchor
+		pElement->same		= NULL;
+		pElement->vallength	= 1UL;
+		pElement->parent	= pRelElement;			// marker of anchor
+		cursor.anchor		= pRelElement;
+	}else{
+		PELEMENT	pAnchor;
+		if(NULL == (pAnchor = static_cast<PELEMENT>(Abs(cursor.anchor)))){
+			ERR_K2HPRN("Could not get anchor element.");
+			return false;
+		}
+		pElement->parent	= NULL;
+		pElement->vallength	= 0UL;
+		pElement->same		= pAnchor->same;
+		pAnchor->same		= pRelElement;
+		pAnchor->vallength	+= 1UL;
+	}
+	return true;
+}
+
+//
+// Chain one page in target area into fence list.
+//
+bool K2HShm::FenceCompactPage(K2HCOMPACTCURSOR& cursor, PPAGEHEAD pRelPageHead)
+{
+	if(!pRelPageHead){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!is_in_compact_area(pRelPageHead, cursor)){
+		ERR_K2HPRN("Page(%p) is not in target area.", pRelPageHead);
+		return false;
+	}
+	K2HPage*	pPage;
+	if(NULL == (pPage = GetPageObject(pRelPageHead, false))){
+		ERR_K2HPRN("Could not make page object.");
+		return false;
+	}
+
+	if(!cursor.anchor){
+		// this page is anchor
+		if(!pPage->SetPageHead(K2HPage::SETHEAD_PREV | K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, pRelPageHead, NULL, 1UL)){
+			ERR_K2HPRN("Could not set anchor page head.");
+			K2H_Delete(pPage);
+			return false;
+		}
+		cursor.anchor = pRelPageHead;
+	}else{
+		K2HPage*	pAnchor;
+		PAGEHEAD	AnchorHead;
+		if(NULL == (pAnchor = GetPageObject(reinterpret_cast<PPAGEHEAD>(cursor.anchor), false)) || !pAnchor->GetPageHead(&AnchorHead)){
+			ERR_K2HPRN("Could not get anchor page head.");
+			K2H_Delete(pAnchor);
+			K2H_Delete(pPage);
+			return false;
+		}
+		if(	!pPage->SetPageHead(K2HPage::SETHEAD_PREV | K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, AnchorHead.next, 0UL)	||
+			!pAnchor->SetPageHead(K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, pRelPageHead, AnchorHead.length + 1UL)		)
+		{
+			ERR_K2HPRN("[FATAL] Could not set page head for fence list, this page is leaked!!!");
+			K2H_Delete(pAnchor);
+			K2H_Delete(pPage);
+			return false;
+		}
+		K2H_Delete(pAnchor);
+	}
+	K2H_Delete(pPage);
+
+	return true;
+}
+
+//
+// Count or fence free entries in target area.
+//
+// [NOTICE]
+// must lock free_element_count(or free_page_count) before calling this method.
+//
+bool K2HShm::FenceCompactFreeEntries(K2HCOMPACTCURSOR& cursor, unsigned long* pcount, bool is_count_only)
+{
+	unsigned long	count = 0UL;
+
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		PELEMENT	pRelNext;
+		for(PELEMENT pRelElement = pHead->pfree_elements; pRelElement; pRelElement = pRelNext){
+			PELEMENT	pElement;
+			if(NULL == (pElement = static_cast<PELEMENT>(Abs(pRelElement)))){
+				ERR_K2HPRN("Found broken free element list.");
+				return false;
+			}
+			pRelNext = pElement->same;
+
+			if(!is_in_compact_area(pRelElement, cursor)){
+				continue;
+			}
+			++count;
+			if(is_count_only){
+				continue;
+			}
+
+			// cut off current element from free list
+			PELEMENT	pPrevElement = static_cast<PELEMENT>(Abs(pElement->parent));
+			PELEMENT	pNextElement = static_cast<PELEMENT>(Abs(pRelNext));
+			if(pPrevElement){
+				pPrevElement->same = pRelNext;
+			}else{
+				pHead->pfree_elements = pRelNext;
+			}
+			if(pNextElement){
+				pNextElement->parent = pElement->parent;
+			}
+			if(0 < pHead->free_element_count){
+				pHead->free_element_count -= 1UL;
+			}
+
+			if(!FenceCompactElement(cursor, pElement)){
+				ERR_K2HPRN("[FATAL] Could not fence free element, this element is leaked!!!");
+				return false;
+			}
+		}
+	}else{
+		PAGEHEAD	CurPageHead;
+		PPAGEHEAD	pRelNext;
+		for(PPAGEHEAD pRelCurPageHead = pHead->pfree_pages; pRelCurPageHead; pRelCurPageHead = pRelNext){
+			K2HPage*	pCurPage;
+			if(NULL == (pCurPage = GetPageObject(pRelCurPageHead, false)) || !pCurPage->GetPageHead(&CurPageHead)){
+				ERR_K2HPRN("Found broken free page list.");
+				K2H_Delete(pCurPage);
+				return false;
+			}
+			K2H_Delete(pCurPage);
+			pRelNext = CurPageHead.next;
+
+			if(!is_in_compact_area(pRelCurPageHead, cursor)){
+				continue;
+			}
+			++count;
+			if(is_count_only){
+				continue;
+			}
+
+			// cut off current page from free list
+			if(NULL == (pCurPage = CutOffPage(pRelCurPageHead, &(pHead->pfree_pages), NULL))){
+				ERR_K2HPRN("[FATAL] Could not cut off a page, some page objects are leaked!!!");
+				return false;
+			}
+			K2H_Delete(pCurPage);
+			if(0L < pHead->free_page_count){
+				pHead->free_page_count--;
+			}
+
+			if(!FenceCompactPage(cursor, pRelCurPageHead)){
+				ERR_K2HPRN("[FATAL] Could not fence free page, this page is leaked!!!");
+				return false;
+			}
+		}
+	}
+	if(pcount){
+		*pcount = count;
+	}
+	return true;
+}
+
+//
+// Put back all fenced entries to free list.
+//
+// [NOTICE]
+// Fenced entries are put back one by one from the next of anchor, and
+// the anchor is put back at last. Thus if this process dies in this
+// method, only one entry is leaked at most.
+//
+bool K2HShm::UnfenceCompactArea(K2HCOMPACTCURSOR& cursor)
+{
+	if(!cursor.anchor){
+		return true;
+	}
+	if(!IsCompactAnchor(cursor)){
+		WAN_K2HPRN("Anchor(%p) of fenced entries is not found, probably another compactor already put back them.", cursor.anchor);
+		cursor.anchor = NULL;
+		return true;
+	}
+
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		PELEMENT	pAnchor = static_cast<PELEMENT>(Abs(cursor.anchor));
+		while(pAnchor->same){
+			PELEMENT	pElement;
+			if(NULL == (pElement = static_cast<PELEMENT>(Abs(pAnchor->same)))){
+				ERR_K2HPRN("[FATAL] Found broken fence list, some elements are leaked!!!");
+				return false;
+			}
+			pAnchor->same = pElement->same;
+			if(1UL < pAnchor->vallength){
+				pAnchor->vallength -= 1UL;
+			}
+			if(!PutBackElement(pElement)){
+				ERR_K2HPRN("[FATAL] Failed to putback element, this element is leaked!!!");
+			}
+		}
+		pAnchor->vallength = 0UL;
+		if(!PutBackElement(pAnchor)){
+			ERR_K2HPRN("[FATAL] Failed to putback anchor element, this element is leaked!!!");
+			return false;
+		}
+	}else{
+		K2HPage*	pAnchor;
+		PAGEHEAD	AnchorHead;
+		if(NULL == (pAnchor = GetPageObject(reinterpret_cast<PPAGEHEAD>(cursor.anchor), false))){
+			ERR_K2HPRN("Could not make anchor page object.");
+			return false;
+		}
+		while(pAnchor->GetPageHead(&AnchorHead) && AnchorHead.next){
+			PPAGEHEAD	pRelPageHead = AnchorHead.next;
+			K2HPage*	pPage;
+			PAGEHEAD	PageHead;
+			if(NULL == (pPage = GetPageObject(pRelPageHead, false)) || !pPage->GetPageHead(&PageHead)){
+				ERR_K2HPRN("[FATAL] Found broken fence list, some pages are leaked!!!");
+				K2H_Delete(pPage);
+				K2H_Delete(pAnchor);
+				return false;
+			}
+			if(	!pAnchor->SetPageHead(K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, PageHead.next, (1UL < AnchorHead.length ? AnchorHead.length - 1UL : 1UL))	||
+				!pPage->SetPageHead(K2HPage::SETHEAD_PREV | K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, NULL, 0UL)											)
+			{
+				ERR_K2HPRN("[FATAL] Could not set page head for fence list, some pages are leaked!!!");
+				K2H_Delete(pPage);
+				K2H_Delete(pAnchor);
+				return false;
+			}
+			K2H_Delete(pPage);
+
+			if(!PutBackPages(pRelPageHead, pRelPageHead, 1UL)){
+				ERR_K2HPRN("[FATAL] Failed to putback page, this page is leaked!!!");
+			}
+		}
+		if(!pAnchor->SetPageHead(K2HPage::SETHEAD_PREV | K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, NULL, 0UL)){
+			ERR_K2HPRN("[FATAL] Could not set anchor page head, this page is leaked!!!");
+			K2H_Delete(pAnchor);
+			return false;
+		}
+		K2H_Delete(pAnchor);
+
+		if(!PutBackPages(reinterpret_cast<PPAGEHEAD>(cursor.anchor), reinterpret_cast<PPAGEHEAD>(cursor.anchor), 1UL)){
+			ERR_K2HPRN("[FATAL] Failed to putback anchor page, this page is leaked!!!");
+			return false;
+		}
+	}
+	cursor.anchor = NULL;
+
+	return true;
+}
+
+//
+// Check the element is linked in collision key index.
+//
+// [NOTICE]
+// The element which has key is not always linked, because writers
+// make new element before locking collision key index.
+// must lock ckindex before calling this method.
+//
+bool K2HShm::IsCompactLinkedElement(PCKINDEX pCKIndex, PELEMENT pElement) const
+{
+	if(!pCKIndex || !pElement || !pElement->key){
+		return false;
+	}
+	PELEMENT	pRelElement	= reinterpret_cast<PELEMENT>(Rel(pElement));
+	PELEMENT	pParent		= static_cast<PELEMENT>(Abs(pElement->parent));
+	if(pParent){
+		return (pParent->small == pRelElement || pParent->big == pRelElement || pParent->same == pRelElement);
+	}
+	return (pCKIndex->element_list == pRelElement);
+}
+
+//
+// Prepare target area for starting to compress.
+//
+// Check the free entries outside target area are enough for moving
+// all used entries in target area. If it is not enough, the writers
+// will expand a new area soon, so this does not start to compress.
+//
+bool K2HShm::StartCompactArea(K2HCOMPACTCURSOR& cursor, bool& isStarted)
+{
+	isStarted = false;
+
+	// anchor which is left by previous compactor
+	if(!FindCompactAnchor(cursor)){
+		ERR_K2HPRN("Something error occurred in searching anchor in target area.");
+		return false;
+	}
+
+	bool	is_pagelist = (K2H_AREA_PAGELIST == cursor.area_type);
+	K2HLock	ALObjFree(ShmFd, Rel(is_pagelist ? static_cast<void*>(&(pHead->free_element_count)) : static_cast<void*>(&(pHead->free_page_count))), K2HLock::RWLOCK);	// LOCK
+
+	unsigned long	free_count = 0UL;
+	if(!FenceCompactFreeEntries(cursor, &free_count, true)){
+		ERR_K2HPRN("Something error occurred in counting free entries in target area.");
+		return false;
+	}
+	unsigned long	area_count	= get_compact_area_count(cursor, GetPageSize());
+	unsigned long	fence_count	= GetCompactFenceCount(cursor);
+	unsigned long	used_count	= ((free_count + fence_count) < area_count ? (area_count - free_count - fence_count) : 0UL);
+	unsigned long	all_free	= static_cast<unsigned long>(is_pagelist ? pHead->free_element_count : pHead->free_page_count);
+	unsigned long	outside		= (free_count < all_free ? (all_free - free_count) : 0UL);
+
+	// [NOTE]
+	// Keeps the half of free entries outside target area for writers.
+	//
+	if(outside < (used_count * 2)){
+		ALObjFree.Unlock();															// UNLOCK
+
+		MSG_K2HPRN("There are not enough free entries(%lu) outside lastest area for moving used entries(%lu), so stop compressing.", outside, used_count);
+		if(!UnfenceCompactArea(cursor)){
+			WAN_K2HPRN("Failed to put back fenced entries, but continue...");
+		}
+		return true;
+	}
+
+	// fence all free entries in target area
+	if(!FenceCompactFreeEntries(cursor, NULL, false)){
+		ERR_K2HPRN("Something error occurred in fencing free entries in target area.");
+		return false;
+	}
+	cursor.next		= NULL;
+	cursor.moved	= 0UL;
+	isStarted		= true;
+
+	return true;
+}
+
+//
+// Relocate one element in target element area.
+//
+// New element is reserved before locking ckindex, and the element is
+// checked after locking because it might be removed(or moved).
+//
+bool K2HShm::RelocateElement(K2HCOMPACTCURSOR& cursor, PELEMENT pElement)
+{
+	if(!pElement){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!pElement->key){
+		// free, fenced or reserving element
+		return true;
+	}
+	k2h_hash_t	hash		= pElement->hash;
+	PELEMENT	pRelElement	= reinterpret_cast<PELEMENT>(Rel(pElement));
+
+	// reserve new element
+	PELEMENT	pNewElement;
+	if(NULL == (pNewElement = ReserveElement(reinterpret_cast<void*>(cursor.area_offset), cursor.area_length))){
+		MSG_K2HPRN("Could not get new element.(ex: no left space)");
+		return false;
+	}
+
+	// lock ckindex
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Could not get ckindex.");
+		if(!PutBackElement(pNewElement)){
+			ERR_K2HPRN("[FATAL] Failed to putback element, this element is leaked!!!");
+		}
+		return false;
+	}
+
+	// recheck after locking
+	if(hash != pElement->hash || !IsCompactLinkedElement(pCKIndex, pElement)){
+		ALObjCKI.Unlock();							// UNLOCK
+		if(!PutBackElement(pNewElement)){
+			ERR_K2HPRN("[FATAL] Failed to putback element, this element is leaked!!!");
+		}
+		return true;
+	}
+
+	// copy
+	pNewElement->small		= pElement->small;
+	pNewElement->big		= pElement->big;
+	pNewElement->parent		= pElement->parent;
+	pNewElement->same		= pElement->same;
+	pNewElement->hash		= pElement->hash;
+	pNewElement->subhash	= pElement->subhash;
+	pNewElement->key		= pElement->key;
+	pNewElement->value		= pElement->value;
+	pNewElement->subkeys	= pElement->subkeys;
+	pNewElement->attrs		= pElement->attrs;
+	pNewElement->keylength	= pElement->keylength;
+	pNewElement->vallength	= pElement->vallength;
+	pNewElement->skeylength	= pElement->skeylength;
+	pNewElement->attrlength	= pElement->attrlength;
+
+	// change list
+	PELEMENT	pRelNew	= reinterpret_cast<PELEMENT>(Rel(pNewElement));
+	PELEMENT	pSmall	= static_cast<PELEMENT>(Abs(pElement->small));
+	PELEMENT	pBig	= static_cast<PELEMENT>(Abs(pElement->big));
+	PELEMENT	pParent	= static_cast<PELEMENT>(Abs(pElement->parent));
+	PELEMENT	pSame	= static_cast<PELEMENT>(Abs(pElement->same));
+	if(pSmall){
+		pSmall->parent	= pRelNew;
+	}
+	if(pBig){
+		pBig->parent	= pRelNew;
+	}
+	if(pSame){
+		pSame->parent	= pRelNew;
+	}
+	if(pParent){
+		if(pParent->small == pRelElement){
+			pParent->small = pRelNew;
+		}else if(pParent->big == pRelElement){
+			pParent->big = pRelNew;
+		}else{	// pParent->same == pRelElement
+			pParent->same = pRelNew;
+		}
+	}else{
+		pCKIndex->element_list = pRelNew;
+	}
+	ALObjCKI.Unlock();								// UNLOCK
+
+	// old element is not referred from any, so fence it.
+	if(!FenceCompactElement(cursor, pElement)){
+		ERR_K2HPRN("[FATAL] Could not fence relocated element, this element is leaked!!!");
+		return false;
+	}
+	cursor.moved++;
+
+	return true;
+}
+
+//
+// Relocate pages in target page area which are used by one element.
+//
+// [NOTE]
+// The page chain is replaced if any page in it is in target area(not
+// only top page). The old pages outside target area are put back to
+// free list, and the old pages in target area are fenced.
+//
+bool K2HShm::RelocatePages(K2HCOMPACTCURSOR& cursor, PELEMENT pElement)
+{
+	if(!pElement){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!pElement->key){
+		return true;
+	}
+	k2h_hash_t	hash = pElement->hash;
+
+	// lock ckindex
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Could not get ckindex.");
+		return false;
+	}
+	if(hash != pElement->hash || !IsCompactLinkedElement(pCKIndex, pElement)){
+		return true;
+	}
+
+	PPAGEHEAD*	ppRelPageHeads[]	= {&(pElement->key), &(pElement->value), &(pElement->subkeys), &(pElement->attrs)};
+	size_t		lengths[]			= {pElement->keylength, pElement->vallength, pElement->skeylength, pElement->attrlength};
+	for(size_t cnt = 0; cnt < (sizeof(lengths) / sizeof(size_t)); ++cnt){
+		PPAGEHEAD	pRelOldTop = *(ppRelPageHeads[cnt]);
+		if(!pRelOldTop || 0UL == lengths[cnt]){
+			continue;
+		}
+
+		// check pages in target area
+		bool		is_found = false;
+		PAGEHEAD	CurPageHead;
+		for(PPAGEHEAD pRelCurPageHead = pRelOldTop; pRelCurPageHead; pRelCurPageHead = CurPageHead.next){
+			if(is_in_compact_area(pRelCurPageHead, cursor)){
+				is_found = true;
+				break;
+			}
+			K2HPage*	pCurPage;
+			if(NULL == (pCurPage = GetPageObject(pRelCurPageHead, false)) || !pCurPage->GetPageHead(&CurPageHead)){
+				ERR_K2HPRN("Could not get page head.");
+				K2H_Delete(pCurPage);
+				return false;
+			}
+			K2H_Delete(pCurPage);
+		}
+		if(!is_found){
+			continue;
+		}
+
+		// reserve and copy
+		K2HPage*	pOldPage;
+		K2HPage*	pNewPage;
+		if(NULL == (pOldPage = GetPageObject(pRelOldTop, false))){
+			ERR_K2HPRN("Could not make page object.");
+			return false;
+		}
+		if(NULL == (pNewPage = ReservePages(lengths[cnt], reinterpret_cast<void*>(cursor.area_offset), cursor.area_length))){
+			MSG_K2HPRN("Could not reserve new pages.(ex: no left space)");
+			K2H_Delete(pOldPage);
+			return false;
+		}
+		if(!CopyPageData(pOldPage, pNewPage)){
+			ERR_K2HPRN("Could not copy page data to reserve new page.");
+			if(!pNewPage->Free()){
+				ERR_K2HPRN("[FATAL] Could not put back reserved pages, these objects are leaked!!!");
+			}
+			K2H_Delete(pNewPage);
+			K2H_Delete(pOldPage);
+			return false;
+		}
+		*(ppRelPageHeads[cnt]) = pNewPage->GetPageHeadRelAddress();
+		K2H_Delete(pNewPage);
+		K2H_Delete(pOldPage);
+
+		// put back or fence old pages
+		PPAGEHEAD	pRelNext;
+		for(PPAGEHEAD pRelCurPageHead = pRelOldTop; pRelCurPageHead; pRelCurPageHead = pRelNext){
+			K2HPage*	pCurPage;
+			if(NULL == (pCurPage = GetPageObject(pRelCurPageHead, false)) || !pCurPage->GetPageHead(&CurPageHead)){
+				ERR_K2HPRN("[FATAL] Could not get old page head, some pages are leaked!!!");
+				K2H_Delete(pCurPage);
+				return false;
+			}
+			pRelNext = CurPageHead.next;
+
+			if(is_in_compact_area(pRelCurPageHead, cursor)){
+				K2H_Delete(pCurPage);
+				if(!FenceCompactPage(cursor, pRelCurPageHead)){
+					ERR_K2HPRN("[FATAL] Could not fence relocated page, this page is leaked!!!");
+					return false;
+				}
+			}else{
+				if(!pCurPage->SetPageHead(K2HPage::SETHEAD_PREV | K2HPage::SETHEAD_NEXT | K2HPage::SETHEAD_LENGTH, NULL, NULL, 0UL)){
+					ERR_K2HPRN("[FATAL] Could not set old page head, some pages are leaked!!!");
+					K2H_Delete(pCurPage);
+					return false;
+				}
+				K2H_Delete(pCurPage);
+				if(!PutBackPages(pRelCurPageHead, pRelCurPageHead, 1UL)){
+					ERR_K2HPRN("[FATAL] Failed to putback page, this page is leaked!!!");
+				}
+			}
+		}
+		cursor.moved++;
+	}
+	return true;
+}
+
+//
+// Remove target area when all entries in it are fenced.
+//
+bool K2HShm::ReleaseCompactArea(K2HCOMPACTCURSOR& cursor, bool& isCompressed)
+{
+	isCompressed = false;
+
+	bool	is_pagelist = (K2H_AREA_PAGELIST == cursor.area_type);
+	K2HLock	ALObjFree(ShmFd, Rel(is_pagelist ? static_cast<void*>(&(pHead->free_element_count)) : static_cast<void*>(&(pHead->free_page_count))), K2HLock::RWLOCK);	// LOCK
+
+	// fence free entries which are put back after starting
+	if(!FenceCompactFreeEntries(cursor, NULL, false)){
+		ERR_K2HPRN("Something error occurred in fencing free entries in target area.");
+		return false;
+	}
+	unsigned long	area_count	= get_compact_area_count(cursor, GetPageSize());
+	unsigned long	fence_count	= GetCompactFenceCount(cursor);
+	if(fence_count < area_count){
+		MSG_K2HPRN("Lastest area still has used entries(%lu/%lu), so scan it again.", area_count - fence_count, area_count);
+		return true;
+	}
+
+	K2HLock	ALObjUnArea(ShmFd, Rel(&(pHead->unassign_area)), K2HLock::RWLOCK);	// LOCK
+
+	PK2HAREA	pLastestArea;
+	if(NULL == (pLastestArea = GetLastestArea()) || pLastestArea->type != cursor.area_type || pLastestArea->file_offset != cursor.area_offset || pLastestArea->length != cursor.area_length){
+		MSG_K2HPRN("Lastest area is changed, so could not remove target area.");
+		return true;
+	}
+
+	bool	is_need_check = false;
+	if(!FreeLastestArea(pLastestArea, is_need_check)){
+		ERR_K2HPRN("Could not free lastest area.");
+		return false;
+	}
 	isCompressed = true;
+	cursor.Reset();
 
-	ALObjUnArea.Unlock();					// UNLOCK
+	ALObjUnArea.Unlock();							// UNLOCK
+	ALObjFree.Unlock();								// UNLOCK
 
 	// need to check area update
 	if(is_need_check){
@@ -938,6 +1751,218 @@ bool K2HShm::AreaCompress(bool& isCompressed)
 	return true;
 }
 
+//
+// Compress lastest area by one step.
+//
+// Returns false when something error occurred.
+// isCompressed is true when the lastest area is removed in this step.
+// isFinished is true when there is no more area which can be compressed
+// now, then the caller should wait for a while before calling again.
+//
+bool K2HShm::AreaCompressStep(K2HCOMPACTCURSOR& cursor, long max_count, bool& isCompressed, bool& isFinished)
+{
+	isCompressed	= false;
+	isFinished		= false;
+
+	if(max_count <= 0){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+
+	K2HFILE_UPDATE_CHECK(this);
+
+	K2HLock	ALObjCompact(ShmFd, Rel(&(pHead->last_area_update)), K2HLock::RWLOCK);	// LOCK(for only one compactor)
+
+	// get lastest area information
+	long	type	= K2H_AREA_UNKNOWN;
+	off_t	offset	= 0L;
+	size_t	length	= 0UL;
+	{
+		K2HLock		ALObjUnArea(ShmFd, Rel(&(pHead->unassign_area)), K2HLock::RDLOCK);	// LOCK
+		PK2HAREA	pLastestArea;
+		if(NULL != (pLastestArea = GetLastestArea()) && (K2H_AREA_PAGELIST == pLastestArea->type || K2H_AREA_PAGE == pLastestArea->type)){
+			type	= pLastestArea->type;
+			offset	= pLastestArea->file_offset;
+			length	= pLastestArea->length;
+		}
+	}
+
+	// check target area is changed(ex. new area is expanded)
+	if(cursor.IsTarget() && (cursor.area_type != type || cursor.area_offset != offset || cursor.area_length != length)){
+		MSG_K2HPRN("Lastest area is changed, so put back fenced entries in old target area.");
+		if(!UnfenceCompactArea(cursor)){
+			WAN_K2HPRN("Failed to put back fenced entries, but continue...");
+		}
+		cursor.Reset();
+	}
+	if(K2H_AREA_UNKNOWN == type){
+		MSG_K2HPRN("There is no area which can be compressed.");
+		isFinished = true;
+		return true;
+	}
+
+	if(!cursor.IsTarget()){
+		// start new target
+		cursor.area_type	= type;
+		cursor.area_offset	= offset;
+		cursor.area_length	= length;
+
+		bool	isStarted = false;
+		if(!StartCompactArea(cursor, isStarted)){
+			ERR_K2HPRN("Something error occurred in starting to compress lastest area.");
+			cursor.Reset();
+			return false;
+		}
+		if(!isStarted){
+			cursor.Reset();
+			isFinished = true;
+			return true;
+		}
+	}else if(!cursor.anchor || !IsCompactAnchor(cursor)){
+		// [NOTE]
+		// Another compactor might make(or remove) the anchor in target area.
+		//
+		if(!FindCompactAnchor(cursor)){
+			ERR_K2HPRN("Something error occurred in searching anchor in target area.");
+			return false;
+		}
+	}
+
+	// relocate
+	bool	is_scan_end	= false;
+	bool	result		= true;
+	long	count		= 0L;
+	if(K2H_AREA_PAGELIST == cursor.area_type){
+		PELEMENT	pTopElement;
+		if(NULL == (pTopElement = static_cast<PELEMENT>(Abs(reinterpret_cast<void*>(cursor.area_offset))))){
+			ERR_K2HPRN("Could not get target element area address.");
+			return false;
+		}
+		unsigned long	area_count	= get_compact_area_count(cursor, GetPageSize());
+		unsigned long	pos			= 0UL;
+		if(cursor.next && is_in_compact_area(cursor.next, cursor)){
+			pos = static_cast<unsigned long>((reinterpret_cast<off_t>(cursor.next) - cursor.area_offset) / static_cast<off_t>(sizeof(ELEMENT)));
+		}
+		for(; pos < area_count && count < max_count; ++pos, ++count){
+			if(!RelocateElement(cursor, &pTopElement[pos])){
+				result = false;
+				break;
+			}
+		}
+		if(pos < area_count){
+			cursor.next = ADDPTR(reinterpret_cast<PELEMENT>(cursor.area_offset), static_cast<off_t>(pos * sizeof(ELEMENT)));
+		}else{
+			is_scan_end = true;
+		}
+	}else{
+		PELEMENT	pElement = NULL;
+		if(!cursor.next || NULL == (pElement = static_cast<PELEMENT>(Abs(cursor.next)))){
+			pElement = static_cast<PELEMENT>(MmapInfos.begin(K2H_AREA_PAGELIST));
+		}
+		for(; pElement && count < max_count; pElement = static_cast<PELEMENT>(MmapInfos.next(pElement, sizeof(ELEMENT))), ++count){
+			if(!RelocatePages(cursor, pElement)){
+				result = false;
+				break;
+			}
+		}
+		if(pElement){
+			cursor.next = reinterpret_cast<PELEMENT>(Rel(pElement));
+		}else{
+			is_scan_end = true;
+		}
+	}
+	if(!result){
+		// [NOTE]
+		// Probably there is no space outside target area, so put back fenced
+		// entries for writers and stop compressing this area.
+		//
+		MSG_K2HPRN("Could not relocate entries in lastest area, so stop compressing.");
+		if(!UnfenceCompactArea(cursor)){
+			WAN_K2HPRN("Failed to put back fenced entries, but continue...");
+		}
+		cursor.Reset();
+		isFinished = true;
+		return false;
+	}
+
+	if(is_scan_end){
+		unsigned long	moved = cursor.moved;
+		if(!ReleaseCompactArea(cursor, isCompressed)){
+			ERR_K2HPRN("Something error occurred in removing lastest area.");
+			return false;
+		}
+		if(!isCompressed){
+			if(0UL == moved){
+				// [NOTE]
+				// Nothing was relocated in this scanning, but some entries are not
+				// fenced(ex. reserved by a writer which is not linked yet), so stop
+				// this time and put back fenced entries for writers.
+				//
+				MSG_K2HPRN("Could not relocate any entry in lastest area by this scanning, so stop compressing now.");
+				if(!UnfenceCompactArea(cursor)){
+					WAN_K2HPRN("Failed to put back fenced entries, but continue...");
+				}
+				cursor.Reset();
+				isFinished = true;
+			}else{
+				// scan again
+				cursor.next		= NULL;
+				cursor.moved	= 0UL;
+			}
+		}
+	}
+	return true;
+}
+
+//
+// Stop compressing by steps, and put back fenced entries in target area.
+//
+bool K2HShm::AreaCompressCancel(K2HCOMPACTCURSOR& cursor)
+{
+	if(!cursor.IsTarget()){
+		return true;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HLock	ALObjCompact(ShmFd, Rel(&(pHead->last_area_update)), K2HLock::RWLOCK);	// LOCK(for only one compactor)
+
+	bool	result = UnfenceCompactArea(cursor);
+	cursor.Reset();
+
+	return result;
+}
+
+//---------------------------------------------------------
+// Area compactor(background thread)
+//---------------------------------------------------------
+bool K2HShm::StartAreaCompactor(long interval_ms, long step_count)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	return K2HAreaCompactor::Get()->Start(this, interval_ms, step_count);
+}
+
+bool K2HShm::StopAreaCompactor(void)
+{
+	return K2HAreaCompactor::Get()->Stop(this);
+}
+
 /*
  * Local variables:
  * tab-width: 4
@@ -19,6 +19,7 @@
  *
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
@@ -32,6 +33,7 @@
 #include "k2hshmupdater.h"
 #include "k2hashfunc.h"
 #include "k2htransfunc.h"
+#include "k2hattrbuiltin.h"
 #include "k2hutil.h"
 #include "k2hdbg.h"
 
@@ -201,6 +203,12 @@ bool K2HShm::Dump(FILE* stream, int dumpmask) const
 			}
 			strTmp += "Pages";
 		}
+		if(K2H_AREA_EXTRA == (pHead->areas[nCnt].type & K2H_AREA_EXTRA)){
+			if(!strTmp.empty()){
+				strTmp += ",";
+			}
+			strTmp += "Extra";
+		}
 		DUMP_LOWPRINT(stream, nest, "[%d] = {\n",	nCnt);
 		nest++;
 		DUMP_PRINT_NV(stream, nest, "type",		NULL, "= %s\n",			strTmp.c_str());
@@ -664,7 +672,7 @@ bool K2HShm::DumpQueue(FILE* stream, const unsigned char* byMark, size_t marklen
 	PBK2HMARKER		pmarker = reinterpret_cast<PBK2HMARKER>(pmkval);
 	size_t			marklen = static_cast<size_t>(mkvallength);
 	// Check current marker size
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		ERR_K2HPRN("The marker is not same size which is calculated.");
 		K2H_Free(pmkval);
 		return false;
@@ -680,6 +688,13 @@ bool K2HShm::DumpQueue(FILE* stream, const unsigned char* byMark, size_t marklen
 
 	CVT_BINARY_TO_PRINTABLE_STRING(strtmp, &(pmarker->byData[pmarker->marker.endoff]), pmarker->marker.endlen);
 	DUMP_PRINT_NV(stream, 4, "END KEY  ", NULL, "= %s\n", strtmp.c_str());
+
+	PK2HMARKEREXT	pext = K2HShm::GetK2HMarkerExt(pmarker);
+	if(pext && 0 == (pext->flags & K2HMARKER_FLAG_COUNT_UNKNOWN)){
+		DUMP_PRINT_NV(stream, 4, "COUNT    ", NULL, "= %jd\n", static_cast<intmax_t>(pext->count));
+	}else{
+		DUMP_PRINT_NV(stream, 4, "COUNT    ", NULL, "= %s\n", "unknown");
+	}
 	DUMP_LOWPRINT(stream, 0, "}\n\n");
 
 	if(K2HShm::IsEmptyK2HMarker(pmarker)){
@@ -735,6 +750,39 @@ bool K2HShm::DumpQueue(FILE* stream, const unsigned char* byMark, size_t marklen
 	return true;
 }
 
+bool K2HShm::DumpRingQueue(FILE* stream, const unsigned char* byMark, size_t marklength)
+{
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	K2HRINGHEAD	rhead;
+	if(!GetRingQueueHead(byMark, marklength, rhead)){
+		// There is no marker
+		return true;
+	}
+
+	// Dump marker
+	string		strtmp;
+	CVT_BINARY_TO_PRINTABLE_STRING(strtmp, byMark, marklength);
+	DUMP_PRINT_NV(stream, 0, "RING MARKER(%s)", strtmp.c_str(), "= {\n");
+	DUMP_PRINT_NV(stream, 4, "BLOCK    ", NULL, "= %p\n", rhead.self);
+	DUMP_PRINT_NV(stream, 4, "CAPACITY ", NULL, "= %zu\n", rhead.capacity);
+	DUMP_PRINT_NV(stream, 4, "HEAD     ", NULL, "= %jd\n", static_cast<intmax_t>(rhead.head));
+	DUMP_PRINT_NV(stream, 4, "TAIL     ", NULL, "= %jd\n", static_cast<intmax_t>(rhead.tail));
+	DUMP_PRINT_NV(stream, 4, "USED     ", NULL, "= %ju\n", static_cast<uintmax_t>(rhead.used));
+	DUMP_PRINT_NV(stream, 4, "COUNT    ", NULL, "= %jd\n", static_cast<intmax_t>(rhead.count));
+	DUMP_LOWPRINT(stream, 0, "}\n\n");
+
+	return true;
+}
+
 //---------------------------------------------------------
 // Print Usage
 //---------------------------------------------------------
@@ -768,6 +816,23 @@ bool K2HShm::PrintState(FILE* stream) const
 	DUMP_PRINT_NV(stream, 0, "Total real data size",NULL, "= %zu byte\n",			static_cast<size_t>(pState->total_page_count * (pState->page_size - PAGEHEAD_SIZE)));
 	DUMP_PRINT_NV(stream, 0, "real data ratio",		NULL, "= %zu %%\n",				(static_cast<size_t>(pState->total_page_count * (pState->page_size - PAGEHEAD_SIZE) * 100) / pState->total_used_size));
 
+	if(0 < pState->compress_count || 0 < pState->decompress_count){
+		fprintf(stream, "\n");
+		DUMP_PRINT_NV(stream, 0, "Compressed values",	NULL, "= %lu ( %lu byte -> %lu byte )\n",	pState->compress_count,	pState->compress_org_bytes,	pState->compress_bytes);
+		DUMP_PRINT_NV(stream, 1, "Compression ratio",	NULL, "= %lu %%\n",				(0 < pState->compress_org_bytes ? ((pState->compress_bytes * 100) / pState->compress_org_bytes) : 100UL));
+		DUMP_PRINT_NV(stream, 1, "Compress CPU time",	NULL, "= %lu us\n",				pState->compress_time_ns / 1000);
+		DUMP_PRINT_NV(stream, 0, "Decompressed values",	NULL, "= %lu\n",				pState->decompress_count);
+		DUMP_PRINT_NV(stream, 1, "Decompress CPU time",	NULL, "= %lu us\n",				pState->decompress_time_ns / 1000);
+	}
+
+	if(0 < pState->cache_limit){
+		fprintf(stream, "\n");
+		DUMP_PRINT_NV(stream, 0, "Cache limit",			NULL, "= %zu byte\n",			pState->cache_limit);
+		DUMP_PRINT_NV(stream, 1, "Hits / Misses",		NULL, "= %lu / %lu\n",			pState->cache_hits, pState->cache_misses);
+		DUMP_PRINT_NV(stream, 1, "Hit ratio",			NULL, "= %lu %%\n",				(0 < (pState->cache_hits + pState->cache_misses) ? ((pState->cache_hits * 100) / (pState->cache_hits + pState->cache_misses)) : 0UL));
+		DUMP_PRINT_NV(stream, 1, "Evicted keys",		NULL, "= %lu\n",				pState->cache_evictions);
+	}
+
 	K2H_Free(pState);
 
 	return true;
@@ -866,6 +931,35 @@ PK2HSTATE K2HShm::GetState(void) const
 		ALObjCMask.Unlock();
 	}
 
+	// compression statistics in this process
+	{
+		uint64_t	compcnt		= 0;
+		uint64_t	orgbytes	= 0;
+		uint64_t	compbytes	= 0;
+		uint64_t	comptime	= 0;
+		uint64_t	decompcnt	= 0;
+		uint64_t	decomptime	= 0;
+		K2hAttrBuiltin::GetCompressStats(this, compcnt, orgbytes, compbytes, comptime, decompcnt, decomptime);
+
+		pState->compress_count				= static_cast<unsigned long>(compcnt);
+		pState->compress_org_bytes			= static_cast<unsigned long>(orgbytes);
+		pState->compress_bytes				= static_cast<unsigned long>(compbytes);
+		pState->compress_time_ns			= static_cast<unsigned long>(comptime);
+		pState->decompress_count			= static_cast<unsigned long>(decompcnt);
+		pState->decompress_time_ns			= static_cast<unsigned long>(decomptime);
+	}
+
+	// cache statistics
+	{
+		PK2HEXTRA	pExtra = GetExtraArea();
+		if(pExtra && (offsetof(K2HEXTRA, cache_evictions) + sizeof(uint64_t)) <= pExtra->length && K2H_CACHE_ACTIVE == pExtra->cache_state){
+			pState->cache_limit				= pExtra->cache_limit;
+			pState->cache_hits				= static_cast<unsigned long>(pExtra->cache_hits);
+			pState->cache_misses			= static_cast<unsigned long>(pExtra->cache_misses);
+			pState->cache_evictions			= static_cast<unsigned long>(pExtra->cache_evictions);
+		}
+	}
+
 	return pState;
 }
 
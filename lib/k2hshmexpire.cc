@@ -0,0 +1,330 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hashfunc.h"
+#include "k2hattrbuiltin.h"
+#include "k2hreaper.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+static inline bool k2h_has_expire_index(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, expire_bucket_pos) + sizeof(int64_t)) <= pExtra->length);
+}
+
+static inline size_t k2h_expire_bucket_name(int64_t bucket, char* pBuff, size_t length)
+{
+	snprintf(pBuff, length, "%s%016" PRIx64, K2HEXPIRE_PREFIX, static_cast<uint64_t>(bucket));
+	return (strlen(pBuff) + 1);
+}
+
+//
+// Set bucket position to the bucket if it is lower than current position.
+//
+static inline void k2h_lower_expire_bucket(PK2HEXTRA pExtra, int64_t bucket)
+{
+	int64_t	pos;
+	while(0 == (pos = __sync_add_and_fetch(&(pExtra->expire_bucket_pos), 0)) || bucket < pos){
+		if(__sync_bool_compare_and_swap(&(pExtra->expire_bucket_pos), pos, bucket)){
+			break;
+		}
+	}
+}
+
+//---------------------------------------------------------
+// Methods
+//---------------------------------------------------------
+// [NOTE]
+// The expiry index is the bucketed lists(ring queues) keyed by expire
+// time, and the keys are listed into it when they are set with expire
+// attribute by Set(). The reaper removes keys in the buckets which are
+// past from the lowest bucket, so that it does not scan all keys.
+//
+// The index may have some garbage entries for the keys which are
+// updated or removed after listing. The reaper checks expire attribute
+// of the key again while the key is locked, thus it never removes the
+// key which is not expired. And the keys which are not listed(ex. set
+// by Replace() or loaded from archive) are not removed by reaper, but
+// they are expired when they are read as same as before.
+//
+bool K2HShm::AddExpireIndex(const unsigned char* byKey, size_t keylength, time_t expire)
+{
+	if(!byKey || 0 == keylength || expire <= 0){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for expiry index.");
+		return false;
+	}
+	if(!k2h_has_expire_index(pExtra)){
+		ERR_K2HPRN("Extra area does not have expiry index area.");
+		return false;
+	}
+
+	int64_t	bucket = static_cast<int64_t>(expire / K2HEXPIRE_BUCKET_UNIT);
+	char	szMark[64];
+	size_t	marklength = k2h_expire_bucket_name(bucket, szMark, sizeof(szMark));
+	K2HBIN	keybin;
+	keybin.byptr	= const_cast<unsigned char*>(byKey);
+	keybin.length	= keylength;
+	if(!PushRingQueue(reinterpret_cast<const unsigned char*>(szMark), marklength, &keybin, 1)){
+		ERR_K2HPRN("Could not push key to expiry index bucket(%s).", szMark);
+		return false;
+	}
+
+	// [NOTE]
+	// The position is updated after pushing, then the reaper which
+	// reads the position always finds this key in bucket.
+	//
+	k2h_lower_expire_bucket(pExtra, bucket);
+
+	return true;
+}
+
+//
+// Remove the key only when it is expired, is_removed is set false when
+// the key does not exist or is not expired.
+//
+// [NOTE]
+// This method does not remove subkeys and does not make history, the
+// subkeys directory's chunk keys are removed.
+//
+bool K2HShm::RemoveExpiredKey(const unsigned char* byKey, size_t keylength, bool& is_removed)
+{
+	is_removed = false;
+	if(!byKey || 0 == keylength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+
+	// make hash
+	k2h_hash_t	hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+	k2h_hash_t	subhash	= K2H_2ND_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+
+	// get element
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);			// LOCK
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElementList;
+	PELEMENT	pElement;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElementList = GetElementList(pCKIndex, hash, subhash)) || NULL == (pElement = GetElement(pElementList, byKey, keylength))){
+		MSG_K2HPRN("Not found Key in k2hash.");
+		return true;
+	}
+
+	// check expire
+	K2HATTRFLAGS	attrflags;
+	if(!GetAttrFlags(pElement, attrflags) || !K2hAttrBuiltin::IsExpire(attrflags)){
+		MSG_K2HPRN("Key is not expired.");
+		return true;
+	}
+
+	// get(keep) subkeys binary for chunk keys
+	unsigned char*	bySubkeys	= NULL;
+	ssize_t			sklength	= 0;
+	if(pElement->subkeys && (0 >= (sklength = Get(pElement, &bySubkeys, PAGEOBJ_SUBKEYS)) || !bySubkeys)){
+		K2H_Free(bySubkeys);
+		sklength = 0;
+	}
+
+	// take off element from ckindex
+	if(!TakeOffElement(pCKIndex, pElement)){
+		ERR_K2HPRN("Failed to take off element from ckey index.");
+		K2H_Free(bySubkeys);
+		return false;
+	}
+	ALObjCKI.Unlock();								// Unlock
+
+	// remove key(pelement already take off from ckeyindex, so do not need to lock)
+	bool	is_check_updated = true;
+	if(!RemoveEx(pElement, NULL, is_check_updated)){
+		ERR_K2HPRN("Failed to remove expired key.");
+		K2H_Free(bySubkeys);
+		return false;
+	}
+	if(bySubkeys){
+		RemoveSubKeysChunks(bySubkeys, static_cast<size_t>(sklength), NULL, 0UL);
+		K2H_Free(bySubkeys);
+	}
+	is_removed = true;
+
+	return true;
+}
+
+//
+// Remove expired keys in expiry index up to maxcount entries.
+// The count of removed keys is set to preaped.
+//
+// [NOTE]
+// The buckets which are before current bucket are checked, then the
+// keys are removed in K2HEXPIRE_BUCKET_UNIT seconds after expiring.
+// The entries are taken from bucket before removing keys, and the key
+// is removed only while its collision key index is locked, thus some
+// processes can run this method at same time.
+//
+bool K2HShm::ReapExpired(size_t maxcount, size_t* preaped)
+{
+	if(preaped){
+		*preaped = 0;
+	}
+	if(0 == maxcount){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_expire_index(pExtra)){
+		MSG_K2HPRN("There is no expiry index.");
+		return true;
+	}
+
+	int64_t	lastbucket	= static_cast<int64_t>(time(NULL) / K2HEXPIRE_BUCKET_UNIT) - 1;
+	int64_t	bucket;
+	size_t	checked		= 0;
+	size_t	reaped		= 0;
+	while(checked < maxcount && 0 < (bucket = __sync_add_and_fetch(&(pExtra->expire_bucket_pos), 0)) && bucket <= lastbucket){
+		char	szMark[64];
+		size_t	marklength = k2h_expire_bucket_name(bucket, szMark, sizeof(szMark));
+
+		// take keys from bucket
+		PK2HBIN	pkeys		= NULL;
+		size_t	popcount	= 0;
+		if(!PopRingQueue(reinterpret_cast<const unsigned char*>(szMark), marklength, true, maxcount - checked, &pkeys, popcount)){
+			ERR_K2HPRN("Could not pop keys from expiry index bucket(%s).", szMark);
+			break;
+		}
+		for(size_t cnt = 0; cnt < popcount; ++cnt){
+			bool	is_removed = false;
+			if(!RemoveExpiredKey(pkeys[cnt].byptr, pkeys[cnt].length, is_removed)){
+				WAN_K2HPRN("Failed to remove expired key, but continue...");
+			}else if(is_removed){
+				++reaped;
+			}
+		}
+		free_k2hbins(pkeys, popcount);
+		checked += popcount;
+		if(0 < popcount){
+			continue;
+		}
+
+		// remove empty bucket
+		bool	is_removed = false;
+		if(!RemoveEmptyRingQueue(reinterpret_cast<const unsigned char*>(szMark), marklength, is_removed)){
+			ERR_K2HPRN("Could not remove empty expiry index bucket(%s).", szMark);
+			break;
+		}
+		if(!is_removed){
+			continue;									// pushed after popping
+		}
+
+		// go to next bucket
+		//
+		// [NOTE]
+		// If the key which expire time is past is pushed to this bucket
+		// after removing it, the position is set back to this bucket.
+		//
+		if(__sync_bool_compare_and_swap(&(pExtra->expire_bucket_pos), bucket, bucket + 1)){
+			if(!IsEmptyRingQueue(reinterpret_cast<const unsigned char*>(szMark), marklength)){
+				k2h_lower_expire_bucket(pExtra, bucket);
+			}
+		}
+	}
+	if(preaped){
+		*preaped = reaped;
+	}
+	return true;
+}
+
+bool K2HShm::StartExpireReaper(long interval_ms, long step_count)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	return K2HExpireReaper::Get()->Start(this, interval_ms, step_count);
+}
+
+bool K2HShm::StopExpireReaper(void)
+{
+	return K2HExpireReaper::Get()->Stop(this);
+}
+
+//
+// Check the element is expiry index bucket's marker.
+//
+// [NOTE]
+// The marker name length is fixed, so that the key is read only when its
+// length is same as marker's.
+//
+bool K2HShm::IsExpireIndexElement(PELEMENT pElement) const
+{
+	if(!pElement || K2HEXPIRE_MARKER_LENGTH != pElement->keylength){
+		return false;
+	}
+	unsigned char*	byKey	= NULL;
+	ssize_t			keylength;
+	bool			result	= false;
+	if(0 < (keylength = Get(pElement, &byKey, PAGEOBJ_KEY)) && byKey && K2HEXPIRE_MARKER_LENGTH == static_cast<size_t>(keylength) && 0 == memcmp(byKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)){
+		result = true;
+	}
+	K2H_Free(byKey);
+	return result;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,188 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+
+#include <stddef.h>
+#include <string.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hhotcache.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Symbols
+//---------------------------------------------------------
+#define	K2H_KEY_VERSION_MAX_BITCOUNT	16
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+static inline bool k2h_has_version_area(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, version_mask) + sizeof(k2h_hash_t)) <= pExtra->length);
+}
+
+//---------------------------------------------------------
+// Methods
+//---------------------------------------------------------
+// [NOTE]
+// The hot key cache keeps decoded values of keys in this process, and
+// the value is returned without locking and reading k2hash while the
+// key version is not changed. The key version is shared by all processes
+// and it is incremented by locking for writing, then the cached value
+// is never stale.
+// The key version is not for each key, but for each unit of collision
+// key indexes. Thus writing other keys in same unit invalidates cached
+// value.
+//
+// [NOTICE]
+// Do not call EnableHotCache/DisableHotCache while other threads read
+// keys by this object.
+//
+bool K2HShm::EnableHotCache(size_t limit)
+{
+	if(0 == limit){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	if(!MakeKeyVersionTable()){
+		ERR_K2HPRN("Could not make key version table for hot key cache.");
+		return false;
+	}
+	K2H_Delete(pHotCache);
+	pHotCache = new K2HHotCache(limit);
+
+	return true;
+}
+
+bool K2HShm::DisableHotCache(void)
+{
+	K2H_Delete(pHotCache);
+	return true;
+}
+
+//
+// Make key version table in extra area if it does not exist.
+//
+// [NOTE]
+// The table is not removed after making it, because other processes
+// may use hot key cache.
+//
+bool K2HShm::MakeKeyVersionTable(void)
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(k2h_has_version_area(pExtra) && pExtra->version_table){
+		return true;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode, and there is no key version table.");
+		return false;
+	}
+	if(!pExtra && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for key version table.");
+		return false;
+	}
+	if(!k2h_has_version_area(pExtra)){
+		ERR_K2HPRN("Extra area does not have key version table area.");
+		return false;
+	}
+
+	K2HLock	ALObjVer(ShmFd, Rel(&(pExtra->version_mask)), K2HLock::RWLOCK);	// LOCK
+	if(pExtra->version_table){
+		return true;
+	}
+
+	int			bitcount	= min(K2HShm::GetMaskBitCount(pHead->min_mask) + K2HShm::GetMaskBitCount(pHead->collision_mask), K2H_KEY_VERSION_MAX_BITCOUNT);
+	k2h_hash_t	version_mask= K2HShm::MakeMask(bitcount);
+	size_t		area_length	= ALIGNMENT(static_cast<size_t>(version_mask + 1) * sizeof(uint64_t), K2HShm::SystemPageSize);
+	off_t		new_area_start	= 0L;
+	if(NULL == ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)){
+		ERR_K2HPRN("Could not expand key version table area.");
+		return false;
+	}
+	pExtra->version_mask	= version_mask;
+	__sync_synchronize();
+	pExtra->version_table	= reinterpret_cast<void*>(new_area_start);
+
+	return true;
+}
+
+//
+// Returns false if there is no key version table.
+//
+bool K2HShm::GetKeyVersion(k2h_hash_t hash, uint64_t& version) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_version_area(pExtra) || !pExtra->version_table){
+		return false;
+	}
+	volatile uint64_t*	pTable;
+	if(NULL == (pTable = static_cast<volatile uint64_t*>(Abs(pExtra->version_table)))){
+		// table area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pTable = static_cast<volatile uint64_t*>(Abs(pExtra->version_table)))){
+			return false;
+		}
+	}
+	version = __sync_add_and_fetch(&pTable[hash & pExtra->version_mask], 0);
+	return true;
+}
+
+//
+// Called after locking collision key index for writing.
+//
+void K2HShm::IncrementKeyVersion(k2h_hash_t hash) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_version_area(pExtra) || !pExtra->version_table){
+		return;
+	}
+	volatile uint64_t*	pTable;
+	if(NULL == (pTable = static_cast<volatile uint64_t*>(Abs(pExtra->version_table)))){
+		// table area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pTable = static_cast<volatile uint64_t*>(Abs(pExtra->version_table)))){
+			ERR_K2HPRN("Could not get key version table area.");
+			return;
+		}
+	}
+	__sync_add_and_fetch(&pTable[hash & pExtra->version_mask], 1);
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -19,6 +19,7 @@
  *
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -28,11 +29,42 @@
 #include "k2hcommon.h"
 #include "k2hshm.h"
 #include "k2hashfunc.h"
+#include "k2hshmupdater.h"
 #include "k2hutil.h"
 #include "k2hdbg.h"
 
 using namespace std;
 
+//---------------------------------------------------------
+// Check alignment of extra area members
+//---------------------------------------------------------
+// [NOTE]
+// K2HEXTRA is packed, and the members which are updated by atomic
+// operation must be 8 bytes aligned, and the futex words must be 4
+// bytes aligned.
+//
+#if	201103L <= __cplusplus
+#define	K2H_EXTRA_ALIGN_CHECK(member, align)	static_assert(0 == (offsetof(K2HEXTRA, member) % (align)), "K2HEXTRA::" #member " is not aligned.")
+
+K2H_EXTRA_ALIGN_CHECK(snapshot_state,		8);
+K2H_EXTRA_ALIGN_CHECK(snapshot_error_count,	8);
+K2H_EXTRA_ALIGN_CHECK(queue_wakeup_seq,		4);
+K2H_EXTRA_ALIGN_CHECK(queue_waiters,		4);
+K2H_EXTRA_ALIGN_CHECK(expire_bucket_pos,	8);
+K2H_EXTRA_ALIGN_CHECK(cache_state,			8);
+K2H_EXTRA_ALIGN_CHECK(cache_hand,			8);
+K2H_EXTRA_ALIGN_CHECK(cache_hits,			8);
+K2H_EXTRA_ALIGN_CHECK(cache_misses,			8);
+K2H_EXTRA_ALIGN_CHECK(cache_evictions,		8);
+K2H_EXTRA_ALIGN_CHECK(watch_state,			8);
+K2H_EXTRA_ALIGN_CHECK(watch_head,			8);
+K2H_EXTRA_ALIGN_CHECK(watch_wakeup_seq,		4);
+K2H_EXTRA_ALIGN_CHECK(watch_waiters,		4);
+K2H_EXTRA_ALIGN_CHECK(version_table,		8);
+K2H_EXTRA_ALIGN_CHECK(version_mask,			8);
+K2H_EXTRA_ALIGN_CHECK(ring_free,			8);
+#endif
+
 //---------------------------------------------------------
 // Structure / Symbols
 //---------------------------------------------------------
@@ -629,10 +661,16 @@ bool K2HShm::BuildMmapInfo(void)
 	// Check version
 	{
 		char	szTmpVer[K2H_HASH_FUNC_VER_LENGTH];
+		char	szOldVer[K2H_HASH_FUNC_VER_LENGTH];
 
+		// [NOTE]
+		// Version 2 is different from version 3 in only the format of queue
+		// marker, then this library attaches both versions. See K2HMARKEREXT.
+		//
 		sprintf(szTmpVer, K2H_VERSION_FORMAT, K2H_VERSION);
-		if(0 != strcmp(szTmpVer, pHead->version)){
-			ERR_K2HPRN("K2HASH file version(\"%s\") is not supported, this library supports only version \"%s\"", pHead->version, szTmpVer);
+		sprintf(szOldVer, K2H_VERSION_FORMAT, K2H_VERSION_V2);
+		if(0 != strcmp(szTmpVer, pHead->version) && 0 != strcmp(szOldVer, pHead->version)){
+			ERR_K2HPRN("K2HASH file version(\"%s\") is not supported, this library supports only version \"%s\" and \"%s\"", pHead->version, szTmpVer, szOldVer);
 			ERR_K2HPRN("You can convert k2hash file to newer format by putting archive file by old version tools(libs), and load it by newer tools(libs).");
 			Clean(false);
 			return false;
@@ -732,6 +770,63 @@ bool K2HShm::ContractMmapInfo(void)
 	return result;
 }
 
+//---------------------------------------------------------
+// Extra area
+//---------------------------------------------------------
+//
+// Returns extra area pointer, if there is no extra area, returns NULL.
+//
+PK2HEXTRA K2HShm::GetExtraArea(void) const
+{
+	if(!IsAttached() || !pHead->pextra){
+		return NULL;
+	}
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = static_cast<PK2HEXTRA>(Abs(pHead->pextra)))){
+		// extra area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		pExtra = static_cast<PK2HEXTRA>(Abs(pHead->pextra));
+	}
+	return pExtra;
+}
+
+//
+// Make extra area if it does not exist, and returns extra area pointer.
+//
+// [NOTE]
+// The extra area is expanded as one of area in k2hash, and it is
+// initialized by zero.
+//
+PK2HEXTRA K2HShm::MakeExtraArea(void)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return NULL;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return NULL;
+	}
+	K2HLock	ALObjExtra(ShmFd, Rel(&(pHead->pextra)), K2HLock::RWLOCK);		// LOCK
+
+	if(pHead->pextra){
+		return GetExtraArea();
+	}
+
+	size_t		area_length		= ALIGNMENT(sizeof(K2HEXTRA), K2HShm::SystemPageSize);
+	off_t		new_area_start	= 0L;
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = static_cast<PK2HEXTRA>(ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)))){
+		ERR_K2HPRN("Could not expand extra area.");
+		return NULL;
+	}
+	sprintf(pExtra->version, "%s", K2H_EXTRA_VERSION_STR);
+	pExtra->length	= area_length;
+	pHead->pextra	= reinterpret_cast<void*>(new_area_start);
+
+	return pExtra;
+}
+
 /*
  * Local variables:
  * tab-width: 4
@@ -20,6 +20,10 @@
  */
 
 #include <string.h>
+#include <limits.h>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 #include "k2hcommon.h"
 #include "k2hshm.h"
@@ -55,9 +59,26 @@ extern PK2HATTRPCK k2h_cvt_attrs_to_bin(K2HAttrs* pAttrs, int& attrspckcnt);
 //    if there is no expire and not set expire seconds in builtin object, expire value is not set.
 //
 //---------------------------------------------------------
-// Class methods
+// Methods for marker
 //---------------------------------------------------------
-PBK2HMARKER K2HShm::InitK2HMarker(size_t& marklen, const unsigned char* bystart, size_t startlen, const unsigned char* byend, size_t endlen)
+// [NOTE]
+// The marker which is made by these methods has K2HMARKEREXT area just
+// after K2HMARKER when the format version of k2hash is K2H_VERSION, and
+// does not have it when the version is K2H_VERSION_V2 for old libraries.
+// These methods can read both type markers, and the marker is converted
+// to the type for the format version when it is updated.
+//
+bool K2HShm::IsExtK2HMarkerFormat(void) const
+{
+	if(!pHead){
+		return false;
+	}
+	char	szOldVer[K2H_VERSION_LENGTH];
+	sprintf(szOldVer, K2H_VERSION_FORMAT, K2H_VERSION_V2);
+	return (0 != strcmp(szOldVer, pHead->version));
+}
+
+PBK2HMARKER K2HShm::InitK2HMarker(size_t& marklen, const unsigned char* bystart, size_t startlen, const unsigned char* byend, size_t endlen) const
 {
 	if(((NULL == bystart) != (0 == startlen)) || ((NULL == byend) != (0 == endlen))){
 		ERR_K2HPRN("Some parameters are wrong.");
@@ -69,9 +90,11 @@ PBK2HMARKER K2HShm::InitK2HMarker(size_t& marklen, const unsigned char* bystart,
 	}
 
 	PBK2HMARKER	pmarker;
+	bool		is_ext	= IsExtK2HMarkerFormat();
+	size_t		headlen	= sizeof(K2HMARKER) + (is_ext ? sizeof(K2HMARKEREXT) : 0);
 
 	// allocation
-	marklen = sizeof(K2HMARKER) + startlen + endlen;
+	marklen = headlen + startlen + endlen;
 	if(NULL == (pmarker = reinterpret_cast<PBK2HMARKER>(malloc(marklen)))){
 		ERR_K2HPRN("Could not allocation memory.");
 		return NULL;
@@ -83,9 +106,17 @@ PBK2HMARKER K2HShm::InitK2HMarker(size_t& marklen, const unsigned char* bystart,
 	// At first, must check length for accessing this structure.
 	//
 	pmarker->marker.startlen	= startlen;
-	pmarker->marker.startoff	= static_cast<off_t>(sizeof(K2HMARKER));
+	pmarker->marker.startoff	= static_cast<off_t>(headlen);
 	pmarker->marker.endlen		= endlen;
-	pmarker->marker.endoff		= static_cast<off_t>(sizeof(K2HMARKER) + startlen);
+	pmarker->marker.endoff		= static_cast<off_t>(headlen + startlen);
+
+	if(is_ext){
+		PK2HMARKEREXT	pext	= reinterpret_cast<PK2HMARKEREXT>(&(pmarker->byData[0]) + sizeof(K2HMARKER));
+		pext->count				= 0;
+		pext->flags				= 0;
+		pext->headseq			= 0;
+		pext->generation		= 0;
+	}
 
 	if(0 < startlen){
 		memcpy((&(pmarker->byData[0]) + pmarker->marker.startoff), bystart, startlen);
@@ -97,7 +128,13 @@ PBK2HMARKER K2HShm::InitK2HMarker(size_t& marklen, const unsigned char* bystart,
 	return pmarker;
 }
 
-PBK2HMARKER K2HShm::UpdateK2HMarker(PBK2HMARKER pmarker, size_t& marklen, const unsigned char* byKey, size_t keylength, bool is_end)
+//
+// Make new marker from pmarker with new start(end) key, and add delta to count.
+// pmarker is freed in this method.
+// If the start key is changed, the delta is the count of pushed(popped) keys
+// at the start of queue, and then headseq is shifted by it.
+//
+PBK2HMARKER K2HShm::UpdateK2HMarker(PBK2HMARKER pmarker, size_t& marklen, const unsigned char* byKey, size_t keylength, bool is_end, int64_t delta) const
 {
 	if(!pmarker || (NULL == byKey) != (0 == keylength)){
 		ERR_K2HPRN("Some parameters are wrong.");
@@ -105,52 +142,41 @@ PBK2HMARKER K2HShm::UpdateK2HMarker(PBK2HMARKER pmarker, size_t& marklen, const
 	}
 
 	PBK2HMARKER	pnewmarker;
+	bool		is_init = true;
 
 	if(0 == pmarker->marker.startlen && 0 == pmarker->marker.endlen){
 		// marker is empty
-
-		// allocation
-		marklen = sizeof(K2HMARKER) + (keylength * 2);
-		if(NULL == (pnewmarker = reinterpret_cast<PBK2HMARKER>(malloc(marklen)))){
-			ERR_K2HPRN("Could not allocation memory.");
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(marklen, byKey, keylength))){
+			K2H_Free(pmarker);
 			return NULL;
 		}
-
-		// set data
-		pnewmarker->marker.startlen	= keylength;
-		pnewmarker->marker.startoff	= static_cast<off_t>(sizeof(K2HMARKER));
-		pnewmarker->marker.endlen	= keylength;
-		pnewmarker->marker.endoff	= static_cast<off_t>(sizeof(K2HMARKER) + keylength);
-
-		memcpy((&(pnewmarker->byData[0]) + pnewmarker->marker.startoff),	byKey,	pnewmarker->marker.startlen);
-		memcpy((&(pnewmarker->byData[0]) + pnewmarker->marker.endoff),		byKey,	pnewmarker->marker.endlen);
-	}else{
-
-		if((is_end && 0 == pmarker->marker.startlen) || (!is_end && 0 == pmarker->marker.endlen)){
-			// When setting start(end) key, the pmarker does not have end(start) key.
-			// Then the end(start) key must be set as same as start(end) key.
-			// So it means initializing.
-			//
+	}else if((is_end && 0 == pmarker->marker.startlen) || (!is_end && 0 == pmarker->marker.endlen)){
+		// When setting start(end) key, the pmarker does not have end(start) key.
+		// Then the end(start) key must be set as same as start(end) key.
+		// So it means initializing.
+		//
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(marklen, byKey, keylength))){
 			K2H_Free(pmarker);
-			return K2HShm::InitK2HMarker(marklen, byKey, keylength);
+			return NULL;
 		}
+	}else{
+		const unsigned char*	bystart	= is_end ? (&(pmarker->byData[0]) + pmarker->marker.startoff) : byKey;
+		size_t					startlen= is_end ? pmarker->marker.startlen : keylength;
+		const unsigned char*	byend	= is_end ? byKey : (&(pmarker->byData[0]) + pmarker->marker.endoff);
+		size_t					endlen	= is_end ? keylength : pmarker->marker.endlen;
 
-		// allocation
-		marklen = sizeof(K2HMARKER) + (is_end ? (pmarker->marker.startlen + keylength) : (keylength + pmarker->marker.endlen));
-		if(NULL == (pnewmarker = reinterpret_cast<PBK2HMARKER>(malloc(marklen)))){
-			ERR_K2HPRN("Could not allocation memory.");
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(marklen, bystart, startlen, byend, endlen))){
+			K2H_Free(pmarker);
 			return NULL;
 		}
-
-		// set data
-		pnewmarker->marker.startlen	= is_end ? pmarker->marker.startlen : keylength;
-		pnewmarker->marker.startoff	= static_cast<off_t>(sizeof(K2HMARKER));
-		pnewmarker->marker.endlen	= is_end ? keylength : pmarker->marker.endlen;
-		pnewmarker->marker.endoff	= static_cast<off_t>(sizeof(K2HMARKER) + pnewmarker->marker.startlen);
-
-		memcpy((&(pnewmarker->byData[0]) + pnewmarker->marker.startoff),	(is_end ? (&(pmarker->byData[0]) + pmarker->marker.startoff) : byKey),	pnewmarker->marker.startlen);
-		memcpy((&(pnewmarker->byData[0]) + pnewmarker->marker.endoff),		(is_end ? byKey : (&(pmarker->byData[0]) + pmarker->marker.endoff)),	pnewmarker->marker.endlen);
+		is_init = false;
+	}
+	K2HShm::CopyK2HMarkerCount(pnewmarker, pmarker, delta);
+	if(!is_end && !is_init){
+		// start key is changed by popping(delta < 0) or pushing(delta > 0)
+		K2HShm::ShiftK2HMarkerHead(pnewmarker, -delta);
 	}
+
 	// cppcheck-suppress uselessAssignmentPtrArg
 	K2H_Free(pmarker);
 
@@ -166,6 +192,107 @@ bool K2HShm::IsEmptyK2HMarker(PBK2HMARKER pmarker)
 	return (0 == pmarker->marker.startlen);
 }
 
+//
+// Check marker size and offsets, both old and extended marker are allowed.
+//
+bool K2HShm::IsSafeK2HMarker(PBK2HMARKER pmarker, size_t marklen)
+{
+	if(!pmarker || marklen < sizeof(K2HMARKER)){
+		return false;
+	}
+	if(	pmarker->marker.startoff != static_cast<off_t>(sizeof(K2HMARKER)) &&
+		pmarker->marker.startoff != static_cast<off_t>(sizeof(K2HMARKER) + sizeof(K2HMARKEREXT)) )
+	{
+		return false;
+	}
+	if(pmarker->marker.endoff != static_cast<off_t>(pmarker->marker.startoff + pmarker->marker.startlen)){
+		return false;
+	}
+	if(marklen != (static_cast<size_t>(pmarker->marker.startoff) + pmarker->marker.startlen + pmarker->marker.endlen)){
+		return false;
+	}
+	return true;
+}
+
+//
+// Returns extended area pointer in marker, returns NULL if marker is old type.
+//
+PK2HMARKEREXT K2HShm::GetK2HMarkerExt(PBK2HMARKER pmarker)
+{
+	if(!pmarker || pmarker->marker.startoff != static_cast<off_t>(sizeof(K2HMARKER) + sizeof(K2HMARKEREXT))){
+		return NULL;
+	}
+	return reinterpret_cast<PK2HMARKEREXT>(&(pmarker->byData[0]) + sizeof(K2HMARKER));
+}
+
+//
+// Copy count and flags from psrcmarker to pdstmarker, and add delta to count.
+//
+// [NOTE]
+// If psrcmarker is NULL, the queue is new, then count is set delta.
+// If psrcmarker is old type marker, we do not know the count of queue, then
+// the unknown flag is set. When the queue is empty, we can know the count
+// correctly, then the flag is cleared.
+//
+bool K2HShm::CopyK2HMarkerCount(PBK2HMARKER pdstmarker, PBK2HMARKER psrcmarker, int64_t delta)
+{
+	PK2HMARKEREXT	pdstext;
+	if(NULL == (pdstext = K2HShm::GetK2HMarkerExt(pdstmarker))){
+		// destination is old type marker, it does not have count.
+		return true;
+	}
+	PK2HMARKEREXT	psrcext = K2HShm::GetK2HMarkerExt(psrcmarker);
+	if(psrcext){
+		pdstext->count		= psrcext->count + delta;
+		pdstext->flags		= psrcext->flags;
+		pdstext->headseq	= psrcext->headseq;
+		pdstext->generation	= psrcext->generation;
+	}else if(psrcmarker){
+		pdstext->count		= 0;
+		pdstext->flags		= K2HMARKER_FLAG_COUNT_UNKNOWN;
+		pdstext->headseq	= 0;
+		pdstext->generation	= 0;
+	}else{
+		pdstext->count		= delta;
+		pdstext->flags		= 0;
+		pdstext->headseq	= 0;
+		pdstext->generation	= 0;
+	}
+	if(0 != (pdstext->flags & K2HMARKER_FLAG_COUNT_UNKNOWN) && K2HShm::IsEmptyK2HMarker(pdstmarker)){
+		pdstext->count	= 0;
+		pdstext->flags	&= ~K2HMARKER_FLAG_COUNT_UNKNOWN;
+	}
+	return true;
+}
+
+//
+// Shift headseq in marker by count which is popped(positive) or pushed(negative)
+// at the start of queue.
+//
+bool K2HShm::ShiftK2HMarkerHead(PBK2HMARKER pmarker, int64_t shift)
+{
+	PK2HMARKEREXT	pext;
+	if(NULL == (pext = K2HShm::GetK2HMarkerExt(pmarker))){
+		return false;
+	}
+	pext->headseq += shift;
+	return true;
+}
+
+//
+// Increment generation in marker, it means that the queue index is not
+// available after this.
+//
+bool K2HShm::ChangeK2HMarkerGeneration(PBK2HMARKER pmarker)
+{
+	PK2HMARKEREXT	pext;
+	if(NULL == (pext = K2HShm::GetK2HMarkerExt(pmarker))){
+		return false;
+	}
+	pext->generation++;
+	return true;
+}
+
 //---------------------------------------------------------
 // Methods for Queue
 //---------------------------------------------------------
@@ -220,7 +347,7 @@ PBK2HMARKER K2HShm::GetMarker(const unsigned char* byMark, size_t marklength, K2
 		K2H_Free(pmkval);
 		return NULL;							// automatically unlock ALObjCKI if it is local
 	}
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		MSG_K2HPRN("Marker exists, but the marker size is wrong.");
 		K2H_Free(pmkval);
 		return NULL;							// automatically unlock ALObjCKI if it is local
@@ -228,12 +355,107 @@ PBK2HMARKER K2HShm::GetMarker(const unsigned char* byMark, size_t marklength, K2
 	return pmarker;
 }
 
+//
+// Add delta to count in marker with WRITE LOCK for marker.
+//
+// [NOTE]
+// This method is used when the marker is not updated by pushing or popping
+// key(ex. the key is pushed but the marker had been updated by other).
+// If the marker does not exist or is old type, nothing to do.
+// If is_change_gen is true(ex. the key in the middle of queue is removed),
+// the generation in marker is incremented too.
+//
+bool K2HShm::AddK2HMarkerCount(const unsigned char* byMark, size_t marklength, int64_t delta, bool is_change_gen)
+{
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(0 == delta && !is_change_gen){
+		return true;
+	}
+
+	K2HLock			ALObjCKI_Marker(K2HLock::RWLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t		hash	= K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	if(NULL == GetCKIndex(hash, ALObjCKI_Marker)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+
+	// Read current marker.(without checking expire)
+	unsigned char*	pmkval	= NULL;
+	ssize_t			mkvallength;
+	if(-1 == (mkvallength = Get(byMark, marklength, &pmkval, false)) || !pmkval){
+		MSG_K2HPRN("There is no marker, so nothing to do.");
+		return true;
+	}
+	PBK2HMARKER		pmarker = reinterpret_cast<PBK2HMARKER>(pmkval);
+	size_t			marklen = static_cast<size_t>(mkvallength);
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
+		ERR_K2HPRN("The marker is not same size which is calculated.");
+		K2H_Free(pmkval);
+		return false;
+	}
+	PK2HMARKEREXT	pext;
+	if(NULL == (pext = K2HShm::GetK2HMarkerExt(pmarker)) || (0 != (pext->flags & K2HMARKER_FLAG_COUNT_UNKNOWN) && !is_change_gen)){
+		MSG_K2HPRN("The marker does not have count, so nothing to do.");
+		K2H_Free(pmkval);
+		return true;
+	}
+	if(0 == (pext->flags & K2HMARKER_FLAG_COUNT_UNKNOWN)){
+		pext->count += delta;
+	}
+	if(is_change_gen){
+		pext->generation++;
+	}
+
+	// Set marker(marker does not have any attribute.)
+	if(!Set(byMark, marklength, &(pmarker->byData[0]), marklen, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
+		ERR_K2HPRN("Could not set marker.");
+		K2H_Free(pmkval);
+		return false;
+	}
+	K2H_Free(pmkval);
+
+	return true;
+}
+
+//
+// Copy count from current marker(which may be empty) to new marker.
+//
+// [NOTE]
+// GetMarker returns NULL for empty marker, but empty marker has count which
+// may not be 0 while other threads are pushing or popping. Thus the count
+// must be taken over when the marker is made newly.
+// This method must be called with WRITE LOCK for marker.
+//
+bool K2HShm::InheritK2HMarkerCount(const unsigned char* byMark, size_t marklength, PBK2HMARKER pnewmarker, int64_t delta) const
+{
+	unsigned char*	pmkval	= NULL;
+	ssize_t			mkvallength;
+	PBK2HMARKER		pmarker	= NULL;
+	if(-1 != (mkvallength = Get(byMark, marklength, &pmkval, false)) && pmkval){
+		pmarker = reinterpret_cast<PBK2HMARKER>(pmkval);
+		if(!K2HShm::IsSafeK2HMarker(pmarker, static_cast<size_t>(mkvallength)) || (K2HShm::IsEmptyK2HMarker(pmarker) && !K2HShm::GetK2HMarkerExt(pmarker))){
+			// broken or old type empty marker, it means new queue.
+			pmarker = NULL;
+		}
+	}
+	bool	result = K2HShm::CopyK2HMarkerCount(pnewmarker, pmarker, delta);
+	K2H_Free(pmkval);
+
+	return result;
+}
+
 //
 // Update only start marker without key modifying.
 //
 // [NOTICE] Be careful for using this method.
 //
-bool K2HShm::UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength)
+// popcount is the count of keys which are removed from queue by replacing
+// start key, if it is negative(unknown), the count in marker is unknown.
+//
+bool K2HShm::UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, long popcount)
 {
 	if(!byMark || 0 == marklength || ((NULL == byKey) != (0 == keylength))){
 		ERR_K2HPRN("Some parameters are wrong.");
@@ -265,7 +487,7 @@ bool K2HShm::UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength
 	size_t			marklen = static_cast<size_t>(mkvallength);
 
 	// Check current marker size
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		ERR_K2HPRN("The marker is not same size which is calculated.");
 		K2H_Free(pmkval);
 		return false;
@@ -280,13 +502,44 @@ bool K2HShm::UpdateStartK2HMarker(const unsigned char* byMark, size_t marklength
 	if(byKey){
 		if(0 != k2hbincmp(byKey, keylength, (&(pmarker->byData[0]) + pmarker->marker.startoff), pmarker->marker.startlen)){
 			// Update marker data
-			pmarker = K2HShm::UpdateK2HMarker(pmarker, marklen, byKey, keylength, false);
+			if(NULL == (pmarker = K2HShm::UpdateK2HMarker(pmarker, marklen, byKey, keylength, false, (popcount < 0 ? 0 : -static_cast<int64_t>(popcount))))){
+				ERR_K2HPRN("Could not make new marker value.");
+				return false;
+			}
+			// [NOTE]
+			// If the count of keys which are skipped by replacing start key is
+			// unknown, the count in marker is not correct after this.
+			//
+			PK2HMARKEREXT	pext = K2HShm::GetK2HMarkerExt(pmarker);
+			if(pext && popcount < 0){
+				pext->flags |= K2HMARKER_FLAG_COUNT_UNKNOWN;
+				K2HShm::ChangeK2HMarkerGeneration(pmarker);
+			}
 		}else{
 			// same queue key is already set, so nothing to do.
 		}
 	}else{
 		// There is no start queue key, it means the queue is empty.
-		pmarker = K2HShm::InitK2HMarker(marklen);
+		//
+		// [NOTE]
+		// headseq and generation are taken over, but the count of removed
+		// keys is unknown, then the generation is changed.
+		//
+		PBK2HMARKER	pnewmarker;
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(marklen))){
+			ERR_K2HPRN("Could not make new marker value.");
+			K2H_Free(pmkval);
+			return false;
+		}
+		PK2HMARKEREXT	pnewext = K2HShm::GetK2HMarkerExt(pnewmarker);
+		PK2HMARKEREXT	poldext = K2HShm::GetK2HMarkerExt(pmarker);
+		if(pnewext && poldext){
+			pnewext->headseq	= poldext->headseq;
+			pnewext->generation	= poldext->generation;
+		}
+		K2HShm::ChangeK2HMarkerGeneration(pnewmarker);
+		K2H_Free(pmkval);
+		pmarker = pnewmarker;
 	}
 
 	// Set new marker
@@ -333,7 +586,7 @@ bool K2HShm::IsEmptyQueue(const unsigned char* byMark, size_t marklength) const
 	}
 
 	// Check current marker size
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		ERR_K2HPRN("The marker is not same size which is calculated.");
 		K2H_Free(pmkval);
 		return true;		// marker is wrong size
@@ -347,6 +600,11 @@ bool K2HShm::IsEmptyQueue(const unsigned char* byMark, size_t marklength) const
 //
 // Returns queue count which is included expired keys.
 //
+// [NOTE]
+// If the marker has extended area, returns the count in it without tracing
+// queue. The count in it is not always exact while other threads are pushing
+// or popping, but it is converged when those are finished.
+//
 int K2HShm::GetCountQueue(const unsigned char* byMark, size_t marklength) const
 {
 	if(!byMark || 0 == marklength){
@@ -373,11 +631,22 @@ int K2HShm::GetCountQueue(const unsigned char* byMark, size_t marklength) const
 		return 0;
 	}
 	// Check current marker size
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		ERR_K2HPRN("The marker is not same size which is calculated.");
 		K2H_Free(pmkval);
 		return 0;
 	}
+	// count in extended marker
+	PK2HMARKEREXT	pext = K2HShm::GetK2HMarkerExt(pmarker);
+	if(pext && 0 == (pext->flags & K2HMARKER_FLAG_COUNT_UNKNOWN)){
+		int	count = (pext->count < 0 ? 0 : (static_cast<int64_t>(INT_MAX) < pext->count ? INT_MAX : static_cast<int>(pext->count)));
+		K2H_Free(pmkval);
+		return count;
+	}
+
+	// [NOTE]
+	// The marker is old type or the count is unknown, then count keys by tracing queue.
+	//
 	// copy start key
 	unsigned char*	pKey		= k2hbindup(&(pmarker->byData[pmarker->marker.startoff]), pmarker->marker.startlen);
 	size_t			keylength	= pmarker->marker.startlen;
@@ -458,7 +727,7 @@ bool K2HShm::ReadQueue(const unsigned char* byMark, size_t marklength, unsigned
 	}
 
 	// Check current marker size
-	if(marklen != (sizeof(K2HMARKER) + pmarker->marker.startlen + pmarker->marker.endlen)){
+	if(!K2HShm::IsSafeK2HMarker(pmarker, marklen)){
 		ERR_K2HPRN("The marker is not same size which is calculated.");
 		K2H_Free(pmkval);
 		return false;
@@ -476,6 +745,13 @@ bool K2HShm::ReadQueue(const unsigned char* byMark, size_t marklength, unsigned
 		*ppKey		= k2hbindup(&(pmarker->byData[pmarker->marker.endoff]), pmarker->marker.endlen);
 		keylength	= pmarker->marker.endlen;
 
+	}else if(K2HQINDEX_INTERVAL <= pos && K2HShm::GetK2HMarkerExt(pmarker)){
+		// Deep position, so trace keys from the nearest key in queue index
+		if(!ReadQueueByIndex(byMark, marklength, pmarker, ppKey, keylength, pos)){
+			// not found or there is no key by position.
+			K2H_Free(pmkval);
+			return false;
+		}
 	}else{
 		// loop count for searching
 		*ppKey		= k2hbindup(&(pmarker->byData[pmarker->marker.startoff]), pmarker->marker.startlen);
@@ -525,6 +801,248 @@ bool K2HShm::ReadQueue(const unsigned char* byMark, size_t marklength, unsigned
 	return true;
 }
 
+//---------------------------------------------------------
+// Methods for Queue index
+//---------------------------------------------------------
+// Utility structure for queue index
+//
+typedef struct k2h_queue_index_key{
+	int64_t		seq;
+	std::string	key;
+
+	bool operator<(const struct k2h_queue_index_key& other) const { return (seq < other.seq); }
+}K2HQIDXKEY;
+
+typedef std::vector<K2HQIDXKEY>	k2hqidxkeys_t;
+
+//
+// Returns index key name for marker, the caller must free it.
+//
+unsigned char* K2HShm::GetQueueIndexKey(const unsigned char* byMark, size_t marklength, size_t& keylength)
+{
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return NULL;
+	}
+	size_t			suffixlen = strlen(K2HQINDEX_SUFFIX);
+	unsigned char*	byKey;
+	if(NULL == (byKey = reinterpret_cast<unsigned char*>(malloc(marklength + suffixlen)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return NULL;
+	}
+	memcpy(byKey, byMark, marklength);
+	memcpy(&byKey[marklength], K2HQINDEX_SUFFIX, suffixlen);
+	keylength = marklength + suffixlen;
+
+	return byKey;
+}
+
+//
+// Get next key of byKey in queue, it is the first subkey of byKey.
+//
+bool K2HShm::GetNextQueueKey(const unsigned char* byKey, size_t keylength, unsigned char** ppNextKey, size_t& nextlength) const
+{
+	*ppNextKey	= NULL;
+	nextlength	= 0;
+
+	// get subkeys.(do not check attribute for no expire)
+	K2HSubKeys*	psubkeys;
+	if(NULL == (psubkeys = GetSubKeys(byKey, keylength, false))){
+		// There is no key nor subkeys
+		return false;
+	}
+	K2HSubKeys::iterator iter = psubkeys->begin();
+	if(iter == psubkeys->end()){
+		// Current key does not have any subkey.
+		K2H_Delete(psubkeys);
+		return false;
+	}
+	*ppNextKey	= k2hbindup(iter->pSubKey, iter->length);
+	nextlength	= iter->length;
+	K2H_Delete(psubkeys);
+
+	return (NULL != *ppNextKey);
+}
+
+//
+// Read key at position in queue by the queue index.
+//
+// [NOTE]
+// The queue index has the keys which sequence number is multiple of
+// K2HQINDEX_INTERVAL, this method traces keys from the nearest key in
+// index which is not popped yet. Thus the count of tracing keys is less
+// than K2HQINDEX_INTERVAL when the position is in indexed range.
+// While tracing keys over indexed range, this method adds new keys into
+// the index, and saves it.
+// If the index is made by other generation or the key in index is not
+// found, the index is made from the start of queue again.
+//
+bool K2HShm::ReadQueueByIndex(const unsigned char* byMark, size_t marklength, PBK2HMARKER pmarker, unsigned char** ppKey, size_t& keylength, int pos) const
+{
+	PK2HMARKEREXT	pext;
+	if(NULL == (pext = K2HShm::GetK2HMarkerExt(pmarker)) || pos < 0){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	int64_t			target = pext->headseq + static_cast<int64_t>(pos);
+	size_t			idxkeylen;
+	unsigned char*	byIdxKey;
+	if(NULL == (byIdxKey = K2HShm::GetQueueIndexKey(byMark, marklength, idxkeylen))){
+		return false;
+	}
+
+	// load index which is made by same generation, and skip popped keys
+	k2hqidxkeys_t	idxkeys;
+	bool			is_changed	= false;
+	unsigned char*	pidxval		= NULL;
+	ssize_t			idxvallen	= Get(byIdxKey, idxkeylen, &pidxval, false);
+	if(pidxval && static_cast<ssize_t>(sizeof(K2HQINDEX)) <= idxvallen){
+		PK2HQINDEX		pindex	= reinterpret_cast<PK2HQINDEX>(pidxval);
+		PK2HQINDEXENT	pentries= reinterpret_cast<PK2HQINDEXENT>(pidxval + sizeof(K2HQINDEX));
+		if(	K2HQINDEX_VERSION == pindex->version && pext->generation == pindex->generation &&
+			(sizeof(K2HQINDEX) + sizeof(K2HQINDEXENT) * pindex->count) <= static_cast<size_t>(idxvallen) )
+		{
+			for(size_t cnt = 0; cnt < pindex->count; ++cnt){
+				if(static_cast<size_t>(idxvallen) < (static_cast<size_t>(pentries[cnt].keyoff) + pentries[cnt].keylen)){
+					idxkeys.clear();
+					break;
+				}
+				if(pentries[cnt].seq < pext->headseq){
+					is_changed = true;				// popped key
+					continue;
+				}
+				K2HQIDXKEY	idxkey;
+				idxkey.seq	= pentries[cnt].seq;
+				idxkey.key.assign(reinterpret_cast<const char*>(pidxval + pentries[cnt].keyoff), pentries[cnt].keylen);
+				idxkeys.push_back(idxkey);
+			}
+		}else{
+			is_changed = true;						// other generation
+		}
+	}
+	K2H_Free(pidxval);
+
+	// trace keys
+	const unsigned char*	byEndKey	= &(pmarker->byData[pmarker->marker.endoff]);
+	size_t					endlen		= pmarker->marker.endlen;
+	bool					result		= false;
+	*ppKey								= NULL;
+	keylength							= 0;
+	for(bool is_retry = false; !result; is_retry = true){
+		// find nearest key in index(sorted by sequence number)
+		K2HQIDXKEY						targetkey;
+		targetkey.seq					= target;
+		k2hqidxkeys_t::const_iterator	iter;
+		k2hqidxkeys_t::const_iterator	nearest = std::upper_bound(idxkeys.begin(), idxkeys.end(), targetkey);
+		nearest = (nearest == idxkeys.begin()) ? idxkeys.end() : (nearest - 1);
+
+		int64_t	curseq;
+		if(nearest != idxkeys.end()){
+			*ppKey		= k2hbindup(reinterpret_cast<const unsigned char*>(nearest->key.data()), nearest->key.length());
+			keylength	= nearest->key.length();
+			curseq		= nearest->seq;
+		}else{
+			*ppKey		= k2hbindup(&(pmarker->byData[pmarker->marker.startoff]), pmarker->marker.startlen);
+			keylength	= pmarker->marker.startlen;
+			curseq		= pext->headseq;
+		}
+
+		k2hqidxkeys_t	newkeys;
+		bool			is_broken = false;
+		for(; *ppKey && curseq < target; ++curseq){
+			// check end of queue
+			if(0 == k2hbincmp(*ppKey, keylength, byEndKey, endlen)){
+				K2H_Free(*ppKey);
+				break;
+			}
+			unsigned char*	pNextKey	= NULL;
+			size_t			nextlength	= 0;
+			if(!GetNextQueueKey(*ppKey, keylength, &pNextKey, nextlength)){
+				K2H_Free(*ppKey);
+				is_broken = true;
+				break;
+			}
+			K2H_Free(*ppKey);
+			*ppKey		= pNextKey;
+			keylength	= nextlength;
+
+			// add new key into index
+			if(0 == (((curseq + 1) % K2HQINDEX_INTERVAL) + K2HQINDEX_INTERVAL) % K2HQINDEX_INTERVAL){
+				K2HQIDXKEY	idxkey;
+				idxkey.seq	= curseq + 1;
+				idxkey.key.assign(reinterpret_cast<const char*>(*ppKey), keylength);
+				newkeys.push_back(idxkey);
+			}
+		}
+		if(is_broken && !is_retry && !idxkeys.empty()){
+			// [NOTE]
+			// The key in index is not found(popped by other or index is old),
+			// then retry to trace from the start of queue without index.
+			//
+			MSG_K2HPRN("Could not trace keys from the key in queue index, so retry from start of queue.");
+			idxkeys.clear();
+			is_changed = true;
+			continue;
+		}
+		if(!*ppKey){
+			keylength = 0;
+			break;
+		}
+		result = true;
+
+		// merge new keys into index
+		for(iter = newkeys.begin(); iter != newkeys.end(); ++iter){
+			bool	is_found = false;
+			for(k2hqidxkeys_t::const_iterator iter2 = idxkeys.begin(); iter2 != idxkeys.end(); ++iter2){
+				if(iter2->seq == iter->seq){
+					is_found = true;
+					break;
+				}
+			}
+			if(!is_found){
+				idxkeys.push_back(*iter);
+				is_changed = true;
+			}
+		}
+	}
+
+	// save index
+	if(is_changed && !isReadMode){
+		std::sort(idxkeys.begin(), idxkeys.end());
+
+		size_t	idxlength = sizeof(K2HQINDEX) + sizeof(K2HQINDEXENT) * idxkeys.size();
+		for(k2hqidxkeys_t::const_iterator iter = idxkeys.begin(); iter != idxkeys.end(); ++iter){
+			idxlength += iter->key.length();
+		}
+		unsigned char*	byIndex;
+		if(NULL == (byIndex = reinterpret_cast<unsigned char*>(malloc(idxlength)))){
+			ERR_K2HPRN("Could not allocation memory.");
+		}else{
+			PK2HQINDEX		pindex		= reinterpret_cast<PK2HQINDEX>(byIndex);
+			PK2HQINDEXENT	pentries	= reinterpret_cast<PK2HQINDEXENT>(byIndex + sizeof(K2HQINDEX));
+			off_t			keyoff		= static_cast<off_t>(sizeof(K2HQINDEX) + sizeof(K2HQINDEXENT) * idxkeys.size());
+			pindex->version				= K2HQINDEX_VERSION;
+			pindex->generation			= pext->generation;
+			pindex->count				= idxkeys.size();
+			for(size_t cnt = 0; cnt < idxkeys.size(); ++cnt){
+				pentries[cnt].seq		= idxkeys[cnt].seq;
+				pentries[cnt].keyoff	= keyoff;
+				pentries[cnt].keylen	= idxkeys[cnt].key.length();
+				memcpy(byIndex + keyoff, idxkeys[cnt].key.data(), idxkeys[cnt].key.length());
+				keyoff					+= static_cast<off_t>(idxkeys[cnt].key.length());
+			}
+			// index key does not have any attribute.
+			if(!const_cast<K2HShm*>(this)->Set(byIdxKey, idxkeylen, byIndex, idxlength, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
+				WAN_K2HPRN("Could not save queue index, but continue...");
+			}
+			K2H_Free(byIndex);
+		}
+	}
+	K2H_Free(byIdxKey);
+
+	return result;
+}
+
 //
 // Read key from queue at position which is based top of queue.
 //
@@ -569,11 +1087,53 @@ bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const unsi
 	}
 	K2HFILE_UPDATE_CHECK(this);
 
+	K2HBIN	key		= {const_cast<unsigned char*>(byKey), keylength};
+	K2HBIN	value	= {const_cast<unsigned char*>(byValue), vallength};
+
 	bool	result;
 	if(is_fifo){
-		result = AddFifoQueue(byMark, marklength, byKey, keylength, byValue, vallength, attrtype, pAttrs, encpass, expire);
+		result = AddFifoQueue(byMark, marklength, &key, &value, 1, attrtype, pAttrs, encpass, expire);
 	}else{
-		result = AddLifoQueue(byMark, marklength, byKey, keylength, byValue, vallength, attrtype, pAttrs, encpass, expire);
+		result = AddLifoQueue(byMark, marklength, &key, &value, 1, attrtype, pAttrs, encpass, expire);
+	}
+	if(result){
+		WakeupQueueWaiters();
+	}
+	return result;
+}
+
+//
+// Add keys into queue at once.
+//
+// pkeys and pvals(allowed NULL) are arrays which have count elements.
+// The order of popping is as same as pushing keys one by one from first key.
+//
+bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, bool is_fifo, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+{
+	if(!byMark || 0 == marklength || !pkeys || 0 == count){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	for(size_t pos = 0; pos < count; ++pos){
+		if(!pkeys[pos].byptr || 0 == pkeys[pos].length){
+			ERR_K2HPRN("Key(position %zu) is empty.", pos);
+			return false;
+		}
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	bool	result;
+	if(is_fifo){
+		result = AddFifoQueue(byMark, marklength, pkeys, pvals, count, attrtype, pAttrs, encpass, expire);
+	}else{
+		result = AddLifoQueue(byMark, marklength, pkeys, pvals, count, attrtype, pAttrs, encpass, expire);
+	}
+	if(result){
+		WakeupQueueWaiters();
 	}
 	return result;
 }
@@ -581,18 +1141,37 @@ bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const unsi
 //
 // Add data to FIFO queue
 //
-bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+// [NOTE]
+// This method adds keys(pkeys) which count is specified into the queue.
+// At first, all keys are made and are linked from first to last by subkeys,
+// and then the first key is linked into end key in queue, and the marker is
+// updated only once. The first key in pkeys is popped first.
+//
+bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
 {
 	//--------------------------------------
-	// Make new key in K2hash
+	// Make new keys in K2hash
 	//--------------------------------------
 	//
 	// attrtype should be allowed OPSMAN_MASK_QUEUEKEY, OPSMAN_MASK_TRANSQUEUEKEY, OPSMAN_MASK_QUEUEMARKER and OPSMAN_MASK_KEYQUEUEKEY for Queue
 	//
-	if(!Set(byKey, keylength, byValue, vallength, NULL, true, pAttrs, encpass, expire, attrtype)){
-		ERR_K2HPRN("Could not make new key.");
-		return false;
+	for(size_t pos = 0; pos < count; ++pos){
+		K2HSubKeys*	pnextskeys = NULL;
+		if((pos + 1) < count){
+			pnextskeys = new K2HSubKeys();
+			pnextskeys->insert(pkeys[pos + 1].byptr, pkeys[pos + 1].length);
+		}
+		if(!Set(pkeys[pos].byptr, pkeys[pos].length, (pvals ? pvals[pos].byptr : NULL), (pvals ? pvals[pos].length : 0), pnextskeys, true, pAttrs, encpass, expire, attrtype)){
+			ERR_K2HPRN("Could not make new key.");
+			K2H_Delete(pnextskeys);
+			return false;
+		}
+		K2H_Delete(pnextskeys);
 	}
+	const unsigned char*	byKey		= pkeys[0].byptr;				// first key which is linked from end key in queue
+	size_t					keylength	= pkeys[0].length;
+	const unsigned char*	byLastKey	= pkeys[count - 1].byptr;		// last key which is new end key in queue
+	size_t					lastkeylen	= pkeys[count - 1].length;
 
 	// Read marker
 	PBK2HMARKER				before_marker	= GetMarker(byMark, marklength);
@@ -605,6 +1184,7 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 	const unsigned char*	last_endkey		= NULL;
 	size_t					last_endlen		= 0;
 	bool					result			= false;	// result code and for loop flag
+	bool					is_counted		= false;	// whether count in marker is updated
 
 	do{
 		//--------------------------------------
@@ -717,7 +1297,7 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 				// ---> update marker
 				//
 				size_t	marklen	= 0;
-				if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byKey, keylength, true))){		// FIFO
+				if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byLastKey, lastkeylen, true, static_cast<int64_t>(count)))){		// FIFO
 					ERR_K2HPRN("Could not make new marker value.");
 					break;													// automatically unlock ALObjCKI_Marker
 				}
@@ -727,11 +1307,12 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 					ERR_K2HPRN("Could not set new marker.");
 					break;													// automatically unlock ALObjCKI_Marker
 				}
-				result = true;												// automatically unlock ALObjCKI_Marker
+				is_counted	= true;
+				result		= true;											// automatically unlock ALObjCKI_Marker
 
-			}else if(0 == k2hbincmp(byKey, keylength, after_endkey, after_endlen)){
+			}else if(0 == k2hbincmp(byLastKey, lastkeylen, after_endkey, after_endlen)){
 				//
-				// marker's end key is changed, and is as same as new key
+				// marker's end key is changed, and is as same as new(last) key
 				// ---> thus we do not any processing.
 				//
 				result = true;												// automatically unlock ALObjCKI_Marker
@@ -750,7 +1331,7 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 				//
 				K2HLock		ALObjCKI_Newkey(K2HLock::RWLOCK);				// auto release locking at leaving in this scope.
 				PELEMENT	pNewkeyElement;
-				if(NULL == (pNewkeyElement = GetElement(byKey, keylength, ALObjCKI_Newkey))){
+				if(NULL == (pNewkeyElement = GetElement(byLastKey, lastkeylen, ALObjCKI_Newkey))){
 					//
 					// there is no new key, probably already popped it.
 					// ---> thus we do not any processing.
@@ -804,7 +1385,7 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 					// there is now marker, but it does not have end key
 					// ---> update marker
 					//
-					if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byKey, keylength, true))){		// FIFO
+					if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byLastKey, lastkeylen, true, static_cast<int64_t>(count)))){		// FIFO
 						ERR_K2HPRN("Could not make new marker value.");
 						break;												// automatically unlock ALObjCKI_Marker
 					}
@@ -813,10 +1394,11 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 					// both before and now marker do not exist.
 					// ---> update(create new) marker
 					//
-					if(NULL == (after_marker = K2HShm::InitK2HMarker(marklen, byKey, keylength))){
+					if(NULL == (after_marker = K2HShm::InitK2HMarker(marklen, byKey, keylength, byLastKey, lastkeylen))){
 						ERR_K2HPRN("Could not create marker.");
 						break;												// automatically unlock ALObjCKI_Marker
 					}
+					InheritK2HMarkerCount(byMark, marklength, after_marker, static_cast<int64_t>(count));
 				}
 
 				// Set new marker(marker does not have any attribute.)
@@ -824,6 +1406,7 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 					ERR_K2HPRN("Could not set new marker.");
 					break;													// automatically unlock ALObjCKI_Marker
 				}
+				is_counted = true;
 			}else{
 				//
 				// before marker exists, and it has end of key.
@@ -846,6 +1429,17 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 		}
 	}while(!result);
 
+	// [NOTE]
+	// If the new key was linked into queue but the marker was not updated by
+	// this method(ex. the key had already been popped), the count in marker
+	// is updated here.
+	//
+	if(result && !is_counted){
+		if(!AddK2HMarkerCount(byMark, marklength, static_cast<int64_t>(count))){
+			WAN_K2HPRN("Could not update count in marker, but continue...");
+		}
+	}
+
 	K2H_Free(before_marker);
 	K2H_Free(after_marker);
 	K2H_Free(last_marker);
@@ -856,8 +1450,33 @@ bool K2HShm::AddFifoQueue(const unsigned char* byMark, size_t marklength, const
 //
 // Add data to LIFO queue
 //
-bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, const unsigned char* byValue, size_t vallength, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
+// [NOTE]
+// This method adds keys(pkeys) which count is specified into the queue.
+// The keys are linked from last to first by subkeys, as same as the result
+// which is pushed one by one. Then the last key in pkeys is popped first.
+// The first key is linked to start key in queue, and the marker is updated
+// only once.
+//
+bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, const PK2HBIN pvals, size_t count, K2hAttrOpsMan::ATTRINITTYPE attrtype, K2HAttrs* pAttrs, const char* encpass, const time_t* expire)
 {
+	//--------------------------------------
+	// Make new keys in K2hash without first key
+	//--------------------------------------
+	for(size_t pos = 1; pos < count; ++pos){
+		K2HSubKeys	prevskeys;
+		prevskeys.insert(pkeys[pos - 1].byptr, pkeys[pos - 1].length);
+		if(!Set(pkeys[pos].byptr, pkeys[pos].length, (pvals ? pvals[pos].byptr : NULL), (pvals ? pvals[pos].length : 0), &prevskeys, true, pAttrs, encpass, expire, attrtype)){
+			ERR_K2HPRN("Could not make new key.");
+			return false;
+		}
+	}
+	const unsigned char*	byKey		= pkeys[0].byptr;				// first key which is linked to start key in queue
+	size_t					keylength	= pkeys[0].length;
+	const unsigned char*	byValue		= pvals ? pvals[0].byptr : NULL;
+	size_t					vallength	= pvals ? pvals[0].length : 0;
+	const unsigned char*	byLastKey	= pkeys[count - 1].byptr;		// last key which is new start key in queue
+	size_t					lastkeylen	= pkeys[count - 1].length;
+
 	// Read marker
 	PBK2HMARKER				before_marker	= GetMarker(byMark, marklength);
 	const unsigned char*	before_startkey	= before_marker ? &(before_marker->byData[before_marker->marker.startoff]) : NULL;
@@ -931,7 +1550,7 @@ bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const
 				// ---> update marker
 				//
 				size_t	marklen	= 0;
-				if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byKey, keylength, false))){		// LIFO
+				if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byLastKey, lastkeylen, false, static_cast<int64_t>(count)))){		// LIFO
 					ERR_K2HPRN("Could not make new marker value.");
 					break;													// automatically unlock ALObjCKI_Marker
 				}
@@ -943,9 +1562,9 @@ bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const
 				}
 				result = true;												// automatically unlock ALObjCKI_Marker
 
-			}else if(0 == k2hbincmp(byKey, keylength, after_startkey, after_startlen)){
+			}else if(0 == k2hbincmp(byLastKey, lastkeylen, after_startkey, after_startlen)){
 				//
-				// marker's start key is changed, and is as same as new key
+				// marker's start key is changed, and is as same as new(last) key
 				// ---> thus we do not any processing.
 				//
 				result = true;												// automatically unlock ALObjCKI_Marker
@@ -979,7 +1598,7 @@ bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const
 					// there is now marker, but it does not have start key
 					// ---> update marker
 					//
-					if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byKey, keylength, false))){		// LIFO
+					if(NULL == (after_marker = K2HShm::UpdateK2HMarker(after_marker, marklen, byLastKey, lastkeylen, false, static_cast<int64_t>(count)))){		// LIFO
 						ERR_K2HPRN("Could not make new marker value.");
 						break;												// automatically unlock ALObjCKI_Marker
 					}
@@ -988,10 +1607,11 @@ bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const
 					// both before and now marker do not exist.
 					// ---> update(create new) marker
 					//
-					if(NULL == (after_marker = K2HShm::InitK2HMarker(marklen, byKey, keylength))){
+					if(NULL == (after_marker = K2HShm::InitK2HMarker(marklen, byLastKey, lastkeylen, byKey, keylength))){
 						ERR_K2HPRN("Could not create marker.");
 						break;												// automatically unlock ALObjCKI_Marker
 					}
+					InheritK2HMarkerCount(byMark, marklength, after_marker, static_cast<int64_t>(count));
 				}
 
 				// Set new marker(marker does not have any attribute.)
@@ -1030,10 +1650,27 @@ bool K2HShm::AddLifoQueue(const unsigned char* byMark, size_t marklength, const
 //
 bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const unsigned char* byKey, size_t keylength, bool is_fifo)
 {
-	if(!byMark || 0 == marklength || !byKey || 0 == keylength){
+	K2HBIN	key = {const_cast<unsigned char*>(byKey), keylength};
+	return AddQueue(byMark, marklength, &key, 1, is_fifo);
+}
+
+//
+// This method does not update any queued key and queued key's subkey, as same as above.
+// The keys in pkeys must be linked by caller before calling this, the first key in pkeys
+// is linked from end of queue(FIFO) or to start of queue(LIFO).
+//
+bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pkeys, size_t count, bool is_fifo)
+{
+	if(!byMark || 0 == marklength || !pkeys || 0 == count){
 		ERR_K2HPRN("Some parameters are wrong.");
 		return false;
 	}
+	for(size_t pos = 0; pos < count; ++pos){
+		if(!pkeys[pos].byptr || 0 == pkeys[pos].length){
+			ERR_K2HPRN("Key(position %zu) is empty.", pos);
+			return false;
+		}
+	}
 	if(!IsAttached()){
 		ERR_K2HPRN("There is no attached K2HASH.");
 		return false;
@@ -1049,13 +1686,28 @@ bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const unsi
 			ERR_K2HPRN("Could not make new marker value.");
 			return false;
 		}
+		InheritK2HMarkerCount(byMark, marklength, pmarker, 0);
 	}
 
 	// Update marker data
-	if(NULL == (pmarker = K2HShm::UpdateK2HMarker(pmarker, marklen, byKey, keylength, is_fifo))){
-		ERR_K2HPRN("Could not make new marker value.");
+	if(K2HShm::IsEmptyK2HMarker(pmarker)){
+		// start key is first key for FIFO, last key for LIFO.
+		const PK2HBIN	pstart	= is_fifo ? &pkeys[0] : &pkeys[count - 1];
+		const PK2HBIN	pend	= is_fifo ? &pkeys[count - 1] : &pkeys[0];
+		PBK2HMARKER		pnewmarker;
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(marklen, pstart->byptr, pstart->length, pend->byptr, pend->length))){
+			ERR_K2HPRN("Could not make new marker value.");
+			K2H_Free(pmarker);
+			return false;
+		}
+		K2HShm::CopyK2HMarkerCount(pnewmarker, pmarker, static_cast<int64_t>(count));
 		K2H_Free(pmarker);
-		return false;
+		pmarker = pnewmarker;
+	}else{
+		if(NULL == (pmarker = K2HShm::UpdateK2HMarker(pmarker, marklen, pkeys[count - 1].byptr, pkeys[count - 1].length, is_fifo, static_cast<int64_t>(count)))){
+			ERR_K2HPRN("Could not make new marker value.");
+			return false;
+		}
 	}
 
 	// Set new marker
@@ -1068,6 +1720,9 @@ bool K2HShm::AddQueue(const unsigned char* byMark, size_t marklength, const unsi
 		return false;
 	}
 	K2H_Free(pmarker);
+	ALObjCKI.Unlock();
+
+	WakeupQueueWaiters();
 
 	return true;
 }
@@ -1181,6 +1836,9 @@ bool K2HShm::PopQueueEx(const unsigned char* byMark, size_t marklength, bool& is
 
 		// cppcheck-suppress nullPointer
 		if(!after_marker){
+			// [NOTE]
+			// Other consumer popped all keys after reading marker, it is not error.
+			//
 			MSG_K2HPRN("After reading marker, the marker is empty or wrong size.");
 
 			K2H_Free(before_marker);
@@ -1190,7 +1848,7 @@ bool K2HShm::PopQueueEx(const unsigned char* byMark, size_t marklength, bool& is
 			vallength	= 0;
 			is_found	= false;
 			is_expired	= false;
-			return false;											// automatically unlock ALObjCKI_Marker
+			return true;											// automatically unlock ALObjCKI_Marker
 		}
 
 		// Check popped key name, compare it and before reading key name.
@@ -1224,6 +1882,8 @@ bool K2HShm::PopQueueEx(const unsigned char* byMark, size_t marklength, bool& is
 			return false;											// automatically unlock ALObjCKI_Marker
 		}
 		K2H_Delete(psubkeys);
+		K2HShm::CopyK2HMarkerCount(pnewmarker, after_marker, -1);
+		K2HShm::ShiftK2HMarkerHead(pnewmarker, 1);
 
 		// Set new marker(marker does not have any attribute)
 		if(!Set(byMark, marklength, &(pnewmarker->byData[0]), newmarklen, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
@@ -1316,6 +1976,217 @@ bool K2HShm::PopQueue(const unsigned char* byMark, size_t marklength, unsigned c
 	return result;
 }
 
+//
+// Pop keys from top of queue at once.
+//
+// This method traces keys from top of queue up to maxcount, and updates the
+// marker only once for those keys. The expired keys are removed but are not
+// returned. ppkeys and ppvals(allowed NULL) are allocated arrays which have
+// popcount elements, caller must free those by free_k2hbins().
+//
+// Returns	false:	Something error occurred.
+//			true:	Succeed(popcount is 0 if there is no popping data)
+//
+bool K2HShm::PopQueue(const unsigned char* byMark, size_t marklength, size_t maxcount, PK2HBIN* ppkeys, PK2HBIN* ppvals, size_t& popcount, const char* encpass)
+{
+	if(!byMark || 0 == marklength || 0 == maxcount || !ppkeys){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	popcount	= 0;
+	*ppkeys		= NULL;
+	if(ppvals){
+		*ppvals	= NULL;
+	}
+
+	PK2HBIN	pkeys		= reinterpret_cast<PK2HBIN>(calloc(maxcount, sizeof(K2HBIN)));
+	PK2HBIN	pvals		= reinterpret_cast<PK2HBIN>(calloc(maxcount, sizeof(K2HBIN)));
+	PK2HBIN	ptraced		= reinterpret_cast<PK2HBIN>(calloc(maxcount, sizeof(K2HBIN)));
+	bool*	pexpired	= reinterpret_cast<bool*>(calloc(maxcount, sizeof(bool)));
+	if(!pkeys || !pvals || !ptraced || !pexpired){
+		ERR_K2HPRN("Could not allocation memory.");
+		K2H_Free(pkeys);
+		K2H_Free(pvals);
+		K2H_Free(ptraced);
+		K2H_Free(pexpired);
+		return false;
+	}
+
+	bool	result = true;
+	while(popcount < maxcount){
+		//--------------------------------------
+		// Read marker without WRITE LOCK
+		//--------------------------------------
+		PBK2HMARKER	before_marker = GetMarker(byMark, marklength);
+		if(!before_marker){
+			// there is no marker or no start key of queue, it means no stacked key in queue.
+			break;
+		}
+		const unsigned char*	before_startkey	= &(before_marker->byData[before_marker->marker.startoff]);
+		size_t					before_startlen	= before_marker->marker.startlen;
+		const unsigned char*	before_endkey	= &(before_marker->byData[before_marker->marker.endoff]);
+		size_t					before_endlen	= before_marker->marker.endlen;
+
+		//--------------------------------------
+		// Trace keys from start key without WRITE LOCK
+		//--------------------------------------
+		size_t			tracecnt	= 0;
+		unsigned char*	pKey		= k2hbindup(before_startkey, before_startlen);
+		size_t			keylength	= before_startlen;
+		while(pKey){
+			ptraced[tracecnt].byptr		= pKey;
+			ptraced[tracecnt].length	= keylength;
+			pexpired[tracecnt]			= false;
+			++tracecnt;
+
+			// check expire
+			K2HATTRFLAGS	attrflags;
+			if(GetAttrFlags(pKey, keylength, attrflags) && K2hAttrBuiltin::IsExpire(attrflags)){
+				pexpired[tracecnt - 1] = true;
+			}
+
+			// check end of queue or reached max count
+			if(0 == k2hbincmp(pKey, keylength, before_endkey, before_endlen) || maxcount <= (popcount + tracecnt)){
+				break;
+			}
+
+			// get next key(without checking attribute)
+			K2HSubKeys*	psubkeys;
+			if(NULL == (psubkeys = GetSubKeys(pKey, keylength, false))){
+				break;
+			}
+			K2HSubKeys::iterator	iter = psubkeys->begin();
+			if(iter == psubkeys->end()){
+				K2H_Delete(psubkeys);
+				break;
+			}
+			pKey		= k2hbindup(iter->pSubKey, iter->length);
+			keylength	= iter->length;
+			K2H_Delete(psubkeys);
+		}
+		if(0 == tracecnt){
+			ERR_K2HPRN("Could not allocation memory.");
+			K2H_Free(before_marker);
+			result = false;
+			break;
+		}
+
+		//--------------------------------------
+		// Re-Read marker with WRITE LOCK
+		//--------------------------------------
+		K2HLock		ALObjCKI_Marker(K2HLock::RWLOCK);					// auto release locking at leaving in this scope.
+		PBK2HMARKER	after_marker = GetMarker(byMark, marklength, &ALObjCKI_Marker);
+		if(!after_marker || 0 != k2hbincmp(before_startkey, before_startlen, &(after_marker->byData[after_marker->marker.startoff]), after_marker->marker.startlen)){
+			// start key is changed(or queue is empty), thus retry from first.
+			ALObjCKI_Marker.Unlock();									// manually unlock
+			bool	is_empty = (NULL == after_marker);
+			K2H_Free(before_marker);
+			K2H_Free(after_marker);
+			for(size_t cnt = 0; cnt < tracecnt; ++cnt){
+				K2H_Free(ptraced[cnt].byptr);
+			}
+			if(is_empty){
+				break;
+			}
+			continue;
+		}
+
+		// [NOTE]
+		// Next start key is read with marker WRITE LOCK, because the end key
+		// may be linked to new key by pushing after tracing.
+		//
+		K2HSubKeys*				pnextskeys	= GetSubKeys(ptraced[tracecnt - 1].byptr, ptraced[tracecnt - 1].length, false);
+		const unsigned char*	pnextstart	= NULL;
+		size_t					nextstartLen= 0;
+		if(pnextskeys){
+			K2HSubKeys::iterator	iter = pnextskeys->begin();
+			if(iter != pnextskeys->end()){
+				pnextstart	= iter->pSubKey;
+				nextstartLen= iter->length;
+			}
+		}
+
+		// Make new next K2HMaker
+		PBK2HMARKER	pnewmarker;
+		size_t		newmarklen	= 0;
+		if(NULL == (pnewmarker = K2HShm::InitK2HMarker(newmarklen, pnextstart, nextstartLen, (0 == after_marker->marker.endlen ? NULL : (&(after_marker->byData[0]) + after_marker->marker.endoff)), after_marker->marker.endlen))){
+			ERR_K2HPRN("Something error is occurred to make new marker.");
+			result = false;
+		}else{
+			K2HShm::CopyK2HMarkerCount(pnewmarker, after_marker, -static_cast<int64_t>(tracecnt));
+			K2HShm::ShiftK2HMarkerHead(pnewmarker, static_cast<int64_t>(tracecnt));
+
+			// Set new marker(marker does not have any attribute)
+			if(!Set(byMark, marklength, &(pnewmarker->byData[0]), newmarklen, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
+				ERR_K2HPRN("Could not set new marker.");
+				result = false;
+			}
+		}
+		K2H_Free(pnewmarker);
+		K2H_Delete(pnextskeys);
+		K2H_Free(before_marker);
+		K2H_Free(after_marker);
+		ALObjCKI_Marker.Unlock();										// manually unlock
+
+		if(!result){
+			for(size_t cnt = 0; cnt < tracecnt; ++cnt){
+				K2H_Free(ptraced[cnt].byptr);
+			}
+			break;
+		}
+
+		//--------------------------------------
+		// Get values and remove keys
+		//--------------------------------------
+		for(size_t cnt = 0; cnt < tracecnt; ++cnt){
+			unsigned char*	pValue	= NULL;
+			ssize_t			vallen	= -1;
+			if(!pexpired[cnt] && -1 == (vallen = Get(ptraced[cnt].byptr, ptraced[cnt].length, &pValue, true, encpass))){
+				MSG_K2HPRN("Could not get popped key value(there is no value or key is expired.)");
+			}
+
+			// Remove key(without subkey & history)
+			if(!Remove(ptraced[cnt].byptr, ptraced[cnt].length, false, NULL, true)){
+				ERR_K2HPRN("Could not remove popped key, but continue...");
+			}
+
+			if(pexpired[cnt]){
+				K2H_Free(ptraced[cnt].byptr);
+				K2H_Free(pValue);
+			}else{
+				pkeys[popcount].byptr	= ptraced[cnt].byptr;
+				pkeys[popcount].length	= ptraced[cnt].length;
+				pvals[popcount].byptr	= pValue;
+				pvals[popcount].length	= (-1 == vallen ? 0 : static_cast<size_t>(vallen));
+				++popcount;
+			}
+			ptraced[cnt].byptr = NULL;
+		}
+	}
+	K2H_Free(ptraced);
+	K2H_Free(pexpired);
+
+	if(!result || 0 == popcount){
+		free_k2hbins(pkeys, popcount);
+		free_k2hbins(pvals, popcount);
+		popcount = 0;
+		return result;
+	}
+	*ppkeys = pkeys;
+	if(ppvals){
+		*ppvals = pvals;
+	}else{
+		free_k2hbins(pvals, popcount);
+	}
+	return true;
+}
+
 int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned int count, bool rmkeyval, k2h_q_remove_trial_callback fp, void* pExtData, const char* encpass)
 {
 	if(!byMark || 0 == marklength){
@@ -1448,6 +2319,8 @@ int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned
 					K2H_Free(pTmpValue);
 					break;													// automatically unlock ALObjCKI_Marker
 				}
+				K2HShm::CopyK2HMarkerCount(pnewmarker, after_marker, -1);
+				K2HShm::ShiftK2HMarkerHead(pnewmarker, 1);
 
 				// Set new marker(marker does not have any attribute)
 				if(!Set(byMark, marklength, &(pnewmarker->byData[0]), newmarklen, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
@@ -1617,8 +2490,8 @@ int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned
 					break;													// automatically unlock ALObjCKI_TopKey
 				}
 				// compare subkey
-				if(0 == k2hbincmp(pnextkey, nextkeyLen, reiter->pSubKey, reiter->length)){
-					MSG_K2HPRN("top normal key is end of queue key. thus stop removing.");
+				if(0 != k2hbincmp(pnextkey, nextkeyLen, reiter->pSubKey, reiter->length)){
+					MSG_K2HPRN("next key of top normal key is changed by other, thus stop removing.");
 					K2H_Free(current_marker);
 					K2H_Delete(psubkeys);
 					K2H_Delete(pnextendskeys);
@@ -1628,10 +2501,12 @@ int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned
 				}
 				K2H_Delete(presubkeys);
 
-				// replace subkeys to top key
+				// replace subkeys to top key(the removing key may be end of queue which does not have subkeys)
 				unsigned char*	bySubkeys = NULL;
 				size_t			skeylength= 0UL;
-				pnextendskeys->Serialize(&bySubkeys, skeylength);
+				if(pnextendskeys){
+					pnextendskeys->Serialize(&bySubkeys, skeylength);
+				}
 				if(!ReplaceSubkeys(ptopkey, topkeylen, bySubkeys, skeylength)){
 					ERR_K2HPRN("Failed to insert new subkeys into normal top key in queue.");
 
@@ -1661,6 +2536,11 @@ int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned
 				}
 				removed_count++;
 
+				// update count in marker(the key in the middle of queue is removed)
+				if(!AddK2HMarkerCount(byMark, marklength, -1, true)){
+					WAN_K2HPRN("Could not update count in marker, but continue...");
+				}
+
 				// special update marker end key if it's needed.
 				if(is_update_marker){
 					//--------------------------------------
@@ -1707,6 +2587,7 @@ int K2HShm::RemoveQueue(const unsigned char* byMark, size_t marklength, unsigned
 						K2H_Free(pTmpValue);
 						break;													// automatically unlock ALObjCKI_Marker
 					}
+					K2HShm::CopyK2HMarkerCount(pnewmarker, after_marker, 0);
 
 					// Set new marker(marker does not have any attribute)
 					if(!Set(byMark, marklength, &(pnewmarker->byData[0]), newmarklen, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
@@ -1774,6 +2655,20 @@ K2HKeyQueue* K2HShm::GetKeyQueueObj(bool is_fifo, const unsigned char* pref, siz
 	return queue;
 }
 
+K2HShardQueue* K2HShm::GetShardQueueObj(bool is_fifo, const unsigned char* pref, size_t preflen, int shardcnt, int mode)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return NULL;
+	}
+	K2HShardQueue*	queue = new K2HShardQueue();
+	if(!queue->Init(this, is_fifo, pref, preflen, shardcnt, mode)){
+		K2H_Delete(queue);
+		return NULL;
+	}
+	return queue;
+}
+
 K2HLowOpsQueue* K2HShm::GetLowOpsQueueObj(bool is_fifo, const unsigned char* pref, size_t preflen)
 {
 	if(!IsAttached()){
@@ -0,0 +1,925 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <vector>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hutil.h"
+#include "k2hashfunc.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility functions for ring queue
+//---------------------------------------------------------
+// [NOTE]
+// The ring queue is stored in the ring block which is mapped in the extra
+// area, and all records are read and written directly by memory copy.
+// The caller must lock the ring marker's cindex before calling these
+// functions, the ring marker key is the lock unit of the ring queue.
+//
+typedef struct k2hring_keep_record{
+	K2HRINGRECORD	record;
+	unsigned char*	byData;
+}K2HRINGKEEP;
+
+typedef std::vector<K2HRINGKEEP>	k2hringkeeplist_t;
+
+static inline bool k2h_has_ring_free(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, ring_free) + sizeof(void*) * K2H_RING_CLASS_COUNT) <= pExtra->length);
+}
+
+//
+// Returns the class which block has the ring data area for needsize, returns -1 if it is too large.
+//
+static inline int k2hring_block_class(size_t needsize)
+{
+	for(int ringclass = 0; ringclass < K2H_RING_CLASS_COUNT; ++ringclass){
+		if(needsize <= ((K2HRING_MIN_BLOCK_SIZE << ringclass) - sizeof(K2HRINGHEAD))){
+			return ringclass;
+		}
+	}
+	return -1;
+}
+
+static inline int k2hring_length_class(size_t length)
+{
+	for(int ringclass = 0; ringclass < K2H_RING_CLASS_COUNT; ++ringclass){
+		if(length == (K2HRING_MIN_BLOCK_SIZE << ringclass)){
+			return ringclass;
+		}
+	}
+	return -1;
+}
+
+static inline size_t k2hring_record_size(size_t length)
+{
+	return (sizeof(K2HRINGRECORD) + length + sizeof(size_t));
+}
+
+static inline unsigned char* k2hring_data_area(const PK2HRINGHEAD pRingHead)
+{
+	return (reinterpret_cast<unsigned char*>(pRingHead) + sizeof(K2HRINGHEAD));
+}
+
+static inline int64_t k2hring_forward(const PK2HRINGHEAD pRingHead, int64_t pos, size_t length)
+{
+	return static_cast<int64_t>((static_cast<size_t>(pos) + (length % pRingHead->capacity)) % pRingHead->capacity);
+}
+
+static inline int64_t k2hring_backward(const PK2HRINGHEAD pRingHead, int64_t pos, size_t length)
+{
+	return static_cast<int64_t>((static_cast<size_t>(pos) + pRingHead->capacity - (length % pRingHead->capacity)) % pRingHead->capacity);
+}
+
+//
+// Read/Write data in ring data area, the data can wrap around the end of ring.
+//
+static void k2hring_read_data(const PK2HRINGHEAD pRingHead, int64_t pos, unsigned char* byData, size_t length)
+{
+	size_t	first = min(length, pRingHead->capacity - static_cast<size_t>(pos));
+	memcpy(byData, k2hring_data_area(pRingHead) + pos, first);
+	if(first < length){
+		memcpy(&byData[first], k2hring_data_area(pRingHead), length - first);
+	}
+}
+
+static void k2hring_write_data(PK2HRINGHEAD pRingHead, int64_t pos, const unsigned char* byData, size_t length)
+{
+	size_t	first = min(length, pRingHead->capacity - static_cast<size_t>(pos));
+	memcpy(k2hring_data_area(pRingHead) + pos, byData, first);
+	if(first < length){
+		memcpy(k2hring_data_area(pRingHead), &byData[first], length - first);
+	}
+}
+
+//
+// Update head, tail, used and count in the ring block.
+//
+// [NOTE]
+// The records must be written before updating these, thus the barrier
+// is put before storing. Each member is 8 bytes aligned and is stored
+// by atomic operation.
+//
+static void k2hring_update_head(PK2HRINGHEAD pRingHead, int64_t head, int64_t tail, uint64_t used, int64_t count)
+{
+	__sync_synchronize();
+	__sync_lock_test_and_set(&(pRingHead->head),	head);
+	__sync_lock_test_and_set(&(pRingHead->tail),	tail);
+	__sync_lock_test_and_set(&(pRingHead->used),	used);
+	__sync_lock_test_and_set(&(pRingHead->count),	count);
+	__sync_synchronize();
+}
+
+//
+// Read one record from pos.
+//
+// is_forward	- true means that pos is top of record, false means that pos is next of record end.
+// recpos		- returns top of record
+// ppData		- if not NULL, returns allocated data
+//
+static bool k2hring_read_record(const PK2HRINGHEAD pRingHead, int64_t pos, bool is_forward, int64_t& recpos, K2HRINGRECORD& record, unsigned char** ppData)
+{
+	if(is_forward){
+		recpos = pos;
+	}else{
+		size_t	trailer = 0;
+		k2hring_read_data(pRingHead, k2hring_backward(pRingHead, pos, sizeof(size_t)), reinterpret_cast<unsigned char*>(&trailer), sizeof(size_t));
+		if(pRingHead->used < k2hring_record_size(trailer)){
+			ERR_K2HPRN("Ring queue record trailer(%zu) is wrong.", trailer);
+			return false;
+		}
+		recpos = k2hring_backward(pRingHead, pos, k2hring_record_size(trailer));
+	}
+	k2hring_read_data(pRingHead, recpos, reinterpret_cast<unsigned char*>(&record), sizeof(K2HRINGRECORD));
+	if(pRingHead->used < k2hring_record_size(record.length)){
+		ERR_K2HPRN("Ring queue record length(%zu) is wrong.", record.length);
+		return false;
+	}
+
+	if(ppData){
+		*ppData = NULL;
+		if(0 < record.length){
+			if(NULL == (*ppData = reinterpret_cast<unsigned char*>(malloc(record.length)))){
+				ERR_K2HPRN("Could not allocation memory.");
+				return false;
+			}
+			k2hring_read_data(pRingHead, k2hring_forward(pRingHead, recpos, sizeof(K2HRINGRECORD)), *ppData, record.length);
+		}
+	}
+	return true;
+}
+
+//
+// Serialize one record(header, data and trailer) into buffer
+//
+static unsigned char* k2hring_serialize_record(unsigned char* byBuff, const K2HRINGRECORD& record, const unsigned char* byData)
+{
+	memcpy(byBuff, &record, sizeof(K2HRINGRECORD));
+	byBuff += sizeof(K2HRINGRECORD);
+	if(0 < record.length){
+		memcpy(byBuff, byData, record.length);
+		byBuff += record.length;
+	}
+	memcpy(byBuff, &record.length, sizeof(size_t));
+	byBuff += sizeof(size_t);
+	return byBuff;
+}
+
+static inline bool k2hring_is_expired(const K2HRINGRECORD& record, time_t now)
+{
+	return (0 != record.expire && record.expire <= now);
+}
+
+//---------------------------------------------------------
+// Methods for Ring Queue block
+//---------------------------------------------------------
+//
+// Returns the ring block which the ring marker points.
+// If the marker does not point the ring block in this k2hash, returns NULL.
+//
+// [NOTE]
+// The caller must lock the ring marker's cindex.
+//
+PK2HRINGHEAD K2HShm::GetRingHead(PELEMENT pMarkerElement, k2h_hash_t hash) const
+{
+	if(!pMarkerElement){
+		ERR_K2HPRN("Parameter is wrong.");
+		return NULL;
+	}
+	unsigned char*	pmkval		= NULL;
+	ssize_t			mkvallen	= Get(pMarkerElement, &pmkval, PAGEOBJ_VALUE);
+	if(!pmkval || static_cast<ssize_t>(sizeof(K2HRINGMARKER)) != mkvallen){
+		WAN_K2HPRN("Ring marker value is something wrong, it is not ring queue marker.");
+		K2H_Free(pmkval);
+		return NULL;
+	}
+	K2HRINGMARKER	rmarker;
+	memcpy(&rmarker, pmkval, sizeof(K2HRINGMARKER));
+	K2H_Free(pmkval);
+
+	PK2HRINGHEAD	pRingHead;
+	if(K2HRINGMARKER_VERSION != rmarker.version || !rmarker.ring || NULL == (pRingHead = static_cast<PK2HRINGHEAD>(Abs(rmarker.ring)))){
+		WAN_K2HPRN("Ring marker does not point ring block in this k2hash.");
+		return NULL;
+	}
+	if(	K2HRINGHEAD_VERSION != pRingHead->version							||
+		rmarker.ring != pRingHead->self											||
+		K2HRING_BLOCK_USED != pRingHead->state									||
+		hash != pRingHead->markhash												||
+		-1 == k2hring_length_class(pRingHead->length)							||
+		(pRingHead->length - sizeof(K2HRINGHEAD)) != pRingHead->capacity		||
+		pRingHead->capacity < pRingHead->used									||
+		pRingHead->head < 0 || pRingHead->capacity <= static_cast<uint64_t>(pRingHead->head)	||
+		pRingHead->tail < 0 || pRingHead->capacity <= static_cast<uint64_t>(pRingHead->tail)	||
+		pRingHead->count < 0													)
+	{
+		WAN_K2HPRN("Ring marker does not point ring block in this k2hash, or the ring block is broken.");
+		return NULL;
+	}
+	return pRingHead;
+}
+
+//
+// Allocate the ring block which has the ring data area for needsize.
+//
+// [NOTE]
+// If the free list for the class is empty, new area is expanded and it
+// is divided into blocks. The first block is returned and others are
+// listed into the free list.
+//
+PK2HRINGHEAD K2HShm::AllocateRingBlock(size_t needsize, k2h_hash_t hash)
+{
+	int		ringclass;
+	if(-1 == (ringclass = k2hring_block_class(needsize))){
+		ERR_K2HPRN("Ring queue size(%zu) is too large.", needsize);
+		return NULL;
+	}
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for ring queue.");
+		return NULL;
+	}
+	if(!k2h_has_ring_free(pExtra)){
+		ERR_K2HPRN("Extra area does not have ring block free list.");
+		return NULL;
+	}
+	size_t	blocklength = K2HRING_MIN_BLOCK_SIZE << ringclass;
+
+	K2HLock	ALObjRing(ShmFd, Rel(&(pExtra->ring_free[ringclass])), K2HLock::RWLOCK);	// LOCK
+
+	if(!pExtra->ring_free[ringclass]){
+		size_t	area_length		= ALIGNMENT(max(blocklength, static_cast<size_t>(K2HRING_CHUNK_SIZE)), K2HShm::SystemPageSize);
+		off_t	new_area_start	= 0L;
+		if(NULL == ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)){
+			ERR_K2HPRN("Could not expand area for ring queue block.");
+			return NULL;
+		}
+		for(size_t pos = 0; (pos + blocklength) <= area_length; pos += blocklength){
+			void*			pRelBlock	= reinterpret_cast<void*>(new_area_start + static_cast<off_t>(pos));
+			PK2HRINGHEAD	pBlock		= static_cast<PK2HRINGHEAD>(Abs(pRelBlock));
+			pBlock->version				= K2HRINGHEAD_VERSION;
+			pBlock->self				= pRelBlock;
+			pBlock->length				= blocklength;
+			pBlock->state				= K2HRING_BLOCK_FREE;
+			pBlock->next				= pExtra->ring_free[ringclass];
+			pExtra->ring_free[ringclass]= pRelBlock;
+		}
+	}
+	PK2HRINGHEAD	pRingHead;
+	if(NULL == (pRingHead = static_cast<PK2HRINGHEAD>(Abs(pExtra->ring_free[ringclass])))){
+		ERR_K2HPRN("Could not get ring block in free list.");
+		return NULL;
+	}
+	pExtra->ring_free[ringclass]	= pRingHead->next;
+	ALObjRing.Unlock();																	// UNLOCK
+
+	pRingHead->state	= K2HRING_BLOCK_USED;
+	pRingHead->markhash	= hash;
+	pRingHead->next		= NULL;
+	pRingHead->capacity	= blocklength - sizeof(K2HRINGHEAD);
+	k2hring_update_head(pRingHead, 0, 0, 0, 0);
+
+	return pRingHead;
+}
+
+bool K2HShm::FreeRingBlock(PK2HRINGHEAD pRingHead)
+{
+	if(!pRingHead){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	int			ringclass;
+	PK2HEXTRA	pExtra;
+	if(-1 == (ringclass = k2hring_length_class(pRingHead->length)) || !k2h_has_ring_free(pExtra = GetExtraArea())){
+		ERR_K2HPRN("Ring block or extra area is something wrong, so the block is leaked.");
+		return false;
+	}
+
+	K2HLock	ALObjRing(ShmFd, Rel(&(pExtra->ring_free[ringclass])), K2HLock::RWLOCK);	// LOCK
+	pRingHead->state				= K2HRING_BLOCK_FREE;
+	pRingHead->markhash				= 0;
+	pRingHead->next					= pExtra->ring_free[ringclass];
+	pExtra->ring_free[ringclass]	= pRingHead->self;
+
+	return true;
+}
+
+//
+// Set the ring marker which points the ring block.
+//
+// [NOTE]
+// The caller must lock the ring marker's cindex.
+//
+bool K2HShm::SetRingMarker(const unsigned char* byMark, size_t marklength, PK2HRINGHEAD pRingHead)
+{
+	K2HRINGMARKER	rmarker;
+	rmarker.version	= K2HRINGMARKER_VERSION;
+	rmarker.ring	= pRingHead->self;
+
+	// Set marker(marker does not have any attribute.)
+	if(!Set(byMark, marklength, reinterpret_cast<const unsigned char*>(&rmarker), sizeof(K2HRINGMARKER), NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL)){
+		ERR_K2HPRN("Could not set ring marker.");
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Methods for Ring Queue
+//---------------------------------------------------------
+K2HRingQueue* K2HShm::GetRingQueueObj(bool is_fifo, const unsigned char* pref, size_t preflen)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return NULL;
+	}
+	K2HRingQueue*	queue = new K2HRingQueue();
+	if(!queue->Init(this, is_fifo, pref, preflen)){
+		K2H_Delete(queue);
+		return NULL;
+	}
+	return queue;
+}
+
+bool K2HShm::IsEmptyRingQueue(const unsigned char* byMark, size_t marklength) const
+{
+	return (0 == GetCountRingQueue(byMark, marklength));
+}
+
+//
+// [NOTICE]
+// The count includes expired records which are not popped yet.
+//
+int K2HShm::GetCountRingQueue(const unsigned char* byMark, size_t marklength) const
+{
+	K2HRINGHEAD	rhead;
+	if(!GetRingQueueHead(byMark, marklength, rhead)){
+		return 0;
+	}
+	return static_cast<int>(min(static_cast<int64_t>(rhead.count), static_cast<int64_t>(INT_MAX)));
+}
+
+//
+// Read the data at pos in ring queue without removing it.
+// pos is counted from popping side, and expired records are skipped.
+//
+bool K2HShm::ReadRingQueue(const unsigned char* byMark, size_t marklength, unsigned char** ppValue, size_t& vallength, bool is_fifo, int pos) const
+{
+	if(!byMark || 0 == marklength || !ppValue || pos < 0){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	*ppValue	= NULL;
+	vallength	= 0;
+
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(const_cast<K2HShm*>(this));
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RDLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PELEMENT	pElement;
+	if(NULL == GetCKIndex(hash, ALObjCKI)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		MSG_K2HPRN("There is no ring marker, so ring queue is empty.");
+		return false;
+	}
+	PK2HRINGHEAD	pRingHead;
+	if(NULL == (pRingHead = GetRingHead(pElement, hash))){
+		MSG_K2HPRN("There is no ring block, so ring queue is empty.");
+		return false;
+	}
+
+	time_t	now		= time(NULL);
+	int64_t	curpos	= is_fifo ? pRingHead->head : pRingHead->tail;
+	for(size_t walked = 0; walked < pRingHead->used; ){
+		int64_t			recpos = 0;
+		K2HRINGRECORD	record;
+		if(!k2hring_read_record(pRingHead, curpos, is_fifo, recpos, record, NULL)){
+			ERR_K2HPRN("Could not read record from ring queue.");
+			return false;
+		}
+		size_t	recsize = k2hring_record_size(record.length);
+		walked			+= recsize;
+		curpos			= is_fifo ? k2hring_forward(pRingHead, recpos, recsize) : recpos;
+
+		if(k2hring_is_expired(record, now)){
+			continue;
+		}
+		if(0 < pos){
+			--pos;
+			continue;
+		}
+
+		// found
+		if(!k2hring_read_record(pRingHead, recpos, true, recpos, record, ppValue)){
+			ERR_K2HPRN("Could not read record data from ring queue.");
+			return false;
+		}
+		vallength = record.length;
+		return true;
+	}
+	MSG_K2HPRN("There is no data at the position in ring queue.");
+	return false;
+}
+
+//
+// Push datas into ring queue at once.
+// All records are appended to the tail of ring, and the ring block is
+// updated only once.
+//
+// [NOTE]
+// When the ring block does not have enough space, the records are moved
+// to the top of new block which is twice or more, and the ring marker is
+// changed to point it. The old block is returned to the free list.
+//
+bool K2HShm::PushRingQueue(const unsigned char* byMark, size_t marklength, const PK2HBIN pvals, size_t count, const time_t* expire)
+{
+	if(!byMark || 0 == marklength || !pvals || 0 == count){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// make records
+	size_t	total = 0;
+	for(size_t cnt = 0; cnt < count; ++cnt){
+		if(!pvals[cnt].byptr || 0 == pvals[cnt].length){
+			ERR_K2HPRN("Pushing data(%zu) is empty.", cnt);
+			return false;
+		}
+		total += k2hring_record_size(pvals[cnt].length);
+	}
+	unsigned char*	byRecords;
+	if(NULL == (byRecords = reinterpret_cast<unsigned char*>(malloc(total)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return false;
+	}
+	K2HRINGRECORD	record;
+	record.expire	= (expire && 0 < *expire) ? (time(NULL) + *expire) : 0;
+	unsigned char*	bySetPos = byRecords;
+	for(size_t cnt = 0; cnt < count; ++cnt){
+		record.length	= pvals[cnt].length;
+		bySetPos		= k2hring_serialize_record(bySetPos, record, pvals[cnt].byptr);
+	}
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PELEMENT	pElement;
+	if(NULL == GetCKIndex(hash, ALObjCKI)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		K2H_Free(byRecords);
+		return false;
+	}
+	PK2HRINGHEAD	pRingHead = NULL;
+	if(NULL != (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		pRingHead = GetRingHead(pElement, hash);
+	}
+
+	// new or expand ring block if needed
+	if(!pRingHead || pRingHead->capacity < (pRingHead->used + total)){
+		size_t			needsize	= pRingHead ? max(pRingHead->used + total, pRingHead->capacity * 2) : total;
+		PK2HRINGHEAD	pNewHead;
+		if(NULL == (pNewHead = AllocateRingBlock(needsize, hash))){
+			ERR_K2HPRN("Could not allocate ring queue block.");
+			K2H_Free(byRecords);
+			return false;
+		}
+		if(pRingHead && 0 < pRingHead->used){
+			// move records to top of new block
+			size_t	first = min(static_cast<size_t>(pRingHead->used), pRingHead->capacity - static_cast<size_t>(pRingHead->head));
+			memcpy(k2hring_data_area(pNewHead), k2hring_data_area(pRingHead) + pRingHead->head, first);
+			if(first < pRingHead->used){
+				memcpy(k2hring_data_area(pNewHead) + first, k2hring_data_area(pRingHead), pRingHead->used - first);
+			}
+			k2hring_update_head(pNewHead, 0, static_cast<int64_t>(pRingHead->used % pNewHead->capacity), pRingHead->used, pRingHead->count);
+		}
+		if(!SetRingMarker(byMark, marklength, pNewHead)){
+			ERR_K2HPRN("Could not set ring marker for new ring queue block.");
+			FreeRingBlock(pNewHead);
+			K2H_Free(byRecords);
+			return false;
+		}
+		if(pRingHead && !FreeRingBlock(pRingHead)){
+			WAN_K2HPRN("Could not return old ring queue block to free list, but continue...");
+		}
+		pRingHead = pNewHead;
+	}
+
+	// append records
+	k2hring_write_data(pRingHead, pRingHead->tail, byRecords, total);
+	K2H_Free(byRecords);
+
+	// update ring block
+	k2hring_update_head(pRingHead, pRingHead->head, k2hring_forward(pRingHead, pRingHead->tail, total), pRingHead->used + total, pRingHead->count + static_cast<int64_t>(count));
+	ALObjCKI.Unlock();
+
+	WakeupQueueWaiters();
+
+	return true;
+}
+
+//
+// Pop datas(up to maxcount) from ring queue at once, expired records are
+// removed and skipped.
+//
+// [NOTICE]
+// If there is no popping data, this method returns true with *ppvals=NULL
+// and popcount=0. The caller must free *ppvals by free_k2hbins().
+//
+bool K2HShm::PopRingQueue(const unsigned char* byMark, size_t marklength, bool is_fifo, size_t maxcount, PK2HBIN* ppvals, size_t& popcount)
+{
+	if(!byMark || 0 == marklength || 0 == maxcount || !ppvals){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	*ppvals		= NULL;
+	popcount	= 0;
+
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PELEMENT	pElement;
+	if(NULL == GetCKIndex(hash, ALObjCKI)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		MSG_K2HPRN("There is no ring marker, so ring queue is empty.");
+		return true;
+	}
+	PK2HRINGHEAD	pRingHead;
+	if(NULL == (pRingHead = GetRingHead(pElement, hash))){
+		MSG_K2HPRN("There is no ring block, so ring queue is empty.");
+		return true;
+	}
+	if(0 == pRingHead->used){
+		return true;
+	}
+
+	PK2HBIN	pvals;
+	size_t	allocnt = static_cast<size_t>(min(static_cast<int64_t>(maxcount), max(static_cast<int64_t>(pRingHead->count), static_cast<int64_t>(1))));
+	if(NULL == (pvals = reinterpret_cast<PK2HBIN>(calloc(allocnt, sizeof(K2HBIN))))){
+		ERR_K2HPRN("Could not allocation memory.");
+		return false;
+	}
+
+	time_t		now		= time(NULL);
+	int64_t		head	= pRingHead->head;
+	int64_t		tail	= pRingHead->tail;
+	uint64_t	used	= pRingHead->used;
+	int64_t		count	= pRingHead->count;
+	while(popcount < allocnt && 0 < used){
+		int64_t			recpos	= 0;
+		K2HRINGRECORD	record;
+		unsigned char*	byData	= NULL;
+		if(!k2hring_read_record(pRingHead, (is_fifo ? head : tail), is_fifo, recpos, record, &byData)){
+			ERR_K2HPRN("Could not read record from ring queue.");
+			free_k2hbins(pvals, popcount);
+			popcount = 0;
+			return false;
+		}
+		size_t	recsize = k2hring_record_size(record.length);
+		if(is_fifo){
+			head = k2hring_forward(pRingHead, recpos, recsize);
+		}else{
+			tail = recpos;
+		}
+		used	-= recsize;
+		count	= max(count - 1, static_cast<int64_t>(0));
+
+		if(k2hring_is_expired(record, now)){
+			MSG_K2HPRN("Popped record is expired, so skip it.");
+			K2H_Free(byData);
+			continue;
+		}
+		pvals[popcount].byptr	= byData;
+		pvals[popcount].length	= record.length;
+		++popcount;
+	}
+	if(0 == used){
+		head	= 0;
+		tail	= 0;
+		count	= 0;
+	}
+
+	// update ring block
+	k2hring_update_head(pRingHead, head, tail, used, count);
+
+	if(0 == popcount){
+		K2H_Free(pvals);
+	}
+	*ppvals = pvals;
+
+	return true;
+}
+
+//
+// Remove records from popping side of ring queue.
+// This method checks up to count records, and returns removed record count.
+// (returns -1 when an error occurred)
+//
+// [NOTICE]
+// The callback function is called while the ring marker is locked.
+// The records which callback function decides not to remove are moved
+// next to the records which are not checked, so that their order is kept.
+//
+int K2HShm::RemoveRingQueue(const unsigned char* byMark, size_t marklength, bool is_fifo, unsigned int count, k2h_q_remove_trial_callback fp, void* pExtData)
+{
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return -1;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return -1;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return -1;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PELEMENT	pElement;
+	if(NULL == GetCKIndex(hash, ALObjCKI)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return -1;
+	}
+	if(NULL == (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		MSG_K2HPRN("There is no ring marker, so ring queue is empty.");
+		return 0;
+	}
+	PK2HRINGHEAD	pRingHead;
+	if(NULL == (pRingHead = GetRingHead(pElement, hash))){
+		MSG_K2HPRN("There is no ring block, so ring queue is empty.");
+		return 0;
+	}
+
+	// check records
+	time_t				now			= time(NULL);
+	int64_t				curpos		= is_fifo ? pRingHead->head : pRingHead->tail;
+	size_t				visited		= 0;
+	size_t				keptsize	= 0;
+	int					removed		= 0;
+	k2hringkeeplist_t	keeplist;
+	for(unsigned int cnt = 0; cnt < count && visited < pRingHead->used; ++cnt){
+		int64_t			prevpos	= curpos;
+		int64_t			recpos	= 0;
+		K2HRINGRECORD	record;
+		unsigned char*	byData	= NULL;
+		if(!k2hring_read_record(pRingHead, curpos, is_fifo, recpos, record, (fp ? &byData : NULL))){
+			ERR_K2HPRN("Could not read record from ring queue.");
+			for(k2hringkeeplist_t::iterator iter = keeplist.begin(); iter != keeplist.end(); ++iter){
+				K2H_Free(iter->byData);
+			}
+			return -1;
+		}
+		size_t	recsize = k2hring_record_size(record.length);
+		visited			+= recsize;
+		curpos			= is_fifo ? k2hring_forward(pRingHead, recpos, recsize) : recpos;
+
+		// check by callback function(expired record is removed without calling it)
+		K2HQRMCBRES	res = K2HQRMCB_RES_CON_RM;
+		if(fp && !k2hring_is_expired(record, now)){
+			if(K2HQRMCB_RES_ERROR == (res = fp(byData, record.length, NULL, 0, pExtData))){
+				// Stop loop, this record is not checked.
+				visited -= recsize;
+				curpos	= prevpos;
+				K2H_Free(byData);
+				break;
+			}
+		}
+		if(K2HQRMCB_RES_CON_RM == res || K2HQRMCB_RES_FIN_RM == res){
+			K2H_Free(byData);
+			++removed;
+		}else{
+			K2HRINGKEEP	keep;
+			keep.record	= record;
+			keep.byData	= byData;
+			keeplist.push_back(keep);
+			keptsize	+= recsize;
+		}
+		if(K2HQRMCB_RES_FIN_RM == res || K2HQRMCB_RES_FIN_NOTRM == res){
+			break;
+		}
+	}
+
+	if(0 == removed){
+		for(k2hringkeeplist_t::iterator iter = keeplist.begin(); iter != keeplist.end(); ++iter){
+			K2H_Free(iter->byData);
+		}
+		return 0;
+	}
+
+	// rewrite kept records next to the records which are not checked
+	if(!keeplist.empty()){
+		unsigned char*	byRecords;
+		if(NULL == (byRecords = reinterpret_cast<unsigned char*>(malloc(keptsize)))){
+			ERR_K2HPRN("Could not allocation memory.");
+			for(k2hringkeeplist_t::iterator iter = keeplist.begin(); iter != keeplist.end(); ++iter){
+				K2H_Free(iter->byData);
+			}
+			return -1;
+		}
+		unsigned char*	bySetPos = byRecords;
+		if(is_fifo){
+			for(k2hringkeeplist_t::iterator iter = keeplist.begin(); iter != keeplist.end(); ++iter){
+				bySetPos = k2hring_serialize_record(bySetPos, iter->record, iter->byData);
+				K2H_Free(iter->byData);
+			}
+		}else{
+			for(k2hringkeeplist_t::reverse_iterator riter = keeplist.rbegin(); riter != keeplist.rend(); ++riter){
+				bySetPos = k2hring_serialize_record(bySetPos, riter->record, riter->byData);
+				K2H_Free(riter->byData);
+			}
+		}
+		int64_t	writepos = is_fifo ? k2hring_backward(pRingHead, curpos, keptsize) : curpos;
+		k2hring_write_data(pRingHead, writepos, byRecords, keptsize);
+		K2H_Free(byRecords);
+	}
+
+	// update ring block
+	int64_t		head	= pRingHead->head;
+	int64_t		tail	= pRingHead->tail;
+	uint64_t	used	= pRingHead->used - (visited - keptsize);
+	int64_t		rest	= max(static_cast<int64_t>(pRingHead->count) - removed, static_cast<int64_t>(0));
+	if(is_fifo){
+		head = k2hring_backward(pRingHead, curpos, keptsize);
+	}else{
+		tail = k2hring_forward(pRingHead, curpos, keptsize);
+	}
+	if(0 == used){
+		head	= 0;
+		tail	= 0;
+		rest	= 0;
+	}
+	k2hring_update_head(pRingHead, head, tail, used, rest);
+
+	return removed;
+}
+
+//
+// Get copy of ring block head(ring queue status).
+//
+bool K2HShm::GetRingQueueHead(const unsigned char* byMark, size_t marklength, K2HRINGHEAD& rhead) const
+{
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(const_cast<K2HShm*>(this));
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RDLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PELEMENT	pElement;
+	if(NULL == GetCKIndex(hash, ALObjCKI)){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		MSG_K2HPRN("There is no ring marker.");
+		return false;
+	}
+	PK2HRINGHEAD	pRingHead;
+	if(NULL == (pRingHead = GetRingHead(pElement, hash))){
+		MSG_K2HPRN("There is no ring block.");
+		return false;
+	}
+	memcpy(&rhead, pRingHead, sizeof(K2HRINGHEAD));
+
+	return true;
+}
+
+//
+// Remove the ring marker key only when the ring queue is empty.
+// is_removed is set false when the ring queue is not empty.
+//
+// [NOTE]
+// Checking and removing are done while the ring marker is locked, thus
+// the records which are pushed by other processes are not lost.
+// The ring block is returned to the free list before unlocking.
+// This method does not make history for removing marker.
+//
+bool K2HShm::RemoveEmptyRingQueue(const unsigned char* byMark, size_t marklength, bool& is_removed)
+{
+	is_removed = false;
+	if(!byMark || 0 == marklength){
+		ERR_K2HPRN("Some parameters are wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is opened READ mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	// LOCK
+	K2HLock		ALObjCKI(K2HLock::RWLOCK);						// auto release locking at leaving in this scope.
+	k2h_hash_t	hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(byMark), marklength);
+	PCKINDEX	pCKIndex;
+	PELEMENT	pElement;
+	if(NULL == (pCKIndex = GetCKIndex(hash, ALObjCKI))){
+		ERR_K2HPRN("Something error occurred, pCKIndex must not be NULL.");
+		return false;
+	}
+	if(NULL == (pElement = GetElement(byMark, marklength, ALObjCKI))){
+		MSG_K2HPRN("There is no ring marker.");
+		is_removed = true;
+		return true;
+	}
+	PK2HRINGHEAD	pRingHead = GetRingHead(pElement, hash);
+	if(pRingHead && 0 != pRingHead->used){
+		MSG_K2HPRN("Ring queue is not empty.");
+		return true;
+	}
+
+	if(!TakeOffElement(pCKIndex, pElement)){
+		ERR_K2HPRN("Failed to take off ring marker element from ckey index.");
+		return false;
+	}
+	if(pRingHead && !FreeRingBlock(pRingHead)){
+		WAN_K2HPRN("Could not return ring queue block to free list, but continue...");
+	}
+	ALObjCKI.Unlock();												// Unlock
+
+	bool	is_check_updated = true;
+	if(!RemoveEx(pElement, NULL, is_check_updated)){
+		ERR_K2HPRN("Failed to remove ring marker.");
+		return false;
+	}
+	is_removed = true;
+
+	return true;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
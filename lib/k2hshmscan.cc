@@ -0,0 +1,283 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hattrbuiltin.h"
+#include "k2hshmupdater.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Structure
+//---------------------------------------------------------
+typedef struct k2h_scan_thread_param{
+	const K2HShm*		pShm;
+	pthread_t			tid;
+	k2h_hash_t			start_hash;
+	k2h_hash_t			end_hash;
+	k2h_hash_t			scan_mask;
+	k2h_scan_callback	fp;
+	void*				pExtData;
+	bool				is_check_attrs;
+	volatile bool*		pis_stop;
+	bool				result;
+}SCANTHPARAM, *PSCANTHPARAM;
+
+//---------------------------------------------------------
+// Methods
+//---------------------------------------------------------
+// [NOTE]
+// The hash range of k2hash(0 to current maximum hash value which is made
+// by current mask and collision mask) is split into contiguous ranges,
+// and each worker thread scans each range. The worker locks each unit of
+// collision key index for reading only once, and calls the callback
+// function for all keys in it while locking.
+// The key and value are passed to the callback function by the pointer
+// to the page data directly, when it is in one page on full mapping.
+// Otherwise(over some pages or not full mapping), those are copied into
+// temporary buffer.
+//
+// [NOTICE]
+// The callback function is called by some threads at the same time, and
+// it must not modify k2hash because the collision key index is locked.
+// The value is raw data, it is not decrypted and decompressed.
+// If is_check_attrs is true, expired keys, history keys and expire
+// index keys are not passed to the callback function.
+//
+bool K2HShm::ScanParallel(int nthreads, k2h_scan_callback fp, void* pExtData, bool is_check_attrs) const
+{
+	if(!fp){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(const_cast<K2HShm*>(this));
+
+	// [NOTE]
+	// The scan mask is decided at starting, if k2hash is expanded during
+	// scanning, the keys in new units are not scanned.
+	//
+	k2h_hash_t	scan_mask	= (pHead->cur_mask << K2HShm::GetMaskBitCount(pHead->collision_mask)) | pHead->collision_mask;
+	uint64_t	unit_count	= static_cast<uint64_t>(scan_mask) + 1;
+
+	if(nthreads <= 0){
+		long	cpucnt = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (0 < cpucnt) ? static_cast<int>(cpucnt) : 1;
+	}
+	if(unit_count < static_cast<uint64_t>(nthreads)){
+		nthreads = static_cast<int>(unit_count);
+	}
+
+	volatile bool	is_stop = false;
+	if(1 == nthreads){
+		// run on this thread
+		return ScanRange(0, scan_mask, scan_mask, fp, pExtData, is_check_attrs, is_stop);
+	}
+
+	// run workers
+	PSCANTHPARAM	pparams		= new SCANTHPARAM[nthreads];
+	uint64_t		range		= unit_count / nthreads;
+	uint64_t		remainder	= unit_count % nthreads;
+	uint64_t		start		= 0;
+	int				runcnt		= 0;
+	bool			result		= true;
+	for(int cnt = 0; cnt < nthreads; ++cnt){
+		uint64_t	count			= range + ((static_cast<uint64_t>(cnt) < remainder) ? 1 : 0);
+		pparams[cnt].pShm			= this;
+		pparams[cnt].start_hash		= static_cast<k2h_hash_t>(start);
+		pparams[cnt].end_hash		= static_cast<k2h_hash_t>(start + count - 1);
+		pparams[cnt].scan_mask		= scan_mask;
+		pparams[cnt].fp				= fp;
+		pparams[cnt].pExtData		= pExtData;
+		pparams[cnt].is_check_attrs	= is_check_attrs;
+		pparams[cnt].pis_stop		= &is_stop;
+		pparams[cnt].result			= false;
+		start						+= count;
+
+		int	thresult;
+		if(0 != (thresult = pthread_create(&(pparams[cnt].tid), NULL, K2HShm::ScanWorkerProc, &(pparams[cnt])))){
+			ERR_K2HPRN("Failed to create thread(return code = %d).", thresult);
+			is_stop	= true;
+			result	= false;
+			break;
+		}
+		++runcnt;
+	}
+
+	// wait for exiting all workers
+	for(int cnt = 0; cnt < runcnt; ++cnt){
+		int		thresult;
+		void*	pretval = NULL;
+		if(0 != (thresult = pthread_join(pparams[cnt].tid, &pretval))){
+			ERR_K2HPRN("Failed to wait thread exiting(return code = %d).", thresult);
+			result = false;
+		}else if(!pparams[cnt].result){
+			ERR_K2HPRN("Worker thread(%d) could not scan hash range(0x%016" PRIx64 " - 0x%016" PRIx64 ").", cnt, pparams[cnt].start_hash, pparams[cnt].end_hash);
+			result = false;
+		}
+	}
+	delete[] pparams;
+
+	return result;
+}
+
+void* K2HShm::ScanWorkerProc(void* param)
+{
+	PSCANTHPARAM	pparam = reinterpret_cast<PSCANTHPARAM>(param);
+	if(!pparam || !pparam->pShm || !pparam->pis_stop){
+		ERR_K2HPRN("Parameter is wrong.");
+		pthread_exit(NULL);
+	}
+	pparam->result = pparam->pShm->ScanRange(pparam->start_hash, pparam->end_hash, pparam->scan_mask, pparam->fp, pparam->pExtData, pparam->is_check_attrs, *(pparam->pis_stop));
+	if(!pparam->result){
+		// stop other workers
+		*(pparam->pis_stop) = true;
+	}
+	pthread_exit(NULL);
+	return NULL;
+}
+
+//
+// Scan units from start_hash to end_hash
+//
+// [NOTE]
+// If the key index for a unit is not assigned yet, GetCKIndex returns the
+// collision key index merged in lower mask. Then the elements in it are
+// checked by its hash and scan mask for not calling twice.
+//
+bool K2HShm::ScanRange(k2h_hash_t start_hash, k2h_hash_t end_hash, k2h_hash_t scan_mask, k2h_scan_callback fp, void* pExtData, bool is_check_attrs, volatile bool& is_stop) const
+{
+	K2HLock	ALObjCKI(K2HLock::RDLOCK);
+	for(k2h_hash_t test_hash = start_hash; !is_stop; ++test_hash){
+		PCKINDEX	pCKIndex = NULL;
+		if(NULL != (pCKIndex = GetCKIndex(test_hash, ALObjCKI)) && pCKIndex->element_list){	// LOCK
+			if(!ScanElementList(pCKIndex->element_list, test_hash, scan_mask, fp, pExtData, is_check_attrs, is_stop)){
+				ERR_K2HPRN("Something error occurred during scanning elements in unit(0x%016" PRIx64 ").", test_hash);
+				return false;
+			}
+		}
+		ALObjCKI.Unlock();																		// UNLOCK
+
+		if(test_hash == end_hash){
+			break;
+		}
+	}
+	return true;
+}
+
+bool K2HShm::ScanElementList(PELEMENT pRelElement, k2h_hash_t unit_hash, k2h_hash_t scan_mask, k2h_scan_callback fp, void* pExtData, bool is_check_attrs, volatile bool& is_stop) const
+{
+	if(!pRelElement || is_stop){
+		return true;
+	}
+	PELEMENT	pElement = static_cast<PELEMENT>(Abs(pRelElement));
+	if(!pElement){
+		ERR_K2HPRN("Absolute pElement converted from pRelElement(%p) is NULL.", pRelElement);
+		return false;
+	}
+
+	// own element
+	bool	is_target = (unit_hash == (pElement->hash & scan_mask));
+	if(is_target && is_check_attrs){
+		K2HATTRFLAGS	attrflags;
+		if(GetAttrFlags(pElement, attrflags) && (K2hAttrBuiltin::IsExpire(attrflags) || 0 != (attrflags.flags & K2HATTR_FLAG_HISTORY))){
+			is_target = false;											// expired or history
+		}
+	}
+	if(is_target){
+		const unsigned char*	byKey		= NULL;
+		const unsigned char*	byValue		= NULL;
+		unsigned char*			pKeyBuff	= NULL;
+		unsigned char*			pValBuff	= NULL;
+		size_t					keylength	= 0;
+		size_t					vallength	= 0;
+		PPAGEHEAD				pPageHead;
+
+		// key
+		if(isFullMapping && pElement->key && NULL != (pPageHead = static_cast<PPAGEHEAD>(Abs(pElement->key))) && !pPageHead->next && pElement->keylength <= pPageHead->length){
+			byKey		= &(pPageHead->data[0]);
+			keylength	= pElement->keylength;
+		}else{
+			ssize_t	length;
+			if(0 < (length = Get(pElement, &pKeyBuff, PAGEOBJ_KEY))){
+				byKey		= pKeyBuff;
+				keylength	= static_cast<size_t>(length);
+			}
+		}
+
+		// value
+		if(isFullMapping && pElement->value && NULL != (pPageHead = static_cast<PPAGEHEAD>(Abs(pElement->value))) && !pPageHead->next && pElement->vallength <= pPageHead->length){
+			byValue		= &(pPageHead->data[0]);
+			vallength	= pElement->vallength;
+		}else if(pElement->value && 0 < pElement->vallength){
+			ssize_t	length;
+			if(0 < (length = Get(pElement, &pValBuff, PAGEOBJ_VALUE))){
+				byValue		= pValBuff;
+				vallength	= static_cast<size_t>(length);
+			}
+		}
+
+		if(byKey && 0 < keylength){
+			if(is_check_attrs && (sizeof(K2HEXPIRE_PREFIX) - 1) <= keylength && 0 == memcmp(byKey, K2HEXPIRE_PREFIX, sizeof(K2HEXPIRE_PREFIX) - 1)){
+				// skip expire index key
+			}else if(!fp(byKey, keylength, byValue, vallength, pExtData)){
+				MSG_K2HPRN("Callback function returns false, so stop scanning.");
+				is_stop = true;
+			}
+		}else{
+			WAN_K2HPRN("Could not get key from element, so skip it.");
+		}
+		K2H_Free(pKeyBuff);
+		K2H_Free(pValBuff);
+	}
+
+	// children
+	if(!ScanElementList(pElement->same, unit_hash, scan_mask, fp, pExtData, is_check_attrs, is_stop)){
+		return false;
+	}
+	if(!ScanElementList(pElement->small, unit_hash, scan_mask, fp, pExtData, is_check_attrs, is_stop)){
+		return false;
+	}
+	if(!ScanElementList(pElement->big, unit_hash, scan_mask, fp, pExtData, is_check_attrs, is_stop)){
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
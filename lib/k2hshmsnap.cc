@@ -0,0 +1,379 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <string.h>
+#include <signal.h>
+#include <limits.h>
+#include <vector>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hcommand.h"
+#include "k2hshmupdater.h"
+#include "k2htrans.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility
+//---------------------------------------------------------
+static bool k2hsnap_write(int fd, const unsigned char* byData, size_t length)
+{
+	for(size_t wrote = 0; wrote < length; ){
+		ssize_t	onewrote;
+		if(-1 == (onewrote = write(fd, &byData[wrote], length - wrote))){
+			if(EINTR == errno){
+				continue;
+			}
+			ERR_K2HPRN("Failed to write snapshot file, errno = %d", errno);
+			return false;
+		}
+		wrote += static_cast<size_t>(onewrote);
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+// Methods for snapshot
+//---------------------------------------------------------
+bool K2HShm::IsSnapshotActive(void) const
+{
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea())){
+		return false;
+	}
+	return (K2H_SNAPSHOT_ACTIVE == pExtra->snapshot_state);
+}
+
+//
+// Capture snapshot unit which includes hash, if the unit is not captured.
+//
+// This is called after locking collision key index for writing, then
+// all elements in the unit are written to the snapshot archive file
+// before updating. If fd is -1, the snapshot file is opened by path in
+// extra area, because the snapshot may be made by other process.
+//
+// [NOTICE]
+// Must lock the collision key index before calling this method.
+// The unit is the hash value masked by snapshot_mask, and the collision
+// key index may have elements in other units if the key index is not
+// arranged to upper yet. So this method checks hash value of elements.
+//
+bool K2HShm::CaptureSnapshot(PCKINDEX pCKIndex, k2h_hash_t hash, int fd) const
+{
+	if(!pCKIndex){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) || K2H_SNAPSHOT_ACTIVE != pExtra->snapshot_state){
+		// nothing to do
+		return true;
+	}
+
+	// captured flag
+	unsigned char*	pBitmap;
+	if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->snapshot_bitmap)))){
+		// bitmap area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->snapshot_bitmap)))){
+			ERR_K2HPRN("Could not get snapshot bitmap area.");
+			__sync_fetch_and_add(&(pExtra->snapshot_error_count), 1L);
+			return false;
+		}
+	}
+	k2h_hash_t		unit	= hash & pExtra->snapshot_mask;
+	size_t			bytepos	= static_cast<size_t>(unit / 8);
+	unsigned char	bitval	= static_cast<unsigned char>(1 << (unit % 8));
+	if(pExtra->snapshot_bitmap_length <= bytepos){
+		ERR_K2HPRN("Snapshot unit(%" PRIu64 ") is over bitmap area length(%zu).", unit, pExtra->snapshot_bitmap_length);
+		__sync_fetch_and_add(&(pExtra->snapshot_error_count), 1L);
+		return false;
+	}
+	if(0 != (pBitmap[bytepos] & bitval)){
+		// already captured
+		return true;
+	}
+
+	// make archive for all elements in unit
+	vector<unsigned char>	archives;
+	vector<PELEMENT>		stack;
+	bool					result = true;
+	if(pCKIndex->element_list){
+		stack.push_back(static_cast<PELEMENT>(Abs(pCKIndex->element_list)));
+	}
+	while(result && !stack.empty()){
+		PELEMENT	pElement = stack.back();
+		stack.pop_back();
+		if(!pElement){
+			ERR_K2HPRN("Element in collision key index is NULL.");
+			result = false;
+			break;
+		}
+		if(pElement->small){
+			stack.push_back(static_cast<PELEMENT>(Abs(pElement->small)));
+		}
+		if(pElement->big){
+			stack.push_back(static_cast<PELEMENT>(Abs(pElement->big)));
+		}
+		if(pElement->same){
+			stack.push_back(static_cast<PELEMENT>(Abs(pElement->same)));
+		}
+		if(unit != (pElement->hash & pExtra->snapshot_mask)){
+			continue;
+		}
+
+		unsigned char*	byKey	= NULL;
+		unsigned char*	byVal	= NULL;
+		unsigned char*	bySKey	= NULL;
+		unsigned char*	byAttrs	= NULL;
+		ssize_t			keylength;
+		ssize_t			vallength;
+		ssize_t			skeylength;
+		ssize_t			attrlength;
+		if(-1 == (keylength = Get(pElement, &byKey, K2HShm::PAGEOBJ_KEY)) || !byKey){
+			ERR_K2HPRN("Element does not have key-data.");
+			K2H_Free(byKey);
+			result = false;
+			break;
+		}
+		if(-1 == (vallength = Get(pElement, &byVal, K2HShm::PAGEOBJ_VALUE)) || !byVal){
+			vallength = 0L;
+			K2H_Free(byVal);
+		}
+		if(-1 == (skeylength = Get(pElement, &bySKey, K2HShm::PAGEOBJ_SUBKEYS)) || !bySKey){
+			skeylength = 0L;
+			K2H_Free(bySKey);
+		}
+		if(-1 == (attrlength = Get(pElement, &byAttrs, K2HShm::PAGEOBJ_ATTRS)) || !byAttrs){
+			attrlength = 0L;
+			K2H_Free(byAttrs);
+		}
+
+		K2HCommandArchive	ArCom;
+		if(ArCom.SetAll(byKey, keylength, byVal, vallength, bySKey, skeylength, byAttrs, attrlength)){
+			const BCOM*	pBinCom = ArCom.Get();
+			archives.insert(archives.end(), pBinCom->byData, pBinCom->byData + scom_total_length(pBinCom->scom));
+		}else{
+			ERR_K2HPRN("Failed to make command archive.");
+			result = false;
+		}
+		K2H_Free(byKey);
+		K2H_Free(byVal);
+		K2H_Free(bySKey);
+		K2H_Free(byAttrs);
+	}
+
+	// write all archives in unit at once
+	if(result && !archives.empty()){
+		int	wfd = fd;
+		if(-1 == wfd && -1 == (wfd = open(pExtra->snapshot_path, O_WRONLY | O_APPEND))){
+			ERR_K2HPRN("Could not open snapshot file(%s), errno = %d", pExtra->snapshot_path, errno);
+			result = false;
+		}else{
+			result = k2hsnap_write(wfd, &archives[0], archives.size());
+			if(-1 == fd){
+				K2H_CLOSE(wfd);
+			}
+		}
+	}
+	if(!result){
+		__sync_fetch_and_add(&(pExtra->snapshot_error_count), 1L);
+	}
+
+	// set captured flag(even if failure, because the snapshot already has failed.)
+	__sync_fetch_and_or(&pBitmap[bytepos], bitval);
+
+	return result;
+}
+
+//
+// Save snapshot to archive file.
+//
+// The snapshot is consistent at the time of starting, and other threads
+// and processes can continue writing while making the snapshot.
+//
+// [NOTE]
+// At starting, this method initializes the captured flag bitmap and sets
+// the snapshot information into the extra area. After that, each writer
+// captures the unit(masked hash) which is not captured yet into the archive
+// file before updating it(copy on write by unit).
+// This method captures all units which are not captured by writers, so
+// that each unit is written to the archive once.
+// While making the snapshot, cur_mask is not increased because the unit
+// must not be changed.
+// If ptranspos is not NULL, the position(size) of the transaction file at
+// starting is set to it. It is the start position for the incremental
+// archive(see K2HArchive::PutIncrement).
+//
+bool K2HShm::SaveSnapshot(const char* pFile, bool isErrSkip, off_t* ptranspos)
+{
+	if(ISEMPTYSTR(pFile)){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for snapshot.");
+		return false;
+	}
+
+	// transaction file for tagging position
+	int	trfd = -1;
+	if(ptranspos && -1 == (trfd = K2HTransManager::Get()->GetArchiveFd(this))){
+		ERR_K2HPRN("Transaction is not enabled, or it does not have transaction file, so could not tag the position of it.");
+		return false;
+	}
+
+	// open snapshot file
+	int		fd;
+	char	szPath[PATH_MAX];
+	if(-1 == (fd = open(pFile, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH))){
+		ERR_K2HPRN("Could not open/create file(%s): errno(%d)", pFile, errno);
+		return false;
+	}
+	if(NULL == realpath(pFile, szPath) || K2H_SNAPSHOT_PATH_LENGTH <= strlen(szPath)){
+		ERR_K2HPRN("Could not get full path for file(%s), or it is too long.", pFile);
+		K2H_CLOSE(fd);
+		return false;
+	}
+
+	// start snapshot
+	k2h_hash_t	snapshot_mask;
+	{
+		K2HLock	ALObjSnap(ShmFd, Rel(const_cast<long*>(&(pExtra->snapshot_state))), K2HLock::RWLOCK);	// LOCK
+
+		if(K2H_SNAPSHOT_ACTIVE == pExtra->snapshot_state){
+			if(0 < pExtra->snapshot_pid && (0 == kill(pExtra->snapshot_pid, 0) || EPERM == errno)){
+				ERR_K2HPRN("Another process(%d) is making snapshot now.", pExtra->snapshot_pid);
+				K2H_CLOSE(fd);
+				return false;
+			}
+			WAN_K2HPRN("The process(%d) which was making snapshot is not running, so start new snapshot.", pExtra->snapshot_pid);
+		}
+
+		// cur_mask is not changed while making snapshot
+		K2HLock	ALObjCMask(ShmFd, Rel(&(pHead->cur_mask)), K2HLock::RWLOCK);					// LOCK
+
+		snapshot_mask			= K2HShm::MakeMask(K2HShm::GetMaskBitCount(pHead->cur_mask) + K2HShm::GetMaskBitCount(pHead->collision_mask));
+		size_t	bitmap_length	= static_cast<size_t>(snapshot_mask / 8) + 1;
+
+		// bitmap area(if the area is small, makes new area)
+		if(!pExtra->snapshot_bitmap || pExtra->snapshot_bitmap_length < bitmap_length){
+			size_t	area_length		= ALIGNMENT(bitmap_length, K2HShm::SystemPageSize);
+			off_t	new_area_start	= 0L;
+			if(NULL == ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)){
+				ERR_K2HPRN("Could not expand bitmap area for snapshot.");
+				K2H_CLOSE(fd);
+				return false;
+			}
+			pExtra->snapshot_bitmap			= reinterpret_cast<unsigned char*>(new_area_start);
+			pExtra->snapshot_bitmap_length	= area_length;
+		}
+		unsigned char*	pBitmap;
+		if(NULL == (pBitmap = static_cast<unsigned char*>(Abs(pExtra->snapshot_bitmap)))){
+			ERR_K2HPRN("Could not get snapshot bitmap area.");
+			K2H_CLOSE(fd);
+			return false;
+		}
+		memset(pBitmap, 0, pExtra->snapshot_bitmap_length);
+
+		// [NOTE]
+		// The writer puts the transaction after updating, so the commands
+		// before this position are included in this snapshot. The commands
+		// after it might be included too, but these are re-loadable.
+		//
+		if(ptranspos){
+			K2HLock		ALObjTrans(trfd, 0L, K2HLock::RDLOCK);		// LOCK
+			struct stat	st;
+			if(-1 == fstat(trfd, &st)){
+				ERR_K2HPRN("Could not get transaction file stat: errno(%d)", errno);
+				K2H_CLOSE(fd);
+				return false;
+			}
+			*ptranspos = st.st_size;
+		}
+
+		strcpy(pExtra->snapshot_path, szPath);
+		pExtra->snapshot_mask			= snapshot_mask;
+		pExtra->snapshot_pid			= getpid();
+		pExtra->snapshot_error_count	= 0L;
+		__sync_synchronize();
+		pExtra->snapshot_state			= K2H_SNAPSHOT_ACTIVE;
+	}
+
+	// capture all units
+	bool	result = true;
+	for(k2h_hash_t unit = 0UL; unit <= snapshot_mask; ++unit){
+		K2HLock		ALObjCKI(K2HLock::RDLOCK);		// LOCK
+		PCKINDEX	pCKIndex;
+		if(NULL == (pCKIndex = GetCKIndex(unit, ALObjCKI)) || !CaptureSnapshot(pCKIndex, unit, fd)){
+			if(isErrSkip){
+				MSG_K2HPRN("Failed to capture snapshot unit(%" PRIu64 "), skipping.", unit);
+				continue;
+			}
+			ERR_K2HPRN("Failed to capture snapshot unit(%" PRIu64 ").", unit);
+			result = false;
+			break;
+		}
+	}
+
+	// stop snapshot
+	{
+		K2HLock	ALObjSnap(ShmFd, Rel(const_cast<long*>(&(pExtra->snapshot_state))), K2HLock::RWLOCK);	// LOCK
+
+		pExtra->snapshot_state	= K2H_SNAPSHOT_NONE;
+		pExtra->snapshot_pid	= 0;
+
+		if(result && !isErrSkip && 0 < pExtra->snapshot_error_count){
+			ERR_K2HPRN("Some units(%ld) could not be captured by writers.", pExtra->snapshot_error_count);
+			result = false;
+		}
+	}
+
+	if(0 != fsync(fd)){
+		WAN_K2HPRN("Failed to sync snapshot file(%s), errno = %d", pFile, errno);
+	}
+	K2H_CLOSE(fd);
+
+	return result;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,559 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hutil.h"
+#include "k2hashfunc.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility structure and functions for subkeys directory
+//---------------------------------------------------------
+typedef struct k2h_subkeys_dir_chunk{
+	std::string	first;						// first subkey(empty for the first chunk)
+	std::string	chunk;						// chunk key name
+}K2HSKDIRCHUNK;
+
+typedef std::vector<K2HSKDIRCHUNK>	k2hskdirchunks_t;
+
+static bool k2h_parse_skdir(const unsigned char* byDir, size_t length, k2hskdirchunks_t& chunks)
+{
+	chunks.clear();
+	if(!K2HShm::IsSubKeysDirectory(byDir, length)){
+		ERR_K2HPRN("Binary data is not subkeys directory.");
+		return false;
+	}
+	const K2HSKDIR*		pdir	= reinterpret_cast<const K2HSKDIR*>(byDir);
+	const K2HSKDIRENT*	pentries= reinterpret_cast<const K2HSKDIRENT*>(byDir + sizeof(K2HSKDIR));
+	if(K2HSKDIR_VERSION != pdir->version || length < (sizeof(K2HSKDIR) + sizeof(K2HSKDIRENT) * pdir->count)){
+		ERR_K2HPRN("Subkeys directory is broken or unknown version(%" PRIu64 ").", pdir->version);
+		return false;
+	}
+	for(size_t cnt = 0; cnt < pdir->count; ++cnt){
+		if(	length < (static_cast<size_t>(pentries[cnt].firstoff) + pentries[cnt].firstlen) ||
+			length < (static_cast<size_t>(pentries[cnt].chunkoff) + pentries[cnt].chunklen) ||
+			0 == pentries[cnt].chunklen )
+		{
+			ERR_K2HPRN("Subkeys directory entry(%zu) is broken.", cnt);
+			chunks.clear();
+			return false;
+		}
+		K2HSKDIRCHUNK	chunk;
+		chunk.first.assign(reinterpret_cast<const char*>(byDir + pentries[cnt].firstoff), pentries[cnt].firstlen);
+		chunk.chunk.assign(reinterpret_cast<const char*>(byDir + pentries[cnt].chunkoff), pentries[cnt].chunklen);
+		chunks.push_back(chunk);
+	}
+	return true;
+}
+
+static unsigned char* k2h_build_skdir(const k2hskdirchunks_t& chunks, size_t& length)
+{
+	length = sizeof(K2HSKDIR) + sizeof(K2HSKDIRENT) * chunks.size();
+	for(k2hskdirchunks_t::const_iterator iter = chunks.begin(); iter != chunks.end(); ++iter){
+		length += iter->first.length() + iter->chunk.length();
+	}
+	unsigned char*	byDir;
+	if(NULL == (byDir = reinterpret_cast<unsigned char*>(malloc(length)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		length = 0;
+		return NULL;
+	}
+	PK2HSKDIR		pdir	= reinterpret_cast<PK2HSKDIR>(byDir);
+	PK2HSKDIRENT	pentries= reinterpret_cast<PK2HSKDIRENT>(byDir + sizeof(K2HSKDIR));
+	off_t			offset	= static_cast<off_t>(sizeof(K2HSKDIR) + sizeof(K2HSKDIRENT) * chunks.size());
+	pdir->magic				= K2HSKDIR_MAGIC;
+	pdir->version			= K2HSKDIR_VERSION;
+	pdir->count				= chunks.size();
+	for(size_t cnt = 0; cnt < chunks.size(); ++cnt){
+		pentries[cnt].firstoff	= offset;
+		pentries[cnt].firstlen	= chunks[cnt].first.length();
+		memcpy(byDir + offset, chunks[cnt].first.data(), chunks[cnt].first.length());
+		offset					+= static_cast<off_t>(chunks[cnt].first.length());
+
+		pentries[cnt].chunkoff	= offset;
+		pentries[cnt].chunklen	= chunks[cnt].chunk.length();
+		memcpy(byDir + offset, chunks[cnt].chunk.data(), chunks[cnt].chunk.length());
+		offset					+= static_cast<off_t>(chunks[cnt].chunk.length());
+	}
+	return byDir;
+}
+
+//
+// Returns the position of the chunk which the subkey belongs to.
+// (the last chunk which first subkey is less than or equal to the subkey)
+//
+static size_t k2h_find_skdir_chunk(const k2hskdirchunks_t& chunks, const unsigned char* bySubkey, size_t length)
+{
+	size_t	start	= 1;
+	size_t	end		= chunks.size();
+	while(start < end){
+		size_t	mid = (start + end) / 2;
+		if(0 < k2hbincmp(reinterpret_cast<const unsigned char*>(chunks[mid].first.data()), chunks[mid].first.length(), bySubkey, length)){
+			end		= mid;
+		}else{
+			start	= mid + 1;
+		}
+	}
+	return (start - 1);
+}
+
+//---------------------------------------------------------
+// Class methods
+//---------------------------------------------------------
+bool K2HShm::IsSubKeysDirectory(const unsigned char* bySubkeys, size_t length)
+{
+	if(!bySubkeys || length < sizeof(K2HSKDIR)){
+		return false;
+	}
+	return (K2HSKDIR_MAGIC == reinterpret_cast<const K2HSKDIR*>(bySubkeys)->magic);
+}
+
+//
+// Returns new chunk key name for the key, the caller must free it.
+//
+// [NOTE]
+// The chunk key name does not include the key name, because the key can
+// be renamed. The name is made from key hash, process id, time and the
+// sequence number in process, then it is unique.
+//
+unsigned char* K2HShm::MakeSubKeysChunkKey(const unsigned char* byKey, size_t keylength, size_t& chunklength)
+{
+	static volatile uint64_t	chunk_sequence = 0;
+
+	struct timespec	ts;
+	if(-1 == clock_gettime(CLOCK_REALTIME, &ts)){
+		ts.tv_sec	= time(NULL);
+		ts.tv_nsec	= 0;
+	}
+	char	szBuff[128];
+	snprintf(szBuff, sizeof(szBuff), "%s%016" PRIx64 "-%d-%" PRIx64 ".%09ld-%" PRIu64, K2HSKDIR_CHUNK_PREFIX, static_cast<uint64_t>(K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength)), getpid(), static_cast<uint64_t>(ts.tv_sec), ts.tv_nsec, __sync_add_and_fetch(&chunk_sequence, 1));
+
+	chunklength = strlen(szBuff) + 1;
+	return k2hbindup(reinterpret_cast<const unsigned char*>(szBuff), chunklength);
+}
+
+//
+// Load subkeys from binary data which is subkeys list or subkeys directory.
+//
+// [NOTE]
+// For subkeys directory, this method reads all chunks and joins them to
+// one subkeys list binary. The chunks are sorted, then loading it does
+// not need to move any subkey in K2HSubKeys.
+//
+K2HSubKeys* K2HShm::LoadSubKeys(const unsigned char* bySubkeys, size_t length) const
+{
+	K2HSubKeys*	pSubKeys = new K2HSubKeys();
+	if(!K2HShm::IsSubKeysDirectory(bySubkeys, length)){
+		if(!pSubKeys->Serialize(bySubkeys, length)){
+			ERR_K2HPRN("Could not convert binary to K2HSubKeys object.");
+			K2H_Delete(pSubKeys);
+		}
+		return pSubKeys;
+	}
+
+	k2hskdirchunks_t	chunks;
+	if(!k2h_parse_skdir(bySubkeys, length, chunks)){
+		K2H_Delete(pSubKeys);
+		return NULL;
+	}
+
+	// load chunks
+	vector<unsigned char*>	values;
+	vector<size_t>			lengths;
+	size_t					total_count	= 0;
+	size_t					total_length= sizeof(size_t);
+	for(k2hskdirchunks_t::const_iterator iter = chunks.begin(); iter != chunks.end(); ++iter){
+		unsigned char*	byValue	= NULL;
+		ssize_t			vallen	= Get(reinterpret_cast<const unsigned char*>(iter->chunk.data()), iter->chunk.length(), &byValue, false);
+		if(!byValue || vallen < static_cast<ssize_t>(sizeof(size_t))){
+			MSG_K2HPRN("Subkeys chunk(%s) is empty or not found, skip it.", iter->chunk.c_str());
+			K2H_Free(byValue);
+			continue;
+		}
+		total_count	+= *reinterpret_cast<const size_t*>(byValue);
+		total_length+= static_cast<size_t>(vallen) - sizeof(size_t);
+		values.push_back(byValue);
+		lengths.push_back(static_cast<size_t>(vallen));
+	}
+
+	// join chunks
+	unsigned char*	byJoined;
+	if(NULL == (byJoined = reinterpret_cast<unsigned char*>(malloc(total_length)))){
+		ERR_K2HPRN("Could not allocation memory.");
+		K2H_Delete(pSubKeys);
+	}else{
+		size_t	offset = sizeof(size_t);
+		*reinterpret_cast<size_t*>(byJoined) = total_count;
+		for(size_t cnt = 0; cnt < values.size(); ++cnt){
+			memcpy(byJoined + offset, values[cnt] + sizeof(size_t), lengths[cnt] - sizeof(size_t));
+			offset += lengths[cnt] - sizeof(size_t);
+		}
+		// joined binary is owned by K2HSubKeys object
+		if(!pSubKeys->Adopt(byJoined, total_length)){
+			ERR_K2HPRN("Could not convert subkeys chunks to K2HSubKeys object.");
+			K2H_Delete(pSubKeys);
+		}
+	}
+	for(vector<unsigned char*>::iterator iter = values.begin(); iter != values.end(); ++iter){
+		K2H_Free(*iter);
+	}
+	return pSubKeys;
+}
+
+//
+// Returns true and subkeys directory binary only when the key has it.
+//
+bool K2HShm::GetSubKeysDirectory(const unsigned char* byKey, size_t keylength, unsigned char** ppDir, size_t& dirlength) const
+{
+	*ppDir		= NULL;
+	dirlength	= 0;
+
+	K2HLock		ALObjCKI(K2HLock::RDLOCK);						// LOCK
+	PELEMENT	pElement;
+	if(NULL == (pElement = GetElement(byKey, keylength, ALObjCKI)) || !pElement->subkeys){
+		return false;
+	}
+	unsigned char*	bySubkeys	= NULL;
+	ssize_t			length		= Get(pElement, &bySubkeys, PAGEOBJ_SUBKEYS);
+	ALObjCKI.Unlock();											// Unlock
+
+	if(!bySubkeys || length <= 0 || !K2HShm::IsSubKeysDirectory(bySubkeys, static_cast<size_t>(length))){
+		K2H_Free(bySubkeys);
+		return false;
+	}
+	*ppDir		= bySubkeys;
+	dirlength	= static_cast<size_t>(length);
+	return true;
+}
+
+//
+// Make binary data for subkeys area of the key.
+//
+// If the subkey count is over threshold, this method makes chunk keys and
+// returns subkeys directory. Otherwise returns subkeys list.
+//
+bool K2HShm::MakeSubKeysBinary(const unsigned char* byKey, size_t keylength, K2HSubKeys* pSubKeys, unsigned char** ppSubkeys, size_t& length)
+{
+	if(!pSubKeys || pSubKeys->size() <= K2HSKDIR_THRESHOLD){
+		if(!pSubKeys){
+			*ppSubkeys	= NULL;
+			length		= 0;
+			return true;
+		}
+		return pSubKeys->Serialize(ppSubkeys, length);
+	}
+
+	// [NOTE]
+	// Each chunk has the half of maximum subkeys for adding subkeys.
+	//
+	k2hskdirchunks_t		chunks;
+	K2HSubKeys				subkeys;
+	bool					result	= true;
+	K2HSubKeys::iterator	iter	= pSubKeys->begin();
+	while(result && iter != pSubKeys->end()){
+		K2HSKDIRCHUNK	chunk;
+		if(!chunks.empty()){
+			chunk.first.assign(reinterpret_cast<const char*>(iter->pSubKey), iter->length);
+		}
+		subkeys.clear();
+		for(; iter != pSubKeys->end() && subkeys.size() < (K2HSKDIR_CHUNK_MAX / 2); ++iter){
+			subkeys.insert(iter->pSubKey, iter->length);
+		}
+
+		// write chunk
+		unsigned char*	byChunk;
+		size_t			chunklen = 0;
+		if(NULL == (byChunk = K2HShm::MakeSubKeysChunkKey(byKey, keylength, chunklen)) || !SetSubKeysChunk(byChunk, chunklen, subkeys, true)){
+			ERR_K2HPRN("Could not make subkeys chunk.");
+			result = false;
+		}else{
+			chunk.chunk.assign(reinterpret_cast<const char*>(byChunk), chunklen);
+			chunks.push_back(chunk);
+		}
+		K2H_Free(byChunk);
+	}
+
+	if(result){
+		if(NULL == (*ppSubkeys = k2h_build_skdir(chunks, length))){
+			result = false;
+		}
+	}
+	if(!result){
+		// remove chunk keys which are made
+		for(k2hskdirchunks_t::const_iterator iter = chunks.begin(); iter != chunks.end(); ++iter){
+			if(!Remove(reinterpret_cast<const unsigned char*>(iter->chunk.data()), iter->chunk.length(), false, NULL, true)){
+				WAN_K2HPRN("Could not remove subkeys chunk(%s), but continue...", iter->chunk.c_str());
+			}
+		}
+	}
+	return result;
+}
+
+//
+// Write subkeys into chunk key.
+//
+// [NOTE]
+// The chunk key does not have any attribute as same as queue marker.
+// Updating chunk replaces only its value, then it does not make history.
+//
+bool K2HShm::SetSubKeysChunk(const unsigned char* byChunk, size_t chunklength, const K2HSubKeys& subkeys, bool is_new)
+{
+	unsigned char*	bySubkeys	= NULL;
+	size_t			length		= 0;
+	if(!subkeys.Serialize(&bySubkeys, length)){
+		ERR_K2HPRN("Could not make binary data from subkeys chunk.");
+		return false;
+	}
+	bool	result;
+	if(is_new){
+		result = Set(byChunk, chunklength, bySubkeys, length, NULL, true, NULL, NULL, NULL, K2hAttrOpsMan::OPSMAN_MASK_ALL);
+	}else{
+		result = ReplaceValue(byChunk, chunklength, bySubkeys, length);
+	}
+	if(!result){
+		ERR_K2HPRN("Could not write subkeys chunk(%s).", reinterpret_cast<const char*>(byChunk));
+	}
+	K2H_Free(bySubkeys);
+	return result;
+}
+
+//
+// Add subkey into the chunk in subkeys directory.
+//
+// [NOTE]
+// This method reads and updates only one chunk, and updates the directory
+// only when the chunk is split.
+//
+bool K2HShm::AddSubKeyToDirectory(const unsigned char* byKey, size_t keylength, const unsigned char* byDir, size_t dirlength, const unsigned char* bySubkey, size_t skeylength)
+{
+	k2hskdirchunks_t	chunks;
+	if(!k2h_parse_skdir(byDir, dirlength, chunks) || chunks.empty()){
+		ERR_K2HPRN("Could not load subkeys directory.");
+		return false;
+	}
+	size_t					pos		= k2h_find_skdir_chunk(chunks, bySubkey, skeylength);
+	const unsigned char*	byChunk	= reinterpret_cast<const unsigned char*>(chunks[pos].chunk.data());
+	size_t					chunklen= chunks[pos].chunk.length();
+
+	// load chunk
+	K2HSubKeys		subkeys;
+	unsigned char*	byValue	= NULL;
+	ssize_t			vallen	= Get(byChunk, chunklen, &byValue, false);
+	if(byValue && 0 < vallen && !subkeys.Adopt(byValue, static_cast<size_t>(vallen))){	// byValue is owned by subkeys
+		ERR_K2HPRN("Could not load subkeys chunk(%s).", chunks[pos].chunk.c_str());
+		return false;
+	}
+
+	subkeys.insert(bySubkey, skeylength);
+	if(subkeys.size() <= K2HSKDIR_CHUNK_MAX){
+		return SetSubKeysChunk(byChunk, chunklen, subkeys, false);
+	}
+
+	// split chunk
+	K2HSubKeys		lower;
+	K2HSubKeys		upper;
+	size_t			cnt = 0;
+	for(K2HSubKeys::iterator iter = subkeys.begin(); iter != subkeys.end(); ++iter, ++cnt){
+		if(cnt < (subkeys.size() / 2)){
+			lower.insert(iter->pSubKey, iter->length);
+		}else{
+			upper.insert(iter->pSubKey, iter->length);
+		}
+	}
+	unsigned char*	byNewChunk;
+	size_t			newchunklen = 0;
+	if(NULL == (byNewChunk = K2HShm::MakeSubKeysChunkKey(byKey, keylength, newchunklen))){
+		return false;
+	}
+	if(!SetSubKeysChunk(byNewChunk, newchunklen, upper, true)){
+		K2H_Free(byNewChunk);
+		return false;
+	}
+	K2HSKDIRCHUNK	newchunk;
+	newchunk.first.assign(reinterpret_cast<const char*>(upper.begin()->pSubKey), upper.begin()->length);
+	newchunk.chunk.assign(reinterpret_cast<const char*>(byNewChunk), newchunklen);
+	K2H_Free(byNewChunk);
+
+	if(!SetSubKeysChunk(byChunk, chunklen, lower, false)){
+		Remove(reinterpret_cast<const unsigned char*>(newchunk.chunk.data()), newchunk.chunk.length(), false, NULL, true);
+		return false;
+	}
+	chunks.insert(chunks.begin() + pos + 1, newchunk);
+
+	// update directory
+	unsigned char*	byNewDir;
+	size_t			newdirlen = 0;
+	if(NULL == (byNewDir = k2h_build_skdir(chunks, newdirlen))){
+		return false;
+	}
+	bool	result;
+	if(false == (result = ReplaceSubkeys(byKey, keylength, byNewDir, newdirlen))){
+		ERR_K2HPRN("Could not replace subkeys directory in key.");
+	}
+	K2H_Free(byNewDir);
+	return result;
+}
+
+//
+// Remove subkey from the chunk in subkeys directory.
+//
+// The empty chunk is removed from the directory, and the directory is
+// converted to subkeys list when only one small chunk is left.
+// The removed chunk key is removed in replacing subkeys of the key.
+//
+bool K2HShm::RemoveSubKeyFromDirectory(const unsigned char* byKey, size_t keylength, const unsigned char* byDir, size_t dirlength, const unsigned char* bySubkey, size_t skeylength, bool& is_found)
+{
+	is_found = false;
+
+	k2hskdirchunks_t	chunks;
+	if(!k2h_parse_skdir(byDir, dirlength, chunks) || chunks.empty()){
+		ERR_K2HPRN("Could not load subkeys directory.");
+		return false;
+	}
+	size_t					pos		= k2h_find_skdir_chunk(chunks, bySubkey, skeylength);
+	const unsigned char*	byChunk	= reinterpret_cast<const unsigned char*>(chunks[pos].chunk.data());
+	size_t					chunklen= chunks[pos].chunk.length();
+
+	// load chunk
+	K2HSubKeys		subkeys;
+	unsigned char*	byValue	= NULL;
+	ssize_t			vallen	= Get(byChunk, chunklen, &byValue, false);
+	if(!byValue || vallen <= 0){
+		MSG_K2HPRN("Could not load subkeys chunk(%s).", chunks[pos].chunk.c_str());
+		K2H_Free(byValue);
+		return true;
+	}
+	if(!subkeys.Adopt(byValue, static_cast<size_t>(vallen))){								// byValue is owned by subkeys
+		MSG_K2HPRN("Could not load subkeys chunk(%s).", chunks[pos].chunk.c_str());
+		return true;
+	}
+
+	if(!subkeys.erase(bySubkey, skeylength)){
+		return true;
+	}
+	is_found = true;
+
+	if(!subkeys.empty() && (1 < chunks.size() || (K2HSKDIR_THRESHOLD / 2) < subkeys.size())){
+		return SetSubKeysChunk(byChunk, chunklen, subkeys, false);
+	}
+
+	// update directory
+	unsigned char*	byNewSubkeys= NULL;
+	size_t			newlength	= 0;
+	if(1 == chunks.size()){
+		// convert to subkeys list
+		if(!subkeys.Serialize(&byNewSubkeys, newlength)){
+			ERR_K2HPRN("Could not make subkeys binary data.");
+			return false;
+		}
+	}else{
+		chunks.erase(chunks.begin() + pos);
+		chunks.front().first.clear();
+
+		// load last one chunk for converting to subkeys list
+		K2HSubKeys*	pLastSubKeys = NULL;
+		if(1 == chunks.size()){
+			unsigned char*	byLast	= NULL;
+			ssize_t			lastlen	= Get(reinterpret_cast<const unsigned char*>(chunks.front().chunk.data()), chunks.front().chunk.length(), &byLast, false);
+			if(byLast && 0 < lastlen){
+				pLastSubKeys = new K2HSubKeys();
+				if(!pLastSubKeys->Adopt(byLast, static_cast<size_t>(lastlen)) || (K2HSKDIR_THRESHOLD / 2) < pLastSubKeys->size()){	// byLast is owned by pLastSubKeys
+					K2H_Delete(pLastSubKeys);
+				}
+			}else{
+				K2H_Free(byLast);
+			}
+		}
+		if(pLastSubKeys){
+			if(!pLastSubKeys->Serialize(&byNewSubkeys, newlength)){
+				ERR_K2HPRN("Could not make subkeys binary data.");
+				K2H_Delete(pLastSubKeys);
+				return false;
+			}
+			K2H_Delete(pLastSubKeys);
+		}else if(NULL == (byNewSubkeys = k2h_build_skdir(chunks, newlength))){
+			return false;
+		}
+	}
+	bool	result;
+	if(false == (result = ReplaceSubkeys(byKey, keylength, byNewSubkeys, newlength))){
+		ERR_K2HPRN("Could not replace subkeys directory in key.");
+	}
+	K2H_Free(byNewSubkeys);
+	return result;
+}
+
+//
+// Remove chunk keys in old directory which are not in new directory.
+//
+// [NOTE]
+// This is called after the subkeys area of the key is replaced or the key
+// is removed, and the caller must not lock the key.
+// The chunk key does not make history.
+//
+void K2HShm::RemoveSubKeysChunks(const unsigned char* byOldDir, size_t oldlength, const unsigned char* byNewDir, size_t newlength)
+{
+	if(!K2HShm::IsSubKeysDirectory(byOldDir, oldlength)){
+		return;
+	}
+	k2hskdirchunks_t	oldchunks;
+	k2hskdirchunks_t	newchunks;
+	if(!k2h_parse_skdir(byOldDir, oldlength, oldchunks)){
+		WAN_K2HPRN("Could not load old subkeys directory, then chunk keys are left.");
+		return;
+	}
+	if(K2HShm::IsSubKeysDirectory(byNewDir, newlength) && !k2h_parse_skdir(byNewDir, newlength, newchunks)){
+		WAN_K2HPRN("Could not load new subkeys directory, then chunk keys are left.");
+		return;
+	}
+	for(k2hskdirchunks_t::const_iterator iter = oldchunks.begin(); iter != oldchunks.end(); ++iter){
+		bool	is_found = false;
+		for(k2hskdirchunks_t::const_iterator iter2 = newchunks.begin(); iter2 != newchunks.end(); ++iter2){
+			if(iter->chunk == iter2->chunk){
+				is_found = true;
+				break;
+			}
+		}
+		if(!is_found && !Remove(reinterpret_cast<const unsigned char*>(iter->chunk.data()), iter->chunk.length(), false, NULL, true)){
+			WAN_K2HPRN("Could not remove subkeys chunk(%s), but continue...", iter->chunk.c_str());
+		}
+	}
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -0,0 +1,170 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+// [NOTE]
+// The wakeup words are in the extra area which is mapped as shared by
+// all processes, so that these use not private futex operation.
+//
+static inline int k2h_futex_wait(volatile uint32_t* paddr, uint32_t value, const struct timespec* timeout)
+{
+	return static_cast<int>(syscall(SYS_futex, paddr, FUTEX_WAIT, value, timeout, NULL, 0));
+}
+
+static inline int k2h_futex_wake(volatile uint32_t* paddr)
+{
+	return static_cast<int>(syscall(SYS_futex, paddr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0));
+}
+
+static inline bool k2h_has_queue_wakeup(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, queue_waiters) + sizeof(uint32_t)) <= pExtra->length);
+}
+
+//---------------------------------------------------------
+// Class methods
+//---------------------------------------------------------
+// [NOTE]
+// The wakeup sequence is one for all queues in k2hash, then a waiter
+// may be woken up by pushing to other queue. The waiter only checks its
+// queue again and sleeps, it costs small. But pushers do not call futex
+// at all when there is no waiter.
+//
+// The waiter must call methods by following order.
+//	1) StartQueueWait()					- registers waiter(makes extra area if needed)
+//	2) GetQueueWakeupSequence()			- reads sequence before checking queue
+//	3) check(pop) queue
+//	4) WaitQueueWakeup(sequence)		- sleeps while sequence is not changed
+//	5) back to 2) or StopQueueWait()
+//
+// The pusher increments sequence after updating queue, and reads waiter
+// count. Both of waiter count and sequence are updated by atomic operation
+// which is full barrier, thus the waiter does not miss pushing.
+//
+bool K2HShm::StartQueueWait(void)
+{
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for queue wakeup.");
+		return false;
+	}
+	if(!k2h_has_queue_wakeup(pExtra)){
+		ERR_K2HPRN("Extra area does not have queue wakeup area.");
+		return false;
+	}
+	__sync_add_and_fetch(&(pExtra->queue_waiters), 1);
+	return true;
+}
+
+void K2HShm::StopQueueWait(void)
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_queue_wakeup(pExtra)){
+		return;
+	}
+	if(0 < pExtra->queue_waiters){
+		__sync_sub_and_fetch(&(pExtra->queue_waiters), 1);
+	}
+}
+
+uint32_t K2HShm::GetQueueWakeupSequence(void) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_queue_wakeup(pExtra)){
+		return 0;
+	}
+	return __sync_add_and_fetch(&(pExtra->queue_wakeup_seq), 0);
+}
+
+//
+// Sleeps until the sequence is changed by pushing or timeout.
+// timeout_ms is milliseconds, negative value means no timeout.
+//
+// [NOTE]
+// This method returns true when it is woken up, timeout or interrupted.
+// The caller must check queue after returning.
+//
+bool K2HShm::WaitQueueWakeup(uint32_t sequence, long timeout_ms) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_queue_wakeup(pExtra)){
+		ERR_K2HPRN("There is no queue wakeup area.");
+		return false;
+	}
+	struct timespec		timeout;
+	struct timespec*	ptimeout = NULL;
+	if(0 <= timeout_ms){
+		timeout.tv_sec	= timeout_ms / 1000;
+		timeout.tv_nsec	= (timeout_ms % 1000) * 1000 * 1000;
+		ptimeout		= &timeout;
+	}
+	if(-1 == k2h_futex_wait(&(pExtra->queue_wakeup_seq), sequence, ptimeout)){
+		if(EAGAIN != errno && ETIMEDOUT != errno && EINTR != errno){
+			ERR_K2HPRN("Failed to wait queue wakeup by futex(errno=%d).", errno);
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// Called after pushing to any queue.
+//
+void K2HShm::WakeupQueueWaiters(void) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_queue_wakeup(pExtra)){
+		// no one has waited
+		return;
+	}
+	__sync_add_and_fetch(&(pExtra->queue_wakeup_seq), 1);
+	if(0 < __sync_add_and_fetch(&(pExtra->queue_waiters), 0)){
+		if(-1 == k2h_futex_wake(&(pExtra->queue_wakeup_seq))){
+			WAN_K2HPRN("Failed to wake up queue waiters by futex(errno=%d).", errno);
+		}
+	}
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
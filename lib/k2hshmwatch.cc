@@ -0,0 +1,423 @@
+/*
+ * K2HASH
+ *
+ * Copyright 2013 Yahoo Japan Corporation.
+ *
+ * K2HASH is key-valuew store base libraries.
+ * K2HASH is made for the purpose of the construction of
+ * original KVS system and the offer of the library.
+ * The characteristic is this KVS library which Key can
+ * layer. And can support multi-processing and multi-thread,
+ * and is provided safely as available KVS.
+ *
+ * For the full copyright and license information, please view
+ * the license file that was distributed with this source code.
+ *
+ * AUTHOR:   Takeshi Nakatani
+ * CREATE:   Mon Oct 19 2026
+ * REVISION:
+ *
+ */
+
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "k2hcommon.h"
+#include "k2hshm.h"
+#include "k2hcommand.h"
+#include "k2hashfunc.h"
+#include "k2hutil.h"
+#include "k2hdbg.h"
+
+using namespace std;
+
+//---------------------------------------------------------
+// Symbols
+//---------------------------------------------------------
+#define	K2H_WATCH_MIN_CAPACITY			64
+
+//---------------------------------------------------------
+// Utility functions
+//---------------------------------------------------------
+// [NOTE]
+// The wakeup words are in the extra area which is mapped as shared by
+// all processes, so that these use not private futex operation.
+//
+static inline int k2h_watch_futex_wait(volatile uint32_t* paddr, uint32_t value, const struct timespec* timeout)
+{
+	return static_cast<int>(syscall(SYS_futex, paddr, FUTEX_WAIT, value, timeout, NULL, 0));
+}
+
+static inline int k2h_watch_futex_wake(volatile uint32_t* paddr)
+{
+	return static_cast<int>(syscall(SYS_futex, paddr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0));
+}
+
+static inline bool k2h_has_watch_area(const PK2HEXTRA pExtra)
+{
+	return (pExtra && (offsetof(K2HEXTRA, watch_waiters) + sizeof(uint32_t)) <= pExtra->length);
+}
+
+static inline bool k2h_is_watch_active(const PK2HEXTRA pExtra)
+{
+	return (k2h_has_watch_area(pExtra) && K2H_WATCH_ACTIVE == pExtra->watch_state);
+}
+
+static inline long k2h_watch_type(long scomtype)
+{
+	switch(scomtype){
+		case	SCOM_SET_ALL:		return K2H_WATCH_OP_SET;
+		case	SCOM_REPLACE_VAL:	return K2H_WATCH_OP_VALUE;
+		case	SCOM_OW_VAL:		return K2H_WATCH_OP_VALUE;
+		case	SCOM_REPLACE_SKEY:	return K2H_WATCH_OP_SUBKEYS;
+		case	SCOM_REPLACE_ATTRS:	return K2H_WATCH_OP_ATTRS;
+		case	SCOM_DEL_KEY:		return K2H_WATCH_OP_DELETE;
+		case	SCOM_RENAME:		return K2H_WATCH_OP_RENAME;
+		default:					break;
+	}
+	return -1L;
+}
+
+//
+// Compare the key in event with prefix.
+//
+// [NOTE]
+// If prefix is longer than the truncated key in event, only the top of
+// prefix is compared. Thus the event for the key which does not match
+// prefix may be returned in this case.
+//
+static inline bool k2h_watch_match_prefix(const K2HWATCHEVENT& event, const unsigned char* byPrefix, size_t prefixlen)
+{
+	if(!byPrefix || 0 == prefixlen){
+		return true;
+	}
+	if(event.keylength < prefixlen){
+		return false;
+	}
+	size_t	cmplen = min(prefixlen, static_cast<size_t>(K2H_WATCH_KEY_LENGTH));
+	return (0 == memcmp(event.key, byPrefix, cmplen));
+}
+
+//---------------------------------------------------------
+// Methods
+//---------------------------------------------------------
+// [NOTE]
+// Watch mode posts the event for each mutation into the event ring in
+// the extra area, and the processes which attach same k2hash can read
+// the events without the transaction plugin. The event is posted from
+// K2HTransaction regardless of enabling transaction, then it does not
+// cost serializing transaction data.
+// The ring is bounded, so that the reader which is late over the ring
+// capacity gets overflow, and must resync all keys.
+//
+// The event ring is made at first enabling, and it is not moved after
+// that, because the processes which are posting do not lock it. Thus
+// the capacity can not be over the capacity at first enabling.
+//
+bool K2HShm::EnableWatch(size_t capacity)
+{
+	if(0 == capacity){
+		ERR_K2HPRN("Parameter is wrong.");
+		return false;
+	}
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	K2HFILE_UPDATE_CHECK(this);
+
+	PK2HEXTRA	pExtra;
+	if(NULL == (pExtra = GetExtraArea()) && NULL == (pExtra = MakeExtraArea())){
+		ERR_K2HPRN("Could not get extra area for watch mode.");
+		return false;
+	}
+	if(!k2h_has_watch_area(pExtra)){
+		ERR_K2HPRN("Extra area does not have watch mode area.");
+		return false;
+	}
+
+	// capacity is power of 2
+	uint64_t	ring_capacity = K2H_WATCH_MIN_CAPACITY;
+	while(ring_capacity < static_cast<uint64_t>(capacity)){
+		ring_capacity <<= 1;
+	}
+	size_t		ring_length = static_cast<size_t>(ring_capacity) * sizeof(K2HWATCHSLOT);
+
+	K2HLock	ALObjWatch(ShmFd, Rel(const_cast<long*>(&(pExtra->watch_state))), K2HLock::RWLOCK);	// LOCK
+
+	// event ring area
+	if(!pExtra->watch_ring){
+		size_t	area_length		= ALIGNMENT(ring_length, K2HShm::SystemPageSize);
+		off_t	new_area_start	= 0L;
+		if(NULL == ExpandArea(K2H_AREA_EXTRA, area_length, new_area_start)){
+			ERR_K2HPRN("Could not expand event ring area for watch mode.");
+			return false;
+		}
+		pExtra->watch_ring			= reinterpret_cast<void*>(new_area_start);
+		pExtra->watch_ring_length	= area_length;
+	}else if(pExtra->watch_ring_length < ring_length){
+		ERR_K2HPRN("Capacity(%zu) is over the event ring area which is made at first enabling.", capacity);
+		return false;
+	}
+	PK2HWATCHSLOT	pRing;
+	if(NULL == (pRing = static_cast<PK2HWATCHSLOT>(Abs(pExtra->watch_ring)))){
+		ERR_K2HPRN("Could not get event ring area.");
+		return false;
+	}
+
+	// [NOTE]
+	// The head is advanced over the capacity before clearing slots, so
+	// that the readers which read before disabling get overflow.
+	//
+	pExtra->watch_state	= K2H_WATCH_NONE;
+	__sync_synchronize();
+	__sync_add_and_fetch(&(pExtra->watch_head), static_cast<uint64_t>(pExtra->watch_ring_length / sizeof(K2HWATCHSLOT)) + 1);
+	memset(pRing, 0, pExtra->watch_ring_length);
+	pExtra->watch_capacity	= ring_capacity;
+	__sync_synchronize();
+	pExtra->watch_state		= K2H_WATCH_ACTIVE;
+
+	return true;
+}
+
+bool K2HShm::DisableWatch(void)
+{
+	if(!IsAttached()){
+		ERR_K2HPRN("There is no attached K2HASH.");
+		return false;
+	}
+	if(isReadMode){
+		ERR_K2HPRN("K2HASH is attached read only mode.");
+		return false;
+	}
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_watch_area(pExtra)){
+		return true;
+	}
+	K2HLock	ALObjWatch(ShmFd, Rel(const_cast<long*>(&(pExtra->watch_state))), K2HLock::RWLOCK);	// LOCK
+	pExtra->watch_state	= K2H_WATCH_NONE;
+
+	// wake up readers for returning
+	__sync_add_and_fetch(&(pExtra->watch_wakeup_seq), 1);
+	if(0 < __sync_add_and_fetch(&(pExtra->watch_waiters), 0)){
+		k2h_watch_futex_wake(&(pExtra->watch_wakeup_seq));
+	}
+	return true;
+}
+
+bool K2HShm::IsWatchMode(void) const
+{
+	return k2h_is_watch_active(GetExtraArea());
+}
+
+//
+// Returns the sequence number of next event, the reader starts reading
+// from this sequence.
+//
+uint64_t K2HShm::GetWatchSequence(void) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_has_watch_area(pExtra)){
+		return 0;
+	}
+	return __sync_add_and_fetch(&(pExtra->watch_head), 0);
+}
+
+//
+// Read events from sequence, and sequence is set next sequence number.
+// The events are filtered by key prefix if byPrefix is specified.
+// maxcount is the maximum count of reading slots, 0 means no limit.
+//
+// [NOTE]
+// If the reader is late over the ring capacity, is_overflow is set true
+// and sequence is set the sequence number of next event. Then the reader
+// must resync all keys because some events are lost.
+// If the event is not written yet by the writer, this method stops
+// reading at that sequence.
+//
+bool K2HShm::ReadWatchEvents(uint64_t& sequence, k2hwatchevlist_t& events, bool& is_overflow, const unsigned char* byPrefix, size_t prefixlen, size_t maxcount) const
+{
+	is_overflow = false;
+
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_watch_active(pExtra)){
+		ERR_K2HPRN("K2HASH is not watch mode.");
+		return false;
+	}
+	PK2HWATCHSLOT	pRing;
+	if(NULL == (pRing = static_cast<PK2HWATCHSLOT>(Abs(pExtra->watch_ring)))){
+		// ring area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pRing = static_cast<PK2HWATCHSLOT>(Abs(pExtra->watch_ring)))){
+			ERR_K2HPRN("Could not get event ring area.");
+			return false;
+		}
+	}
+	uint64_t	capacity	= pExtra->watch_capacity;
+	uint64_t	head		= __sync_add_and_fetch(&(pExtra->watch_head), 0);
+
+	if(head < sequence || capacity < (head - sequence)){
+		is_overflow	= true;
+		sequence	= head;
+		return true;
+	}
+	for(size_t count = 0; sequence < head && (0 == maxcount || count < maxcount); ++count){
+		PK2HWATCHSLOT	pSlot	= &pRing[sequence & (capacity - 1)];
+		uint64_t		before	= pSlot->sequence;
+		__sync_synchronize();
+
+		if(before != (sequence + 1)){
+			if(before < (sequence + 1) && (head - sequence) < capacity){
+				// writer does not finish writing event yet.
+				break;
+			}
+			is_overflow	= true;
+			sequence	= __sync_add_and_fetch(&(pExtra->watch_head), 0);
+			return true;
+		}
+		K2HWATCHEVENT	event;
+		memcpy(&event, &(pSlot->event), sizeof(K2HWATCHEVENT));
+		__sync_synchronize();
+
+		if(before != pSlot->sequence){
+			// overwritten while copying
+			is_overflow	= true;
+			sequence	= __sync_add_and_fetch(&(pExtra->watch_head), 0);
+			return true;
+		}
+		if(k2h_watch_match_prefix(event, byPrefix, prefixlen)){
+			events.push_back(event);
+		}
+		++sequence;
+	}
+	return true;
+}
+
+//
+// Sleeps until the event after sequence is posted, or timeout.
+// timeout_ms is milliseconds, negative value means no timeout.
+//
+// [NOTE]
+// The waiter count is incremented before reading the wakeup sequence,
+// and the writer increments the wakeup sequence before reading the
+// waiter count. Both are atomic operations which are full barrier, thus
+// the waiter does not miss posting.
+// This method returns true when it is woken up, timeout or interrupted.
+//
+bool K2HShm::WaitWatchEvent(uint64_t sequence, long timeout_ms) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_watch_active(pExtra)){
+		ERR_K2HPRN("K2HASH is not watch mode.");
+		return false;
+	}
+	struct timespec		timeout;
+	struct timespec*	ptimeout = NULL;
+	if(0 <= timeout_ms){
+		timeout.tv_sec	= timeout_ms / 1000;
+		timeout.tv_nsec	= (timeout_ms % 1000) * 1000 * 1000;
+		ptimeout		= &timeout;
+	}
+
+	__sync_add_and_fetch(&(pExtra->watch_waiters), 1);
+	uint32_t	wakeup_seq	= __sync_add_and_fetch(&(pExtra->watch_wakeup_seq), 0);
+	bool		result		= true;
+	if(sequence == __sync_add_and_fetch(&(pExtra->watch_head), 0)){
+		if(-1 == k2h_watch_futex_wait(&(pExtra->watch_wakeup_seq), wakeup_seq, ptimeout)){
+			if(EAGAIN != errno && ETIMEDOUT != errno && EINTR != errno){
+				ERR_K2HPRN("Failed to wait watch event by futex(errno=%d).", errno);
+				result = false;
+			}
+		}
+	}
+	__sync_sub_and_fetch(&(pExtra->watch_waiters), 1);
+
+	return result;
+}
+
+//
+// Post the event for mutation, this is called from K2HTransaction.
+// If the mutation is renaming, the new key is posted as setting key.
+//
+// [NOTE]
+// The slot is written without locking. If the writer which posts the
+// event for same slot after the ring turns around writes at same time,
+// the reader detects it by the sequence in slot.
+//
+void K2HShm::PostWatchEvent(long scomtype, const unsigned char* byKey, size_t keylength, const unsigned char* byNewKey, size_t newkeylength) const
+{
+	PK2HEXTRA	pExtra = GetExtraArea();
+	if(!k2h_is_watch_active(pExtra) || !byKey || 0 == keylength){
+		return;
+	}
+	long	type;
+	if(-1L == (type = k2h_watch_type(scomtype))){
+		return;
+	}
+	PK2HWATCHSLOT	pRing;
+	if(NULL == (pRing = static_cast<PK2HWATCHSLOT>(Abs(pExtra->watch_ring)))){
+		// ring area is made by other process after attaching, so need to update mapping.
+		K2HFILE_UPDATE_AREA(const_cast<K2HShm*>(this));
+		if(NULL == (pRing = static_cast<PK2HWATCHSLOT>(Abs(pExtra->watch_ring)))){
+			return;
+		}
+	}
+	uint64_t	capacity = pExtra->watch_capacity;
+	if(0 == capacity || pExtra->watch_ring_length < (static_cast<size_t>(capacity) * sizeof(K2HWATCHSLOT))){
+		return;
+	}
+
+	for(int cnt = 0; cnt < 2; ++cnt){
+		uint64_t		sequence	= __sync_fetch_and_add(&(pExtra->watch_head), 1);
+		PK2HWATCHSLOT	pSlot		= &pRing[sequence & (capacity - 1)];
+
+		pSlot->sequence = 0;
+		__sync_synchronize();
+
+		pSlot->event.sequence	= sequence;
+		pSlot->event.hash		= K2H_HASH_FUNC(reinterpret_cast<const void*>(byKey), keylength);
+		pSlot->event.type		= type;
+		pSlot->event.keylength	= keylength;
+		memset(pSlot->event.key, 0, K2H_WATCH_KEY_LENGTH);
+		memcpy(pSlot->event.key, byKey, min(keylength, static_cast<size_t>(K2H_WATCH_KEY_LENGTH)));
+		__sync_synchronize();
+
+		pSlot->sequence = sequence + 1;
+
+		if(K2H_WATCH_OP_RENAME != type || !byNewKey || 0 == newkeylength){
+			break;
+		}
+		// post new key
+		type		= K2H_WATCH_OP_SET;
+		byKey		= byNewKey;
+		keylength	= newkeylength;
+	}
+
+	// wake up readers
+	__sync_add_and_fetch(&(pExtra->watch_wakeup_seq), 1);
+	if(0 < __sync_add_and_fetch(&(pExtra->watch_waiters), 0)){
+		if(-1 == k2h_watch_futex_wake(&(pExtra->watch_wakeup_seq))){
+			WAN_K2HPRN("Failed to wake up watch readers by futex(errno=%d).", errno);
+		}
+	}
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noexpandtab sw=4 ts=4 fdm=marker
+ * vim<600: noexpandtab sw=4 ts=4
+ */
@@ -31,7 +31,8 @@ DECL_EXTERN_C_START
 // Symbols / Macros
 //---------------------------------------------------------
 // For k2hash structure
-#define	K2H_VERSION							2				// version string value
+#define	K2H_VERSION							3				// version string value
+#define	K2H_VERSION_V2						2				// old version string value which is supported
 #define	K2H_VERSION_FORMAT					"K2H V%d"		// must be 8byte with nil
 #define	MAX_K2HAREA_COUNT					2048			// maximum count for areas member in k2hash
 #define	MAX_KINDEX_AREA_COUNT				32				// maximum count for key_index_area member in k2hash(this means bit count)
@@ -193,6 +194,147 @@ typedef struct k2h_area{
 #define	K2H_AREA_CKINDEX		4L
 #define	K2H_AREA_PAGELIST		8L
 #define	K2H_AREA_PAGE			16L
+#define	K2H_AREA_EXTRA			32L
+
+
+//=========================================================
+// K2Hash extra area Structure
+//
+// This structure is set in the extra area which is pointed by
+// pextra member in k2hash head structure. This area is made
+// when it is needed, so old k2hash file does not have this area.
+// (Old k2hash library maps this area as other area, but it does
+// not use it.)
+//
+// [NOTICE]
+// This area is initialized by zero, so that all members must be
+// zero as default value. If adding new member, it must be added
+// at the end of this structure.
+// This structure is packed, but all 64 bit members are 8 bytes
+// aligned(the area starts at the system page boundary), because
+// some of them are updated by atomic operations. If adding new
+// member, keep this alignment by padding member, and add checking
+// it into k2hshminit.cc.
+//
+// About snapshot
+// 	snapshot_state is K2H_SNAPSHOT_ACTIVE while making snapshot.
+// 	The snapshot unit is the hash value masked by snapshot_mask
+// 	(cur_mask and collision mask bits), and the captured flag for
+// 	each unit is set in the bitmap area(snapshot_bitmap). When the
+// 	collision key index is locked for writing, the unit which is
+// 	not captured yet is written to snapshot_path before updating.
+//
+// About queue wakeup
+// 	queue_wakeup_seq is incremented after pushing to any queue in
+// 	k2hash, and the pusher wakes up the waiters by futex only when
+// 	queue_waiters is not zero. The waiter reads queue_wakeup_seq
+// 	before checking queue, and sleeps by futex while the sequence
+// 	is not changed. These members must be 4 bytes aligned for futex.
+//
+// About expiry index
+// 	expire_bucket_pos is the lowest bucket number in the expiry index
+// 	which may not be empty(0 means that no key has been listed). It is
+// 	decreased by setting key which expires in lower bucket, and it is
+// 	increased by reaper after the bucket is empty.
+//
+// About cache mode
+// 	cache_state is K2H_CACHE_ACTIVE while k2hash is used as cache.
+// 	When the total size of k2hash is over cache_limit and the free
+// 	page count is under cache_watermark, keys are evicted by CLOCK
+// 	algorithm before setting key. The reference unit is the hash
+// 	value masked by cache_mask(same as the collision key index when
+// 	cache mode is enabled), and the reference bit for each unit is
+// 	set in the bitmap area(cache_bitmap) by reading or setting key.
+// 	The clock hand(cache_hand) walks units, clears the reference bit
+// 	if it is set, otherwise evicts all keys in the unit.
+//
+// About watch
+// 	watch_state is K2H_WATCH_ACTIVE while mutations are posted into the
+// 	event ring(watch_ring) which has watch_capacity(power of 2) slots.
+// 	The writer gets the sequence number by incrementing watch_head, and
+// 	writes the event into the slot(sequence & (watch_capacity - 1)).
+// 	The ring area is made at first enabling, and it is not moved after
+// 	that. watch_wakeup_seq and watch_waiters are used for waking up the
+// 	readers by futex as same as queue wakeup, and must be 4 bytes
+// 	aligned.
+//
+// About key version
+// 	version_table is the counter array which has (version_mask + 1)
+// 	counters, and it is made when the hot key cache is enabled in any
+// 	process. After that, the counter for (hash & version_mask) is
+// 	incremented whenever the collision key index is locked for writing
+// 	by any process. version_mask is made from the minimum of cur_mask
+// 	and collision_mask, then all keys in one collision key index use
+// 	the same counter.
+//
+// About ring queue block
+// 	ring_free is the list of free ring blocks(see K2HRINGHEAD) for each
+// 	size class. The list is locked by the file lock on its member while
+// 	a block is taken from it or returned to it.
+//
+#define	K2H_EXTRA_VERSION_STR				"K2HEX V1"		// version string for extra area
+#define	K2H_EXTRA_VERSION_LENGTH			16
+#define	K2H_SNAPSHOT_PATH_LENGTH			1024
+
+#define	K2H_SNAPSHOT_NONE					0L
+#define	K2H_SNAPSHOT_ACTIVE					1L
+
+#define	K2H_CACHE_NONE						0L
+#define	K2H_CACHE_ACTIVE					1L
+
+#define	K2H_WATCH_NONE						0L
+#define	K2H_WATCH_ACTIVE					1L
+
+#define	K2H_RING_CLASS_COUNT				24				// size class count of ring block(1KB to 8GB)
+
+typedef struct k2h_extra{
+	char			version[K2H_EXTRA_VERSION_LENGTH];
+	size_t			length;									// this structure area length
+	volatile long	snapshot_state;							// K2H_SNAPSHOT_NONE / K2H_SNAPSHOT_ACTIVE
+	pid_t			snapshot_pid;							// process id which is making snapshot
+	int32_t			reserved1;								// padding for 8 bytes alignment of following members
+	k2h_hash_t		snapshot_mask;							// mask value for snapshot unit
+	unsigned char*	snapshot_bitmap;						// captured flag bitmap area(relative pointer)
+	size_t			snapshot_bitmap_length;					// bitmap area length
+	volatile long	snapshot_error_count;					// failure count for capturing while making snapshot
+	char			snapshot_path[K2H_SNAPSHOT_PATH_LENGTH];	// snapshot archive file path
+	volatile uint32_t	queue_wakeup_seq;					// sequence number which is incremented by pushing queue
+	volatile uint32_t	queue_waiters;						// waiter count for queue wakeup
+	volatile int64_t	expire_bucket_pos;					// lowest bucket number which may not be empty in expiry index
+	volatile long		cache_state;						// K2H_CACHE_NONE / K2H_CACHE_ACTIVE
+	size_t				cache_limit;						// total size of k2hash which starts evicting
+	long				cache_watermark;					// free page count which starts evicting
+	k2h_hash_t			cache_mask;							// mask value for reference unit
+	unsigned char*		cache_bitmap;						// reference bitmap area(relative pointer)
+	size_t				cache_bitmap_length;				// bitmap area length
+	volatile uint64_t	cache_hand;							// next unit for clock hand
+	volatile uint64_t	cache_hits;							// count of found keys by reading
+	volatile uint64_t	cache_misses;						// count of not found(expired) keys by reading
+	volatile uint64_t	cache_evictions;					// count of evicted keys
+	volatile long		watch_state;						// K2H_WATCH_NONE / K2H_WATCH_ACTIVE
+	void*				watch_ring;							// event ring area(relative pointer)
+	size_t				watch_ring_length;					// event ring area length
+	uint64_t			watch_capacity;						// slot count in event ring(power of 2)
+	volatile uint64_t	watch_head;							// next sequence number for posting event
+	volatile uint32_t	watch_wakeup_seq;					// sequence number which is incremented by posting event
+	volatile uint32_t	watch_waiters;						// waiter count for watch wakeup
+	void*				version_table;						// key version counter table area(relative pointer)
+	k2h_hash_t			version_mask;						// mask value for key version counter
+	void*				ring_free[K2H_RING_CLASS_COUNT];	// free ring block list for each size class(relative pointer)
+}K2HASH_ATTR_PACKED K2HEXTRA, *PK2HEXTRA;
+
+//---------------------------------------------------------
+// Watch event slot in event ring
+//
+// [NOTE]
+// sequence is the event sequence number + 1 after the event is written,
+// and it is zero while writing. The reader compares it before and after
+// copying the event, then it detects the slot which is overwritten.
+//
+typedef struct k2h_watch_slot{
+	volatile uint64_t	sequence;
+	K2HWATCHEVENT		event;
+}K2HASH_ATTR_PACKED K2HWATCHSLOT, *PK2HWATCHSLOT;
 
 
 //=========================================================
@@ -256,6 +398,190 @@ typedef union binary_k2h_marker{
 	K2HMARKER		marker;
 }K2HASH_ATTR_PACKED BK2HMARKER, *PBK2HMARKER;
 
+// Extended area for marker
+//
+// [NOTE]
+// The extended marker has this structure just after K2HMARKER, and then
+// the start key offset is sizeof(K2HMARKER) + sizeof(K2HMARKEREXT). The
+// old type marker does not have this area, it is distinguished by start
+// key offset.
+// Old libraries can not read the extended marker(it is read as empty or
+// broken marker), then the extended marker is made only in the k2hash
+// which format version is K2H_VERSION(3). Old libraries do not attach it
+// because they check the format version. In the k2hash which format version
+// is K2H_VERSION_V2(made by old library), the marker is always made as old
+// type, and then old libraries can use the queue in it at the same time.
+// This version can read both type markers, but the count of queue and the
+// queue index are available only with the extended marker. The k2hash of
+// old format version can be converted by putting archive and loading it
+// into new k2hash.
+//
+// count	- the count is not the count of keys in queue, it is accumulated
+//			  value which is incremented by pushing and decremented by popping.
+//			  Then it can be negative temporarily when racing.
+// headseq	- the sequence number of the start key in queue. Each queued key
+//			  has sequence number which is not changed while it is in queue,
+//			  then the position of key is (sequence number - headseq).
+//			  headseq is incremented by popping and decremented by pushing
+//			  to the start of queue(LIFO).
+// generation-
+//			  this is incremented when the keys in queue are removed or are
+//			  replaced without popping from the start of queue. The queue
+//			  index(K2HQINDEX) is available only when it has same generation.
+//
+#define	K2HMARKER_FLAG_COUNT_UNKNOWN	1UL
+
+typedef struct k2h_marker_ext{
+	int64_t			count;					// accumulated count of queue
+	uint64_t		flags;					// K2HMARKER_FLAG_XXX
+	int64_t			headseq;				// sequence number of the start key
+	uint64_t		generation;				// generation of sequence numbers
+}K2HASH_ATTR_PACKED K2HMARKEREXT, *PK2HMARKEREXT;
+
+// Queue index
+//
+// The queue index is stored in the index key which name is marker name and
+// K2HQINDEX_SUFFIX. It has some sequence numbers and key names in queue at
+// each interval, then reading the key at any position in queue traces keys
+// from the nearest key in the index instead of the start of queue.
+// The index value is K2HQINDEX, K2HQINDEXENT array(count) and key names.
+// The entries are sorted by sequence number.
+// This index is made and extended by reading queue, and it is not updated
+// by pushing and popping.
+//
+#define	K2HQINDEX_VERSION				1UL
+#define	K2HQINDEX_SUFFIX				"/K2HQINDEX"
+#define	K2HQINDEX_INTERVAL				64L
+
+typedef struct k2h_queue_index_entry{
+	int64_t			seq;					// sequence number of key
+	off_t			keyoff;					// key name offset from K2HQINDEX top
+	size_t			keylen;					// key name length
+}K2HASH_ATTR_PACKED K2HQINDEXENT, *PK2HQINDEXENT;
+
+typedef struct k2h_queue_index{
+	uint64_t		version;				// K2HQINDEX_VERSION
+	uint64_t		generation;				// generation in marker when this index is made
+	size_t			count;					// entry count
+}K2HASH_ATTR_PACKED K2HQINDEX, *PK2HQINDEX;
+
+//---------------------------------------------------------
+// Structure for Ring Queue
+//---------------------------------------------------------
+// The ring queue is stored in one contiguous ring block in the extra
+// area(K2H_AREA_EXTRA), and the ring marker key value is K2HRINGMARKER
+// which has the relative pointer to the ring block. The ring block is
+// K2HRINGHEAD and following ring data area which size is capacity.
+// Each record in ring data area is K2HRINGRECORD, data and the trailer
+// which is same value as length in K2HRINGRECORD(size_t). The trailer is
+// used for reading the records from tail(LIFO).
+// Records can wrap around the end of ring data area.
+//
+// head		- offset of top record in ring data area
+// tail		- offset of next pushing record in ring data area
+// used		- used bytes in ring data area(head == tail when used is 0)
+//
+// These members are updated while the ring marker key is locked, and
+// they are stored by atomic operation after the records are written.
+//
+// The size of ring block is (K2HRING_MIN_BLOCK_SIZE << class), and the
+// ring blocks which size is smaller than K2HRING_CHUNK_SIZE are made by
+// dividing one area of K2HRING_CHUNK_SIZE. Then many small ring queues
+// (ex. buckets of expiry index) do not use up the areas in k2hash.
+// When the ring queue is expanded or removed, the old block is returned
+// to the free list(ring_free in K2HEXTRA) for its class, and it is
+// reused by other ring queue. The block is never returned to system as
+// same as other areas.
+//
+// [NOTICE]
+// The ring block is not included in archive, and the ring marker key
+// in archive does not point the ring block in other k2hash. Then such
+// ring marker is checked by self pointer and marker hash in the block,
+// and it is treated as empty ring queue.
+//
+#define	K2HRINGMARKER_VERSION			2UL
+#define	K2HRINGHEAD_VERSION				1UL
+#define	K2HRING_MIN_BLOCK_SIZE			1024UL
+#define	K2HRING_CHUNK_SIZE				(1024UL * 1024UL)
+
+#define	K2HRING_BLOCK_FREE				0UL
+#define	K2HRING_BLOCK_USED				1UL
+
+typedef struct k2h_ring_marker{
+	uint64_t			version;			// K2HRINGMARKER_VERSION
+	void*				ring;				// ring block(relative pointer)
+}K2HASH_ATTR_PACKED K2HRINGMARKER, *PK2HRINGMARKER;
+
+typedef struct k2h_ring_head{
+	uint64_t			version;			// K2HRINGHEAD_VERSION
+	void*				self;				// this block(relative pointer)
+	size_t				length;				// block length including this structure
+	uint64_t			state;				// K2HRING_BLOCK_FREE / K2HRING_BLOCK_USED
+	k2h_hash_t			markhash;			// hash value of ring marker key which uses this block
+	void*				next;				// next free block(relative pointer)
+	size_t				capacity;			// ring data area size
+	volatile int64_t	head;				// top record offset from ring data area top
+	volatile int64_t	tail;				// next record offset from ring data area top
+	volatile uint64_t	used;				// used bytes in ring data area
+	volatile int64_t	count;				// record count in ring
+}K2HASH_ATTR_PACKED K2HRINGHEAD, *PK2HRINGHEAD;
+
+typedef struct k2h_ring_record{
+	size_t			length;					// data length
+	time_t			expire;					// expire time(0 means no expire)
+}K2HASH_ATTR_PACKED K2HRINGRECORD, *PK2HRINGRECORD;
+
+//---------------------------------------------------------
+// Structure for Subkeys directory
+//---------------------------------------------------------
+// When the subkey count of a key is over K2HSKDIR_THRESHOLD, the subkeys
+// are divided into some chunks. Each chunk is stored as the value of the
+// chunk key which name starts with K2HSKDIR_CHUNK_PREFIX, and the value
+// is same format as subkeys list. The subkeys area of the key has the
+// subkeys directory instead of subkeys list.
+// The directory is K2HSKDIR, K2HSKDIRENT array(count), the first subkeys
+// and the chunk key names. The entries are sorted by the first subkey,
+// and the first subkey of the first entry is empty because it means the
+// lower bound of all subkeys.
+// The magic in K2HSKDIR is at the same position of subkey count in the
+// subkeys list, and the subkey count never be this value.
+// The chunk is split into two chunks when its subkey count is over
+// K2HSKDIR_CHUNK_MAX, and the chunk is removed when it is empty.
+//
+#define	K2HSKDIR_MAGIC					(~((size_t)0))
+#define	K2HSKDIR_VERSION				1UL
+#define	K2HSKDIR_CHUNK_PREFIX			"/K2HSKCHUNK/"
+#define	K2HSKDIR_THRESHOLD				1024UL
+#define	K2HSKDIR_CHUNK_MAX				1024UL
+
+typedef struct k2h_subkeys_dir_entry{
+	off_t			firstoff;				// first subkey offset from K2HSKDIR top
+	size_t			firstlen;				// first subkey length
+	off_t			chunkoff;				// chunk key name offset from K2HSKDIR top
+	size_t			chunklen;				// chunk key name length
+}K2HASH_ATTR_PACKED K2HSKDIRENT, *PK2HSKDIRENT;
+
+typedef struct k2h_subkeys_dir{
+	size_t			magic;					// K2HSKDIR_MAGIC
+	uint64_t		version;				// K2HSKDIR_VERSION
+	size_t			count;					// entry(chunk) count
+}K2HASH_ATTR_PACKED K2HSKDIR, *PK2HSKDIR;
+
+//---------------------------------------------------------
+// Expiry index
+//---------------------------------------------------------
+// The keys which have expire attribute are listed in the expiry index.
+// The index is bucketed lists keyed by expire time(seconds) divided by
+// K2HEXPIRE_BUCKET_UNIT. Each bucket is a ring queue which marker name
+// is K2HEXPIRE_PREFIX and bucket number(hex), and its records are the
+// key names which expire in the bucket.
+// The bucket is removed when the reaper has checked all keys in it.
+// The bucket markers are internal keys, then K2HShm::iterator skips them.
+//
+#define	K2HEXPIRE_PREFIX				"/K2HEXPIRE/"
+#define	K2HEXPIRE_BUCKET_UNIT			10L
+#define	K2HEXPIRE_MARKER_LENGTH			(sizeof(K2HEXPIRE_PREFIX) + 16)		// prefix + 16 hex digits + '\0'
+
 // extern "C" - end
 DECL_EXTERN_C_END
 
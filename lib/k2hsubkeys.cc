@@ -31,21 +31,21 @@ using namespace std;
 //---------------------------------------------------------
 // K2HSubKeys Methods
 //---------------------------------------------------------
-K2HSubKeys::K2HSubKeys()
+K2HSubKeys::K2HSubKeys() : pArena(NULL), ArenaLength(0UL)
 {
 }
 
-K2HSubKeys::K2HSubKeys(const K2HSubKeys& other)
+K2HSubKeys::K2HSubKeys(const K2HSubKeys& other) : pArena(NULL), ArenaLength(0UL)
 {
 	(*this) = other;
 }
 
-K2HSubKeys::K2HSubKeys(const char* pSubkeys)
+K2HSubKeys::K2HSubKeys(const char* pSubkeys) : pArena(NULL), ArenaLength(0UL)
 {
 	Serialize(reinterpret_cast<const unsigned char*>(pSubkeys), pSubkeys ? strlen(pSubkeys) + 1 : 0UL);
 }
 
-K2HSubKeys::K2HSubKeys(const unsigned char* pSubkeys, size_t length)
+K2HSubKeys::K2HSubKeys(const unsigned char* pSubkeys, size_t length) : pArena(NULL), ArenaLength(0UL)
 {
 	Serialize(pSubkeys, length);
 }
@@ -55,6 +55,17 @@ K2HSubKeys::~K2HSubKeys()
 	clear();
 }
 
+//
+// The subkey which points into arena is not freed, the arena is freed
+// at clear().
+//
+void K2HSubKeys::FreeSubKey(unsigned char* pSubKey) const
+{
+	if(pSubKey && !IsArenaData(pSubKey)){
+		free(pSubKey);
+	}
+}
+
 bool K2HSubKeys::Serialize(unsigned char** ppSubkeys, size_t& length) const
 {
 	if(!ppSubkeys){
@@ -118,16 +129,51 @@ bool K2HSubKeys::Serialize(const unsigned char* pSubkeys, size_t length)
 		return true;
 	}
 
+	unsigned char*	byArena;
+	if(NULL == (byArena = static_cast<unsigned char*>(malloc(length)))){
+		ERR_K2HPRN("Could not allocate memory.");
+		return false;
+	}
+	memcpy(byArena, pSubkeys, length);
+
+	return Adopt(byArena, length);
+}
+
+//
+// Loads subkeys from binary and takes the ownership of it.
+// pSubkeys must be allocated by malloc, it is freed at clear() or
+// destructor(also freed when this method fails).
+//
+// [NOTE]
+// The binary is already sorted usually, then each subkey points into
+// the binary without allocation and copying. Only if the subkey is not
+// sorted(or duplicated), it is copied by insert().
+//
+bool K2HSubKeys::Adopt(unsigned char* pSubkeys, size_t length)
+{
+	clear();
+
+	if(!pSubkeys || 0UL == length){
+		K2H_Free(pSubkeys);
+		return true;
+	}
+	pArena		= pSubkeys;
+	ArenaLength	= length;
+
 	// get subkey count
 	size_t	TotalCount = 0UL;
-	{
+	if(length < sizeof(size_t)){
+		ERR_K2HPRN("Not enough length for loading.");
+		return false;
+	}else{
 		const size_t*	pCountPos = reinterpret_cast<const size_t*>(pSubkeys);
 		TotalCount = *pCountPos;
 	}
+	SubKeys.reserve(std::min(TotalCount, (length - sizeof(size_t)) / sizeof(size_t)));
 
 	// load
-	size_t					rest_length	= length;
-	const unsigned char*	byReadPos	= reinterpret_cast<const unsigned char*>(reinterpret_cast<size_t>(pSubkeys) + sizeof(size_t));
+	size_t			rest_length	= length - sizeof(size_t);
+	unsigned char*	byReadPos	= pSubkeys + sizeof(size_t);
 
 	for(size_t cnt = 0; cnt < TotalCount; cnt++){
 		const size_t*		pLengthPos;
@@ -147,7 +193,15 @@ bool K2HSubKeys::Serialize(const unsigned char* pSubkeys, size_t length)
 		}
 
 		// set into array
-		insert(byReadPos, *pLengthPos);
+		if(0UL < *pLengthPos && (SubKeys.empty() || 0 > SubKeys.back().compare(byReadPos, *pLengthPos))){
+			// keep sorted, then only push back
+			SUBKEY	subkey;
+			subkey.pSubKey	= byReadPos;
+			subkey.length	= *pLengthPos;
+			SubKeys.push_back(subkey);
+		}else{
+			insert(byReadPos, *pLengthPos);
+		}
 
 		byReadPos		+= *pLengthPos;
 		rest_length		-= *pLengthPos;
@@ -171,9 +225,11 @@ void K2HSubKeys::clear(void)
 {
 	// cppcheck-suppress postfixOperator
 	for(skeyarr_t::iterator iter = SubKeys.begin(); iter != SubKeys.end(); iter++){
-		K2H_Free(iter->pSubKey);
+		FreeSubKey(iter->pSubKey);
 	}
 	SubKeys.clear();
+	K2H_Free(pArena);
+	ArenaLength = 0UL;
 }
 
 bool K2HSubKeys::empty(void) const
@@ -284,7 +340,7 @@ K2HSubKeys::iterator K2HSubKeys::erase(K2HSubKeys::iterator iter)
 		return iter;
 	}
 
-	K2H_Free(iter.iter_pos->pSubKey);
+	FreeSubKey(iter.iter_pos->pSubKey);
 	iter.iter_pos = SubKeys.erase(iter.iter_pos);
 	return iter;
 }
@@ -335,7 +391,7 @@ K2HSubKeys::iterator K2HSubKeys::insert(const unsigned char* bySubkey, size_t le
 			// same value(remove old value).
 			unsigned char*	pSubKey = insert_iter->pSubKey;
 			insert_iter = SubKeys.erase(insert_iter);
-			K2H_Free(pSubKey);
+			FreeSubKey(pSubKey);
 			break;
 
 		}else if(nResult < 0){
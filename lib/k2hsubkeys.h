@@ -83,7 +83,12 @@ class K2HSubKeys
 		friend class K2HSKIterator;
 
 	protected:
-		skeyarr_t	SubKeys;
+		skeyarr_t		SubKeys;
+		unsigned char*	pArena;				// loaded binary, subkeys which are loaded point into this area.
+		size_t			ArenaLength;
+
+		bool IsArenaData(const unsigned char* pData) const { return (pArena && pArena <= pData && pData < (pArena + ArenaLength)); }
+		void FreeSubKey(unsigned char* pSubKey) const;
 
 	public:
 		typedef K2HSKIterator	iterator;
@@ -96,6 +101,7 @@ class K2HSubKeys
 
 		bool Serialize(unsigned char** ppSubkeys, size_t& length) const;
 		bool Serialize(const unsigned char* pSubkeys, size_t length);
+		bool Adopt(unsigned char* pSubkeys, size_t length);
 		strarr_t::size_type StringArray(strarr_t& strarr) const;
 
 		K2HSubKeys& operator=(const K2HSubKeys& other);
@@ -51,8 +51,9 @@ bool K2HTransaction::Put(long type, const unsigned char* byKey, size_t keylength
 		ERR_K2HPRN("Parameter is wrong.");
 		return false;
 	}
-	if(!IsEnable()){
-		// do not need transaction.
+	if(!K2HTransManager::Get()->isEnableWithoutLock(pShm)){
+		// do not need transaction, but post event for watch mode.
+		pShm->PostWatchEvent(type, byKey, keylength, byExdata, exdatalength);
 		return true;
 	}
 
@@ -69,6 +70,9 @@ bool K2HTransaction::Put(long type, const unsigned char* byKey, size_t keylength
 		return true;
 	}
 
+	// post event for watch mode
+	pShm->PostWatchEvent(type, byKey, keylength, byExdata, exdatalength);
+
 	if(!K2HCommandArchive::Put(type, byKey, keylength, byVal, vallength, bySKey, skeylength, byAttrs, attrlength, byExdata, exdatalength)){
 		return false;
 	}
@@ -93,20 +97,25 @@ bool K2HTransaction::Put(void)
 		// do not need transaction.
 		return true;
 	}
-	if(!IsEnable()){
+	if(!K2HTransManager::Get()->isEnableWithoutLock(pShm)){
 		// do not need transaction.
 		return true;
 	}
 	return K2HTransManager::Get()->Put(pShm, pBinCom);
 }
 
+//
+// [NOTE]
+// This returns true in watch mode too, because callers prepare the data
+// for putting only when this returns true.
+//
 bool K2HTransaction::IsEnable(void) const
 {
 	if(!pShm){
 		ERR_K2HPRN("Parameter is wrong.");
 		return false;
 	}
-	return K2HTransManager::Get()->isEnableWithoutLock(pShm);	// without locking
+	return (K2HTransManager::Get()->isEnableWithoutLock(pShm) || pShm->IsWatchMode());	// without locking
 }
 
 //---------------------------------------------------------
@@ -83,6 +83,8 @@ static inline char* programname(char* prgpath)
 // FILE                 compress k2hash file
 // -replace             make and replace temporary file for compress
 // -direct              compress directly with mmap
+// -online              compress directly by small steps while other processes read/write
+// -step <count>        entry count for one step in online mode
 // -print               print only area information
 // -mask <bit count>    bit mask count for hash
 // -cmask <bit count>   collision bit mask count
@@ -96,11 +98,14 @@ typedef std::map<std::string, std::string> params_t;
 static void Help(char* progname)
 {
 	PRN("");
-	PRN("Usage: %s [-replace | -direct | -print] [options] FILE", progname ? programname(progname) : "program");
+	PRN("Usage: %s [-replace | -direct | -online | -print] [options] FILE", progname ? programname(progname) : "program");
 	PRN("");
 	PRN("Option -h                   help display");
 	PRN("       -replace             make and replace temporary file for compress");
 	PRN("       -direct              compress directly with mmap");
+	PRN("       -online              compress directly by small steps while other");
+	PRN("                            processes read/write k2hash");
+	PRN("       -step <count>        entry count for one step in online mode(default 64)");
 	PRN("       -print               print only area information");
 	PRN("       -mask <bit count>    bit mask count for hash(*1)");
 	PRN("       -cmask <bit count>   collision bit mask count(*1)");
@@ -138,6 +143,10 @@ static bool ParameterParser(int argc, char** argv, params_t& params)
 			params["-g"] = argv[++nCnt];
 		}else if(0 == strcasecmp(argv[nCnt], "-direct")){
 			params["-direct"] = "";
+		}else if(0 == strcasecmp(argv[nCnt], "-online")){
+			params["-online"] = "";
+		}else if(0 == strcasecmp(argv[nCnt], "-step")){
+			params["-step"] = argv[++nCnt];
 		}else if(0 == strcasecmp(argv[nCnt], "-replace")){
 			params["-replace"] = "";
 		}else if(0 == strcasecmp(argv[nCnt], "-print")){
@@ -211,6 +220,8 @@ int main(int argc, char** argv)
 	string		strFile;
 	bool		isDirect		= false;
 	bool		isPrint			= false;
+	bool		isOnline		= false;
+	long		StepCount		= K2HShm::DEFAULT_COMPACTOR_STEP_COUNT;
 	int			MaskBitCnt		= 0;
 	int			CMaskBitCnt		= 0;
 	int			MaxElementCnt	= 0;
@@ -223,7 +234,14 @@ int main(int argc, char** argv)
 		exit(-1);
 	}
 
-	if(params.end() != params.find("-direct")){
+	if(params.end() != params.find("-online")){
+		if(params.end() != params.find("-direct") || params.end() != params.find("-replace") || params.end() != params.find("-print")){
+			ERR("parameter \"-online\" could not set with \"-direct\", \"-replace\" and \"-print\".");
+			exit(-1);
+		}
+		isDirect = true;
+		isOnline = true;
+	}else if(params.end() != params.find("-direct")){
 		if(params.end() != params.find("-replace") || params.end() != params.find("-print")){
 			ERR("parameter \"-direct\" could not set with \"-replace\" and \"-print\".");
 			exit(-1);
@@ -238,9 +256,20 @@ int main(int argc, char** argv)
 	}else if(params.end() != params.find("-print")){
 		isPrint = true;
 	}else{
-		ERR("must specify \"-replace\" or \"-direct\" or \"-print\" option.");
+		ERR("must specify \"-replace\" or \"-direct\" or \"-online\" or \"-print\" option.");
 		exit(-1);
 	}
+	if(params.end() != params.find("-step")){
+		if(!isOnline){
+			ERR("parameter \"-step\" must be set with \"-online\".");
+			exit(-1);
+		}
+		StepCount = atol(params["-step"].c_str());
+		if(StepCount <= 0){
+			ERR("Option \"-step\" parameter(%ld) is wrong.", StepCount);
+			exit(-1);
+		}
+	}
 
 	if(params.end() != params.find("-mask")){
 		if(isDirect || isPrint){
@@ -300,6 +329,37 @@ int main(int argc, char** argv)
 			ERR("Failed to detach k2hash.");
 		}
 
+	}else if(isOnline){
+		// attach k2hash ( update monitor file automatically )
+		if(!k2hash.Attach(strFile.c_str(), false, false, false, false)){
+			ERR("Could not attach replaced file %s", strFile.c_str());
+			exit(-1);
+		}
+
+		// loop until there is no area which can be compressed
+		K2HCOMPACTCURSOR	cursor;
+		long				compressed_count= 0L;
+		bool				isFinished		= false;
+		while(!isFinished){
+			bool	isCompressed = false;
+			if(!k2hash.AreaCompressStep(cursor, StepCount, isCompressed, isFinished)){
+				ERR("Failed to compress %s file online.", strFile.c_str());
+				k2hash.AreaCompressCancel(cursor);
+				k2hash.Detach();
+				exit(-1);
+			}
+			if(isCompressed){
+				compressed_count++;
+			}
+		}
+
+		// detach k2hash
+		if(!k2hash.Detach()){
+			ERR("Failed to detach k2hash.");
+		}
+		PRN("Compress %s file %s(removed %ld area).", strFile.c_str(), (0L < compressed_count) ? "succeed" : "finished but no compress", compressed_count);
+		PRN("");
+
 	}else if(isDirect){
 		PRN("");
 		PRN("[NOTICE] \"-direct\" is unsupported mode,");
@@ -21,9 +21,14 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <string>
 #include <stdlib.h>
+#include <pthread.h>
 #include <k2hash.h>
 #include <k2hshm.h>
+#include <k2hbuilder.h>
+#include <k2hashfunc.h>
 using namespace std ;
 
 #define MAX 10
@@ -31,13 +36,25 @@ using namespace std ;
 #define MODE_TSV	0
 #define MODE_MDBM	1
 
+#define IMPORT_CHUNK_COUNT	100000		// record count for one loading by threads
+
+typedef pair<string, string>	kvpair_t ;
+typedef vector<kvpair_t>		kvlist_t ;
+
+typedef struct import_thread_param{
+	K2HShm*			k2hash ;
+	const kvlist_t*	plist ;
+	bool			is_raw ;
+}IMPTHPARAM ;
+
 // -----------------------------------------
 // Processing for command line
 // -----------------------------------------
 void usage()
 {
     cout << "\nusage: \n" << endl ;
-    cout << "k2himport inputfile outputfile [-mdbm]" << endl ;
+    cout << "k2himport inputfile outputfile [-mdbm] [-thread count] [-raw]" << endl ;
+    cout << "k2himport inputfile outputfile [-mdbm] -build" << endl ;
     cout << "k2himport -h\n" << endl ;
 	exit(EXIT_FAILURE) ;
 }
@@ -56,6 +73,18 @@ bool isExistOption(int argc, const char **argv, const string& target)
 	return answer ;
 }
 
+int getOptionValue(int argc, const char **argv, const string& target, int defvalue)
+{
+	for (int i = 1 ; i < (argc - 1); i++)
+	{
+		string tmp = argv[i] ;
+		if (tmp == target) {
+			return atoi(argv[i + 1]) ;
+		}
+	}
+	return defvalue ;
+}
+
 #define MINPARAMATERS	3
 int CheckParamater(int argc, const char **argv)
 {
@@ -68,36 +97,24 @@ int CheckParamater(int argc, const char **argv)
 }
 
 // -----------------------------------------
-// Converting TSV mode
+// Reading TSV mode
 // -----------------------------------------
 //
-int ConvertfromTsv(ifstream *ifs, K2HShm *k2hash)
+bool ReadfromTsv(ifstream *ifs, string& readkey, string& readvalue)
 {
-	int readlines = 0 ;
-	string readkey ;
-	string readvalue ;
-
-	// processing by each line
-	while (getline(*ifs, readkey, '\t')) {	// read till tab
-		if (ifs->eof()) break ;
-		getline(*ifs, readvalue) ;			// read from tab to eol
-		k2hash->Set(readkey.c_str(), readvalue.c_str()) ;
-		readlines++ ;
-	}
-
-	return readlines ;
+	if (!getline(*ifs, readkey, '\t')) return false ;	// read till tab
+	if (ifs->eof()) return false ;
+	getline(*ifs, readvalue) ;							// read from tab to eol
+	return true ;
 }
 
 // -----------------------------------------
-// Converting mdbm_export mode
+// Reading mdbm_export mode
 // -----------------------------------------
 //
-int ConvertfromMdbm(ifstream *ifs, K2HShm *k2hash)
+void SkipMdbmHeader(ifstream *ifs)
 {
-	int readlines = 0 ;
 	string mdbmheader[5] ;
-	string readkey ;
-	string readvalue ;
 
 	// skip head of file, so mdbm_exports puts five line for head.
 	for (int i = 0 ; i < 5; i ++) getline(*ifs, mdbmheader[i]) ;
@@ -105,27 +122,165 @@ int ConvertfromMdbm(ifstream *ifs, K2HShm *k2hash)
 		cout << "error: not a mdbm file." << endl ;
 		exit(EXIT_FAILURE) ;
 	}
+}
+
+bool ReadfromMdbm(ifstream *ifs, string& readkey, string& readvalue)
+{
+	// key and value by each line after skip head
+	if (!getline(*ifs, readkey)) return false ;
+	getline(*ifs, readvalue) ;
+	return true ;
+}
+
+bool ReadPair(int convertmode, ifstream *ifs, string& readkey, string& readvalue)
+{
+	if (MODE_MDBM == convertmode) return ReadfromMdbm(ifs, readkey, readvalue) ;
+	return ReadfromTsv(ifs, readkey, readvalue) ;
+}
+
+// -----------------------------------------
+// Importing
+// -----------------------------------------
+//
+bool SetPair(K2HShm *k2hash, const kvpair_t& kvpair, bool is_raw)
+{
+	if (!is_raw) return k2hash->Set(kvpair.first.c_str(), kvpair.second.c_str()) ;
+
+	// without attributes and transaction
+	return k2hash->BulkSet(reinterpret_cast<const unsigned char*>(kvpair.first.c_str()), kvpair.first.length() + 1, reinterpret_cast<const unsigned char*>(kvpair.second.c_str()), kvpair.second.length() + 1, NULL, 0UL, NULL, 0UL) ;
+}
+
+void* ImportThread(void* param)
+{
+	IMPTHPARAM* pthparam = reinterpret_cast<IMPTHPARAM*>(param) ;
+	for (kvlist_t::const_iterator iter = pthparam->plist->begin(); iter != pthparam->plist->end(); ++iter) {
+		SetPair(pthparam->k2hash, *iter, pthparam->is_raw) ;
+	}
+	pthread_exit(NULL) ;
+	return NULL ;
+}
+
+// Import one chunk, each thread sets keys which are in same hash range.
+void ImportChunk(K2HShm *k2hash, const kvlist_t& chunk, int threadcnt, bool is_raw)
+{
+	if (threadcnt <= 1) {
+		for (kvlist_t::const_iterator iter = chunk.begin(); iter != chunk.end(); ++iter) {
+			SetPair(k2hash, *iter, is_raw) ;
+		}
+		return ;
+	}
+
+	vector<kvlist_t> partitions(threadcnt) ;
+	for (kvlist_t::const_iterator iter = chunk.begin(); iter != chunk.end(); ++iter) {
+		k2h_hash_t hash = K2H_HASH_FUNC(reinterpret_cast<const void*>(iter->first.c_str()), iter->first.length() + 1) ;
+		partitions[k2hash->GetBulkPartition(hash, threadcnt)].push_back(*iter) ;
+	}
+
+	vector<IMPTHPARAM> thparams(threadcnt) ;
+	vector<pthread_t>  threads(threadcnt) ;
+	vector<bool>       isrun(threadcnt, false) ;
+	for (int i = 0 ; i < threadcnt; i++) {
+		thparams[i].k2hash = k2hash ;
+		thparams[i].plist  = &partitions[i] ;
+		thparams[i].is_raw = is_raw ;
+		if (partitions[i].empty()) continue ;
+		if (0 != pthread_create(&threads[i], NULL, ImportThread, &thparams[i])) {
+			cout << "warning: could not create thread, so import on main thread." << endl ;
+			ImportThread(&thparams[i]) ;
+			continue ;
+		}
+		isrun[i] = true ;
+	}
+	for (int i = 0 ; i < threadcnt; i++) {
+		if (isrun[i]) pthread_join(threads[i], NULL) ;
+	}
+}
+
+// Count records and pages, and expand k2hash areas at once.
+void PrepareImport(int convertmode, ifstream *ifs, K2HShm *k2hash)
+{
+	unsigned long records = 0UL ;
+	unsigned long pages   = 0UL ;
+	string readkey ;
+	string readvalue ;
+
+	if (MODE_MDBM == convertmode) SkipMdbmHeader(ifs) ;
+	while (ReadPair(convertmode, ifs, readkey, readvalue)) {
+		records++ ;
+		pages += k2hash->GetPageCount(readkey.length() + 1) + k2hash->GetPageCount(readvalue.length() + 1) ;
+	}
+	if (!k2hash->PrepareBulkLoad(records, pages)) {
+		cout << "warning: could not expand k2hash areas before importing." << endl ;
+	}
+
+	// rewind
+	ifs->clear() ;
+	ifs->seekg(0, ios::beg) ;
+}
 
-	// loop for key and value by each line after skip head
-	while (getline(*ifs, readkey)) {
-		getline(*ifs, readvalue) ;
-		k2hash->Set(readkey.c_str(), readvalue.c_str()) ;
+int Import(int convertmode, ifstream *ifs, K2HShm *k2hash, int threadcnt, bool is_raw)
+{
+	int readlines = 0 ;
+	kvpair_t kvpair ;
+	kvlist_t chunk ;
+
+	if (MODE_MDBM == convertmode) SkipMdbmHeader(ifs) ;
+
+	// processing by each chunk
+	while (ReadPair(convertmode, ifs, kvpair.first, kvpair.second)) {
+		chunk.push_back(kvpair) ;
 		readlines++ ;
+		if (IMPORT_CHUNK_COUNT <= chunk.size()) {
+			ImportChunk(k2hash, chunk, threadcnt, is_raw) ;
+			chunk.clear() ;
+		}
 	}
+	if (!chunk.empty()) ImportChunk(k2hash, chunk, threadcnt, is_raw) ;
 
 	return readlines ;
 }
 
+// Build new k2hash file offline, the file can be replaced by k2hreplace.
+int Build(int convertmode, ifstream *ifs, const string& outfile)
+{
+	int readlines = 0 ;
+	string readkey ;
+	string readvalue ;
+	K2HBuilder builder(K2HShm::MIN_MASK_BITCOUNT, 8, 512, 128) ;
+
+	if (MODE_MDBM == convertmode) SkipMdbmHeader(ifs) ;
+	while (ReadPair(convertmode, ifs, readkey, readvalue)) {
+		if (!builder.Add(readkey.c_str(), readvalue.c_str())) {
+			cout << "error: can't add key(" << readkey << ") for building k2file" << endl ;
+			exit(EXIT_FAILURE);
+		}
+		readlines++ ;
+	}
+	if (!builder.Build(outfile.c_str())) {
+		cout << "error: can't build k2file(the file must not exist)" << endl ;
+		exit(EXIT_FAILURE);
+	}
+	return readlines ;
+}
+
 // -----------------------------------------
 // Main
 // -----------------------------------------
 int main(int argc, const char **argv)
 {
 	int convertmode = CheckParamater(argc, argv) ;
+	int threadcnt = getOptionValue(argc, argv, string("-thread"), 1) ;
+	bool is_raw = isExistOption(argc, argv, string("-raw")) ;
+	bool is_build = isExistOption(argc, argv, string("-build")) ;
 	string modename ;
 	string inpfile = argv[1] ;
 	string outfile = argv[2] ;
 
+	if (threadcnt < 1) {
+		cout << "error: -thread option value must be over 0." << endl ;
+		exit(EXIT_FAILURE);
+	}
+
 	// import base file
 	ifstream ifs(inpfile.c_str()) ;
 	if (ifs.fail()) {
@@ -133,6 +288,14 @@ int main(int argc, const char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	// building new k2hash file offline
+	if (is_build) {
+		int readlines = Build(convertmode, &ifs, outfile) ;
+		ifs.close() ;
+		cout << readlines << " items build success" << (MODE_MDBM == convertmode ? "(mdbm)" : "(tsv)") << endl ;
+		return EXIT_SUCCESS ;
+	}
+
 	// attach k2hash file
 	K2HShm    k2hash;
 	if(!k2hash.Attach(outfile.c_str(), false, true, false, true, 10, 8, 512, 128)){
@@ -140,16 +303,19 @@ int main(int argc, const char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	// expanding areas before bulk importing
+	if (1 < threadcnt || is_raw) {
+		PrepareImport(convertmode, &ifs, &k2hash) ;
+	}
+
 	// converting
-	int readlines = 0 ;
+	int readlines = Import(convertmode, &ifs, &k2hash, threadcnt, is_raw) ;
 	switch(convertmode)
 	{
 		case MODE_TSV:
-			readlines = ConvertfromTsv(&ifs, &k2hash) ;
 			modename = "(tsv)" ;
 			break ;
 		case MODE_MDBM:
-			readlines = ConvertfromMdbm(&ifs, &k2hash) ;
 			modename = "(mdbm)" ;
 			break ;
 	}
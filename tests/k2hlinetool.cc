@@ -96,6 +96,12 @@ typedef std::vector<std::string> strlist_t;
 typedef std::vector<std::string> params_t;
 typedef std::map<std::string, params_t> option_t;
 
+typedef enum k2hlt_queue_type{
+	K2HLT_QUEUE_NORMAL = 0,						// K2HQueue
+	K2HLT_QUEUE_RING,							// K2HRingQueue
+	K2HLT_QUEUE_SHARD							// K2HShardQueue
+}K2HLTQUEUETYPE;
+
 typedef struct option_type{
 	const char*	option;
 	const char*	norm_option;
@@ -647,9 +653,13 @@ static void Help(const char* progname)
 // setf(sf) <key> <offset> <file>           					set directly key-value from file.
 // fill(f) <prefix> <value> <count>         					set key-value by prefix repeating by count
 // fillsub <parent> <prefix> <val> <cnt>    					set key-value under parent key by prefix repeating by count
+// increment(incr) <key> <delta>                                add delta to 64bit integer value of key and print it.
+// cas <key> <expected value> <new value>                       set new value only if value is expected value("null" means no key).
+// append <key> <value>                                         append value(without terminating null) to value of key.
 // rm <key> [all]                           					remove key, if all parameter is specified, remove all sub key under key
 // rmsub <parent key> <key>                 					remove key under parent key
 // rename(ren) <key> <new key>                                  rename key to new key name
+// reap [max count]                                             remove expired keys listed in expiry index(default max count is 64)
 // print(p) <key> [all] [noattrcheck] [pass=....]               print value/subkeys by key, if all parameter is specified, print nesting sub keys
 // printattr(pa) <key>                                          print attribute by key.
 // addattr(aa) <key> <attr name> <attr value>                   add attribute to key.
@@ -662,7 +672,10 @@ static void Help(const char* progname)
 // load <file path>                         					load and run command file.
 // trans(tr) <on [filename [prefix [param]]] | off>
 //												[expire=sec] 	disable/enable transaction.
-// archive(ar) <put | load> <filename>      					put/load archive(transaction) file.
+// archive(ar) <put | load | snapshot> <filename>			put/load archive(transaction) file, or put snapshot archive file.
+// archive(ar) snapshot <filename> pos						put snapshot archive file, and print transaction file position.
+// archive(ar) increment <filename> <position>				put incremental archive file from transaction file position.
+// archive(ar) compact <filename> <output filename>			compact archive file to output file.
 // queue(que) [prefix] empty									check queue is empty
 // queue(que) [prefix] count									get data count in queue
 // queue(que) [prefix] read <fifo | lifo> <pos>	[pass=...]		read the value from queue at position
@@ -670,8 +683,13 @@ static void Help(const char* progname)
 // 												[expire=sec] 	push the value to queue(fifo/lifo)
 // queue(que) [prefix] pop <fifo | lifo> [pass=...]				pop the value from queue
 // queue(que) [prefix] dump <fifo | lifo>						dump queue
+// queue(que) [prefix] popwait <fifo | lifo> <timeout ms>		pop the value from queue with waiting until pushing or timeout
+// queue(que) [prefix] pushbatch <fifo | lifo> <value>...		push the values to queue at once
+// queue(que) [prefix] popbatch <fifo | lifo> <count>			pop the values(up to count) from queue at once
 // queue(que) [prefix] remove(rm) <fifo | lifo> <count> [c]
 // 													[pass=...] 	remove count of values in queue
+// ringqueue(rque) [prefix] <sub command> <parameters...>		ring queue command, sub command and parameters are as same as queue command
+// shardqueue(sque) [prefix] <sub command> <parameters...>		sharded queue command, sub command and parameters are as same as queue command
 // keyqueue(kque) [prefix] empty								check keyqueue is empty
 // keyqueue(kque) [prefix] count								get data count in keyqueue
 // keyqueue(kque) [prefix] read <fifo | lifo> <pos> [pass=...]	read the value from keyqueue at position
@@ -682,10 +700,12 @@ static void Help(const char* progname)
 // keyqueue(kque) [prefix] remove(rm) <fifo | lifo> <count> [c]
 // 													[pass=...]	remove count of key-name in queue and remove those from k2hash
 // builtinattr(ba) [mtime] [history] [expire=second]
-//                                       [enc] [pass=file path] set builtin attribute
+//                                       [enc] [pass=file path]
+//          [compress=<lz4 | zstd | no>] [compmin=byte]         set builtin attribute
 // loadpluginattr(lpa) filepath                                 load plugin attribute library.
 // addpassphrase(app) <pass phrase> [default]                   add pass phrase for crypt into builtin attribute.
 // cleanallattr(caa)                                            clear all attribute setting.
+// cache <on <limit byte> [watermark] | off>                    enable/disable cache mode which evicts keys over limit.
 // shell														exit shell(same as "!" command).
 // echo <string>...												echo string
 // sleep <second>												sleep seconds
@@ -706,9 +726,13 @@ static void LineHelp(void)
 	PRN("setf(sf) <key> <offset> <file>                               set directly key-value from file.");
 	PRN("fill(f) <prefix> <value> <count>                             set key-value by prefix repeating by count");
 	PRN("fillsub <parent> <prefix> <val> <cnt>                        set key-value under parent key by prefix repeating by count");
+	PRN("increment(incr) <key> <delta>                                add delta to 64bit integer value of key and print it.");
+	PRN("cas <key> <expected value> <new value>                       set new value only if value is expected value(\"null\" means no key).");
+	PRN("append <key> <value>                                         append value(without terminating null) to value of key.");
 	PRN("rm <key> [all]                                               remove key, if all parameter is specified, remove all sub key under key");
 	PRN("rmsub <parent key> <key>                                     remove key under parent key");
 	PRN("rename(ren) <key> <new key>                                  rename key to new key name");
+	PRN("reap [max count]                                             remove expired keys listed in expiry index(default max count is 64)");
 	PRN("print(p) <key> [all] [noattrcheck] [pass=....]               print value/subkeys by key, if all parameter is specified, print nesting sub keys");
 	PRN("printattr(pa) <key>                                          print attribute by key.");
 	PRN("addattr(aa) <key> <attr name> <attr value>                   add attribute to key.");
@@ -724,7 +748,12 @@ static void LineHelp(void)
 	PRN("trans(tr) <on [filename [prefix [param]]] | off> [expire=sec]");
 	PRN("                                                             disable/enable transaction.");
 	PRN("threadpool(pool) [number]                                    set/display thread pool count for transaction, 0 means no thread pool.");
-	PRN("archive(ar) <put | load> <filename>                          put/load archive(transaction) file.");
+	PRN("archive(ar) <put | load | snapshot> <filename>               put/load archive(transaction) file, or put snapshot archive");
+	PRN("                                                             file which is consistent at starting without stopping writers.");
+	PRN("archive(ar) snapshot <filename> pos                          put snapshot archive file, and print transaction file position.");
+	PRN("archive(ar) increment <filename> <position>                  put incremental(compacted) archive file which has transaction");
+	PRN("                                                             after the position, and print the next position.");
+	PRN("archive(ar) compact <filename> <output filename>             compact archive file(keep only the last data-set for each key).");
 	PRN("queue(que) [prefix] empty                                    check queue is empty");
 	PRN("queue(que) [prefix] count                                    get data count in queue");
 	PRN("queue(que) [prefix] read <fifo | lifo> <pos> [pass=...]      read the value from queue at position");
@@ -732,8 +761,15 @@ static void LineHelp(void)
 	PRN("                                                             push the value to queue(fifo/lifo)");
 	PRN("queue(que) [prefix] pop <fifo | lifo> [pass=...]             pop the value from queue");
 	PRN("queue(que) [prefix] dump <fifo | lifo>                       dump queue");
+	PRN("queue(que) [prefix] popwait <fifo | lifo> <timeout ms>       pop the value from queue with waiting until pushing or timeout");
+	PRN("queue(que) [prefix] pushbatch <fifo | lifo> <value>...       push the values to queue at once");
+	PRN("queue(que) [prefix] popbatch <fifo | lifo> <count>           pop the values(up to count) from queue at once");
 	PRN("queue(que) [prefix] remove(rm) <fifo | lifo> <count> [c] [pass=...]");
 	PRN("                                                             remove count of values in queue");
+	PRN("ringqueue(rque) [prefix] <sub command> <parameters...>       ring queue command, sub command and parameters are as same as");
+	PRN("                                                             queue command(except pass parameter).");
+	PRN("shardqueue(sque) [prefix] <sub command> <parameters...>      sharded queue command, sub command and parameters are as same");
+	PRN("                                                             as queue command.");
 	PRN("keyqueue(kque) [prefix] empty                                check keyqueue is empty");
 	PRN("keyqueue(kque) [prefix] count                                get data count in keyqueue");
 	PRN("keyqueue(kque) [prefix] read <fifo | lifo> <pos> [pass=...]  read the value from keyqueue at position");
@@ -744,10 +780,11 @@ static void LineHelp(void)
 	PRN("keyqueue(kque) [prefix] remove(rm) <fifo | lifo> <count> [c] [pass=...]");
 	PRN("                                                             remove count of key-name in queue and remove those from k2hash");
 	PRN("builtinattr(ba) [mtime] [history] [expire=second] [enc] [pass=file path]");
-	PRN("                                                             set builtin attribute.");
+	PRN("                [compress=<lz4 | zstd | no>] [compmin=byte]  set builtin attribute.");
 	PRN("loadpluginattr(lpa) filepath                                 load plugin attribute library.");
 	PRN("addpassphrase(app) <pass phrase> [default]                   add pass phrase for crypt into builtin attribute.");
 	PRN("cleanallattr(caa)                                            clear all attribute setting.");
+	PRN("cache <on <limit byte> [watermark] | off>                    enable/disable cache mode which evicts keys over limit.");
 	PRN("shell                                                        exit shell(same as \"!\" command).");
 	PRN("echo <string>...                                             echo string");
 	PRN("sleep <second>                                               sleep seconds");
@@ -803,10 +840,15 @@ const OPTTYPE LineOptionTypes[] = {
 	{"fill",			"fill",				3,	3},
 	{"f",				"fill",				3,	3},
 	{"fillsub",			"fillsub",			4,	4},
+	{"increment",		"increment",		2,	2},
+	{"incr",			"increment",		2,	2},
+	{"cas",				"cas",				3,	3},
+	{"append",			"append",			2,	2},
 	{"rm",				"rm",				1,	2},
 	{"rmsub",			"rmsub",			2,	2},
 	{"rename",			"rename",			2,	2},
 	{"ren",				"rename",			2,	2},
+	{"reap",			"reap",				0,	1},
 	{"print",			"print",			1,	3},
 	{"p",				"print",			1,	3},
 	{"printattr",		"printattr",		1,	1},
@@ -833,21 +875,26 @@ const OPTTYPE LineOptionTypes[] = {
 	{"tr",				"trans",			1,	5},
 	{"threadpool",		"threadpool",		0,	1},
 	{"pool",			"threadpool",		0,	1},
-	{"archive",			"archive",			2,	2},
-	{"ar",				"archive",			2,	2},
+	{"archive",			"archive",			2,	3},
+	{"ar",				"archive",			2,	3},
 	{"shell",			"shell",			0,	0},
-	{"queue",			"queue",			1,	6},
-	{"que",				"queue",			1,	6},
+	{"queue",			"queue",			1,	16},
+	{"que",				"queue",			1,	16},
+	{"ringqueue",		"ringqueue",		1,	16},
+	{"rque",			"ringqueue",		1,	16},
+	{"shardqueue",		"shardqueue",		1,	16},
+	{"sque",			"shardqueue",		1,	16},
 	{"keyqueue",		"keyqueue",			1,	7},
 	{"kque",			"keyqueue",			1,	7},
-	{"builtinattr",		"builtinattr",		0,	6},
-	{"ba",				"builtinattr",		0,	6},
+	{"builtinattr",		"builtinattr",		0,	8},
+	{"ba",				"builtinattr",		0,	8},
 	{"loadpluginattr",	"loadpluginattr",	1,	1},
 	{"lpa",				"loadpluginattr",	1,	1},
 	{"addpassphrase",	"addpassphrase",	1,	2},
 	{"app",				"addpassphrase",	1,	2},
 	{"cleanallattr",	"cleanallattr",		0,	0},
 	{"caa",				"cleanallattr",		0,	0},
+	{"cache",			"cache",			1,	3},
 	{"sh",				"shell",			0,	0},
 	{"echo",			"echo",				1,	9999},
 	{"sleep",			"sleep",			1,	1},
@@ -1700,6 +1747,69 @@ static bool FillSubkeyCommand(K2HShm& k2hash, const params_t& params)
 	return true;
 }
 
+static bool IncrementCommand(K2HShm& k2hash, const params_t& params)
+{
+	int64_t	delta = static_cast<int64_t>(atoll(params[1].c_str()));
+	int64_t	value = 0;
+	if(isModeCAPI){
+		if(!k2h_increment_str(reinterpret_cast<k2h_h>(&k2hash), params[0].c_str(), delta, &value)){
+			ERR("Something error occurred while incrementing value.");
+			return true;	// for continue.
+		}
+	}else{
+		if(!k2hash.Increment(params[0].c_str(), delta, &value)){
+			ERR("Something error occurred while incrementing value.");
+			return true;	// for continue.
+		}
+	}
+	PRN(" Value : %" PRId64, value);
+	PRN("");
+
+	return true;
+}
+
+static bool CompareAndSwapCommand(K2HShm& k2hash, const params_t& params)
+{
+	const unsigned char*	pExpected	= NULL;
+	size_t					explength	= 0;
+	if(0 != strcasecmp(params[1].c_str(), "null")){
+		pExpected	= reinterpret_cast<const unsigned char*>(params[1].c_str());
+		explength	= params[1].length() + 1;
+	}
+	bool	is_swapped = false;
+	if(isModeCAPI){
+		if(!k2h_compare_and_swap(reinterpret_cast<k2h_h>(&k2hash), reinterpret_cast<const unsigned char*>(params[0].c_str()), params[0].length() + 1, pExpected, explength, reinterpret_cast<const unsigned char*>(params[2].c_str()), params[2].length() + 1, &is_swapped)){
+			ERR("Something error occurred while comparing and swapping value.");
+			return true;	// for continue.
+		}
+	}else{
+		if(!k2hash.CompareAndSwap(reinterpret_cast<const unsigned char*>(params[0].c_str()), params[0].length() + 1, pExpected, explength, reinterpret_cast<const unsigned char*>(params[2].c_str()), params[2].length() + 1, is_swapped)){
+			ERR("Something error occurred while comparing and swapping value.");
+			return true;	// for continue.
+		}
+	}
+	PRN(" Swapped : %s", is_swapped ? "yes" : "no");
+	PRN("");
+
+	return true;
+}
+
+static bool AppendCommand(K2HShm& k2hash, const params_t& params)
+{
+	if(isModeCAPI){
+		if(!k2h_append(reinterpret_cast<k2h_h>(&k2hash), reinterpret_cast<const unsigned char*>(params[0].c_str()), params[0].length() + 1, reinterpret_cast<const unsigned char*>(params[1].c_str()), params[1].length())){
+			ERR("Something error occurred while appending value.");
+			return true;	// for continue.
+		}
+	}else{
+		if(!k2hash.Append(reinterpret_cast<const unsigned char*>(params[0].c_str()), params[0].length() + 1, reinterpret_cast<const unsigned char*>(params[1].c_str()), params[1].length())){
+			ERR("Something error occurred while appending value.");
+			return true;	// for continue.
+		}
+	}
+	return true;
+}
+
 static bool RemoveCommand(K2HShm& k2hash, const params_t& params)
 {
 	bool isRemoveSubkeyAll = false;
@@ -1814,6 +1924,36 @@ static bool RenameCommand(K2HShm& k2hash, const params_t& params)
 	return true;
 }
 
+static bool ReapCommand(K2HShm& k2hash, const params_t& params)
+{
+	int	maxcount = static_cast<int>(K2HShm::DEFAULT_REAPER_STEP_COUNT);
+	if(1 == params.size()){
+		if(0 >= (maxcount = atoi(params[0].c_str()))){
+			ERR("reap command parameter must be number over 0.");
+			return true;	// for continue.
+		}
+	}
+
+	int	reaped;
+	if(isModeCAPI){
+		if(-1 == (reaped = k2h_reap_expired(reinterpret_cast<k2h_h>(&k2hash), maxcount))){
+			ERR("Something error occurred while reaping expired keys.");
+			return true;	// for continue.
+		}
+	}else{
+		size_t	reapedcnt = 0;
+		if(!k2hash.ReapExpired(static_cast<size_t>(maxcount), &reapedcnt)){
+			ERR("Something error occurred while reaping expired keys.");
+			return true;	// for continue.
+		}
+		reaped = static_cast<int>(reapedcnt);
+	}
+	PRN(" Reaped expired keys : %d", reaped);
+	PRN("");
+
+	return true;
+}
+
 static bool PrintCommand(K2HShm& k2hash, const params_t& params)
 {
 	bool	isSubkeys		= false;
@@ -2932,27 +3072,90 @@ static bool ThreadPoolCommand(const K2HShm& k2hash, const params_t& params)
 static bool ArchiveCommand(K2HShm& k2hash, const params_t& params)
 {
 	bool	isLoad;
+	bool	isSnapshot = false;
 	string	filepath;
-	if(2 != params.size()){
-		if(2 < params.size()){
-			ERR("Unknown parameter(%s) for archive command.", params[2].c_str());
+	if(params.size() < 2){
+		ERR("archive command needs archive file path as 2\'nd parameter.");
+		return true;	// for continue.
+	}
+	if(0 == strcasecmp(params[0].c_str(), "increment")){
+		if(3 != params.size()){
+			ERR("archive increment command needs transaction file position as 3\'rd parameter.");
+			return true;	// for continue.
+		}
+		off_t	startpos	= static_cast<off_t>(atoll(params[2].c_str()));
+		off_t	endpos		= 0;
+		bool	result;
+		if(isModeCAPI){
+			result = k2h_put_archive_increment(reinterpret_cast<k2h_h>(&k2hash), params[1].c_str(), startpos, &endpos, true);
+		}else{
+			K2HArchive	archiveobj(params[1].c_str(), false);
+			result = archiveobj.PutIncrement(&k2hash, startpos, &endpos, true);
+		}
+		if(!result){
+			ERR("Something error occurred during putting incremental archive file(%s).", params[1].c_str());
+			return true;	// for continue.
+		}
+		PRN("Next transaction file position: %jd", static_cast<intmax_t>(endpos));
+		return true;
+
+	}else if(0 == strcasecmp(params[0].c_str(), "compact")){
+		if(3 != params.size()){
+			ERR("archive compact command needs output file path as 3\'rd parameter.");
+			return true;	// for continue.
+		}
+		bool	result;
+		if(isModeCAPI){
+			result = k2h_compact_archive(params[1].c_str(), params[2].c_str(), false);
 		}else{
-			ERR("archive command needs archive file path as 2\'nd parameter.");
+			K2HArchive	archiveobj(params[1].c_str(), false);
+			result = archiveobj.Compact(params[2].c_str());
+		}
+		if(!result){
+			ERR("Something error occurred during compacting archive file(%s) to file(%s).", params[1].c_str(), params[2].c_str());
 		}
 		return true;	// for continue.
 	}
+
 	if(0 == strcasecmp(params[0].c_str(), "put")){
 		isLoad = false;
 	}else if(0 == strcasecmp(params[0].c_str(), "load")){
 		isLoad = true;
+	}else if(0 == strcasecmp(params[0].c_str(), "snapshot")){
+		isLoad		= false;
+		isSnapshot	= true;
 	}else{
 		ERR("Unknown parameter(%s) for archive command.", params[0].c_str());
 		return true;	// for continue.
 	}
+	if(2 != params.size() && (!isSnapshot || 0 != strcasecmp(params[2].c_str(), "pos"))){
+		ERR("Unknown parameter(%s) for archive command.", params[2].c_str());
+		return true;	// for continue.
+	}
 	filepath = params[1].c_str();
 
 	// archive
-	if(isModeCAPI){
+	if(isSnapshot){
+		bool	result;
+		off_t	transpos	= 0;
+		bool	isPos		= (3 == params.size());
+		if(isModeCAPI){
+			if(isPos){
+				result = k2h_put_archive_snapshot_pos(reinterpret_cast<k2h_h>(&k2hash), filepath.c_str(), false, &transpos);
+			}else{
+				result = k2h_put_archive_snapshot(reinterpret_cast<k2h_h>(&k2hash), filepath.c_str(), false);
+			}
+		}else{
+			result = k2hash.SaveSnapshot(filepath.c_str(), false, (isPos ? &transpos : NULL));
+		}
+		if(!result){
+			ERR("Something error occurred during putting snapshot archive file(%s).", filepath.c_str());
+			return true;	// for continue.
+		}
+		if(isPos){
+			PRN("Transaction file position: %jd", static_cast<intmax_t>(transpos));
+		}
+	}else if(isModeCAPI){
 		bool result;
 		if(isLoad){
 			result = k2h_load_archive(reinterpret_cast<k2h_h>(&k2hash), filepath.c_str(), false);
@@ -2977,7 +3180,50 @@ static bool ArchiveCommand(K2HShm& k2hash, const params_t& params)
 	return true;
 }
 
-static bool QueueEmptySubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+//
+// Open queue handle(C API) / Get queue object by queue type
+//
+static k2h_q_h OpenQueueHandle(K2HShm& k2hash, K2HLTQUEUETYPE qtype, bool is_fifo, const char* prefix)
+{
+	k2h_q_h	qhandle;
+	if(K2HLT_QUEUE_RING == qtype){
+		if(prefix){
+			qhandle = k2h_ringq_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
+		}else{
+			qhandle = k2h_ringq_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
+		}
+	}else if(K2HLT_QUEUE_SHARD == qtype){
+		if(prefix){
+			qhandle = k2h_shardq_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, 0, K2H_SHARDQ_DEFAULT_MODE, prefix);
+		}else{
+			qhandle = k2h_shardq_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo, 0, K2H_SHARDQ_DEFAULT_MODE);
+		}
+	}else{
+		if(prefix){
+			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
+		}else{
+			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
+		}
+	}
+	return qhandle;
+}
+
+static K2HQueue* GetQueueObject(K2HShm& k2hash, K2HLTQUEUETYPE qtype, bool is_fifo, const char* prefix)
+{
+	const unsigned char*	pref	= reinterpret_cast<const unsigned char*>(prefix);
+	size_t					preflen	= (prefix ? strlen(prefix) : 0);
+	K2HQueue*				pqueue;
+	if(K2HLT_QUEUE_RING == qtype){
+		pqueue = k2hash.GetRingQueueObj(is_fifo, pref, preflen);
+	}else if(K2HLT_QUEUE_SHARD == qtype){
+		pqueue = k2hash.GetShardQueueObj(is_fifo, pref, preflen);
+	}else{
+		pqueue = k2hash.GetQueueObj(is_fifo, pref, preflen);
+	}
+	return pqueue;
+}
+
+static bool QueueEmptySubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(1 != params.size()){
 		if(1 < params.size()){
@@ -2990,12 +3236,7 @@ static bool QueueEmptySubCommand(K2HShm& k2hash, const char* prefix, const param
 
 	// Queue empty
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), true, prefix);	// fifo
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), true);						// fifo
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, true, prefix);	// fifo
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3014,22 +3255,23 @@ static bool QueueEmptySubCommand(K2HShm& k2hash, const char* prefix, const param
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, true, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){	// fifo
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, true, prefix))){	// fifo
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
-		if(queue.IsEmpty()){
+		if(pqueue->IsEmpty()){
 			PRN(" Queue is EMPTY.");
 		}else{
 			PRN(" Queue is NOT empty.");
 		}
 		PRN("");
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueueCountSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueueCountSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(1 != params.size()){
 		if(1 < params.size()){
@@ -3042,12 +3284,7 @@ static bool QueueCountSubCommand(K2HShm& k2hash, const char* prefix, const param
 
 	// Queue count
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), true, prefix);	// fifo
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), true);						// fifo
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, true, prefix);	// fifo
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3063,20 +3300,21 @@ static bool QueueCountSubCommand(K2HShm& k2hash, const char* prefix, const param
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, true, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){	// fifo
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, true, prefix))){	// fifo
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
 
-		int	count = queue.GetCount();
+		int	count = pqueue->GetCount();
 		PRN(" Data count in Queue : %d", count);
 		PRN("");
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueueReadSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueueReadSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(3 != params.size() && 4 != params.size()){
 		if(4 < params.size()){
@@ -3111,12 +3349,7 @@ static bool QueueReadSubCommand(K2HShm& k2hash, const char* prefix, const params
 
 	// Queue Read
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3150,35 +3383,39 @@ static bool QueueReadSubCommand(K2HShm& k2hash, const char* prefix, const params
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, is_fifo, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
 
 		unsigned char*	pval	= NULL;
 		size_t			vallen	= 0;
-		if(!queue.Read(&pval, vallen, pos, pass)){
+		if(!pqueue->Read(&pval, vallen, pos, pass)){
 			ERR("Something error occurred during reading queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 
 		if(!pval || 0 == vallen){
 			ERR("There is no read queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 
 		if(!BinaryDumpUtility("READ QUEUE", pval, vallen)){
 			ERR("Something error occurred during printing read queue.");
 			K2H_Free(pval);
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 		K2H_Free(pval);
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueuePushSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueuePushSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(3 != params.size() && 4 != params.size() && 5 != params.size()){
 		if(5 < params.size()){
@@ -3224,12 +3461,7 @@ static bool QueuePushSubCommand(K2HShm& k2hash, const char* prefix, const params
 
 	// Queue PUSH
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3247,20 +3479,22 @@ static bool QueuePushSubCommand(K2HShm& k2hash, const char* prefix, const params
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, is_fifo, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
-		if(!queue.Push(reinterpret_cast<const unsigned char*>(strvalue.c_str()), strvalue.size() + 1, NULL, ppass, pexpire)){
+		if(!pqueue->Push(reinterpret_cast<const unsigned char*>(strvalue.c_str()), strvalue.size() + 1, NULL, ppass, pexpire)){
 			ERR("Something error occurred during pushing queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueuePopSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueuePopSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(2 != params.size() && 3 != params.size()){
 		if(3 < params.size()){
@@ -3294,12 +3528,7 @@ static bool QueuePopSubCommand(K2HShm& k2hash, const char* prefix, const params_
 
 	// Queue POP
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3333,35 +3562,249 @@ static bool QueuePopSubCommand(K2HShm& k2hash, const char* prefix, const params_
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, is_fifo, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
 
 		unsigned char*	pval	= NULL;
 		size_t			vallen	= 0;
-		if(!queue.Pop(&pval, vallen, NULL, pass)){
+		if(!pqueue->Pop(&pval, vallen, NULL, pass)){
 			ERR("Something error occurred during popping queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 
 		if(!pval || 0 == vallen){
 			ERR("There is no popped queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 
 		if(!BinaryDumpUtility("POPPED QUEUE", pval, vallen)){
 			ERR("Something error occurred during printing popped queue.");
 			K2H_Free(pval);
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
 		K2H_Free(pval);
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueueDumpSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueuePopWaitSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
+{
+	if(3 != params.size()){
+		if(3 < params.size()){
+			ERR("Unknown parameter(%s) for queue popwait command.", params[3].c_str());
+		}else{
+			ERR("queue popwait command needs more parameter.");
+		}
+		return true;	// for continue.
+	}
+
+	bool	is_fifo = false;
+	if(0 == strcasecmp(params[1].c_str(), "fifo")){
+		is_fifo = true;
+	}else if(0 == strcasecmp(params[1].c_str(), "lifo")){
+		is_fifo = false;
+	}else{
+		ERR("queue popwait command has unknown parameter: %s", params[1].c_str());
+	}
+	long	timeout_ms = atol(params[2].c_str());
+
+	// Queue POP WAIT
+	unsigned char*	pval	= NULL;
+	size_t			vallen	= 0;
+	if(isModeCAPI){
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
+		if(K2H_INVALID_HANDLE == qhandle){
+			ERR("Something error occurred during initializing queue.");
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_pop_wait(qhandle, &pval, &vallen, timeout_ms)){
+			ERR("Something error occurred during popping queue.");
+			k2h_q_free(qhandle);
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_free(qhandle)){
+			ERR("Something error occurred during closing queue.");
+			K2H_Free(pval);
+			return true;	// for continue.
+		}
+
+	}else{
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
+			ERR("Something error occurred during initializing queue.");
+			return true;	// for continue.
+		}
+		if(!pqueue->PopWait(&pval, vallen, timeout_ms)){
+			ERR("Something error occurred during popping queue.");
+			K2H_Delete(pqueue);
+			return true;	// for continue.
+		}
+		K2H_Delete(pqueue);
+	}
+
+	if(!pval || 0 == vallen){
+		ERR("There is no popped queue(timeout).");
+		return true;	// for continue.
+	}
+	if(!BinaryDumpUtility("POPPED QUEUE", pval, vallen)){
+		ERR("Something error occurred during printing popped queue.");
+	}
+	K2H_Free(pval);
+
+	return true;
+}
+
+static bool QueuePushBatchSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
+{
+	if(params.size() < 3){
+		ERR("queue pushbatch command needs more parameter.");
+		return true;	// for continue.
+	}
+
+	bool	is_fifo = false;
+	if(0 == strcasecmp(params[1].c_str(), "fifo")){
+		is_fifo = true;
+	}else if(0 == strcasecmp(params[1].c_str(), "lifo")){
+		is_fifo = false;
+	}else{
+		ERR("queue pushbatch command has unknown parameter: %s", params[1].c_str());
+	}
+
+	size_t	datacnt	= params.size() - 2;
+	K2HBIN*	pdatas	= new K2HBIN[datacnt];
+	for(size_t pos = 0; pos < datacnt; ++pos){
+		pdatas[pos].byptr	= reinterpret_cast<unsigned char*>(const_cast<char*>(params[pos + 2].c_str()));
+		pdatas[pos].length	= params[pos + 2].size() + 1;
+	}
+
+	// Queue PUSH BATCH
+	if(isModeCAPI){
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
+		if(K2H_INVALID_HANDLE == qhandle){
+			ERR("Something error occurred during initializing queue.");
+			delete[] pdatas;
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_push_batch(qhandle, pdatas, datacnt)){
+			ERR("Something error occurred during pushing queue.");
+			k2h_q_free(qhandle);
+			delete[] pdatas;
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_free(qhandle)){
+			ERR("Something error occurred during closing queue.");
+			delete[] pdatas;
+			return true;	// for continue.
+		}
+
+	}else{
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
+			ERR("Something error occurred during initializing queue.");
+			delete[] pdatas;
+			return true;	// for continue.
+		}
+		if(!pqueue->PushBatch(pdatas, datacnt)){
+			ERR("Something error occurred during pushing queue.");
+			delete[] pdatas;
+			K2H_Delete(pqueue);
+			return true;	// for continue.
+		}
+		K2H_Delete(pqueue);
+	}
+	delete[] pdatas;
+	return true;
+}
+
+static bool QueuePopBatchSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
+{
+	if(3 != params.size()){
+		if(3 < params.size()){
+			ERR("Unknown parameter(%s) for queue popbatch command.", params[3].c_str());
+		}else{
+			ERR("queue popbatch command needs more parameter.");
+		}
+		return true;	// for continue.
+	}
+
+	bool	is_fifo = false;
+	if(0 == strcasecmp(params[1].c_str(), "fifo")){
+		is_fifo = true;
+	}else if(0 == strcasecmp(params[1].c_str(), "lifo")){
+		is_fifo = false;
+	}else{
+		ERR("queue popbatch command has unknown parameter: %s", params[1].c_str());
+	}
+
+	int	maxcount = atoi(params[2].c_str());
+	if(maxcount <= 0){
+		ERR("queue popbatch count is ignore.");
+		return true;	// for continue.
+	}
+
+	// Queue POP BATCH
+	PK2HBIN	pdatas	= NULL;
+	size_t	datacnt	= 0;
+	if(isModeCAPI){
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
+		if(K2H_INVALID_HANDLE == qhandle){
+			ERR("Something error occurred during initializing queue.");
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_pop_batch(qhandle, static_cast<size_t>(maxcount), &pdatas, &datacnt)){
+			ERR("Something error occurred during popping queue.");
+			k2h_q_free(qhandle);
+			return true;	// for continue.
+		}
+
+		if(!k2h_q_free(qhandle)){
+			ERR("Something error occurred during closing queue.");
+			free_k2hbins(pdatas, datacnt);
+			return true;	// for continue.
+		}
+
+	}else{
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
+			ERR("Something error occurred during initializing queue.");
+			return true;	// for continue.
+		}
+		if(!pqueue->PopBatch(static_cast<size_t>(maxcount), &pdatas, datacnt)){
+			ERR("Something error occurred during popping queue.");
+			K2H_Delete(pqueue);
+			return true;	// for continue.
+		}
+		K2H_Delete(pqueue);
+	}
+
+	if(!pdatas || 0 == datacnt){
+		ERR("There is no popped queue.");
+		return true;	// for continue.
+	}
+	for(size_t pos = 0; pos < datacnt; ++pos){
+		if(!BinaryDumpUtility("POPPED QUEUE", pdatas[pos].byptr, pdatas[pos].length)){
+			ERR("Something error occurred during printing popped queue.");
+			break;
+		}
+	}
+	free_k2hbins(pdatas, datacnt);
+
+	return true;
+}
+
+static bool QueueDumpSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(2 != params.size()){
 		if(2 < params.size()){
@@ -3383,12 +3826,7 @@ static bool QueueDumpSubCommand(K2HShm& k2hash, const char* prefix, const params
 
 	// Queue DUMP
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3405,16 +3843,18 @@ static bool QueueDumpSubCommand(K2HShm& k2hash, const char* prefix, const params
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, is_fifo, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
 
-		if(!queue.Dump(stdout)){
+		if(!pqueue->Dump(stdout)){
 			ERR("Something error occurred during dumping queue.");
+			K2H_Delete(pqueue);
 			return true;	// for continue.
 		}
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
@@ -3490,7 +3930,7 @@ static K2HQRMCBRES QueueRemoveCallback(const unsigned char* bydata, size_t datal
 	return res;
 }
 
-static bool QueueRemoveSubCommand(K2HShm& k2hash, const char* prefix, const params_t& params)
+static bool QueueRemoveSubCommand(K2HShm& k2hash, K2HLTQUEUETYPE qtype, const char* prefix, const params_t& params)
 {
 	if(3 != params.size() && 4 != params.size() && 5 != params.size()){
 		if(5 < params.size()){
@@ -3533,12 +3973,7 @@ static bool QueueRemoveSubCommand(K2HShm& k2hash, const char* prefix, const para
 
 	// Queue REMOVE
 	if(isModeCAPI){
-		k2h_q_h	qhandle;
-		if(prefix){
-			qhandle = k2h_q_handle_str_prefix(reinterpret_cast<k2h_h>(&k2hash), is_fifo, prefix);
-		}else{
-			qhandle = k2h_q_handle(reinterpret_cast<k2h_h>(&k2hash), is_fifo);
-		}
+		k2h_q_h	qhandle = OpenQueueHandle(k2hash, qtype, is_fifo, prefix);
 		if(K2H_INVALID_HANDLE == qhandle){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
@@ -3564,51 +3999,63 @@ static bool QueueRemoveSubCommand(K2HShm& k2hash, const char* prefix, const para
 		}
 
 	}else{
-		K2HQueue	queue;
-		if(!queue.Init(&k2hash, is_fifo, reinterpret_cast<const unsigned char*>(prefix), (prefix ? strlen(prefix) : 0))){
+		K2HQueue*	pqueue;
+		if(NULL == (pqueue = GetQueueObject(k2hash, qtype, is_fifo, prefix))){
 			ERR("Something error occurred during initializing queue.");
 			return true;	// for continue.
 		}
 		if(is_confirm){
-			if(-1 == queue.Remove(count, QueueRemoveCallback, NULL, ppass)){
+			if(-1 == pqueue->Remove(count, QueueRemoveCallback, NULL, ppass)){
 				ERR("Something error occurred during removing queue.");
+				K2H_Delete(pqueue);
 				return true;	// for continue.
 			}
 		}else{
-			if(-1 == queue.Remove(count, NULL, NULL, ppass)){
+			if(-1 == pqueue->Remove(count, NULL, NULL, ppass)){
 				ERR("Something error occurred during removing queue.");
+				K2H_Delete(pqueue);
 				return true;	// for continue.
 			}
 		}
+		K2H_Delete(pqueue);
 	}
 	return true;
 }
 
-static bool QueueCommand(K2HShm& k2hash, params_t& params)
+static bool QueueCommand(K2HShm& k2hash, params_t& params, K2HLTQUEUETYPE qtype)
 {
 	bool	bResult = false;
 
 	// check sub command
 	if(0 == strcasecmp(params[0].c_str(), "empty")){
-		bResult = QueueEmptySubCommand(k2hash, NULL, params);
+		bResult = QueueEmptySubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "count")){
-		bResult = QueueCountSubCommand(k2hash, NULL, params);
+		bResult = QueueCountSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "read")){
-		bResult = QueueReadSubCommand(k2hash, NULL, params);
+		bResult = QueueReadSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "push")){
-		bResult = QueuePushSubCommand(k2hash, NULL, params);
+		bResult = QueuePushSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "pop")){
-		bResult = QueuePopSubCommand(k2hash, NULL, params);
+		bResult = QueuePopSubCommand(k2hash, qtype, NULL, params);
+
+	}else if(0 == strcasecmp(params[0].c_str(), "popwait")){
+		bResult = QueuePopWaitSubCommand(k2hash, qtype, NULL, params);
+
+	}else if(0 == strcasecmp(params[0].c_str(), "pushbatch")){
+		bResult = QueuePushBatchSubCommand(k2hash, qtype, NULL, params);
+
+	}else if(0 == strcasecmp(params[0].c_str(), "popbatch")){
+		bResult = QueuePopBatchSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "dump")){
-		bResult = QueueDumpSubCommand(k2hash, NULL, params);
+		bResult = QueueDumpSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(0 == strcasecmp(params[0].c_str(), "remove") || 0 == strcasecmp(params[0].c_str(), "rm")){
-		bResult = QueueRemoveSubCommand(k2hash, NULL, params);
+		bResult = QueueRemoveSubCommand(k2hash, qtype, NULL, params);
 
 	}else if(2 <= params.size()){
 		// case of first parameter is prefix
@@ -3616,25 +4063,34 @@ static bool QueueCommand(K2HShm& k2hash, params_t& params)
 		params.erase(params.begin());
 
 		if(0 == strcasecmp(params[0].c_str(), "empty")){
-			bResult = QueueEmptySubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueueEmptySubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "count")){
-			bResult = QueueCountSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueueCountSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "read")){
-			bResult = QueueReadSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueueReadSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "push")){
-			bResult = QueuePushSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueuePushSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "pop")){
-			bResult = QueuePopSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueuePopSubCommand(k2hash, qtype, strprefix.c_str(), params);
+
+		}else if(0 == strcasecmp(params[0].c_str(), "popwait")){
+			bResult = QueuePopWaitSubCommand(k2hash, qtype, strprefix.c_str(), params);
+
+		}else if(0 == strcasecmp(params[0].c_str(), "pushbatch")){
+			bResult = QueuePushBatchSubCommand(k2hash, qtype, strprefix.c_str(), params);
+
+		}else if(0 == strcasecmp(params[0].c_str(), "popbatch")){
+			bResult = QueuePopBatchSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "dump")){
-			bResult = QueueDumpSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueueDumpSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else if(0 == strcasecmp(params[0].c_str(), "remove") || 0 == strcasecmp(params[0].c_str(), "rm")){
-			bResult = QueueRemoveSubCommand(k2hash, strprefix.c_str(), params);
+			bResult = QueueRemoveSubCommand(k2hash, qtype, strprefix.c_str(), params);
 
 		}else{
 			ERR("queue command needs sub command parameter.");
@@ -4334,6 +4790,10 @@ static bool BultinAttrCommand(K2HShm& k2hash, const params_t& params)
 	bool			is_defenc	= true;
 	string			passfile;
 	bool			is_history	= true;
+	const char*		pcomptype	= NULL;
+	const size_t*	pcompmin	= NULL;
+	string			comptype;
+	size_t			compmin		= 0;
 
 	// cppcheck-suppress unreadVariable
 	time_t		expire		= 0;
@@ -4360,6 +4820,15 @@ static bool BultinAttrCommand(K2HShm& k2hash, const params_t& params)
 		}else if(0 == strncasecmp(iter->c_str(), "pass=", 5)){
 			passfile	= iter->substr(5);
 			ppassfile	= passfile.c_str();
+
+		}else if(0 == strncasecmp(iter->c_str(), "compress=", 9)){
+			comptype	= iter->substr(9);
+			pcomptype	= comptype.c_str();
+
+		}else if(0 == strncasecmp(iter->c_str(), "compmin=", 8)){
+			compmin		= static_cast<size_t>(atoll(iter->substr(8).c_str()));
+			pcompmin	= &compmin;
+
 		}else{
 			ERR("unknown parameter %s.", iter->c_str());
 			return true;		// for continue.
@@ -4375,8 +4844,11 @@ static bool BultinAttrCommand(K2HShm& k2hash, const params_t& params)
 		if(!k2h_set_common_attr(reinterpret_cast<k2h_h>(&k2hash), pis_mtime, pis_defenc, ppassfile, pis_history, pexpire)){
 			ERR("Something error occurred during setting builtin attribute.");
 		}
+		if((pcomptype || pcompmin) && !k2h_set_common_attr_compress(reinterpret_cast<k2h_h>(&k2hash), pcomptype, pcompmin, NULL, NULL)){
+			ERR("Something error occurred during setting builtin attribute for compression.");
+		}
 	}else{
-		if(!k2hash.SetCommonAttribute(pis_mtime, pis_defenc, ppassfile, pis_history, pexpire, NULL)){
+		if(!k2hash.SetCommonAttribute(pis_mtime, pis_defenc, ppassfile, pis_history, pexpire, NULL, pcomptype, pcompmin)){
 			ERR("Something error occurred during setting builtin attribute.");
 		}
 	}
@@ -4450,6 +4922,51 @@ static bool CleanAllAttrCommand(K2HShm& k2hash, const params_t& params)
 	return true;
 }
 
+static bool CacheCommand(K2HShm& k2hash, const params_t& params)
+{
+	if(0 == strcasecmp(params[0].c_str(), "on")){
+		if(params.size() < 2){
+			ERR("cache on command needs limit parameter.");
+			return true;		// for continue.
+		}
+		size_t	limit		= static_cast<size_t>(atoll(params[1].c_str()));
+		long	watermark	= K2HShm::DEFAULT_CACHE_WATERMARK;
+		if(3 == params.size()){
+			watermark = atol(params[2].c_str());
+		}
+		if(0 == limit || watermark <= 0){
+			ERR("cache on command parameters must be number over 0.");
+			return true;		// for continue.
+		}
+		if(isModeCAPI){
+			if(!k2h_enable_cache(reinterpret_cast<k2h_h>(&k2hash), limit, watermark)){
+				ERR("Something error occurred during enabling cache mode.");
+			}
+		}else{
+			if(!k2hash.EnableCache(limit, watermark)){
+				ERR("Something error occurred during enabling cache mode.");
+			}
+		}
+	}else if(0 == strcasecmp(params[0].c_str(), "off")){
+		if(1 < params.size()){
+			ERR("unknown parameter %s.", params[1].c_str());
+			return true;		// for continue.
+		}
+		if(isModeCAPI){
+			if(!k2h_disable_cache(reinterpret_cast<k2h_h>(&k2hash))){
+				ERR("Something error occurred during disabling cache mode.");
+			}
+		}else{
+			if(!k2hash.DisableCache()){
+				ERR("Something error occurred during disabling cache mode.");
+			}
+		}
+	}else{
+		ERR("unknown parameter %s.", params[0].c_str());
+	}
+	return true;
+}
+
 static bool ShellCommand(void)
 {
 	static const char*	pDefaultShell = "/bin/sh";
@@ -4595,6 +5112,30 @@ static bool CommandStringHandle(K2HShm& k2hash, ConsoleInput& InputIF, const cha
 			CleanOptionMap(opts);
 			return false;
 		}
+	}else if(opts.end() != opts.find("increment") || opts.end() != opts.find("incr")){
+		LapTime	laptime;
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress knownConditionTrueFalse
+		if(!IncrementCommand(k2hash, opts["increment"])){
+			CleanOptionMap(opts);
+			return false;
+		}
+	}else if(opts.end() != opts.find("cas")){
+		LapTime	laptime;
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress knownConditionTrueFalse
+		if(!CompareAndSwapCommand(k2hash, opts["cas"])){
+			CleanOptionMap(opts);
+			return false;
+		}
+	}else if(opts.end() != opts.find("append")){
+		LapTime	laptime;
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress knownConditionTrueFalse
+		if(!AppendCommand(k2hash, opts["append"])){
+			CleanOptionMap(opts);
+			return false;
+		}
 	}else if(opts.end() != opts.find("rm")){
 		LapTime	laptime;
 		// cppcheck-suppress unmatchedSuppression
@@ -4619,6 +5160,14 @@ static bool CommandStringHandle(K2HShm& k2hash, ConsoleInput& InputIF, const cha
 			CleanOptionMap(opts);
 			return false;
 		}
+	}else if(opts.end() != opts.find("reap")){
+		LapTime	laptime;
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress knownConditionTrueFalse
+		if(!ReapCommand(k2hash, opts["reap"])){
+			CleanOptionMap(opts);
+			return false;
+		}
 	}else if(opts.end() != opts.find("print") || opts.end() != opts.find("p")){
 		LapTime	laptime;
 		// cppcheck-suppress unmatchedSuppression
@@ -4732,7 +5281,17 @@ static bool CommandStringHandle(K2HShm& k2hash, ConsoleInput& InputIF, const cha
 			return false;
 		}
 	}else if(opts.end() != opts.find("queue")){
-		if(!QueueCommand(k2hash, opts["queue"])){
+		if(!QueueCommand(k2hash, opts["queue"], K2HLT_QUEUE_NORMAL)){
+			CleanOptionMap(opts);
+			return false;
+		}
+	}else if(opts.end() != opts.find("ringqueue")){
+		if(!QueueCommand(k2hash, opts["ringqueue"], K2HLT_QUEUE_RING)){
+			CleanOptionMap(opts);
+			return false;
+		}
+	}else if(opts.end() != opts.find("shardqueue")){
+		if(!QueueCommand(k2hash, opts["shardqueue"], K2HLT_QUEUE_SHARD)){
 			CleanOptionMap(opts);
 			return false;
 		}
@@ -4769,6 +5328,13 @@ static bool CommandStringHandle(K2HShm& k2hash, ConsoleInput& InputIF, const cha
 			CleanOptionMap(opts);
 			return false;
 		}
+	}else if(opts.end() != opts.find("cache")){
+		// cppcheck-suppress unmatchedSuppression
+		// cppcheck-suppress knownConditionTrueFalse
+		if(!CacheCommand(k2hash, opts["cache"])){
+			CleanOptionMap(opts);
+			return false;
+		}
 	}else if(opts.end() != opts.find("shell") || opts.end() != opts.find("sh")){
 		// cppcheck-suppress unmatchedSuppression
 		// cppcheck-suppress knownConditionTrueFalse
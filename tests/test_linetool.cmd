@@ -471,6 +471,344 @@ p testkey
 printattr testkey
 rm testkey
 
+que cntque push fifo cntvalue1
+que cntque push fifo cntvalue2
+que cntque push lifo cntvalue3
+que cntque count
+que cntque pop fifo
+que cntque count
+que cntque rm fifo 1
+que cntque count
+que cntque pop lifo
+que cntque count
+que cntque empty
+
+que batchque pushbatch fifo batchvalue1 batchvalue2 batchvalue3 batchvalue4
+que batchque count
+que batchque popbatch fifo 3
+que batchque count
+que batchque pushbatch lifo batchvalue5 batchvalue6
+que batchque read fifo 0
+que batchque popbatch fifo 10
+que batchque count
+que batchque popbatch fifo 1
+
+rque ringque push fifo ringvalue1
+rque ringque push fifo ringvalue2
+rque ringque push fifo ringvalue3
+rque ringque count
+rque ringque read fifo 2
+rque ringque read lifo 0
+que ringque count
+rque ringque pop fifo
+rque ringque pushbatch fifo ringvalue4 ringvalue5 ringvalue6
+rque ringque count
+rque ringque rm fifo 2
+rque ringque popbatch fifo 10
+rque ringque empty
+rque ringque push lifo ringvalue7 expire=1
+rque ringque push lifo ringvalue8
+sleep 2
+rque ringque pop lifo
+rque ringque pop lifo
+rque ringque empty
+rque ringque pushbatch fifo ringvalue00-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue01-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue02-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue03-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue04-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue05-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue06-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue07-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue08-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue09-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue10-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue11-abcdefghijklmnopqrstuvwxyz0123456789
+rque ringque pushbatch fifo ringvalue12-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue13-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue14-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue15-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue16-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue17-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue18-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue19-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue20-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue21-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue22-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue23-abcdefghijklmnopqrstuvwxyz0123456789
+rque ringque pushbatch fifo ringvalue24-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue25-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue26-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue27-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue28-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue29-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue30-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue31-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue32-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue33-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue34-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue35-abcdefghijklmnopqrstuvwxyz0123456789
+rque ringque pushbatch fifo ringvalue36-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue37-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue38-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue39-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue40-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue41-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue42-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue43-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue44-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue45-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue46-abcdefghijklmnopqrstuvwxyz0123456789 ringvalue47-abcdefghijklmnopqrstuvwxyz0123456789
+rque ringque count
+rque ringque read fifo 0
+rque ringque read fifo 40
+rque ringque read lifo 0
+rque ringque rm lifo 20
+rque ringque popbatch fifo 12
+rque ringque popbatch lifo 12
+rque ringque count
+
+sque shardque push fifo shardvalue1
+sque shardque push fifo shardvalue2 pass=testpass
+sque shardque pushbatch fifo shardvalue3 shardvalue4 shardvalue5
+sque shardque count
+sque shardque empty
+sque shardque read fifo 0
+sque shardque read lifo 0
+sque shardque read fifo 1 pass=testpass
+sque shardque pop fifo
+sque shardque pop fifo pass=testpass
+sque shardque rm fifo 1
+sque shardque popbatch lifo 5
+sque shardque count
+sque shardque empty
+
+set attrkey attrvalue
+aa attrkey attrname1 attrvalue1
+aa attrkey attrname2 a
+aa attrkey attrname-long-abcdefghijklmnopqrstuvwxyz0123456789 attrvalue-long-abcdefghijklmnopqrstuvwxyz0123456789
+aa attrkey attrname1 attrvalue1-replaced
+pa attrkey
+p attrkey
+setsub attrkey attrchild1 childvalue1
+setsub attrkey attrchild2 null
+setsub attrkey attrchild-long-abcdefghijklmnopqrstuvwxyz0123456789 childvalue3
+setsub attrchild1 attrgrandchild grandchildvalue
+p attrkey all
+pa attrkey
+rmsub attrkey attrchild2
+p attrkey
+rm attrkey all
+p attrchild1
+p attrgrandchild
+
+ba expire=1
+set fastkey1 fastvalue1
+p fastkey1
+sleep 2
+p fastkey1
+p fastkey1 noattrcheck
+cleanallattr
+set fastkey2 fastvalue2 expire=1
+set fastkey3 fastvalue3
+sleep 2
+p fastkey2
+p fastkey3
+ba history
+set histkey histvalue1
+set histkey histvalue2
+p histkey
+cleanallattr
+set enckey encvalue pass=testpass
+p enckey pass=testpass
+p enckey pass=wrongpass
+set enckey encvalue2
+p enckey
+rm fastkey1
+rm fastkey2
+rm fastkey3
+rm histkey
+rm enckey
+
+ba expire=1
+set chainkey1 chainvalue1
+cleanallattr
+set chainkey2 chainvalue2
+sleep 2
+p chainkey1
+p chainkey2
+app chainpass default
+set chainkey3 chainvalue3
+p chainkey3
+cleanallattr
+p chainkey3
+app chainpass
+p chainkey3
+cleanallattr
+ba mtime
+set chainkey4 chainvalue4
+cleanallattr
+set chainkey5 chainvalue5
+printattr chainkey5
+rm chainkey1
+rm chainkey2
+rm chainkey3
+rm chainkey4
+rm chainkey5
+
+set enckey1 encvalue1 pass=testpass
+set enckey2 encvalue2-abcdefghijklmnopqrstuvwxyz0123456789-abcdefghijklmnopqrstuvwxyz0123456789 pass=testpass
+set enckey3 encvalue3 pass=otherpass
+p enckey1 pass=testpass
+p enckey2 pass=testpass
+p enckey3 pass=otherpass
+p enckey3 pass=testpass
+p enckey1
+set enckey1 encvalue1-updated pass=testpass
+p enckey1 pass=testpass
+p enckey1 pass=otherpass
+que encque push fifo encquevalue1 pass=testpass
+que encque push fifo encquevalue2 pass=testpass
+que encque read fifo 1 pass=testpass
+que encque pop fifo pass=testpass
+que encque pop fifo pass=testpass
+rm enckey1
+rm enckey2
+rm enckey3
+
+ba compress=lz4 compmin=16
+set compkey1 compvalue1
+set compkey2 compvalue2-aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa
+p compkey1
+p compkey2
+set compkey2 compvalue2-bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb
+p compkey2
+ba compress=zstd
+set compkey3 compvalue3-cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc pass=testpass
+p compkey3 pass=testpass
+p compkey3
+que compque push fifo compquevalue-dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd
+que compque pop fifo
+ba compress=no
+p compkey2
+set compkey4 compvalue4-eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee
+p compkey4
+cleanallattr
+p compkey2
+rm compkey1
+rm compkey2
+rm compkey3
+rm compkey4
+
+set reapkey1 reapvalue1 expire=1
+set reapkey2 reapvalue2 expire=1
+set reapkey3 reapvalue3 expire=100
+ba expire=1
+set reapkey4 reapvalue4
+cleanallattr
+sleep 11
+reap 1000
+p reapkey1 noattrcheck
+p reapkey2 noattrcheck
+p reapkey4 noattrcheck
+p reapkey3
+reap
+rm reapkey3
+
+cache on 1000000000
+fill cachekey cachevalue 5
+p cachekey-0
+p cachekey-4
+cache off
+cache on 1 100000
+fill evictkey evictvalue 5
+p evictkey-0
+p evictkey-3
+p evictkey-4
+p cachekey-0
+set evictkey-5 evictvalue
+p evictkey-5
+cache off
+fill cachekey cachevalue 5
+p cachekey-0
+p cachekey-4
+rm cachekey-0
+rm cachekey-1
+rm cachekey-2
+rm cachekey-3
+rm cachekey-4
+rm evictkey-5
+
+incr cntkey 5
+incr cntkey 10
+increment cntkey -10
+incr cntkey 0
+dp cntkey 8 0
+set strcntkey strvalue
+incr strcntkey 1
+cas caskey null casvalue1
+p caskey
+cas caskey null casvalue2
+cas caskey casvalue2 casvalue3
+p caskey
+cas caskey casvalue1 casvalue3
+p caskey
+cas caskey casvalue3 casvalue4
+p caskey
+append appkey abc
+append appkey defgh
+dp appkey 8 0
+set appkey2 abc
+append appkey2 def
+dp appkey2 7 0
+rm cntkey
+rm strcntkey
+rm caskey
+rm appkey
+rm appkey2
+
+set ipkey ipvalue1
+set ipkey ipvalue2
+p ipkey
+set ipkey ipv3
+p ipkey
+set ipkey inplace-abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789
+p ipkey
+set ipkey INPLACE-ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789
+p ipkey
+set ipkey ipvalue4
+p ipkey
+set ipkey null
+p ipkey
+set ipkey ipvalue5
+aa ipkey ipattr ipattrvalue
+set ipkey ipvalue6
+p ipkey
+pa ipkey
+set ipkey ipvalue7 pass=testpass
+p ipkey pass=testpass
+set ipkey inplace-abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789 pass=testpass
+p ipkey pass=testpass
+setsub ipkey ipchild ipchildvalue
+set ipkey ipvalue8 rmsub
+p ipkey
+p ipchild
+rm ipkey
+
+fillsub skdir sk skval 1030
+setsub skdir sk-new newvalue
+rmsub skdir sk-5
+rmsub skdir sk-1029
+rmsub skdir sk-nosuch
+p sk-5
+p sk-1029
+p sk-100
+p skdir
+rm skdir all
+p skdir
+p sk-100
+p sk-new
+
+que deepque pushbatch fifo dq000 dq001 dq002 dq003 dq004 dq005 dq006 dq007 dq008 dq009 dq010 dq011 dq012
+que deepque pushbatch fifo dq013 dq014 dq015 dq016 dq017 dq018 dq019 dq020 dq021 dq022 dq023 dq024 dq025
+que deepque pushbatch fifo dq026 dq027 dq028 dq029 dq030 dq031 dq032 dq033 dq034 dq035 dq036 dq037 dq038
+que deepque pushbatch fifo dq039 dq040 dq041 dq042 dq043 dq044 dq045 dq046 dq047 dq048 dq049 dq050 dq051
+que deepque pushbatch fifo dq052 dq053 dq054 dq055 dq056 dq057 dq058 dq059 dq060 dq061 dq062 dq063 dq064
+que deepque pushbatch fifo dq065 dq066 dq067 dq068 dq069 dq070 dq071 dq072 dq073 dq074 dq075 dq076 dq077
+que deepque pushbatch fifo dq078 dq079 dq080 dq081 dq082 dq083 dq084 dq085 dq086 dq087 dq088 dq089 dq090
+que deepque pushbatch fifo dq091 dq092 dq093 dq094 dq095 dq096 dq097 dq098 dq099 dq100 dq101 dq102 dq103
+que deepque pushbatch fifo dq104 dq105 dq106 dq107 dq108 dq109 dq110 dq111 dq112 dq113 dq114 dq115 dq116
+que deepque pushbatch fifo dq117 dq118 dq119 dq120 dq121 dq122 dq123 dq124 dq125 dq126 dq127 dq128 dq129
+que deepque pushbatch fifo dq130 dq131 dq132 dq133 dq134 dq135 dq136 dq137 dq138 dq139 dq140 dq141 dq142
+que deepque count
+que deepque read fifo 0
+que deepque read fifo 70
+que deepque read fifo 130
+que deepque read fifo 139
+que deepque read fifo 140
+que deepque read lifo 100
+que deepque popbatch fifo 10
+que deepque read fifo 70
+que deepque read fifo 129
+que deepque push lifo dqtop
+que deepque read fifo 0
+que deepque read fifo 71
+que deepque rm fifo 65
+que deepque count
+que deepque read fifo 0
+que deepque read fifo 64
+que deepque read fifo 65
+que deepque rm fifo 100
+que deepque empty
+
+que waitque push fifo waitvalue1
+que waitque push fifo waitvalue2
+que waitque popwait fifo 1000
+que waitque popwait lifo 0
+que waitque popwait fifo 100
+que waitque count
+rque waitque push fifo waitvalue3
+rque waitque popwait fifo 100
+rque waitque popwait fifo 100
+rque waitque empty
+
 ###### exit
 exit
 
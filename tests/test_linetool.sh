@@ -85,11 +85,11 @@ rm -f "${K2HFILE}" "${LOGFILE}"
 	fi
 
 	#----------------------------------------------------------
-	# tmp file type test
+	# tmp file type test(encrypt type is AES256 GCM)
 	#----------------------------------------------------------
 	rm -f "${K2HFILE}"
 
-	if ! "${LINETOOL}" -t "${K2HFILE}" -mask 4 -cmask 2 -elementcnt 32 -pagesize 128 -fullmap -run "${CMDFILE}"; then
+	if ! K2HATTR_ENC_TYPE=AES256_GCM "${LINETOOL}" -t "${K2HFILE}" -mask 4 -cmask 2 -elementcnt 32 -pagesize 128 -fullmap -run "${CMDFILE}"; then
 		exit 1
 	fi
 
@@ -102,6 +102,15 @@ rm -f "${K2HFILE}" "${LOGFILE}"
 		exit 1
 	fi
 
+	#----------------------------------------------------------
+	# file type test(not full mapping)
+	#----------------------------------------------------------
+	rm -f "${K2HFILE}"
+
+	if ! "${LINETOOL}" -f "${K2HFILE}" -mask 4 -cmask 2 -elementcnt 32 -pagesize 128 -run "${CMDFILE}"; then
+		exit 1
+	fi
+
 	#----------------------------------------------------------
 	# test for direct save/load
 	#----------------------------------------------------------